@@ -0,0 +1,651 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+// Benchmarks the AudioCapture conversion kernels and the specialized frame
+// converters against the original per-sample switch loop, the resamplers
+// against the original double-precision linear interpolator, and the copy the
+// passthrough path saves, and the FLAC encoder behind AudioFlacSink with its
+// autocorrelation kernels. --sweep runs the frame converters for every format
+// and channel count and the linear resampler for every rate over 64 to 8192
+// frame buffers, reporting ns, bytes and, on x86, cycles per frame; --json
+// prints the same as JSON for comparing runs and sizing capture hosts. Only
+// needs the C++ standard library, so besides the Haiku makefile it also
+// builds on other hosts with the root CMakeLists.txt. AudioCapture itself,
+// fed by synthetic devices, is measured by host/CaptureBenchmark.
+
+#include <chrono>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "AudioConvert.h"
+#include "AudioFlac.h"
+#include "AudioResampler.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <x86intrin.h>
+#define BENCHMARK_CYCLE_COUNTER 1
+#endif
+
+static const double kMinRunSeconds = 0.2;
+// The sweep measures a lot more cases, each for a shorter time
+static const double kSweepRunSeconds = 0.05;
+// AudioFlacSink's default
+static const size_t kFlacBenchmarkBlockSize = 4096;
+
+static const char* kSampleTypeNames[SAMPLE_TYPE_COUNT] = {
+    "float", "int32", "int16", "int8", "uint8"
+};
+
+struct RateConversion {
+    double inputRate;
+    double outputRate;
+};
+
+static const RateConversion kRateConversions[] = {
+    { 44100, 48000 },
+    { 48000, 44100 },
+    { 48000, 16000 },
+    { 96000, 48000 }
+};
+
+
+// The conversion loop AudioCapture::processData used before the kernels
+static void
+referenceConvert(float* out, const void* data, size_t frameCount,
+    uint32_t inputChannels, SampleType type)
+{
+    const size_t bytesPerSample = sampleTypeSize(type);
+    const size_t inputFrameSize = inputChannels * bytesPerSample;
+    const char* inputData = static_cast<const char*>(data);
+
+    for (size_t i = 0; i < frameCount; ++i) {
+        float left = 0.0f, right = 0.0f;
+        const void* framePtr = inputData + i * inputFrameSize;
+
+        switch (type) {
+            case SAMPLE_FLOAT: left = static_cast<const float*>(framePtr)[0]; break;
+            case SAMPLE_INT32: left = static_cast<const int32_t*>(framePtr)[0] / 2147483648.0f; break;
+            case SAMPLE_INT16: left = static_cast<const int16_t*>(framePtr)[0] / 32768.0f; break;
+            case SAMPLE_UINT8: left = (static_cast<int16_t>(static_cast<const uint8_t*>(framePtr)[0]) - 128) / 128.0f; break;
+            case SAMPLE_INT8:  left = static_cast<const int8_t*>(framePtr)[0] / 128.0f; break;
+            default: left = 0.0f; break;
+        }
+        if (inputChannels >= 2) {
+            const void* sample2Ptr = static_cast<const char*>(framePtr) + bytesPerSample;
+            switch (type) {
+                case SAMPLE_FLOAT: right = static_cast<const float*>(sample2Ptr)[0]; break;
+                case SAMPLE_INT32: right = static_cast<const int32_t*>(sample2Ptr)[0] / 2147483648.0f; break;
+                case SAMPLE_INT16: right = static_cast<const int16_t*>(sample2Ptr)[0] / 32768.0f; break;
+                case SAMPLE_UINT8: right = (static_cast<int16_t>(static_cast<const uint8_t*>(sample2Ptr)[0]) - 128) / 128.0f; break;
+                case SAMPLE_INT8:  right = static_cast<const int8_t*>(sample2Ptr)[0] / 128.0f; break;
+                default: right = 0.0f; break;
+            }
+        } else {
+            right = left;
+        }
+        out[i * 2 + 0] = left;
+        out[i * 2 + 1] = right;
+    }
+}
+
+
+static void
+kernelConvert(float* out, const void* data, size_t frameCount,
+    uint32_t inputChannels, SampleConvertFunc convert)
+{
+    if (inputChannels == 2) {
+        convert(out, data, frameCount * 2);
+    } else {
+        convert(out + frameCount, data, frameCount);
+        expandMonoToStereo(out, out + frameCount, frameCount);
+    }
+}
+
+
+// The stereo resampler AudioCapture used before LinearResampler
+static size_t
+referenceResample(float* outBuffer, const float* inBuffer, size_t inFrameCount,
+    double ratio, double& inputBufferOffset)
+{
+    size_t outFrameCount = 0;
+    double currentInputPos = inputBufferOffset;
+
+    while (true) {
+        size_t index1 = static_cast<size_t>(floor(currentInputPos));
+        double alpha = currentInputPos - index1;
+        if (index1 + 1 >= inFrameCount)
+            break;
+
+        const float* sample1Pair = &inBuffer[index1 * 2];
+        const float* sample2Pair = &inBuffer[(index1 + 1) * 2];
+        outBuffer[outFrameCount * 2 + 0] = static_cast<float>(sample1Pair[0] * (1.0 - alpha) + sample2Pair[0] * alpha);
+        outBuffer[outFrameCount * 2 + 1] = static_cast<float>(sample1Pair[1] * (1.0 - alpha) + sample2Pair[1] * alpha);
+        outFrameCount++;
+
+        currentInputPos += ratio;
+    }
+
+    inputBufferOffset = fmax(0.0, currentInputPos - inFrameCount);
+    return outFrameCount;
+}
+
+
+static void
+fillRandom(std::vector<uint8_t>& buffer, SampleType type)
+{
+    if (type == SAMPLE_FLOAT) {
+        float* samples = reinterpret_cast<float*>(buffer.data());
+        for (size_t i = 0; i < buffer.size() / sizeof(float); i++)
+            samples[i] = rand() / (float)RAND_MAX * 2.0f - 1.0f;
+        return;
+    }
+    for (size_t i = 0; i < buffer.size(); i++)
+        buffer[i] = static_cast<uint8_t>(rand());
+}
+
+
+// Time stamp counter ticks, which count at the nominal clock of the CPU
+// rather than the current one, so a core running below or above it shows
+// more or fewer cycles than it actually spent. Not available elsewhere.
+static bool
+haveCycleCounter()
+{
+#ifdef BENCHMARK_CYCLE_COUNTER
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+static uint64_t
+readCycleCounter()
+{
+#ifdef BENCHMARK_CYCLE_COUNTER
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+
+// Returns the average time per frame of repeated calls to func, which
+// processes frameCount frames, and the cycles per frame if there is a
+// counter for them
+template<typename Func>
+static double
+measureNsPerFrame(size_t frameCount, Func func, double runSeconds = kMinRunSeconds,
+    double* cyclesPerFrame = NULL)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    // Warm up caches and let the CPU clock settle
+    for (int i = 0; i < 16; i++)
+        func();
+
+    size_t iterations = 0;
+    const uint64_t startCycles = readCycleCounter();
+    Clock::time_point start = Clock::now();
+    double elapsed = 0.0;
+    do {
+        for (int i = 0; i < 64; i++)
+            func();
+        iterations += 64;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (elapsed < runSeconds);
+
+    const double frames = static_cast<double>(iterations) * frameCount;
+    if (cyclesPerFrame != NULL)
+        *cyclesPerFrame = (readCycleCounter() - startCycles) / frames;
+    return elapsed * 1e9 / frames;
+}
+
+
+static void
+benchmarkConversion(size_t frameCount)
+{
+    printf("Best kernel ISA: %s, %zu frames per buffer\n\n",
+        sampleKernelISAName(bestSampleKernelISA()), frameCount);
+    printf("%-6s %-3s %-7s %12s %9s %10s\n", "format", "ch", "kernel",
+        "ns/frame", "speedup", "max error");
+
+    std::vector<float> expected(frameCount * 2);
+    std::vector<float> output(frameCount * 2);
+
+    for (int type = 0; type < SAMPLE_TYPE_COUNT; type++) {
+        SampleType sampleType = static_cast<SampleType>(type);
+        static const uint32_t kChannelCounts[] = { 1, 2, 6 };
+        for (size_t n = 0; n < sizeof(kChannelCounts) / sizeof(kChannelCounts[0]); n++) {
+            const uint32_t channels = kChannelCounts[n];
+            std::vector<uint8_t> input(frameCount * channels * sampleTypeSize(sampleType));
+            fillRandom(input, sampleType);
+
+            referenceConvert(expected.data(), input.data(), frameCount, channels, sampleType);
+            double referenceNs = measureNsPerFrame(frameCount, [&]() {
+                referenceConvert(output.data(), input.data(), frameCount, channels, sampleType);
+            });
+            printf("%-6s %-3u %-7s %12.3f %9s %10s\n", kSampleTypeNames[type],
+                channels, "legacy", referenceNs, "1.00x", "-");
+
+            FrameConvertFunc frameConvert = getFrameConverter(sampleType, channels);
+            memset(output.data(), 0, output.size() * sizeof(float));
+            frameConvert(output.data(), input.data(), frameCount, channels);
+            float frameError = 0.0f;
+            for (size_t i = 0; i < output.size(); i++)
+                frameError = fmaxf(frameError, fabsf(output[i] - expected[i]));
+            double frameNs = measureNsPerFrame(frameCount, [&]() {
+                frameConvert(output.data(), input.data(), frameCount, channels);
+            });
+            printf("%-6s %-3u %-7s %12.3f %8.2fx %10.3g\n", kSampleTypeNames[type],
+                channels, "frames", frameNs, referenceNs / frameNs, frameError);
+
+            // The raw kernels only cover the layouts they can convert directly
+            for (int isa = 0; channels <= 2 && isa < SAMPLE_KERNEL_ISA_COUNT; isa++) {
+                SampleConvertFunc convert = getSampleConverter(sampleType,
+                    static_cast<SampleKernelISA>(isa));
+                if (convert == NULL)
+                    continue;
+
+                memset(output.data(), 0, output.size() * sizeof(float));
+                kernelConvert(output.data(), input.data(), frameCount, channels, convert);
+                float maxError = 0.0f;
+                for (size_t i = 0; i < output.size(); i++)
+                    maxError = fmaxf(maxError, fabsf(output[i] - expected[i]));
+
+                double ns = measureNsPerFrame(frameCount, [&]() {
+                    kernelConvert(output.data(), input.data(), frameCount, channels, convert);
+                });
+                printf("%-6s %-3u %-7s %12.3f %8.2fx %10.3g\n", kSampleTypeNames[type],
+                    channels, sampleKernelISAName(static_cast<SampleKernelISA>(isa)),
+                    ns, referenceNs / ns, maxError);
+            }
+        }
+    }
+}
+
+
+static void
+benchmarkResampling(size_t frameCount)
+{
+    static const struct {
+        const char*      name;
+        ResamplerQuality quality;
+    } kResamplers[] = {
+        { "linear", RESAMPLER_LINEAR },
+        { "sinc-fast", RESAMPLER_SINC_FAST },
+        { "sinc-medium", RESAMPLER_SINC_MEDIUM },
+        { "sinc-best", RESAMPLER_SINC_BEST }
+    };
+
+    printf("\nStereo resampling, %zu input frames per buffer\n\n", frameCount);
+    printf("%-13s %-11s %12s %12s %9s %10s\n", "rate", "resampler",
+        "ns/frame", "Mframes/s", "speedup", "max error");
+
+    std::vector<float> input(frameCount * 2);
+    for (size_t i = 0; i < frameCount; i++) {
+        input[i * 2 + 0] = sinf(i * 0.01f);
+        input[i * 2 + 1] = cosf(i * 0.013f);
+    }
+
+    for (size_t r = 0; r < sizeof(kRateConversions) / sizeof(kRateConversions[0]); r++) {
+        const RateConversion& rates = kRateConversions[r];
+        const double ratio = rates.inputRate / rates.outputRate;
+        char rateName[32];
+        snprintf(rateName, sizeof(rateName), "%.1fk>%.1fk", rates.inputRate / 1000,
+            rates.outputRate / 1000);
+
+        std::vector<float> expected(static_cast<size_t>(frameCount / ratio + 8) * 2);
+        std::vector<float> output;
+
+        double offset = 0.0;
+        const size_t expectedFrames = referenceResample(expected.data(), input.data(),
+            frameCount, ratio, offset);
+        double referenceNs = measureNsPerFrame(frameCount, [&]() {
+            referenceResample(expected.data(), input.data(), frameCount, ratio, offset);
+        });
+        printf("%-13s %-11s %12.3f %12.1f %9s %10s\n", rateName, "legacy",
+            referenceNs, 1e3 / referenceNs, "1.00x", "-");
+
+        for (size_t k = 0; k < sizeof(kResamplers) / sizeof(kResamplers[0]); k++) {
+            AudioResampler* resampler = AudioResampler::Create(kResamplers[k].quality, 2,
+                rates.inputRate, rates.outputRate);
+            if (resampler == NULL)
+                continue;
+
+            const size_t maxFrames = resampler->MaxOutputFrames(frameCount);
+            output.resize(maxFrames * 2);
+
+            // Only the linear resampler is expected to reproduce the old output
+            char error[16] = "-";
+            if (kResamplers[k].quality == RESAMPLER_LINEAR) {
+                const size_t frames = resampler->Process(output.data(), maxFrames,
+                    input.data(), frameCount);
+                float maxError = frames == expectedFrames ? 0.0f : INFINITY;
+                for (size_t i = 0; i < expectedFrames * 2 && i < frames * 2; i++)
+                    maxError = fmaxf(maxError, fabsf(output[i] - expected[i]));
+                snprintf(error, sizeof(error), "%.3g", maxError);
+            }
+
+            double ns = measureNsPerFrame(frameCount, [&]() {
+                resampler->Process(output.data(), maxFrames, input.data(), frameCount);
+            });
+            printf("%-13s %-11s %12.3f %12.1f %8.2fx %10s\n", rateName,
+                kResamplers[k].name, ns, 1e3 / ns, referenceNs / ns, error);
+            delete resampler;
+        }
+    }
+}
+
+
+// A float stereo device at the output rate used to be copied into the
+// conversion buffer before the callback saw it. Passthrough hands the device
+// buffer over directly. Both end in a copy into a ring buffer sized block.
+static void
+benchmarkPassthrough(size_t frameCount)
+{
+    printf("\nFloat stereo delivery, %zu frames per buffer\n\n", frameCount);
+    printf("%-12s %12s %9s %12s %12s\n", "path", "ns/frame", "speedup",
+        "bytes/frame", "GB/s moved");
+
+    std::vector<uint8_t> input(frameCount * 2 * sizeof(float));
+    fillRandom(input, SAMPLE_FLOAT);
+    std::vector<float> converted(frameCount * 2);
+    std::vector<float> ring(frameCount * 2);
+    const float* device = reinterpret_cast<const float*>(input.data());
+    FrameConvertFunc frameConvert = getFrameConverter(SAMPLE_FLOAT, 2);
+
+    auto consume = [&](const float* frames) {
+        memcpy(ring.data(), frames, frameCount * 2 * sizeof(float));
+    };
+
+    // Bytes read plus bytes written per frame
+    const double copyBytes = 4 * 2 * sizeof(float);
+    const double passthroughBytes = 2 * 2 * sizeof(float);
+
+    double copyNs = measureNsPerFrame(frameCount, [&]() {
+        frameConvert(converted.data(), device, frameCount, 2);
+        consume(converted.data());
+    });
+    printf("%-12s %12.3f %9s %12.0f %12.2f\n", "copy", copyNs, "1.00x", copyBytes,
+        copyBytes / copyNs);
+
+    double passthroughNs = measureNsPerFrame(frameCount, [&]() {
+        consume(device);
+    });
+    printf("%-12s %12.3f %8.2fx %12.0f %12.2f\n", "passthrough", passthroughNs,
+        copyNs / passthroughNs, passthroughBytes, passthroughBytes / passthroughNs);
+
+    printf("\nSaved per second of 48 kHz stereo: %.2f MB, %.3f ms of CPU time\n",
+        48000 * (copyBytes - passthroughBytes) / 1e6, 48000 * (copyNs - passthroughNs) / 1e6);
+}
+
+
+// Music-like stereo at 48 kHz: a few partials per channel, partly shared,
+// over a noise floor, as full scale integers of bitsPerSample
+static void
+fillMusic(std::vector<int32_t>& samples, size_t frameCount, uint32_t bitsPerSample)
+{
+    const double scale = (1 << (bitsPerSample - 1)) - 1;
+    samples.resize(frameCount * 2);
+    for (size_t f = 0; f < frameCount; f++) {
+        const double t = f / 48000.0;
+        const double shared = 0.3 * sin(2 * M_PI * 220.0 * t) + 0.15 * sin(2 * M_PI * 661.0 * t);
+        const double left = shared + 0.1 * sin(2 * M_PI * 1490.0 * t);
+        const double right = shared + 0.1 * sin(2 * M_PI * 2210.0 * t);
+        const double noise = 1e-3 * (rand() / (double)RAND_MAX - 0.5);
+        samples[f * 2] = static_cast<int32_t>(lrint((left + noise) * scale));
+        samples[f * 2 + 1] = static_cast<int32_t>(lrint((right + noise) * scale));
+    }
+}
+
+
+// The autocorrelation LPC analysis runs per channel and block, and a whole
+// block per encoder call, which is what one AudioFlacSink encoder thread does
+static void
+benchmarkFlac()
+{
+    const size_t blockSize = kFlacBenchmarkBlockSize;
+    const uint32_t lagCount = kFlacDefaultLPCOrder + 1;
+
+    printf("\nFLAC autocorrelation, %zu samples, %u lags\n\n", blockSize, lagCount);
+    printf("%-8s %12s %9s\n", "kernel", "ns/sample", "speedup");
+
+    std::vector<float> signal(blockSize);
+    for (size_t i = 0; i < blockSize; i++)
+        signal[i] = static_cast<float>(rand() % 65536 - 32768);
+    double autocorrelation[kFlacMaxLPCOrder + 1];
+
+    double scalarNs = 0.0;
+    for (int isa = SAMPLE_KERNEL_SCALAR; isa < SAMPLE_KERNEL_ISA_COUNT; isa++) {
+        FlacAutocorrelationFunc kernel = getFlacAutocorrelation(static_cast<SampleKernelISA>(isa));
+        if (kernel == NULL)
+            continue;
+        const double ns = measureNsPerFrame(blockSize, [&]() {
+            kernel(autocorrelation, signal.data(), blockSize, lagCount);
+        });
+        if (isa == SAMPLE_KERNEL_SCALAR)
+            scalarNs = ns;
+        printf("%-8s %12.3f %8.2fx\n", sampleKernelISAName(static_cast<SampleKernelISA>(isa)), ns,
+            scalarNs / ns);
+    }
+
+    printf("\nFLAC encoding, 48 kHz stereo, %zu frame blocks, one thread\n\n", blockSize);
+    printf("%-6s %12s %10s %10s %10s\n", "bits", "ns/frame", "realtime", "vs PCM", "vs float");
+    for (uint32_t bits : {16u, 24u}) {
+        std::vector<int32_t> samples;
+        fillMusic(samples, blockSize * 16, bits);
+
+        FlacFrameEncoder encoder;
+        encoder.Init(2, bits, 48000, blockSize);
+        std::vector<uint8_t> output(encoder.MaxFrameSize());
+        size_t encodedBytes = 0;
+        for (size_t b = 0; b < 16; b++)
+            encodedBytes += encoder.Encode(output.data(), &samples[b * blockSize * 2], blockSize, b);
+
+        uint32_t number = 0;
+        const double ns = measureNsPerFrame(blockSize, [&]() {
+            const size_t b = number % 16;
+            encoder.Encode(output.data(), &samples[b * blockSize * 2], blockSize, number++);
+        });
+        const double frames = blockSize * 16.0;
+        printf("%-6u %12.3f %9.0fx %10.3f %10.3f\n", bits, ns, 1e9 / (48000 * ns),
+            encodedBytes / (frames * 2 * bits / 8), encodedBytes / (frames * 2 * sizeof(float)));
+    }
+}
+
+// One measurement of the sweep. Conversions have no rates, resampling is
+// always from float frames.
+struct SweepResult {
+    const char* kind;
+    SampleType  format;
+    uint32_t    inputChannels;
+    uint32_t    outputChannels;
+    double      inputRate;
+    double      outputRate;
+    size_t      frames;
+    double      nsPerFrame;
+    double      bytesPerSecond;
+    double      cyclesPerFrame;
+};
+
+static const size_t kSweepMinFrames = 64;
+static const size_t kSweepMaxFrames = 8192;
+
+
+// Every device format and channel count through the converter processData()
+// binds for it, into the device layout and into the default stereo one
+static void
+sweepConversion(std::vector<SweepResult>& results)
+{
+    static const uint32_t kChannelCounts[] = { 1, 2, 4, 6, 8 };
+
+    std::vector<uint8_t> input(kSweepMaxFrames * 8 * sizeof(int32_t));
+    std::vector<float> output(kSweepMaxFrames * 8);
+
+    for (int type = 0; type < SAMPLE_TYPE_COUNT; type++) {
+        const SampleType sampleType = static_cast<SampleType>(type);
+        fillRandom(input, sampleType);
+        for (size_t n = 0; n < sizeof(kChannelCounts) / sizeof(kChannelCounts[0]); n++) {
+            const uint32_t channels = kChannelCounts[n];
+            for (int layout = 0; layout < 2; layout++) {
+                const uint32_t outputChannels = layout == 0 ? channels : 2;
+                if (layout == 1 && channels == 2)
+                    continue;
+                FrameConvertFunc convert = getFrameConverter(sampleType, channels, outputChannels);
+                if (convert == NULL)
+                    continue;
+
+                // Device samples read plus float samples written
+                const double bytesPerFrame = channels * sampleTypeSize(sampleType)
+                    + outputChannels * sizeof(float);
+                for (size_t frames = kSweepMinFrames; frames <= kSweepMaxFrames; frames *= 2) {
+                    SweepResult result = { "convert", sampleType, channels, outputChannels, 0, 0,
+                        frames, 0, 0, 0 };
+                    result.nsPerFrame = measureNsPerFrame(frames, [&]() {
+                        convert(output.data(), input.data(), frames, channels);
+                    }, kSweepRunSeconds, &result.cyclesPerFrame);
+                    result.bytesPerSecond = bytesPerFrame * 1e9 / result.nsPerFrame;
+                    results.push_back(result);
+                }
+            }
+        }
+    }
+}
+
+
+// The linear resampler on stereo float frames, timed per input frame
+static void
+sweepResampling(std::vector<SweepResult>& results)
+{
+    std::vector<float> input(kSweepMaxFrames * 2);
+    for (size_t i = 0; i < kSweepMaxFrames; i++) {
+        input[i * 2 + 0] = sinf(i * 0.01f);
+        input[i * 2 + 1] = cosf(i * 0.013f);
+    }
+    std::vector<float> output;
+
+    for (size_t r = 0; r < sizeof(kRateConversions) / sizeof(kRateConversions[0]); r++) {
+        const RateConversion& rates = kRateConversions[r];
+        AudioResampler* resampler = AudioResampler::Create(RESAMPLER_LINEAR, 2, rates.inputRate,
+            rates.outputRate);
+        if (resampler == NULL)
+            continue;
+
+        const size_t maxFrames = resampler->MaxOutputFrames(kSweepMaxFrames);
+        output.resize(maxFrames * 2);
+        // Input frames read plus the output frames written for them
+        const double bytesPerFrame = 2 * sizeof(float) * (1.0 + rates.outputRate / rates.inputRate);
+        for (size_t frames = kSweepMinFrames; frames <= kSweepMaxFrames; frames *= 2) {
+            SweepResult result = { "resample", SAMPLE_FLOAT, 2, 2, rates.inputRate,
+                rates.outputRate, frames, 0, 0, 0 };
+            result.nsPerFrame = measureNsPerFrame(frames, [&]() {
+                resampler->Process(output.data(), maxFrames, input.data(), frames);
+            }, kSweepRunSeconds, &result.cyclesPerFrame);
+            result.bytesPerSecond = bytesPerFrame * 1e9 / result.nsPerFrame;
+            results.push_back(result);
+        }
+        delete resampler;
+    }
+}
+
+
+static void
+printSweepTable(const std::vector<SweepResult>& results)
+{
+    printf("Sweep over %zu to %zu frame buffers, best kernel ISA: %s\n\n", kSweepMinFrames,
+        kSweepMaxFrames, sampleKernelISAName(bestSampleKernelISA()));
+    printf("%-8s %-6s %-13s %6s %12s %12s %13s\n", "kind", "format", "layout", "frames",
+        "ns/frame", "MB/s", "cycles/frame");
+
+    for (size_t i = 0; i < results.size(); i++) {
+        const SweepResult& result = results[i];
+        char layout[32];
+        if (result.inputRate > 0) {
+            snprintf(layout, sizeof(layout), "%.1fk>%.1fk", result.inputRate / 1000,
+                result.outputRate / 1000);
+        } else {
+            snprintf(layout, sizeof(layout), "%u>%u", result.inputChannels, result.outputChannels);
+        }
+        char cycles[16] = "-";
+        if (haveCycleCounter())
+            snprintf(cycles, sizeof(cycles), "%.2f", result.cyclesPerFrame);
+        printf("%-8s %-6s %-13s %6zu %12.3f %12.1f %13s\n", result.kind,
+            kSampleTypeNames[result.format], layout, result.frames, result.nsPerFrame,
+            result.bytesPerSecond / 1e6, cycles);
+    }
+}
+
+
+// All names written are fixed identifiers, nothing needs escaping
+static void
+printSweepJSON(const std::vector<SweepResult>& results)
+{
+    printf("{\n");
+    printf("  \"isa\": \"%s\",\n", sampleKernelISAName(bestSampleKernelISA()));
+    printf("  \"cycle_counter\": %s,\n", haveCycleCounter() ? "\"tsc\"" : "null");
+    printf("  \"run_seconds\": %g,\n", kSweepRunSeconds);
+    printf("  \"results\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const SweepResult& result = results[i];
+        printf("    {\"kind\": \"%s\", \"format\": \"%s\", \"input_channels\": %u, "
+            "\"output_channels\": %u, ", result.kind, kSampleTypeNames[result.format],
+            result.inputChannels, result.outputChannels);
+        if (result.inputRate > 0) {
+            printf("\"resampler\": \"linear\", \"input_rate\": %.0f, \"output_rate\": %.0f, ",
+                result.inputRate, result.outputRate);
+        }
+        printf("\"frames\": %zu, \"ns_per_frame\": %.4f, \"bytes_per_second\": %.0f, ",
+            result.frames, result.nsPerFrame, result.bytesPerSecond);
+        if (haveCycleCounter())
+            printf("\"cycles_per_frame\": %.3f}", result.cyclesPerFrame);
+        else
+            printf("\"cycles_per_frame\": null}");
+        printf("%s\n", i + 1 < results.size() ? "," : "");
+    }
+    printf("  ]\n}\n");
+}
+
+
+int
+main(int argc, char** argv)
+{
+    size_t frameCount = 4096;
+    bool sweep = false;
+    bool json = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--sweep") == 0)
+            sweep = true;
+        else if (strcmp(argv[i], "--json") == 0)
+            sweep = json = true;
+        else
+            frameCount = strtoul(argv[i], NULL, 10);
+    }
+    if (frameCount == 0) {
+        fprintf(stderr, "Usage: %s [frames] [--sweep | --json]\n", argv[0]);
+        return 1;
+    }
+
+    // The sweep picks its own buffer sizes and, as JSON, is meant for scripts
+    // comparing runs, so it prints nothing else
+    if (sweep) {
+        std::vector<SweepResult> results;
+        sweepConversion(results);
+        sweepResampling(results);
+        if (json)
+            printSweepJSON(results);
+        else
+            printSweepTable(results);
+        return 0;
+    }
+
+    benchmarkConversion(frameCount);
+    benchmarkResampling(frameCount);
+    benchmarkPassthrough(frameCount);
+    benchmarkFlac();
+    return 0;
+}
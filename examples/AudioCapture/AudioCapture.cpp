@@ -11,9 +11,9 @@
 #include "AudioCapture.h"
 
 void
-myAudioCallback(const float* stereoData, size_t frameCount, void* userData)
+myAudioCallback(const float* data, size_t frameCount, uint32 channelCount, void* userData)
 {
-    printf("Callback: Received %zu stereo frames. UserData ptr: %p\n", frameCount, userData);
+    printf("Callback: Received %zu frames of %u channels. UserData ptr: %p\n", frameCount, channelCount, userData);
 }
 
 int main()
@@ -44,7 +44,8 @@ int main()
     }
 
     if (capture.IsRunning()) {
-        printf("Capture running for 5 seconds...\n");
+        printf("Capture running for 5 seconds (%s)...\n",
+            capture.IsPassthrough() ? "passthrough" : "converting");
         snooze(1 * 1000 * 1000);
     } else {
          fprintf(stderr, "Capture did not start correctly.\n");
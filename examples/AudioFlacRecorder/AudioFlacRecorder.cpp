@@ -0,0 +1,79 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#include "AudioCapture.h"
+#include "AudioFlacSink.h"
+
+#include <Application.h>
+#include <OS.h>
+
+#include <stdio.h>
+
+
+int main() {
+    BApplication app("application/x-vnd.my-audio-flac-recorder-test");
+
+    float fileSampleRate = 48000.0f;
+
+    printf("Creating AudioCapture...\n");
+    // No callback: the FLAC sink is fed straight from the capture thread
+    AudioCapture capture(NULL, NULL, 0.0f, "Example");
+
+    if (capture.Status() != B_OK) {
+        fprintf(stderr, "Failed to initialize AudioCapture: %s\n", strerror(capture.Status()));
+        return 1;
+    }
+
+    float deviceSampleRate = capture.DeviceSampleRate();
+    uint32 inputChannels = capture.InputChannelCount();
+    printf("Device Info - Rate: %.1f Hz, Input Channels: %u\n", deviceSampleRate, inputChannels);
+
+    const char* outputFilename = "output.flac";
+    AudioFlacSink flacSink;
+    // 24 bits, one encoder thread per CPU
+    status_t openStatus = flacSink.Open(outputFilename, 2, fileSampleRate, 24);
+    if (openStatus != B_OK) {
+        fprintf(stderr, "Failed to open FLAC file %s: %s\n", outputFilename, strerror(openStatus));
+        return 1;
+    }
+    int32 sinkId = flacSink.AttachTo(capture);
+    if (sinkId < 0) {
+        fprintf(stderr, "Failed to attach FLAC file: %s\n", strerror(sinkId));
+        return 1;
+    }
+    printf("Initialized FLAC writer for: %s, %u encoders\n", outputFilename,
+        flacSink.EncoderCount());
+
+    printf("Starting audio capture...\n");
+    status_t startStatus = capture.Start();
+    if (startStatus != B_OK) {
+         fprintf(stderr, "Failed to start capture: %s\n", strerror(startStatus));
+         return 1;
+    }
+
+    printf("Capture running. Recording to %s for 10 seconds...\n", outputFilename);
+    snooze(10 * 1000 * 1000);
+
+    printf("Stopping capture...\n");
+    capture.Stop();
+
+    printf("Encoding remaining buffered data...\n");
+    status_t closeStatus = flacSink.Close();
+    if (closeStatus != B_OK)
+        fprintf(stderr, "Error writing FLAC data: %s\n", strerror(closeStatus));
+
+    if (flacSink.DroppedFrameCount() > 0) {
+        fprintf(stderr, "Warning: %llu frames dropped while encoding was behind\n",
+            (unsigned long long)flacSink.DroppedFrameCount());
+    }
+
+    const uint64 frames = flacSink.FrameCount();
+    const uint64 floatBytes = frames * 2 * sizeof(float);
+    printf("Finalized FLAC file: %s, %llu frames, %llu bytes, %.1f%% of float\n",
+        outputFilename, (unsigned long long)frames, (unsigned long long)flacSink.EncodedBytes(),
+        floatBytes > 0 ? 100.0 * flacSink.EncodedBytes() / floatBytes : 0.0);
+
+    return 0;
+}
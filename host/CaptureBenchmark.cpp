@@ -0,0 +1,415 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+// Runs AudioCapture and VideoConsumer unchanged on the synthetic devices of
+// the MediaKit stand-in, as fast as they take the buffers or paced like the
+// devices with --realtime. The audio cases report the time spent in the
+// capture hook per device frame from AudioCapture's own statistics, the
+// video cases the time VideoConsumer's control thread spends per frame,
+// with and without the copy it makes for producers that don't fill its
+// buffers. Allocations made on the capture thread or in a node's handlers
+// are counted by wrapping glibc's malloc(). Exits with 1 when a case
+// allocates, loses frames or delivers frames out of order, so it can run
+// as a regression check. Builds with the root CMakeLists.txt.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+
+#include <MediaRoster.h>
+
+#include "AudioCapture.h"
+#include "HostMedia.h"
+#include "VideoConsumer.h"
+
+// Device buffers of the audio cases
+static const size_t kDeviceBufferFrames = 1024;
+// Audio and video the cases run on, in seconds
+static const double kFastSeconds = 60.0;
+static const double kFastVideoSeconds = 10.0;
+static const double kRealtimeSeconds = 2.0;
+// Grace on top of the length of a case before it counts as stuck
+static const bigtime_t kCaseTimeout = 10000000;
+
+static std::atomic<bool> sCountAllocations(false);
+static std::atomic<size_t> sAllocationCount(0);
+
+
+static inline void
+countAllocation()
+{
+    if (sCountAllocations.load(std::memory_order_relaxed)
+            && (AudioCapture::InRealtimeCallback() || hostInEventHandler()))
+        sAllocationCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+// operator new and the rest of the C++ library end up here as well.
+// Sanitizers bring their own allocator, allocations go uncounted there.
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__) && !defined(__SANITIZE_THREAD__)
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* memory, size_t size);
+
+
+extern "C" void*
+malloc(size_t size)
+{
+    countAllocation();
+    return __libc_malloc(size);
+}
+
+
+extern "C" void*
+calloc(size_t count, size_t size)
+{
+    countAllocation();
+    return __libc_calloc(count, size);
+}
+
+
+extern "C" void*
+realloc(void* memory, size_t size)
+{
+    countAllocation();
+    return __libc_realloc(memory, size);
+}
+#endif
+
+
+// #pragma mark - Audio
+
+
+// One device and capture setup
+struct AudioCase {
+    const char*       name;
+    uint32            deviceFormat;
+    uint32            deviceChannels;
+    float             deviceRate;
+    float             targetRate;
+    AudioChannelLayout layout;
+    ResamplerQuality  quality;
+    // SAMPLE_FLOAT for the float callback, or the PCM callback format
+    SampleType        outputType;
+    bool              metering;
+    bool              gate;
+    // The device switches to this sample type halfway through, 0 never
+    uint32            switchFormat;
+};
+
+static const uint32 kSurroundMask = B_CHANNEL_LEFT | B_CHANNEL_RIGHT | B_CHANNEL_CENTER
+    | B_CHANNEL_SUB | B_CHANNEL_REARLEFT | B_CHANNEL_REARRIGHT;
+
+static const AudioCase kAudioCases[] = {
+    { "f/2 48k passthrough", media_raw_audio_format::B_AUDIO_FLOAT, 2, 48000, 0,
+        AUDIO_CHANNELS_STEREO, RESAMPLER_LINEAR, SAMPLE_FLOAT, false, false, 0 },
+    { "s16/2 44.1k>f/2 48k", media_raw_audio_format::B_AUDIO_SHORT, 2, 44100, 48000,
+        AUDIO_CHANNELS_STEREO, RESAMPLER_LINEAR, SAMPLE_FLOAT, false, false, 0 },
+    { "s32/6 48k>f/2 mix", media_raw_audio_format::B_AUDIO_INT, 6, 48000, 0,
+        AUDIO_CHANNELS_STEREO, RESAMPLER_LINEAR, SAMPLE_FLOAT, true, false, 0 },
+    { "f/2 48k>s16/1 16k", media_raw_audio_format::B_AUDIO_FLOAT, 2, 48000, 16000,
+        AUDIO_CHANNELS_MONO, RESAMPLER_SINC_MEDIUM, SAMPLE_INT16, false, false, 0 },
+    { "s16/2 48k>f/2 gated", media_raw_audio_format::B_AUDIO_SHORT, 2, 48000, 0,
+        AUDIO_CHANNELS_STEREO, RESAMPLER_LINEAR, SAMPLE_FLOAT, true, true, 0 },
+    { "f>s16/2 48k switch", media_raw_audio_format::B_AUDIO_FLOAT, 2, 48000, 0,
+        AUDIO_CHANNELS_STEREO, RESAMPLER_LINEAR, SAMPLE_FLOAT, false, true,
+        media_raw_audio_format::B_AUDIO_SHORT }
+};
+
+
+// Frames the callbacks got, to hold against the capture's own count
+static std::atomic<uint64> sAudioFrames(0);
+
+
+static void
+audioCallback(const float* /*data*/, size_t frameCount, uint32 /*channelCount*/, void* /*userData*/)
+{
+    sAudioFrames.fetch_add(frameCount, std::memory_order_relaxed);
+}
+
+
+static void
+pcmCallback(const void* /*data*/, size_t frameCount, uint32 /*channelCount*/, SampleType /*format*/,
+    void* /*userData*/)
+{
+    sAudioFrames.fetch_add(frameCount, std::memory_order_relaxed);
+}
+
+
+// Returns false when the case failed
+static bool
+runAudioCase(const AudioCase& setup, bool realtime)
+{
+    HostAudioInput input;
+    hostDefaultAudioInput(input);
+    input.name = setup.name;
+    input.format.frame_rate = setup.deviceRate;
+    input.format.channel_count = setup.deviceChannels;
+    input.format.format = setup.deviceFormat;
+    input.format.valid_bits = static_cast<int16>(
+        (setup.deviceFormat & media_raw_audio_format::B_AUDIO_SIZE_MASK) * 8);
+    input.format.buffer_size = kDeviceBufferFrames * setup.deviceChannels
+        * (setup.deviceFormat & media_raw_audio_format::B_AUDIO_SIZE_MASK);
+    input.format.channel_mask = setup.deviceChannels == 6 ? kSurroundMask
+        : B_CHANNEL_LEFT | B_CHANNEL_RIGHT;
+    input.realtime = realtime;
+    input.bufferCount = static_cast<uint64>((realtime ? kRealtimeSeconds : kFastSeconds)
+        * setup.deviceRate / kDeviceBufferFrames);
+    if (setup.switchFormat != 0) {
+        input.switchAfter = input.bufferCount / 2;
+        input.switchFormat = setup.switchFormat;
+    }
+
+    status_t status = hostSetAudioInputs(&input, 1);
+    if (status != B_OK) {
+        printf("%-22s setup failed: %s\n", setup.name, strerror(status));
+        return false;
+    }
+
+    // Picks up the device when constructed
+    AudioCapture capture(setup.outputType == SAMPLE_FLOAT ? audioCallback : NULL, NULL,
+        setup.targetRate, "CaptureBenchmark");
+    capture.SetChannelLayout(setup.layout);
+    capture.SetResamplingQuality(setup.quality);
+    if (setup.outputType != SAMPLE_FLOAT)
+        capture.SetPCMCallback(pcmCallback, setup.outputType);
+    if (setup.metering)
+        capture.SetMetering(50000);
+    if (setup.gate)
+        capture.SetGate(AUDIO_GATE_SUPPRESS, -50.0f, 200000, 100000);
+
+    sAudioFrames.store(0);
+    sAllocationCount.store(0);
+    sCountAllocations.store(true);
+    status = capture.Start();
+    if (status != B_OK) {
+        sCountAllocations.store(false);
+        printf("%-22s start failed: %s\n", setup.name, strerror(status));
+        return false;
+    }
+
+    // The recorder notifies B_WILL_STOP once the device ran dry
+    const bigtime_t timeout = system_time() + kCaseTimeout
+        + static_cast<bigtime_t>(input.bufferCount * kDeviceBufferFrames * 1e6 / setup.deviceRate);
+    while (capture.IsRunning() && system_time() < timeout)
+        snooze(1000);
+    const bool finished = !capture.IsRunning();
+    sCountAllocations.store(false);
+
+    AudioCaptureStats stats;
+    capture.GetStats(stats);
+    capture.Stop();
+
+    const double ns = stats.framesIn > 0 ? static_cast<double>(stats.processTime) / stats.framesIn
+        : 0.0;
+    const size_t allocations = sAllocationCount.load();
+    const bool framesMatch = stats.framesOut == sAudioFrames.load()
+        && stats.framesIn == input.bufferCount * kDeviceBufferFrames;
+    printf("%-22s %10.3f %10.1f %12llu %8llu %8lld %7zu%s\n", setup.name, ns,
+        ns > 0.0 ? 1e9 / (ns * setup.deviceRate) : 0.0,
+        static_cast<unsigned long long>(stats.framesOut),
+        static_cast<unsigned long long>(stats.droppedBuffers),
+        static_cast<long long>(stats.maxBufferGap), allocations,
+        !finished ? "  stuck" : !framesMatch ? "  frames lost" : "");
+    return finished && framesMatch && allocations == 0;
+}
+
+
+static bool
+benchmarkAudio(bool realtime)
+{
+    printf("\nAudioCapture, %zu frame device buffers, %s\n\n", kDeviceBufferFrames,
+        realtime ? "paced like a device" : "as fast as possible");
+    printf("%-22s %10s %10s %12s %8s %8s %7s\n", "case", "ns/frame", "x realtime", "frames out",
+        "dropped", "gap us", "allocs");
+
+    bool passed = true;
+    for (size_t n = 0; n < sizeof(kAudioCases) / sizeof(kAudioCases[0]); n++)
+        passed &= runAudioCase(kAudioCases[n], realtime);
+    return passed;
+}
+
+
+// #pragma mark - Video
+
+
+struct VideoCase {
+    const char*       name;
+    uint32            width;
+    uint32            height;
+};
+
+static const VideoCase kVideoCases[] = {
+    { "640x480", 640, 480 },
+    { "1280x720", 1280, 720 },
+    { "1920x1080", 1920, 1080 }
+};
+
+static const float kVideoFieldRate = 30.0f;
+
+// Checked on the consumer's control thread, the input writes the frame
+// number into the first word of every frame
+struct FrameCheck {
+    std::atomic<uint64> frames;
+    std::atomic<uint64> outOfOrder;
+    uint64            next;
+};
+
+
+static void
+frameCallback(BBitmap* frame, void* userData)
+{
+    FrameCheck* check = static_cast<FrameCheck*>(userData);
+    uint64 number;
+    memcpy(&number, frame->Bits(), sizeof(number));
+    if (number < check->next)
+        check->outOfOrder.fetch_add(1, std::memory_order_relaxed);
+    check->next = number + 1;
+    check->frames.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+// Connects a VideoConsumer to the video input the way a capture application
+// does, runs frameCount frames through it and tears everything down again
+static bool
+runVideoCase(const VideoCase& setup, bool consumerBuffers, bool realtime)
+{
+    const double seconds = realtime ? kRealtimeSeconds : kFastVideoSeconds;
+    HostVideoInput input;
+    hostDefaultVideoInput(input);
+    input.width = setup.width;
+    input.height = setup.height;
+    input.fieldRate = kVideoFieldRate;
+    input.realtime = realtime;
+    input.frameCount = static_cast<uint64>(seconds * kVideoFieldRate);
+    input.useConsumerBuffers = consumerBuffers;
+    const char* mode = consumerBuffers ? "own buffers" : "copy";
+
+    status_t status = hostSetVideoInput(input);
+    BMediaRoster* roster = BMediaRoster::Roster(&status);
+    if (roster == NULL) {
+        printf("%-10s %-12s setup failed: %s\n", setup.name, mode, strerror(status));
+        return false;
+    }
+
+    VideoConsumer* consumer = new VideoConsumer("CaptureBenchmark", NULL, 0);
+    FrameCheck check;
+    check.frames = 0;
+    check.outOfOrder = 0;
+    check.next = 0;
+    consumer->SetFrameCallback(frameCallback, &check);
+
+    media_node producer;
+    media_output output;
+    media_input consumerInput;
+    int32 count = 0;
+    status = roster->RegisterNode(consumer);
+    if (status == B_OK)
+        status = roster->GetVideoInput(&producer);
+    if (status == B_OK)
+        status = roster->GetFreeOutputsFor(producer, &output, 1, &count, B_MEDIA_RAW_VIDEO);
+    if (status == B_OK && count == 1) {
+        status = roster->GetFreeInputsFor(consumer->Node(), &consumerInput, 1, &count,
+            B_MEDIA_RAW_VIDEO);
+    }
+    if (status == B_OK && count == 1) {
+        media_format format = output.format;
+        status = roster->Connect(output.source, consumerInput.destination, &format, &output,
+            &consumerInput);
+    } else if (status == B_OK) {
+        status = B_MEDIA_BAD_NODE;
+    }
+    if (status != B_OK) {
+        printf("%-10s %-12s connect failed: %s\n", setup.name, mode, strerror(status));
+        roster->UnregisterNode(consumer);
+        delete consumer;
+        return false;
+    }
+
+    // The input sends its first frame one period after the consumer starts
+    const bigtime_t period = static_cast<bigtime_t>(1e6 / kVideoFieldRate);
+    const bigtime_t start = system_time() + 50000;
+    sAllocationCount.store(0);
+    sCountAllocations.store(true);
+    roster->StartNode(consumer->Node(), start);
+    roster->StartNode(producer, start + period);
+
+    HostVideoStats videoStats;
+    const bigtime_t timeout = system_time() + kCaseTimeout
+        + static_cast<bigtime_t>(seconds * 1e6);
+    do {
+        snooze(10000);
+        hostGetVideoStats(videoStats);
+    } while ((videoStats.framesSent + videoStats.framesDropped < input.frameCount
+            || check.frames.load() < videoStats.framesSent) && system_time() < timeout);
+    sCountAllocations.store(false);
+
+    HostNodeStats nodeStats;
+    hostGetNodeStats(consumer->Node(), nodeStats);
+
+    roster->StopNode(producer, 0, true);
+    roster->StopNode(consumer->Node(), 0, true);
+    roster->Disconnect(producer.node, output.source, consumer->Node().node,
+        consumerInput.destination);
+    roster->UnregisterNode(consumer);
+    delete consumer;
+
+    const uint64 frames = check.frames.load();
+    const double us = nodeStats.buffers > 0
+        ? nodeStats.bufferTime / 1e3 / nodeStats.buffers : 0.0;
+    const size_t bytes = static_cast<size_t>(setup.width) * setup.height * 4;
+    const size_t allocations = sAllocationCount.load();
+    const bool complete = frames == input.frameCount && videoStats.framesDropped == 0
+        && check.outOfOrder.load() == 0;
+    // Throughput of the copy, own buffers are handed over as they are
+    char copyRate[16] = "-";
+    if (!consumerBuffers && us > 0.0)
+        snprintf(copyRate, sizeof(copyRate), "%.2f", bytes / (us * 1e3));
+    printf("%-10s %-12s %10.2f %10.2f %10s %8llu %8llu %7zu%s\n", setup.name, mode, us,
+        nodeStats.maxBufferTime / 1e3, copyRate, static_cast<unsigned long long>(frames),
+        static_cast<unsigned long long>(videoStats.framesDropped), allocations,
+        check.outOfOrder.load() > 0 ? "  out of order" : !complete ? "  frames lost" : "");
+    return complete && allocations == 0;
+}
+
+
+static bool
+benchmarkVideo(bool realtime)
+{
+    printf("\nVideoConsumer, B_RGB32 at %.0f fps, %s\n\n", kVideoFieldRate,
+        realtime ? "paced like a device" : "as fast as possible");
+    printf("%-10s %-12s %10s %10s %10s %8s %8s %7s\n", "size", "buffers", "us/frame", "max us",
+        "copy GB/s", "frames", "dropped", "allocs");
+
+    bool passed = true;
+    for (size_t n = 0; n < sizeof(kVideoCases) / sizeof(kVideoCases[0]); n++) {
+        passed &= runVideoCase(kVideoCases[n], true, realtime);
+        passed &= runVideoCase(kVideoCases[n], false, realtime);
+    }
+    return passed;
+}
+
+
+int
+main(int argc, char** argv)
+{
+    bool realtime = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--realtime") == 0) {
+            realtime = true;
+        } else {
+            fprintf(stderr, "Usage: %s [--realtime]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    bool passed = benchmarkAudio(realtime);
+    passed &= benchmarkVideo(realtime);
+    if (!passed)
+        printf("\nFAILED\n");
+    return passed ? 0 : 1;
+}
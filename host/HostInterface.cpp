@@ -0,0 +1,193 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+// BBitmap and the color space helpers of the interface kit, see
+// host/HostMedia.h
+
+#include <string.h>
+
+#include <Bitmap.h>
+
+// Rows start on 32 bit boundaries, like on Haiku
+static int32
+bytesPerRowFor(color_space space, int32 width)
+{
+    switch (space) {
+        case B_RGB32:
+        case B_RGBA32:
+        case B_RGB32_BIG:
+        case B_RGBA32_BIG:
+            return width * 4;
+        case B_RGB24:
+        case B_RGB24_BIG:
+        case B_YCbCr444:
+        case B_YUV444:
+            return (width * 3 + 3) / 4 * 4;
+        case B_RGB16:
+        case B_RGB15:
+        case B_RGBA15:
+        case B_RGB16_BIG:
+        case B_RGB15_BIG:
+        case B_RGBA15_BIG:
+        case B_YCbCr422:
+        case B_YUV422:
+            return (width * 2 + 3) / 4 * 4;
+        case B_YCbCr411:
+        case B_YUV411:
+            return ((width + 3) / 4 * 6 + 3) / 4 * 4;
+        case B_CMAP8:
+        case B_GRAY8:
+            return (width + 3) / 4 * 4;
+        case B_GRAY1:
+            return (width + 31) / 32 * 4;
+        default:
+            return 0;
+    }
+}
+
+
+bool
+bitmaps_support_space(color_space space, uint32* supportFlags)
+{
+    const bool supported = bytesPerRowFor(space, 1) > 0;
+    if (supportFlags != NULL)
+        *supportFlags = supported ? B_VIEWS_SUPPORT_DRAW_BITMAP : 0;
+    return supported;
+}
+
+
+status_t
+get_pixel_size_for(color_space space, size_t* pixelChunk, size_t* rowAlignment,
+    size_t* pixelsPerChunk)
+{
+    size_t chunk;
+    size_t pixels = 1;
+    switch (space) {
+        case B_RGB32:
+        case B_RGBA32:
+        case B_RGB32_BIG:
+        case B_RGBA32_BIG:
+            chunk = 4;
+            break;
+        case B_RGB24:
+        case B_RGB24_BIG:
+        case B_YCbCr444:
+        case B_YUV444:
+            chunk = 3;
+            break;
+        case B_RGB16:
+        case B_RGB15:
+        case B_RGBA15:
+        case B_RGB16_BIG:
+        case B_RGB15_BIG:
+        case B_RGBA15_BIG:
+            chunk = 2;
+            break;
+        case B_YCbCr422:
+        case B_YUV422:
+            chunk = 4;
+            pixels = 2;
+            break;
+        case B_YCbCr411:
+        case B_YUV411:
+            chunk = 6;
+            pixels = 4;
+            break;
+        case B_CMAP8:
+        case B_GRAY8:
+            chunk = 1;
+            break;
+        case B_GRAY1:
+            chunk = 1;
+            pixels = 8;
+            break;
+        default:
+            return B_BAD_VALUE;
+    }
+
+    if (pixelChunk != NULL)
+        *pixelChunk = chunk;
+    if (rowAlignment != NULL)
+        *rowAlignment = 4;
+    if (pixelsPerChunk != NULL)
+        *pixelsPerChunk = pixels;
+    return B_OK;
+}
+
+
+// #pragma mark - BBitmap
+
+
+BBitmap::BBitmap(BRect bounds, uint32 flags, color_space colorSpace, int32 bytesPerRow)
+{
+    _InitObject(bounds, colorSpace, flags, bytesPerRow);
+}
+
+
+BBitmap::BBitmap(BRect bounds, color_space colorSpace, bool acceptsViews, bool needsContiguous)
+{
+    _InitObject(bounds, colorSpace,
+        (acceptsViews ? B_BITMAP_ACCEPTS_VIEWS : 0) | (needsContiguous ? B_BITMAP_IS_CONTIGUOUS : 0),
+        B_ANY_BYTES_PER_ROW);
+}
+
+
+BBitmap::~BBitmap()
+{
+    if (fArea >= 0)
+        delete_area(fArea);
+}
+
+
+status_t
+BBitmap::LockBits(uint32* /*state*/)
+{
+    return fInitError;
+}
+
+
+void
+BBitmap::UnlockBits()
+{
+}
+
+
+void
+BBitmap::_InitObject(BRect bounds, color_space colorSpace, uint32 flags, int32 bytesPerRow)
+{
+    fArea = -1;
+    fBits = NULL;
+    fBounds = bounds;
+    fColorSpace = colorSpace;
+    fFlags = flags;
+    fBytesPerRow = 0;
+
+    const int32 minBytesPerRow = bounds.IsValid()
+        ? bytesPerRowFor(colorSpace, bounds.IntegerWidth() + 1) : 0;
+    if (minBytesPerRow <= 0 || (bytesPerRow != B_ANY_BYTES_PER_ROW && bytesPerRow < minBytesPerRow)) {
+        fInitError = B_BAD_VALUE;
+        return;
+    }
+    if ((flags & (B_BITMAP_ACCEPTS_VIEWS | B_BITMAP_WILL_OVERLAY)) != 0) {
+        fInitError = B_NOT_SUPPORTED;
+        return;
+    }
+
+    fBytesPerRow = bytesPerRow == B_ANY_BYTES_PER_ROW ? minBytesPerRow : bytesPerRow;
+    const size_t size = static_cast<size_t>(fBytesPerRow) * (bounds.IntegerHeight() + 1);
+    void* address = NULL;
+    fArea = create_area("bitmap", &address, B_ANY_ADDRESS,
+        (size + B_PAGE_SIZE - 1) / B_PAGE_SIZE * B_PAGE_SIZE, B_FULL_LOCK,
+        B_READ_AREA | B_WRITE_AREA);
+    if (fArea < 0) {
+        fInitError = fArea;
+        return;
+    }
+    fBits = static_cast<uint8*>(address);
+
+    if ((flags & B_BITMAP_CLEAR_TO_WHITE) != 0)
+        memset(fBits, 0xff, size);
+    fInitError = B_OK;
+}
@@ -0,0 +1,719 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+// Kernel calls of OS.h and scheduler.h on pthreads, see host/HostMedia.h.
+// Objects live in tables keyed by id and are handed out as shared
+// pointers, so deleting one while another thread waits on it is safe. None
+// of the calls used while running allocates.
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+
+#include <OS.h>
+#include <scheduler.h>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct Thread {
+    Thread()
+        : id(-1), function(NULL), data(NULL), priority(B_NORMAL_PRIORITY), started(false),
+          resumed(false), exitValue(0) {}
+
+    thread_id         id;
+    thread_func       function;
+    void*             data;
+    char              name[B_OS_NAME_LENGTH];
+    int32             priority;
+    pthread_t         pthread;
+    bool              started;
+    bool              resumed;
+    status_t          exitValue;
+    std::mutex        lock;
+    std::condition_variable resumeCondition;
+};
+
+struct Semaphore {
+    Semaphore() : count(0), waiting(0), deleted(false) {}
+
+    int32             count;
+    int32             waiting;
+    bool              deleted;
+    char              name[B_OS_NAME_LENGTH];
+    std::mutex        lock;
+    std::condition_variable condition;
+};
+
+struct PortMessage {
+    int32             code;
+    size_t            size;
+    uint8             data[HOST_PORT_MESSAGE_SIZE];
+};
+
+struct Port {
+    Port() : messages(NULL), capacity(0), first(0), count(0), closed(false) {}
+    ~Port() { delete[] messages; }
+
+    PortMessage*      messages;
+    int32             capacity;
+    int32             first;
+    int32             count;
+    bool              closed;
+    char              name[B_OS_NAME_LENGTH];
+    std::mutex        lock;
+    std::condition_variable readCondition;
+    std::condition_variable writeCondition;
+};
+
+struct Area {
+    area_info         info;
+};
+
+// Ids are never reused, like on Haiku
+std::mutex sTableLock;
+int32 sNextID = 1;
+std::map<thread_id, std::shared_ptr<Thread> > sThreads;
+std::map<sem_id, std::shared_ptr<Semaphore> > sSemaphores;
+std::map<port_id, std::shared_ptr<Port> > sPorts;
+std::map<area_id, Area> sAreas;
+
+thread_local thread_id sCurrentThread = -1;
+
+}
+
+
+template<typename T>
+static std::shared_ptr<T>
+lookup(std::map<int32, std::shared_ptr<T> >& table, int32 id)
+{
+    std::lock_guard<std::mutex> tableLock(sTableLock);
+    typename std::map<int32, std::shared_ptr<T> >::iterator it = table.find(id);
+    return it != table.end() ? it->second : std::shared_ptr<T>();
+}
+
+
+static void
+copyName(char* name, const char* source)
+{
+    strncpy(name, source != NULL ? source : "", B_OS_NAME_LENGTH - 1);
+    name[B_OS_NAME_LENGTH - 1] = '\0';
+}
+
+
+// Turns Haiku timeout flags into a deadline, false for an infinite wait
+static bool
+deadlineFor(uint32 flags, bigtime_t timeout, Clock::time_point& deadline)
+{
+    if ((flags & (B_RELATIVE_TIMEOUT | B_ABSOLUTE_TIMEOUT)) == 0 || timeout == B_INFINITE_TIMEOUT)
+        return false;
+
+    const bigtime_t relative = (flags & B_ABSOLUTE_TIMEOUT) != 0 ? timeout - system_time() : timeout;
+    deadline = Clock::now() + std::chrono::microseconds(relative > 0 ? relative : 0);
+    return true;
+}
+
+
+// #pragma mark - Time
+
+
+bigtime_t
+system_time(void)
+{
+    return system_time_nsecs() / 1000;
+}
+
+
+nanotime_t
+system_time_nsecs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<nanotime_t>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+}
+
+
+status_t
+snooze(bigtime_t amount)
+{
+    if (amount <= 0)
+        return B_OK;
+
+    struct timespec time;
+    time.tv_sec = amount / 1000000;
+    time.tv_nsec = (amount % 1000000) * 1000;
+    while (nanosleep(&time, &time) != 0 && errno == EINTR)
+        ;
+    return B_OK;
+}
+
+
+status_t
+snooze_until(bigtime_t time, int timeBase)
+{
+    if (timeBase != B_SYSTEM_TIMEBASE)
+        return B_BAD_VALUE;
+
+    struct timespec until;
+    until.tv_sec = time / 1000000;
+    until.tv_nsec = (time % 1000000) * 1000;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) == EINTR)
+        ;
+    return B_OK;
+}
+
+
+// #pragma mark - Threads
+
+
+static void*
+threadEntry(void* cookie)
+{
+    Thread* thread = static_cast<Thread*>(cookie);
+    sCurrentThread = thread->id;
+    {
+        // Haiku threads start suspended
+        std::unique_lock<std::mutex> lock(thread->lock);
+        while (!thread->resumed)
+            thread->resumeCondition.wait(lock);
+    }
+    thread->exitValue = thread->function(thread->data);
+    return NULL;
+}
+
+
+thread_id
+spawn_thread(thread_func function, const char* name, int32 priority, void* data)
+{
+    if (function == NULL)
+        return B_BAD_VALUE;
+
+    std::shared_ptr<Thread> thread = std::make_shared<Thread>();
+    thread->function = function;
+    thread->data = data;
+    thread->priority = priority;
+    copyName(thread->name, name);
+    {
+        std::lock_guard<std::mutex> tableLock(sTableLock);
+        thread->id = sNextID++;
+        sThreads[thread->id] = thread;
+    }
+
+    if (pthread_create(&thread->pthread, NULL, threadEntry, thread.get()) != 0) {
+        std::lock_guard<std::mutex> tableLock(sTableLock);
+        sThreads.erase(thread->id);
+        return B_NO_MORE_THREADS;
+    }
+    thread->started = true;
+    // Thread names are limited to 16 bytes on Linux
+    char shortName[16];
+    strncpy(shortName, thread->name, sizeof(shortName) - 1);
+    shortName[sizeof(shortName) - 1] = '\0';
+    pthread_setname_np(thread->pthread, shortName);
+    return thread->id;
+}
+
+
+status_t
+resume_thread(thread_id id)
+{
+    std::shared_ptr<Thread> thread = lookup(sThreads, id);
+    if (!thread)
+        return B_BAD_THREAD_ID;
+
+    std::lock_guard<std::mutex> lock(thread->lock);
+    if (thread->resumed)
+        return B_BAD_THREAD_STATE;
+    thread->resumed = true;
+    thread->resumeCondition.notify_one();
+    return B_OK;
+}
+
+
+status_t
+wait_for_thread(thread_id id, status_t* returnValue)
+{
+    std::shared_ptr<Thread> thread = lookup(sThreads, id);
+    if (!thread || !thread->started)
+        return B_BAD_THREAD_ID;
+    if (id == find_thread(NULL))
+        return B_DONT_DO_THAT;
+
+    // Waiting for a suspended thread resumes it
+    {
+        std::lock_guard<std::mutex> lock(thread->lock);
+        thread->resumed = true;
+        thread->resumeCondition.notify_one();
+    }
+    {
+        std::lock_guard<std::mutex> tableLock(sTableLock);
+        if (sThreads.erase(id) == 0)
+            return B_BAD_THREAD_ID;
+    }
+    pthread_join(thread->pthread, NULL);
+    if (returnValue != NULL)
+        *returnValue = thread->exitValue;
+    return B_OK;
+}
+
+
+status_t
+set_thread_priority(thread_id id, int32 newPriority)
+{
+    std::shared_ptr<Thread> thread = lookup(sThreads, id);
+    if (!thread)
+        return B_BAD_THREAD_ID;
+
+    const int32 oldPriority = thread->priority;
+    thread->priority = newPriority;
+    return oldPriority;
+}
+
+
+thread_id
+find_thread(const char* name)
+{
+    if (name == NULL) {
+        // Threads not spawned here get an id the first time they ask
+        if (sCurrentThread < 0) {
+            std::lock_guard<std::mutex> tableLock(sTableLock);
+            sCurrentThread = sNextID++;
+        }
+        return sCurrentThread;
+    }
+
+    std::lock_guard<std::mutex> tableLock(sTableLock);
+    for (std::map<thread_id, std::shared_ptr<Thread> >::iterator it = sThreads.begin();
+            it != sThreads.end(); ++it) {
+        if (strcmp(it->second->name, name) == 0)
+            return it->first;
+    }
+    return B_NAME_NOT_FOUND;
+}
+
+
+status_t
+rename_thread(thread_id id, const char* newName)
+{
+    std::shared_ptr<Thread> thread = lookup(sThreads, id);
+    if (!thread)
+        return B_BAD_THREAD_ID;
+
+    copyName(thread->name, newName);
+    return B_OK;
+}
+
+
+// A fixed guess, host threads run without Haiku's priorities
+int32
+suggest_thread_priority(uint32 /*task_flags*/, int32 /*period*/, bigtime_t /*jitter*/,
+    bigtime_t /*length*/)
+{
+    return B_NORMAL_PRIORITY;
+}
+
+
+bigtime_t
+estimate_max_scheduling_latency(thread_id /*thread*/)
+{
+    return 1000;
+}
+
+
+// #pragma mark - Semaphores
+
+
+sem_id
+create_sem(int32 count, const char* name)
+{
+    if (count < 0)
+        return B_BAD_VALUE;
+
+    std::shared_ptr<Semaphore> semaphore = std::make_shared<Semaphore>();
+    semaphore->count = count;
+    copyName(semaphore->name, name);
+
+    std::lock_guard<std::mutex> tableLock(sTableLock);
+    const sem_id id = sNextID++;
+    sSemaphores[id] = semaphore;
+    return id;
+}
+
+
+status_t
+delete_sem(sem_id id)
+{
+    std::shared_ptr<Semaphore> semaphore;
+    {
+        std::lock_guard<std::mutex> tableLock(sTableLock);
+        std::map<sem_id, std::shared_ptr<Semaphore> >::iterator it = sSemaphores.find(id);
+        if (it == sSemaphores.end())
+            return B_BAD_SEM_ID;
+        semaphore = it->second;
+        sSemaphores.erase(it);
+    }
+
+    // Waiters return B_BAD_SEM_ID
+    std::lock_guard<std::mutex> lock(semaphore->lock);
+    semaphore->deleted = true;
+    semaphore->condition.notify_all();
+    return B_OK;
+}
+
+
+status_t
+acquire_sem(sem_id id)
+{
+    return acquire_sem_etc(id, 1, 0, 0);
+}
+
+
+status_t
+acquire_sem_etc(sem_id id, int32 count, uint32 flags, bigtime_t timeout)
+{
+    if (count < 1)
+        return B_BAD_VALUE;
+
+    std::shared_ptr<Semaphore> semaphore = lookup(sSemaphores, id);
+    if (!semaphore)
+        return B_BAD_SEM_ID;
+
+    Clock::time_point deadline;
+    const bool timed = deadlineFor(flags, timeout, deadline);
+
+    std::unique_lock<std::mutex> lock(semaphore->lock);
+    if (semaphore->count < count && timed && (flags & B_RELATIVE_TIMEOUT) != 0 && timeout <= 0)
+        return B_WOULD_BLOCK;
+
+    semaphore->waiting++;
+    while (!semaphore->deleted && semaphore->count < count) {
+        if (!timed) {
+            semaphore->condition.wait(lock);
+        } else if (semaphore->condition.wait_until(lock, deadline) == std::cv_status::timeout
+                && !semaphore->deleted && semaphore->count < count) {
+            semaphore->waiting--;
+            return B_TIMED_OUT;
+        }
+    }
+    semaphore->waiting--;
+    if (semaphore->deleted)
+        return B_BAD_SEM_ID;
+
+    semaphore->count -= count;
+    return B_OK;
+}
+
+
+status_t
+release_sem(sem_id id)
+{
+    return release_sem_etc(id, 1, 0);
+}
+
+
+status_t
+release_sem_etc(sem_id id, int32 count, uint32 flags)
+{
+    std::shared_ptr<Semaphore> semaphore = lookup(sSemaphores, id);
+    if (!semaphore)
+        return B_BAD_SEM_ID;
+
+    std::lock_guard<std::mutex> lock(semaphore->lock);
+    if ((flags & B_RELEASE_ALL) != 0)
+        count = semaphore->waiting > 0 ? semaphore->waiting : 0;
+    else if (count < 0)
+        return B_BAD_VALUE;
+    if ((flags & B_RELEASE_IF_WAITING_ONLY) != 0 && semaphore->waiting == 0)
+        return B_OK;
+
+    semaphore->count += count;
+    semaphore->condition.notify_all();
+    return B_OK;
+}
+
+
+status_t
+get_sem_count(sem_id id, int32* threadCount)
+{
+    std::shared_ptr<Semaphore> semaphore = lookup(sSemaphores, id);
+    if (!semaphore)
+        return B_BAD_SEM_ID;
+    if (threadCount == NULL)
+        return B_BAD_VALUE;
+
+    // Negative for the number of waiting threads, like on Haiku
+    std::lock_guard<std::mutex> lock(semaphore->lock);
+    *threadCount = semaphore->count > 0 ? semaphore->count : -semaphore->waiting;
+    return B_OK;
+}
+
+
+// #pragma mark - Ports
+
+
+port_id
+create_port(int32 capacity, const char* name)
+{
+    if (capacity <= 0)
+        return B_BAD_VALUE;
+
+    std::shared_ptr<Port> port = std::make_shared<Port>();
+    port->messages = new(std::nothrow) PortMessage[capacity];
+    if (port->messages == NULL)
+        return B_NO_MEMORY;
+    port->capacity = capacity;
+    copyName(port->name, name);
+
+    std::lock_guard<std::mutex> tableLock(sTableLock);
+    const port_id id = sNextID++;
+    sPorts[id] = port;
+    return id;
+}
+
+
+status_t
+close_port(port_id id)
+{
+    std::shared_ptr<Port> port = lookup(sPorts, id);
+    if (!port)
+        return B_BAD_PORT_ID;
+
+    // Readers still get the queued messages
+    std::lock_guard<std::mutex> lock(port->lock);
+    port->closed = true;
+    port->readCondition.notify_all();
+    port->writeCondition.notify_all();
+    return B_OK;
+}
+
+
+status_t
+delete_port(port_id id)
+{
+    std::shared_ptr<Port> port;
+    {
+        std::lock_guard<std::mutex> tableLock(sTableLock);
+        std::map<port_id, std::shared_ptr<Port> >::iterator it = sPorts.find(id);
+        if (it == sPorts.end())
+            return B_BAD_PORT_ID;
+        port = it->second;
+        sPorts.erase(it);
+    }
+
+    std::lock_guard<std::mutex> lock(port->lock);
+    port->closed = true;
+    port->count = 0;
+    port->readCondition.notify_all();
+    port->writeCondition.notify_all();
+    return B_OK;
+}
+
+
+status_t
+write_port(port_id id, int32 code, const void* buffer, size_t bufferSize)
+{
+    return write_port_etc(id, code, buffer, bufferSize, 0, 0);
+}
+
+
+status_t
+write_port_etc(port_id id, int32 code, const void* buffer, size_t bufferSize, uint32 flags,
+    bigtime_t timeout)
+{
+    if (bufferSize > HOST_PORT_MESSAGE_SIZE || (buffer == NULL && bufferSize > 0))
+        return B_BAD_VALUE;
+
+    std::shared_ptr<Port> port = lookup(sPorts, id);
+    if (!port)
+        return B_BAD_PORT_ID;
+
+    Clock::time_point deadline;
+    const bool timed = deadlineFor(flags, timeout, deadline);
+
+    std::unique_lock<std::mutex> lock(port->lock);
+    while (!port->closed && port->count == port->capacity) {
+        if (timed && (flags & B_RELATIVE_TIMEOUT) != 0 && timeout <= 0)
+            return B_WOULD_BLOCK;
+        if (!timed)
+            port->writeCondition.wait(lock);
+        else if (port->writeCondition.wait_until(lock, deadline) == std::cv_status::timeout
+                && port->count == port->capacity)
+            return B_TIMED_OUT;
+    }
+    if (port->closed)
+        return B_BAD_PORT_ID;
+
+    PortMessage& message = port->messages[(port->first + port->count) % port->capacity];
+    message.code = code;
+    message.size = bufferSize;
+    if (bufferSize > 0)
+        memcpy(message.data, buffer, bufferSize);
+    port->count++;
+    port->readCondition.notify_one();
+    return B_OK;
+}
+
+
+ssize_t
+read_port(port_id id, int32* code, void* buffer, size_t bufferSize)
+{
+    return read_port_etc(id, code, buffer, bufferSize, 0, 0);
+}
+
+
+ssize_t
+read_port_etc(port_id id, int32* code, void* buffer, size_t bufferSize, uint32 flags,
+    bigtime_t timeout)
+{
+    if (code == NULL || (buffer == NULL && bufferSize > 0))
+        return B_BAD_VALUE;
+
+    std::shared_ptr<Port> port = lookup(sPorts, id);
+    if (!port)
+        return B_BAD_PORT_ID;
+
+    Clock::time_point deadline;
+    const bool timed = deadlineFor(flags, timeout, deadline);
+
+    std::unique_lock<std::mutex> lock(port->lock);
+    while (!port->closed && port->count == 0) {
+        if (timed && (flags & B_RELATIVE_TIMEOUT) != 0 && timeout <= 0)
+            return B_WOULD_BLOCK;
+        if (!timed)
+            port->readCondition.wait(lock);
+        else if (port->readCondition.wait_until(lock, deadline) == std::cv_status::timeout
+                && port->count == 0)
+            return B_TIMED_OUT;
+    }
+    if (port->count == 0)
+        return B_BAD_PORT_ID;
+
+    // Like on Haiku the rest of a message that doesn't fit is lost
+    const PortMessage& message = port->messages[port->first];
+    const size_t size = message.size < bufferSize ? message.size : bufferSize;
+    *code = message.code;
+    if (size > 0)
+        memcpy(buffer, message.data, size);
+    port->first = (port->first + 1) % port->capacity;
+    port->count--;
+    port->writeCondition.notify_one();
+    return static_cast<ssize_t>(size);
+}
+
+
+// #pragma mark - Areas
+
+
+area_id
+create_area(const char* name, void** startAddress, uint32 /*addressSpec*/, size_t size, uint32 lock,
+    uint32 protection)
+{
+    if (startAddress == NULL || size == 0 || size % B_PAGE_SIZE != 0)
+        return B_BAD_VALUE;
+
+    // Areas are always placed anywhere, and always committed
+    void* address = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (address == MAP_FAILED)
+        return B_NO_MEMORY;
+
+    Area area;
+    memset(&area.info, 0, sizeof(area.info));
+    copyName(area.info.name, name);
+    area.info.size = size;
+    area.info.lock = lock;
+    area.info.protection = protection;
+    area.info.address = address;
+    area.info.ram_size = static_cast<uint32>(size);
+
+    std::lock_guard<std::mutex> tableLock(sTableLock);
+    area.info.area = sNextID++;
+    sAreas[area.info.area] = area;
+    *startAddress = address;
+    return area.info.area;
+}
+
+
+status_t
+delete_area(area_id id)
+{
+    void* address;
+    size_t size;
+    {
+        std::lock_guard<std::mutex> tableLock(sTableLock);
+        std::map<area_id, Area>::iterator it = sAreas.find(id);
+        if (it == sAreas.end())
+            return B_BAD_VALUE;
+        address = it->second.info.address;
+        size = it->second.info.size;
+        sAreas.erase(it);
+    }
+
+    munmap(address, size);
+    return B_OK;
+}
+
+
+area_id
+area_for(void* address)
+{
+    const uint8* pointer = static_cast<const uint8*>(address);
+    std::lock_guard<std::mutex> tableLock(sTableLock);
+    for (std::map<area_id, Area>::iterator it = sAreas.begin(); it != sAreas.end(); ++it) {
+        const uint8* start = static_cast<const uint8*>(it->second.info.address);
+        if (pointer >= start && pointer < start + it->second.info.size)
+            return it->first;
+    }
+    return B_ERROR;
+}
+
+
+status_t
+get_area_info(area_id id, area_info* areaInfo)
+{
+    if (areaInfo == NULL)
+        return B_BAD_VALUE;
+
+    std::lock_guard<std::mutex> tableLock(sTableLock);
+    std::map<area_id, Area>::iterator it = sAreas.find(id);
+    if (it == sAreas.end())
+        return B_BAD_VALUE;
+
+    *areaInfo = it->second.info;
+    return B_OK;
+}
+
+
+// #pragma mark - System
+
+
+status_t
+get_system_info(system_info* info)
+{
+    if (info == NULL)
+        return B_BAD_VALUE;
+
+    memset(info, 0, sizeof(*info));
+    const long cpuCount = sysconf(_SC_NPROCESSORS_ONLN);
+    info->cpu_count = cpuCount > 0 ? static_cast<uint32>(cpuCount) : 1;
+    const long pages = sysconf(_SC_PHYS_PAGES);
+    const long freePages = sysconf(_SC_AVPHYS_PAGES);
+    info->max_pages = pages > 0 ? static_cast<uint64>(pages) : 0;
+    info->used_pages = pages > 0 && freePages >= 0 ? static_cast<uint64>(pages - freePages) : 0;
+    copyName(info->kernel_name, "host");
+    return B_OK;
+}
@@ -0,0 +1,2503 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+// The media kit part of the host stand-in, see HostMedia.h. HostMediaServer
+// takes the place of the media server: it keeps the registered nodes and
+// the synthetic devices, connects them and runs the video input.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <new>
+
+#include <Application.h>
+#include <Autolock.h>
+#include <Bitmap.h>
+#include <Buffer.h>
+#include <BufferConsumer.h>
+#include <BufferGroup.h>
+#include <MediaEventLooper.h>
+#include <MediaRecorder.h>
+#include <MediaRoster.h>
+#include <TimeSource.h>
+#include <scheduler.h>
+
+#include "HostMedia.h"
+
+// Messages on node control ports
+enum {
+    HOST_NODE_START = 0x60000000,
+    HOST_NODE_STOP,
+    HOST_BUFFER_RECEIVED
+};
+
+struct HostStopMessage {
+    bigtime_t         performanceTime;
+    bool              immediate;
+};
+
+static const int32 kControlPortCapacity = 64;
+static const int32 kMaxAudioInputs = 8;
+static const int32 kMaxNodes = 32;
+static const int32 kVideoBufferCount = 4;
+// How long the video input waits for its consumer to start
+static const bigtime_t kConsumerStartTimeout = 1000000;
+// How long an immediate StopNode() waits for the node
+static const bigtime_t kStopTimeout = 5000000;
+
+static thread_local bool sInEventHandler = false;
+
+// Pre-rendered device buffers a recorder replays, see BMediaRecorder
+struct HostRecorderSource {
+    HostAudioInput    input;
+    media_format      format;
+    media_format      switchFormat;
+    size_t            frameCount;
+    uint8**           buffers;
+    uint8**           switchBuffers;
+    size_t            bufferCount;
+};
+
+
+static size_t
+sampleSize(uint32 format)
+{
+    return format & media_raw_audio_format::B_AUDIO_SIZE_MASK;
+}
+
+
+// 440 Hz on every channel, the second half of every second silent
+static void
+fillSine(void* data, size_t frameCount, const media_multi_audio_format& format, uint64 firstFrame,
+    void* /*cookie*/)
+{
+    const uint64 rate = static_cast<uint64>(format.frame_rate);
+    for (size_t f = 0; f < frameCount; f++) {
+        const uint64 frame = firstFrame + f;
+        const bool silent = rate > 0 && frame % rate >= rate / 2;
+        const double value = silent ? 0.0 : 0.5 * sin(2 * M_PI * 440.0 * frame / format.frame_rate);
+        for (uint32 c = 0; c < format.channel_count; c++) {
+            const size_t i = f * format.channel_count + c;
+            switch (format.format) {
+                case media_raw_audio_format::B_AUDIO_FLOAT:
+                    static_cast<float*>(data)[i] = static_cast<float>(value);
+                    break;
+                case media_raw_audio_format::B_AUDIO_INT:
+                    static_cast<int32*>(data)[i] = static_cast<int32>(value * 2147483647.0);
+                    break;
+                case media_raw_audio_format::B_AUDIO_SHORT:
+                    static_cast<int16*>(data)[i] = static_cast<int16>(value * 32767);
+                    break;
+                case media_raw_audio_format::B_AUDIO_CHAR:
+                    static_cast<int8*>(data)[i] = static_cast<int8>(value * 127);
+                    break;
+                case media_raw_audio_format::B_AUDIO_UCHAR:
+                    static_cast<uint8*>(data)[i] = static_cast<uint8>(128 + value * 127);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+}
+
+
+static void
+copyName(char* name, const char* source)
+{
+    snprintf(name, B_MEDIA_NAME_LENGTH, "%s", source != NULL ? source : "");
+}
+
+
+static bool
+nameMatches(const char* name, const char* pattern)
+{
+    if (pattern == NULL)
+        return true;
+    const size_t length = strlen(pattern);
+    if (length > 0 && pattern[length - 1] == '*')
+        return strncmp(name, pattern, length - 1) == 0;
+    return strcmp(name, pattern) == 0;
+}
+
+
+// #pragma mark - HostMediaServer
+
+
+class HostSystemTimeSource : public BTimeSource {
+public:
+    virtual BMediaAddOn* AddOn(int32* internalID) const
+    {
+        if (internalID != NULL)
+            *internalID = 0;
+        return NULL;
+    }
+};
+
+
+class HostMediaServer {
+public:
+    static BTimeSource* TimeSource();
+
+    static status_t SetAudioInputs(const HostAudioInput* inputs, int32 count);
+    static status_t SetVideoInput(const HostVideoInput& input);
+    static status_t GetVideoStats(HostVideoStats& stats);
+    static status_t GetNodeStats(const media_node& node, HostNodeStats& stats);
+
+    static status_t GetAudioInput(media_node* _node);
+    static status_t GetVideoInput(media_node* _node);
+    static status_t GetLiveNodeInfo(const media_node& node, live_node_info* _liveInfo);
+    static status_t GetLiveNodes(live_node_info* _liveNodes, int32* inOutTotalCount,
+        const media_format* hasInput, const media_format* hasOutput, const char* name,
+        uint64 nodeKinds);
+    static status_t GetFreeInputsFor(const media_node& node, media_input* _inputs, int32 capacity,
+        int32* _foundCount, media_type filterType);
+    static status_t GetFreeOutputsFor(const media_node& node, media_output* _outputs,
+        int32 capacity, int32* _foundCount, media_type filterType);
+
+    static status_t RegisterNode(BMediaNode* node);
+    static status_t UnregisterNode(BMediaNode* node);
+    static void NodeDeleted(BMediaNode* node);
+
+    static status_t Connect(const media_source& from, const media_destination& to,
+        media_format* format, media_output* _output, media_input* _input);
+    static status_t Disconnect(const media_source& source, const media_destination& destination);
+    static status_t SetOutputBuffersFor(const media_source& source,
+        const media_destination& destination, BBufferGroup* group, int32* changeTag);
+
+    static status_t StartNode(const media_node& node, bigtime_t performanceTime);
+    static status_t StopNode(const media_node& node, bigtime_t performanceTime, bool immediate);
+
+    static status_t OpenAudioInput(const media_node& node, const media_output* output,
+        const media_format* format, HostRecorderSource*& _source, media_output& _output);
+    static void CloseAudioInput(HostRecorderSource* source);
+
+    static status_t HandleNodeMessage(BMediaNode* node, int32 code, const void* data, size_t size);
+    static void AccountBuffer(BMediaNode* node, bigtime_t time, bool handled);
+    static int32 StopsHandled(BMediaEventLooper* looper);
+    static void StopHandled(BMediaEventLooper* looper);
+
+private:
+    struct AudioDevice {
+        HostAudioInput    input;
+        char              name[B_MEDIA_NAME_LENGTH];
+        media_node        node;
+        int32             openCount;
+    };
+
+    struct VideoDevice {
+        HostVideoInput    input;
+        char              name[B_MEDIA_NAME_LENGTH];
+        media_node        node;
+
+        // Connection
+        BBufferConsumer*  consumer;
+        media_source      source;
+        media_destination destination;
+        media_format      format;
+        bigtime_t         downstreamLatency;
+        BBufferGroup*     ownGroup;
+        std::atomic<BBufferGroup*> consumerGroup;
+
+        thread_id         thread;
+        std::atomic<bool> running;
+        bigtime_t         startTime;
+        std::atomic<uint64> framesSent;
+        std::atomic<uint64> framesDropped;
+    };
+
+    static void _InitDevices();
+    static void _SetupAudioDevice(AudioDevice& device, const HostAudioInput& input);
+    static void _SetupVideoDevice(const HostVideoInput& input);
+    static BMediaNode* _FindNode(media_node_id id);
+    static BMediaNode* _FindNodeByPort(port_id port);
+    static AudioDevice* _FindAudioDevice(media_node_id id);
+    static media_output _AudioOutput(const AudioDevice& device);
+    static media_output _VideoOutput();
+    static size_t _VideoFrameSize(const media_format& format);
+    static void _StopVideo();
+    static int32 _VideoThread(void* cookie);
+
+    static BLocker    sLock;
+    static bool       sInitialized;
+    static int32      sNextNodeID;
+    static HostSystemTimeSource* sTimeSource;
+    static BMediaNode* sNodes[kMaxNodes];
+    static AudioDevice sAudioDevices[kMaxAudioInputs];
+    static int32      sAudioDeviceCount;
+    static VideoDevice sVideo;
+};
+
+
+BLocker HostMediaServer::sLock("media server");
+bool HostMediaServer::sInitialized = false;
+int32 HostMediaServer::sNextNodeID = 1;
+HostSystemTimeSource* HostMediaServer::sTimeSource = NULL;
+BMediaNode* HostMediaServer::sNodes[kMaxNodes];
+HostMediaServer::AudioDevice HostMediaServer::sAudioDevices[kMaxAudioInputs];
+int32 HostMediaServer::sAudioDeviceCount = 0;
+HostMediaServer::VideoDevice HostMediaServer::sVideo;
+
+
+// Called with sLock held
+void
+HostMediaServer::_InitDevices()
+{
+    if (sInitialized)
+        return;
+    sInitialized = true;
+
+    sTimeSource = new HostSystemTimeSource();
+    sTimeSource->fNodeID = sNextNodeID++;
+
+    HostAudioInput audio;
+    hostDefaultAudioInput(audio);
+    sAudioDeviceCount = 1;
+    _SetupAudioDevice(sAudioDevices[0], audio);
+
+    sVideo.node.node = -1;
+    sVideo.thread = -1;
+    HostVideoInput video;
+    hostDefaultVideoInput(video);
+    _SetupVideoDevice(video);
+}
+
+
+void
+HostMediaServer::_SetupAudioDevice(AudioDevice& device, const HostAudioInput& input)
+{
+    device.input = input;
+    copyName(device.name, input.name);
+    device.input.name = device.name;
+    if (device.node.node < 0) {
+        device.node.node = sNextNodeID++;
+        device.node.port = create_port(1, device.name);
+        device.node.kind = B_BUFFER_PRODUCER | B_PHYSICAL_INPUT;
+    }
+    device.openCount = 0;
+}
+
+
+void
+HostMediaServer::_SetupVideoDevice(const HostVideoInput& input)
+{
+    sVideo.input = input;
+    copyName(sVideo.name, input.name);
+    sVideo.input.name = sVideo.name;
+    if (sVideo.node.node < 0) {
+        sVideo.node.node = sNextNodeID++;
+        sVideo.node.port = create_port(1, sVideo.name);
+        sVideo.node.kind = B_BUFFER_PRODUCER | B_PHYSICAL_INPUT;
+    }
+    sVideo.consumer = NULL;
+    sVideo.ownGroup = NULL;
+    sVideo.consumerGroup = NULL;
+}
+
+
+BTimeSource*
+HostMediaServer::TimeSource()
+{
+    BAutolock locker(sLock);
+    _InitDevices();
+    return sTimeSource;
+}
+
+
+status_t
+HostMediaServer::SetAudioInputs(const HostAudioInput* inputs, int32 count)
+{
+    if (inputs == NULL || count < 1 || count > kMaxAudioInputs)
+        return B_BAD_VALUE;
+
+    BAutolock locker(sLock);
+    _InitDevices();
+    for (int32 i = 0; i < sAudioDeviceCount; i++) {
+        if (sAudioDevices[i].openCount > 0)
+            return B_BUSY;
+    }
+
+    for (int32 i = 0; i < count; i++)
+        _SetupAudioDevice(sAudioDevices[i], inputs[i]);
+    sAudioDeviceCount = count;
+    return B_OK;
+}
+
+
+status_t
+HostMediaServer::SetVideoInput(const HostVideoInput& input)
+{
+    if (input.width == 0 || input.height == 0 || input.fieldRate <= 0.0f
+            || !bitmaps_support_space(input.colorSpace, NULL))
+        return B_BAD_VALUE;
+
+    BAutolock locker(sLock);
+    _InitDevices();
+    if (sVideo.consumer != NULL)
+        return B_BUSY;
+
+    _SetupVideoDevice(input);
+    return B_OK;
+}
+
+
+status_t
+HostMediaServer::GetVideoStats(HostVideoStats& stats)
+{
+    stats.framesSent = sVideo.framesSent.load();
+    stats.framesDropped = sVideo.framesDropped.load();
+    return B_OK;
+}
+
+
+status_t
+HostMediaServer::GetNodeStats(const media_node& node, HostNodeStats& stats)
+{
+    BAutolock locker(sLock);
+    BMediaNode* mediaNode = _FindNode(node.node);
+    if (mediaNode == NULL)
+        return B_MEDIA_BAD_NODE;
+
+    stats.buffers = mediaNode->fBuffersHandled;
+    stats.bufferTime = mediaNode->fBufferTime;
+    stats.maxBufferTime = mediaNode->fMaxBufferTime;
+    return B_OK;
+}
+
+
+BMediaNode*
+HostMediaServer::_FindNode(media_node_id id)
+{
+    for (int32 i = 0; i < kMaxNodes; i++) {
+        if (sNodes[i] != NULL && sNodes[i]->ID() == id)
+            return sNodes[i];
+    }
+    return NULL;
+}
+
+
+BMediaNode*
+HostMediaServer::_FindNodeByPort(port_id port)
+{
+    for (int32 i = 0; i < kMaxNodes; i++) {
+        if (sNodes[i] != NULL && sNodes[i]->ControlPort() == port)
+            return sNodes[i];
+    }
+    return NULL;
+}
+
+
+HostMediaServer::AudioDevice*
+HostMediaServer::_FindAudioDevice(media_node_id id)
+{
+    for (int32 i = 0; i < sAudioDeviceCount; i++) {
+        if (sAudioDevices[i].node.node == id)
+            return &sAudioDevices[i];
+    }
+    return NULL;
+}
+
+
+media_output
+HostMediaServer::_AudioOutput(const AudioDevice& device)
+{
+    media_output output;
+    output.node = device.node;
+    output.source.port = device.node.port;
+    output.source.id = 0;
+    output.format.type = B_MEDIA_RAW_AUDIO;
+    output.format.u.raw_audio = device.input.format;
+    copyName(output.name, device.name);
+    return output;
+}
+
+
+media_output
+HostMediaServer::_VideoOutput()
+{
+    media_output output;
+    output.node = sVideo.node;
+    output.source.port = sVideo.node.port;
+    output.source.id = 0;
+    output.format.type = B_MEDIA_RAW_VIDEO;
+    media_raw_video_format& format = output.format.u.raw_video;
+    format.field_rate = sVideo.input.fieldRate;
+    format.interlace = 1;
+    format.first_active = 0;
+    format.last_active = sVideo.input.height - 1;
+    format.orientation = B_VIDEO_TOP_LEFT_RIGHT;
+    format.pixel_width_aspect = 1;
+    format.pixel_height_aspect = 1;
+    format.display.format = sVideo.input.colorSpace;
+    format.display.line_width = sVideo.input.width;
+    format.display.line_count = sVideo.input.height;
+    copyName(output.name, sVideo.name);
+    return output;
+}
+
+
+size_t
+HostMediaServer::_VideoFrameSize(const media_format& format)
+{
+    const media_video_display_info& display = format.u.raw_video.display;
+    size_t bytesPerRow = display.bytes_per_row;
+    if (bytesPerRow == 0) {
+        BBitmap bitmap(BRect(0, 0, display.line_width - 1, 0), display.format);
+        bytesPerRow = bitmap.BytesPerRow();
+    }
+    return bytesPerRow * display.line_count;
+}
+
+
+status_t
+HostMediaServer::GetAudioInput(media_node* _node)
+{
+    if (_node == NULL)
+        return B_BAD_VALUE;
+
+    BAutolock locker(sLock);
+    _InitDevices();
+    if (sAudioDeviceCount < 1)
+        return B_MEDIA_BAD_NODE;
+    *_node = sAudioDevices[0].node;
+    return B_OK;
+}
+
+
+status_t
+HostMediaServer::GetVideoInput(media_node* _node)
+{
+    if (_node == NULL)
+        return B_BAD_VALUE;
+
+    BAutolock locker(sLock);
+    _InitDevices();
+    *_node = sVideo.node;
+    return B_OK;
+}
+
+
+status_t
+HostMediaServer::GetLiveNodeInfo(const media_node& node, live_node_info* _liveInfo)
+{
+    if (_liveInfo == NULL)
+        return B_BAD_VALUE;
+
+    BAutolock locker(sLock);
+    _InitDevices();
+    _liveInfo->node = node;
+    if (AudioDevice* device = _FindAudioDevice(node.node)) {
+        copyName(_liveInfo->name, device->name);
+        return B_OK;
+    }
+    if (node.node == sVideo.node.node) {
+        copyName(_liveInfo->name, sVideo.name);
+        return B_OK;
+    }
+    if (BMediaNode* mediaNode = _FindNode(node.node)) {
+        copyName(_liveInfo->name, mediaNode->Name());
+        return B_OK;
+    }
+    return B_MEDIA_BAD_NODE;
+}
+
+
+status_t
+HostMediaServer::GetLiveNodes(live_node_info* _liveNodes, int32* inOutTotalCount,
+    const media_format* hasInput, const media_format* hasOutput, const char* name,
+    uint64 nodeKinds)
+{
+    if (_liveNodes == NULL || inOutTotalCount == NULL || *inOutTotalCount < 1)
+        return B_BAD_VALUE;
+
+    BAutolock locker(sLock);
+    _InitDevices();
+    const int32 capacity = *inOutTotalCount;
+    int32 count = 0;
+
+    // Devices only produce, registered nodes only consume
+    const bool wantProducers = hasInput == NULL && (nodeKinds & B_BUFFER_CONSUMER) == 0;
+    const bool wantConsumers = hasOutput == NULL && (nodeKinds & B_BUFFER_PRODUCER) == 0;
+    if (wantProducers) {
+        const bool audio = hasOutput == NULL || hasOutput->type == B_MEDIA_RAW_AUDIO
+            || hasOutput->type == B_MEDIA_UNKNOWN_TYPE;
+        const bool video = hasOutput == NULL || hasOutput->type == B_MEDIA_RAW_VIDEO
+            || hasOutput->type == B_MEDIA_UNKNOWN_TYPE;
+        for (int32 i = 0; audio && i < sAudioDeviceCount && count < capacity; i++) {
+            if (!nameMatches(sAudioDevices[i].name, name))
+                continue;
+            _liveNodes[count].node = sAudioDevices[i].node;
+            copyName(_liveNodes[count].name, sAudioDevices[i].name);
+            count++;
+        }
+        if (video && count < capacity && nameMatches(sVideo.name, name)) {
+            _liveNodes[count].node = sVideo.node;
+            copyName(_liveNodes[count].name, sVideo.name);
+            count++;
+        }
+    }
+    for (int32 i = 0; wantConsumers && i < kMaxNodes && count < capacity; i++) {
+        BBufferConsumer* consumer = dynamic_cast<BBufferConsumer*>(sNodes[i]);
+        if (consumer == NULL || !nameMatches(sNodes[i]->Name(), name))
+            continue;
+        if (hasInput != NULL && hasInput->type != B_MEDIA_UNKNOWN_TYPE
+                && hasInput->type != consumer->fConsumerType)
+            continue;
+        _liveNodes[count].node = sNodes[i]->Node();
+        copyName(_liveNodes[count].name, sNodes[i]->Name());
+        count++;
+    }
+
+    *inOutTotalCount = count;
+    return B_OK;
+}
+
+
+status_t
+HostMediaServer::GetFreeInputsFor(const media_node& node, media_input* _inputs, int32 capacity,
+    int32* _foundCount, media_type filterType)
+{
+    if (_inputs == NULL || _foundCount == NULL || capacity < 1)
+        return B_BAD_VALUE;
+
+    BAutolock locker(sLock);
+    BBufferConsumer* consumer = dynamic_cast<BBufferConsumer*>(_FindNode(node.node));
+    if (consumer == NULL)
+        return B_MEDIA_BAD_NODE;
+
+    int32 count = 0;
+    int32 cookie = 0;
+    media_input input;
+    while (count < capacity && consumer->GetNextInput(&cookie, &input) == B_OK) {
+        if (input.source != media_source::null)
+            continue;
+        if (filterType != B_MEDIA_UNKNOWN_TYPE && input.format.type != filterType)
+            continue;
+        _inputs[count++] = input;
+    }
+    consumer->DisposeInputCookie(cookie);
+
+    *_foundCount = count;
+    return B_OK;
+}
+
+
+// Audio inputs take any number of recorders
+status_t
+HostMediaServer::GetFreeOutputsFor(const media_node& node, media_output* _outputs,
+    int32 capacity, int32* _foundCount, media_type filterType)
+{
+    if (_outputs == NULL || _foundCount == NULL || capacity < 1)
+        return B_BAD_VALUE;
+
+    BAutolock locker(sLock);
+    _InitDevices();
+    *_foundCount = 0;
+    if (AudioDevice* device = _FindAudioDevice(node.node)) {
+        if (filterType == B_MEDIA_UNKNOWN_TYPE || filterType == B_MEDIA_RAW_AUDIO) {
+            _outputs[0] = _AudioOutput(*device);
+            *_foundCount = 1;
+        }
+        return B_OK;
+    }
+    if (node.node == sVideo.node.node) {
+        if (sVideo.consumer == NULL
+                && (filterType == B_MEDIA_UNKNOWN_TYPE || filterType == B_MEDIA_RAW_VIDEO)) {
+            _outputs[0] = _VideoOutput();
+            *_foundCount = 1;
+        }
+        return B_OK;
+    }
+    return _FindNode(node.node) != NULL ? B_OK : B_MEDIA_BAD_NODE;
+}
+
+
+status_t
+HostMediaServer::RegisterNode(BMediaNode* node)
+{
+    if (node == NULL)
+        return B_BAD_VALUE;
+
+    {
+        BAutolock locker(sLock);
+        _InitDevices();
+        int32 slot = -1;
+        for (int32 i = 0; i < kMaxNodes; i++) {
+            if (sNodes[i] == node)
+                return B_MEDIA_NODE_ALREADY_EXISTS;
+            if (sNodes[i] == NULL && slot < 0)
+                slot = i;
+        }
+        if (slot < 0)
+            return B_MEDIA_TOO_MANY_NODES;
+
+        node->fNodeID = sNextNodeID++;
+        sNodes[slot] = node;
+    }
+
+    node->NodeRegistered();
+    return B_OK;
+}
+
+
+status_t
+HostMediaServer::UnregisterNode(BMediaNode* node)
+{
+    BAutolock locker(sLock);
+    for (int32 i = 0; i < kMaxNodes; i++) {
+        if (sNodes[i] == node) {
+            sNodes[i] = NULL;
+            return B_OK;
+        }
+    }
+    return B_MEDIA_BAD_NODE;
+}
+
+
+void
+HostMediaServer::NodeDeleted(BMediaNode* node)
+{
+    BAutolock locker(sLock);
+    for (int32 i = 0; i < kMaxNodes; i++) {
+        if (sNodes[i] == node)
+            sNodes[i] = NULL;
+    }
+}
+
+
+// Only the video input connects through the roster, audio inputs connect
+// to a BMediaRecorder
+status_t
+HostMediaServer::Connect(const media_source& from, const media_destination& to,
+    media_format* format, media_output* _output, media_input* _input)
+{
+    if (format == NULL || _output == NULL || _input == NULL)
+        return B_BAD_VALUE;
+
+    BBufferConsumer* consumer;
+    media_output output;
+    {
+        BAutolock locker(sLock);
+        _InitDevices();
+        if (from.port != sVideo.node.port || from.id != 0)
+            return B_MEDIA_BAD_SOURCE;
+        if (sVideo.consumer != NULL)
+            return B_MEDIA_ALREADY_CONNECTED;
+        consumer = dynamic_cast<BBufferConsumer*>(_FindNodeByPort(to.port));
+        if (consumer == NULL)
+            return B_MEDIA_BAD_DESTINATION;
+
+        // Wildcards take the device's values, anything else has to match
+        output = _VideoOutput();
+        const media_raw_video_format& device = output.format.u.raw_video;
+        if (format->type == B_MEDIA_UNKNOWN_TYPE || format->type == B_MEDIA_NO_TYPE)
+            format->type = B_MEDIA_RAW_VIDEO;
+        media_raw_video_format& video = format->u.raw_video;
+        if (format->type != B_MEDIA_RAW_VIDEO
+                || (video.display.format != B_NO_COLOR_SPACE
+                    && video.display.format != device.display.format)
+                || (video.display.line_width != 0
+                    && video.display.line_width != device.display.line_width)
+                || (video.display.line_count != 0
+                    && video.display.line_count != device.display.line_count)) {
+            return B_MEDIA_BAD_FORMAT;
+        }
+        if (video.field_rate == 0.0f)
+            video.field_rate = device.field_rate;
+        if (video.interlace == 0)
+            video.interlace = device.interlace;
+        if (video.last_active == 0)
+            video.last_active = device.last_active;
+        if (video.orientation == 0)
+            video.orientation = device.orientation;
+        if (video.pixel_width_aspect == 0)
+            video.pixel_width_aspect = device.pixel_width_aspect;
+        if (video.pixel_height_aspect == 0)
+            video.pixel_height_aspect = device.pixel_height_aspect;
+        video.display.format = device.display.format;
+        video.display.line_width = device.display.line_width;
+        video.display.line_count = device.display.line_count;
+
+        sVideo.consumer = consumer;
+        sVideo.source = from;
+        sVideo.destination = to;
+    }
+
+    // The consumer may hand over its buffers from Connected()
+    status_t status = consumer->AcceptFormat(to, format);
+    if (status == B_OK)
+        status = consumer->Connected(from, to, *format, _input);
+    media_node_id timeSource;
+    if (status == B_OK)
+        status = consumer->GetLatencyFor(to, &sVideo.downstreamLatency, &timeSource);
+    if (status != B_OK) {
+        BAutolock locker(sLock);
+        sVideo.consumer = NULL;
+        sVideo.consumerGroup = NULL;
+        return status;
+    }
+
+    BAutolock locker(sLock);
+    sVideo.format = _input->format;
+    sVideo.ownGroup = new BBufferGroup(_VideoFrameSize(sVideo.format), kVideoBufferCount);
+    if (sVideo.ownGroup->InitCheck() != B_OK) {
+        status = sVideo.ownGroup->InitCheck();
+        delete sVideo.ownGroup;
+        sVideo.ownGroup = NULL;
+        locker.Unlock();
+        Disconnect(from, to);
+        return status;
+    }
+
+    output.destination = to;
+    output.format = sVideo.format;
+    *_output = output;
+    *format = sVideo.format;
+    return B_OK;
+}
+
+
+status_t
+HostMediaServer::Disconnect(const media_source& source, const media_destination& destination)
+{
+    BBufferConsumer* consumer;
+    {
+        BAutolock locker(sLock);
+        if (sVideo.consumer == NULL || source != sVideo.source || destination != sVideo.destination)
+            return B_MEDIA_NOT_CONNECTED;
+        consumer = sVideo.consumer;
+    }
+
+    _StopVideo();
+    consumer->Disconnected(source, destination);
+
+    BAutolock locker(sLock);
+    sVideo.consumer = NULL;
+    sVideo.consumerGroup = NULL;
+    if (sVideo.ownGroup != NULL) {
+        // Buffers still queued at the consumer come back when it handles
+        // or flushes them
+        sVideo.ownGroup->ReclaimAllBuffers();
+        delete sVideo.ownGroup;
+        sVideo.ownGroup = NULL;
+    }
+    return B_OK;
+}
+
+
+status_t
+HostMediaServer::SetOutputBuffersFor(const media_source& source,
+    const media_destination& destination, BBufferGroup* group, int32* changeTag)
+{
+    BBufferConsumer* consumer;
+    media_request_info info;
+    info.what = media_request_info::B_SET_OUTPUT_BUFFERS_FOR;
+    info.source = source;
+    info.destination = destination;
+    {
+        BAutolock locker(sLock);
+        if (sVideo.consumer == NULL || source != sVideo.source || destination != sVideo.destination)
+            return B_MEDIA_BAD_DESTINATION;
+        consumer = sVideo.consumer;
+
+        // A producer that doesn't use the group still accepts it
+        sVideo.consumerGroup = sVideo.input.useConsumerBuffers ? group : NULL;
+        info.status = B_OK;
+        if (changeTag != NULL)
+            (*changeTag)++;
+        info.change_tag = changeTag != NULL ? *changeTag : 0;
+        info.format = sVideo.format;
+    }
+
+    consumer->RequestCompleted(info);
+    return B_OK;
+}
+
+
+status_t
+HostMediaServer::StartNode(const media_node& node, bigtime_t performanceTime)
+{
+    BAutolock locker(sLock);
+    _InitDevices();
+    if (_FindAudioDevice(node.node) != NULL)
+        return B_OK;
+
+    if (node.node == sVideo.node.node) {
+        if (sVideo.consumer == NULL)
+            return B_MEDIA_NOT_CONNECTED;
+        if (sVideo.thread >= 0)
+            return B_OK;
+
+        sVideo.startTime = performanceTime;
+        sVideo.framesSent = 0;
+        sVideo.framesDropped = 0;
+        sVideo.running = true;
+        sVideo.thread = spawn_thread(_VideoThread, sVideo.name,
+            suggest_thread_priority(B_VIDEO_RECORDING), NULL);
+        if (sVideo.thread < 0) {
+            const status_t status = sVideo.thread;
+            sVideo.thread = -1;
+            sVideo.running = false;
+            return status;
+        }
+        return resume_thread(sVideo.thread);
+    }
+
+    BMediaNode* mediaNode = _FindNode(node.node);
+    if (mediaNode == NULL)
+        return B_MEDIA_BAD_NODE;
+
+    mediaNode->fBuffersHandled = 0;
+    mediaNode->fBufferTime = 0;
+    mediaNode->fMaxBufferTime = 0;
+    return write_port(mediaNode->ControlPort(), HOST_NODE_START, &performanceTime,
+        sizeof(performanceTime));
+}
+
+
+status_t
+HostMediaServer::StopNode(const media_node& node, bigtime_t performanceTime, bool immediate)
+{
+    BMediaEventLooper* looper;
+    int32 stops = 0;
+    {
+        BAutolock locker(sLock);
+        _InitDevices();
+        if (_FindAudioDevice(node.node) != NULL)
+            return B_OK;
+
+        if (node.node == sVideo.node.node) {
+            locker.Unlock();
+            _StopVideo();
+            return B_OK;
+        }
+
+        BMediaNode* mediaNode = _FindNode(node.node);
+        if (mediaNode == NULL)
+            return B_MEDIA_BAD_NODE;
+
+        looper = immediate ? dynamic_cast<BMediaEventLooper*>(mediaNode) : NULL;
+        if (looper != NULL)
+            stops = StopsHandled(looper);
+
+        const HostStopMessage message = { performanceTime, immediate };
+        const status_t status = write_port(mediaNode->ControlPort(), HOST_NODE_STOP, &message,
+            sizeof(message));
+        if (status != B_OK)
+            return status;
+    }
+
+    if (looper == NULL)
+        return B_OK;
+
+    const bigtime_t timeout = system_time() + kStopTimeout;
+    while (StopsHandled(looper) == stops) {
+        if (system_time() > timeout)
+            return B_TIMED_OUT;
+        snooze(1000);
+    }
+    return B_OK;
+}
+
+
+void
+HostMediaServer::_StopVideo()
+{
+    thread_id thread;
+    {
+        BAutolock locker(sLock);
+        thread = sVideo.thread;
+        sVideo.running = false;
+        sVideo.thread = -1;
+    }
+    if (thread >= 0)
+        wait_for_thread(thread, NULL);
+}
+
+
+// Sends frames until stopped or frameCount frames are out. The first word
+// of every frame is its number.
+int32
+HostMediaServer::_VideoThread(void* /*cookie*/)
+{
+    VideoDevice& video = sVideo;
+    const bigtime_t period = static_cast<bigtime_t>(1000000 / video.input.fieldRate);
+    const size_t frameSize = _VideoFrameSize(video.format);
+    BMediaEventLooper* looper = dynamic_cast<BMediaEventLooper*>(video.consumer);
+
+    // Frames that arrive before the consumer has started are thrown away
+    const bigtime_t startTimeout = system_time() + kConsumerStartTimeout;
+    while (video.running && looper != NULL && looper->RunState() != BMediaEventLooper::B_STARTED
+            && system_time() < startTimeout) {
+        snooze(500);
+    }
+
+    bigtime_t next = video.startTime;
+    for (uint64 frame = 0; video.running
+            && (video.input.frameCount == 0 || frame < video.input.frameCount); frame++) {
+        if (video.input.realtime) {
+            // Sent ahead by the consumer's latency to arrive in time
+            snooze_until(next - video.downstreamLatency, B_SYSTEM_TIMEBASE);
+        }
+
+        BBufferGroup* group = video.consumerGroup.load();
+        if (group == NULL)
+            group = video.ownGroup;
+        BBuffer* buffer = group->RequestBuffer(frameSize,
+            video.input.realtime ? period : kConsumerStartTimeout);
+        if (buffer == NULL) {
+            video.framesDropped++;
+            next += period;
+            continue;
+        }
+
+        memcpy(buffer->Data(), &frame, sizeof(frame));
+        media_header* header = buffer->Header();
+        header->type = B_MEDIA_RAW_VIDEO;
+        header->size_used = static_cast<uint32>(frameSize);
+        header->start_time = video.input.realtime ? next : system_time();
+        header->time_source = sTimeSource->ID();
+        header->destination = video.destination.id;
+        header->u.raw_video.field_sequence = static_cast<uint32>(frame);
+        header->u.raw_video.line_count = video.format.u.raw_video.display.line_count;
+
+        if (write_port(video.destination.port, HOST_BUFFER_RECEIVED, &buffer, sizeof(buffer))
+                != B_OK) {
+            buffer->Recycle();
+            video.framesDropped++;
+        } else {
+            video.framesSent++;
+        }
+        next += period;
+    }
+    return B_OK;
+}
+
+
+status_t
+HostMediaServer::OpenAudioInput(const media_node& node, const media_output* output,
+    const media_format* format, HostRecorderSource*& _source, media_output& _output)
+{
+    BAutolock locker(sLock);
+    _InitDevices();
+    AudioDevice* device = _FindAudioDevice(node.node);
+    if (device == NULL)
+        return B_MEDIA_BAD_NODE;
+    if (output != NULL && output->source != _AudioOutput(*device).source)
+        return B_MEDIA_BAD_SOURCE;
+
+    // Wildcards take the device's values, anything else has to match
+    const media_multi_audio_format& deviceFormat = device->input.format;
+    if (format != NULL) {
+        const media_multi_audio_format& requested = format->u.raw_audio;
+        if ((format->type != B_MEDIA_RAW_AUDIO && format->type != B_MEDIA_UNKNOWN_TYPE)
+                || (requested.frame_rate != 0.0f && requested.frame_rate != deviceFormat.frame_rate)
+                || (requested.channel_count != 0
+                    && requested.channel_count != deviceFormat.channel_count)
+                || (requested.format != 0 && requested.format != deviceFormat.format)) {
+            return B_MEDIA_BAD_FORMAT;
+        }
+    }
+
+    const size_t frameSize = deviceFormat.channel_count * sampleSize(deviceFormat.format);
+    if (frameSize == 0 || deviceFormat.buffer_size < frameSize || deviceFormat.frame_rate <= 0.0f)
+        return B_MEDIA_BAD_FORMAT;
+
+    HostRecorderSource* source = static_cast<HostRecorderSource*>(
+        calloc(1, sizeof(HostRecorderSource)));
+    if (source == NULL)
+        return B_NO_MEMORY;
+    source->input = device->input;
+    source->format.type = B_MEDIA_RAW_AUDIO;
+    source->format.u.raw_audio = deviceFormat;
+    source->switchFormat = source->format;
+    source->frameCount = deviceFormat.buffer_size / frameSize;
+    source->format.u.raw_audio.buffer_size = source->frameCount * frameSize;
+    if (source->input.switchAfter > 0) {
+        media_multi_audio_format& switched = source->switchFormat.u.raw_audio;
+        switched.format = source->input.switchFormat;
+        switched.buffer_size = source->frameCount * switched.channel_count
+            * sampleSize(switched.format);
+        switched.valid_bits = static_cast<int16>(sampleSize(switched.format) * 8);
+    }
+
+    // About a second of device buffers, each allocated on its own so that
+    // reading past one is caught by the usual tools
+    size_t bufferCount = static_cast<size_t>(deviceFormat.frame_rate / source->frameCount + 0.5);
+    source->bufferCount = bufferCount > 0 ? bufferCount : 1;
+    source->buffers = static_cast<uint8**>(calloc(source->bufferCount, sizeof(uint8*)));
+    source->switchBuffers = static_cast<uint8**>(calloc(source->bufferCount, sizeof(uint8*)));
+    bool failed = source->buffers == NULL || source->switchBuffers == NULL;
+    HostAudioFillFunc fill = source->input.fill != NULL ? source->input.fill : fillSine;
+    for (size_t i = 0; !failed && i < source->bufferCount; i++) {
+        const uint64 firstFrame = static_cast<uint64>(i) * source->frameCount;
+        source->buffers[i] = static_cast<uint8*>(malloc(source->format.u.raw_audio.buffer_size));
+        failed = source->buffers[i] == NULL;
+        if (!failed) {
+            fill(source->buffers[i], source->frameCount, source->format.u.raw_audio, firstFrame,
+                source->input.cookie);
+        }
+        if (!failed && source->input.switchAfter > 0) {
+            const size_t size = source->switchFormat.u.raw_audio.buffer_size;
+            source->switchBuffers[i] = static_cast<uint8*>(malloc(size > 0 ? size : 1));
+            failed = source->switchBuffers[i] == NULL;
+            if (!failed) {
+                fill(source->switchBuffers[i], source->frameCount, source->switchFormat.u.raw_audio,
+                    firstFrame, source->input.cookie);
+            }
+        }
+    }
+    if (failed) {
+        CloseAudioInput(source);
+        return B_NO_MEMORY;
+    }
+
+    device->openCount++;
+    _source = source;
+    _output = _AudioOutput(*device);
+    return B_OK;
+}
+
+
+void
+HostMediaServer::CloseAudioInput(HostRecorderSource* source)
+{
+    if (source == NULL)
+        return;
+
+    {
+        BAutolock locker(sLock);
+        for (int32 i = 0; i < sAudioDeviceCount; i++) {
+            if (source->buffers != NULL && source->buffers[0] != NULL
+                    && strcmp(sAudioDevices[i].name, source->input.name) == 0
+                    && sAudioDevices[i].openCount > 0) {
+                sAudioDevices[i].openCount--;
+                break;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < source->bufferCount; i++) {
+        if (source->buffers != NULL)
+            free(source->buffers[i]);
+        if (source->switchBuffers != NULL)
+            free(source->switchBuffers[i]);
+    }
+    free(source->buffers);
+    free(source->switchBuffers);
+    free(source);
+}
+
+
+status_t
+HostMediaServer::HandleNodeMessage(BMediaNode* node, int32 code, const void* data, size_t size)
+{
+    switch (code) {
+        case HOST_NODE_START:
+            if (size != sizeof(bigtime_t))
+                return B_BAD_DATA;
+            node->Start(*static_cast<const bigtime_t*>(data));
+            return B_OK;
+
+        case HOST_NODE_STOP:
+        {
+            if (size != sizeof(HostStopMessage))
+                return B_BAD_DATA;
+            const HostStopMessage* message = static_cast<const HostStopMessage*>(data);
+            node->Stop(message->performanceTime, message->immediate);
+            return B_OK;
+        }
+
+        case HOST_BUFFER_RECEIVED:
+        {
+            BBufferConsumer* consumer = dynamic_cast<BBufferConsumer*>(node);
+            if (consumer == NULL || size != sizeof(BBuffer*))
+                return B_BAD_DATA;
+            BBuffer* buffer;
+            memcpy(&buffer, data, sizeof(buffer));
+            const bigtime_t start = system_time_nsecs();
+            sInEventHandler = true;
+            consumer->BufferReceived(buffer);
+            sInEventHandler = false;
+            AccountBuffer(node, system_time_nsecs() - start, false);
+            return B_OK;
+        }
+
+        default:
+            return B_ERROR;
+    }
+}
+
+
+// Only the control thread of the node writes these
+void
+HostMediaServer::AccountBuffer(BMediaNode* node, bigtime_t time, bool handled)
+{
+    node->fBufferTime += time;
+    if (handled) {
+        node->fBuffersHandled++;
+        if (time > node->fMaxBufferTime)
+            node->fMaxBufferTime = time;
+    }
+}
+
+
+int32
+HostMediaServer::StopsHandled(BMediaEventLooper* looper)
+{
+    return __atomic_load_n(&looper->fStopsHandled, __ATOMIC_ACQUIRE);
+}
+
+
+void
+HostMediaServer::StopHandled(BMediaEventLooper* looper)
+{
+    __atomic_add_fetch(&looper->fStopsHandled, 1, __ATOMIC_RELEASE);
+}
+
+
+// #pragma mark - Host interface
+
+
+void
+hostDefaultAudioInput(HostAudioInput& input)
+{
+    memset(&input, 0, sizeof(input));
+    input.name = "Host audio input";
+    input.format.frame_rate = 48000.0f;
+    input.format.channel_count = 2;
+    input.format.format = media_raw_audio_format::B_AUDIO_SHORT;
+    input.format.byte_order = B_MEDIA_HOST_ENDIAN;
+    input.format.buffer_size = 1024 * 2 * sizeof(int16);
+    input.format.channel_mask = B_CHANNEL_LEFT | B_CHANNEL_RIGHT;
+    input.format.valid_bits = 16;
+    input.realtime = true;
+}
+
+
+void
+hostDefaultVideoInput(HostVideoInput& input)
+{
+    memset(&input, 0, sizeof(input));
+    input.name = "Host video input";
+    input.width = 640;
+    input.height = 480;
+    input.colorSpace = B_RGB32;
+    input.fieldRate = 30.0f;
+    input.realtime = true;
+    input.useConsumerBuffers = true;
+}
+
+
+status_t
+hostSetAudioInputs(const HostAudioInput* inputs, int32 count)
+{
+    return HostMediaServer::SetAudioInputs(inputs, count);
+}
+
+
+status_t
+hostSetVideoInput(const HostVideoInput& input)
+{
+    return HostMediaServer::SetVideoInput(input);
+}
+
+
+status_t
+hostGetVideoStats(HostVideoStats& stats)
+{
+    return HostMediaServer::GetVideoStats(stats);
+}
+
+
+status_t
+hostGetNodeStats(const media_node& node, HostNodeStats& stats)
+{
+    return HostMediaServer::GetNodeStats(node, stats);
+}
+
+
+bool
+hostInEventHandler()
+{
+    return sInEventHandler;
+}
+
+
+// #pragma mark - BApplication
+
+
+BApplication* be_app = NULL;
+
+
+// #pragma mark - MediaDefs
+
+
+media_node media_node::null;
+media_source media_source::null;
+media_destination media_destination::null;
+media_raw_audio_format media_raw_audio_format::wildcard;
+media_multi_audio_format media_multi_audio_format::wildcard;
+media_raw_video_format media_raw_video_format::wildcard;
+
+
+media_node::media_node()
+    : node(-1),
+      port(-1),
+      kind(0)
+{
+}
+
+
+media_source::media_source()
+    : port(-1),
+      id(-1)
+{
+}
+
+
+media_destination::media_destination()
+    : port(-1),
+      id(-1)
+{
+}
+
+
+bool
+operator==(const media_node& a, const media_node& b)
+{
+    return a.node == b.node && a.port == b.port && a.kind == b.kind;
+}
+
+
+bool
+operator!=(const media_node& a, const media_node& b)
+{
+    return !(a == b);
+}
+
+
+bool
+operator==(const media_source& a, const media_source& b)
+{
+    return a.port == b.port && a.id == b.id;
+}
+
+
+bool
+operator!=(const media_source& a, const media_source& b)
+{
+    return !(a == b);
+}
+
+
+bool
+operator==(const media_destination& a, const media_destination& b)
+{
+    return a.port == b.port && a.id == b.id;
+}
+
+
+bool
+operator!=(const media_destination& a, const media_destination& b)
+{
+    return !(a == b);
+}
+
+
+media_input::media_input()
+{
+    memset(name, 0, sizeof(name));
+}
+
+
+media_output::media_output()
+{
+    memset(name, 0, sizeof(name));
+}
+
+
+live_node_info::live_node_info()
+{
+    memset(name, 0, sizeof(name));
+}
+
+
+buffer_clone_info::buffer_clone_info()
+    : buffer(0),
+      area(0),
+      offset(0),
+      size(0),
+      flags(0)
+{
+    memset(_reserved_, 0, sizeof(_reserved_));
+}
+
+
+// #pragma mark - BMediaNode
+
+
+BMediaNode::BMediaNode(const char* name)
+    : fNodeID(-1),
+      fKinds(0),
+      fRunMode(B_INCREASE_LATENCY),
+      fBuffersHandled(0),
+      fBufferTime(0),
+      fMaxBufferTime(0)
+{
+    copyName(fName, name);
+    fControlPort = create_port(kControlPortCapacity, fName);
+}
+
+
+BMediaNode::~BMediaNode()
+{
+    HostMediaServer::NodeDeleted(this);
+    delete_port(fControlPort);
+}
+
+
+media_node
+BMediaNode::Node() const
+{
+    media_node node;
+    node.node = fNodeID;
+    node.port = fControlPort;
+    node.kind = static_cast<uint32>(fKinds);
+    return node;
+}
+
+
+BTimeSource*
+BMediaNode::TimeSource() const
+{
+    return HostMediaServer::TimeSource();
+}
+
+
+status_t
+BMediaNode::HandleMessage(int32 /*message*/, const void* /*data*/, size_t /*size*/)
+{
+    return B_ERROR;
+}
+
+
+status_t
+BMediaNode::RequestCompleted(const media_request_info& /*info*/)
+{
+    return B_OK;
+}
+
+
+void
+BMediaNode::Start(bigtime_t /*atPerformanceTime*/)
+{
+}
+
+
+void
+BMediaNode::Stop(bigtime_t /*atPerformanceTime*/, bool /*immediate*/)
+{
+}
+
+
+void
+BMediaNode::Seek(bigtime_t /*toMediaTime*/, bigtime_t /*atPerformanceTime*/)
+{
+}
+
+
+void
+BMediaNode::TimeWarp(bigtime_t /*atRealTime*/, bigtime_t /*toPerformanceTime*/)
+{
+}
+
+
+void
+BMediaNode::SetRunMode(run_mode mode)
+{
+    fRunMode = mode;
+}
+
+
+void
+BMediaNode::NodeRegistered()
+{
+}
+
+
+status_t
+BMediaNode::WaitForMessage(bigtime_t waitUntil, uint32 /*flags*/, void* /*_reserved_*/)
+{
+    uint8 data[HOST_PORT_MESSAGE_SIZE];
+    int32 code;
+    const ssize_t size = read_port_etc(fControlPort, &code, data, sizeof(data),
+        B_ABSOLUTE_TIMEOUT, waitUntil);
+    if (size < 0)
+        return static_cast<status_t>(size);
+
+    // The stand-in's own messages first, like the base class handlers on
+    // Haiku
+    if (HostMediaServer::HandleNodeMessage(this, code, data, size) != B_OK)
+        HandleMessage(code, data, size);
+    return B_OK;
+}
+
+
+// #pragma mark - BTimeSource
+
+
+BTimeSource::BTimeSource()
+    : BMediaNode("called by BTimeSource")
+{
+    AddNodeKind(B_TIME_SOURCE);
+}
+
+
+BTimeSource::~BTimeSource()
+{
+}
+
+
+// #pragma mark - BTimedEventQueue
+
+
+media_timed_event::media_timed_event()
+{
+    memset(static_cast<void*>(this), 0, sizeof(*this));
+}
+
+
+media_timed_event::media_timed_event(bigtime_t inTime, int32 inType)
+{
+    memset(static_cast<void*>(this), 0, sizeof(*this));
+    event_time = inTime;
+    type = inType;
+}
+
+
+media_timed_event::media_timed_event(bigtime_t inTime, int32 inType, void* inPointer,
+    uint32 inCleanup)
+{
+    memset(static_cast<void*>(this), 0, sizeof(*this));
+    event_time = inTime;
+    type = inType;
+    pointer = inPointer;
+    cleanup = inCleanup;
+}
+
+
+media_timed_event::media_timed_event(bigtime_t inTime, int32 inType, void* inPointer,
+    uint32 inCleanup, int32 inData, int64 inBigdata, const char* inUserData, size_t dataSize)
+{
+    memset(static_cast<void*>(this), 0, sizeof(*this));
+    event_time = inTime;
+    type = inType;
+    pointer = inPointer;
+    cleanup = inCleanup;
+    data = inData;
+    bigdata = inBigdata;
+    if (inUserData != NULL)
+        memcpy(user_data, inUserData, dataSize < sizeof(user_data) ? dataSize : sizeof(user_data));
+}
+
+
+BTimedEventQueue::BTimedEventQueue()
+    : fLock("timed event queue"),
+      fCount(0),
+      fCleanupHook(NULL),
+      fCleanupContext(NULL)
+{
+}
+
+
+BTimedEventQueue::~BTimedEventQueue()
+{
+    FlushEvents(0, B_ALWAYS);
+}
+
+
+// After the events of the same time, so those run in the order added
+status_t
+BTimedEventQueue::AddEvent(const media_timed_event& event)
+{
+    if (event.type <= B_ANY_EVENT)
+        return B_BAD_VALUE;
+
+    BAutolock locker(fLock);
+    if (fCount == kCapacity)
+        return B_NO_MEMORY;
+
+    int32 index = fCount;
+    while (index > 0 && fEvents[index - 1].event_time > event.event_time)
+        index--;
+    memmove(&fEvents[index + 1], &fEvents[index], (fCount - index) * sizeof(media_timed_event));
+    fEvents[index] = event;
+    fCount++;
+    return B_OK;
+}
+
+
+status_t
+BTimedEventQueue::RemoveEvent(const media_timed_event* event)
+{
+    if (event == NULL)
+        return B_BAD_VALUE;
+
+    BAutolock locker(fLock);
+    for (int32 i = 0; i < fCount; i++) {
+        if (&fEvents[i] == event || memcmp(&fEvents[i], event, sizeof(*event)) == 0) {
+            memmove(&fEvents[i], &fEvents[i + 1], (fCount - i - 1) * sizeof(media_timed_event));
+            fCount--;
+            return B_OK;
+        }
+    }
+    return B_ERROR;
+}
+
+
+status_t
+BTimedEventQueue::RemoveFirstEvent(media_timed_event* _event)
+{
+    BAutolock locker(fLock);
+    if (fCount == 0)
+        return B_ERROR;
+
+    if (_event != NULL)
+        *_event = fEvents[0];
+    else
+        _CleanUp(fEvents[0]);
+    memmove(&fEvents[0], &fEvents[1], (fCount - 1) * sizeof(media_timed_event));
+    fCount--;
+    return B_OK;
+}
+
+
+bool
+BTimedEventQueue::HasEvents() const
+{
+    BAutolock locker(fLock);
+    return fCount > 0;
+}
+
+
+int32
+BTimedEventQueue::EventCount() const
+{
+    BAutolock locker(fLock);
+    return fCount;
+}
+
+
+const media_timed_event*
+BTimedEventQueue::FirstEvent() const
+{
+    BAutolock locker(fLock);
+    return fCount > 0 ? &fEvents[0] : NULL;
+}
+
+
+bigtime_t
+BTimedEventQueue::FirstEventTime() const
+{
+    BAutolock locker(fLock);
+    return fCount > 0 ? fEvents[0].event_time : B_INFINITE_TIMEOUT;
+}
+
+
+const media_timed_event*
+BTimedEventQueue::LastEvent() const
+{
+    BAutolock locker(fLock);
+    return fCount > 0 ? &fEvents[fCount - 1] : NULL;
+}
+
+
+bigtime_t
+BTimedEventQueue::LastEventTime() const
+{
+    BAutolock locker(fLock);
+    return fCount > 0 ? fEvents[fCount - 1].event_time : B_INFINITE_TIMEOUT;
+}
+
+
+void
+BTimedEventQueue::SetCleanupHook(cleanup_hook hook, void* context)
+{
+    BAutolock locker(fLock);
+    fCleanupHook = hook;
+    fCleanupContext = context;
+}
+
+
+status_t
+BTimedEventQueue::FlushEvents(bigtime_t eventTime, time_direction direction, bool inclusive,
+    int32 eventType)
+{
+    BAutolock locker(fLock);
+    int32 kept = 0;
+    for (int32 i = 0; i < fCount; i++) {
+        if (_Matches(fEvents[i], eventTime, direction, inclusive, eventType)) {
+            _CleanUp(fEvents[i]);
+            continue;
+        }
+        if (kept != i)
+            fEvents[kept] = fEvents[i];
+        kept++;
+    }
+    fCount = kept;
+    return B_OK;
+}
+
+
+bool
+BTimedEventQueue::_Matches(const media_timed_event& event, bigtime_t eventTime,
+    time_direction direction, bool inclusive, int32 eventType) const
+{
+    if (eventType != B_ANY_EVENT && event.type != eventType)
+        return false;
+
+    switch (direction) {
+        case B_ALWAYS:
+            return true;
+        case B_BEFORE_TIME:
+            return event.event_time < eventTime || (inclusive && event.event_time == eventTime);
+        case B_AT_TIME:
+            return event.event_time == eventTime;
+        case B_AFTER_TIME:
+            return event.event_time > eventTime || (inclusive && event.event_time == eventTime);
+        default:
+            return false;
+    }
+}
+
+
+void
+BTimedEventQueue::_CleanUp(const media_timed_event& event)
+{
+    if (event.cleanup == B_RECYCLE_BUFFER) {
+        if (event.type == B_HANDLE_BUFFER && event.pointer != NULL)
+            static_cast<BBuffer*>(event.pointer)->Recycle();
+    } else if (event.cleanup >= B_USER_CLEANUP && fCleanupHook != NULL) {
+        fCleanupHook(&event, fCleanupContext);
+    }
+}
+
+
+// #pragma mark - BMediaEventLooper
+
+
+BMediaEventLooper::BMediaEventLooper(uint32 /*apiVersion*/)
+    : BMediaNode("called by BMediaEventLooper"),
+      fControlThread(-1),
+      fCurrentPriority(B_URGENT_PRIORITY),
+      fSetPriority(B_URGENT_PRIORITY),
+      fRunState(B_UNREGISTERED),
+      fEventLatency(0),
+      fSchedulingLatency(0),
+      fBufferDuration(0),
+      fStopsHandled(0)
+{
+    fEventQueue.SetCleanupHook(_CleanUpEntry, this);
+}
+
+
+BMediaEventLooper::~BMediaEventLooper()
+{
+    // Subclasses should have called Quit() from their destructor already
+    if (fControlThread >= 0)
+        Quit();
+}
+
+
+void
+BMediaEventLooper::NodeRegistered()
+{
+    Run();
+}
+
+
+void
+BMediaEventLooper::Start(bigtime_t performanceTime)
+{
+    fEventQueue.AddEvent(media_timed_event(performanceTime, BTimedEventQueue::B_START));
+}
+
+
+// An immediate stop goes ahead of everything queued
+void
+BMediaEventLooper::Stop(bigtime_t performanceTime, bool immediate)
+{
+    fEventQueue.AddEvent(media_timed_event(immediate ? 0 : performanceTime,
+        BTimedEventQueue::B_STOP));
+}
+
+
+void
+BMediaEventLooper::Seek(bigtime_t mediaTime, bigtime_t performanceTime)
+{
+    fEventQueue.AddEvent(media_timed_event(performanceTime, BTimedEventQueue::B_SEEK, NULL,
+        BTimedEventQueue::B_NO_CLEANUP, 0, mediaTime, NULL));
+}
+
+
+void
+BMediaEventLooper::TimeWarp(bigtime_t atRealTime, bigtime_t toPerformanceTime)
+{
+    fEventQueue.AddEvent(media_timed_event(atRealTime, BTimedEventQueue::B_WARP, NULL,
+        BTimedEventQueue::B_NO_CLEANUP, 0, toPerformanceTime, NULL));
+}
+
+
+status_t
+BMediaEventLooper::AddTimer(bigtime_t atPerformanceTime, int32 cookie)
+{
+    return fEventQueue.AddEvent(media_timed_event(atPerformanceTime, BTimedEventQueue::B_TIMER,
+        NULL, BTimedEventQueue::B_EXPIRE_TIMER, cookie, 0, NULL));
+}
+
+
+void
+BMediaEventLooper::SetRunMode(run_mode mode)
+{
+    BMediaNode::SetRunMode(mode);
+}
+
+
+void
+BMediaEventLooper::CleanUpEvent(const media_timed_event* /*event*/)
+{
+}
+
+
+// Handles messages until the first event is due, then dispatches it
+void
+BMediaEventLooper::ControlLoop()
+{
+    status_t error = B_OK;
+    while (RunState() != B_QUITTING) {
+        if (error == B_TIMED_OUT || error == B_WOULD_BLOCK) {
+            const bigtime_t now = system_time();
+            media_timed_event event;
+            if (fEventQueue.HasEvents() && TimeSource()->RealTimeFor(fEventQueue.FirstEventTime(),
+                    fEventLatency + fSchedulingLatency) <= now
+                    && fEventQueue.RemoveFirstEvent(&event) == B_OK) {
+                const bigtime_t lateness = now
+                    - TimeSource()->RealTimeFor(event.event_time, fEventLatency);
+                DispatchEvent(&event, lateness);
+            }
+        } else if (error != B_OK) {
+            // The port is gone
+            break;
+        }
+
+        bigtime_t waitUntil = B_INFINITE_TIMEOUT;
+        if (fEventQueue.HasEvents()) {
+            waitUntil = TimeSource()->RealTimeFor(fEventQueue.FirstEventTime(),
+                fEventLatency + fSchedulingLatency);
+        }
+        error = WaitForMessage(waitUntil);
+    }
+}
+
+
+int32
+BMediaEventLooper::RunState() const
+{
+    return __atomic_load_n(&fRunState, __ATOMIC_ACQUIRE);
+}
+
+
+status_t
+BMediaEventLooper::SetPriority(int32 priority)
+{
+    fSetPriority = priority;
+    fCurrentPriority = priority;
+    if (fControlThread >= 0)
+        set_thread_priority(fControlThread, priority);
+    return B_OK;
+}
+
+
+void
+BMediaEventLooper::SetRunState(run_state state)
+{
+    __atomic_store_n(&fRunState, static_cast<int32>(state), __ATOMIC_RELEASE);
+}
+
+
+void
+BMediaEventLooper::SetEventLatency(bigtime_t latency)
+{
+    fEventLatency = latency > 0 ? latency : 0;
+}
+
+
+void
+BMediaEventLooper::SetBufferDuration(bigtime_t duration)
+{
+    fBufferDuration = duration > 0 ? duration : 0;
+}
+
+
+void
+BMediaEventLooper::Run()
+{
+    if (fControlThread >= 0)
+        return;
+
+    SetRunState(B_STOPPED);
+    char name[B_OS_NAME_LENGTH];
+    snprintf(name, sizeof(name), "%.20s control", Name());
+    fControlThread = spawn_thread(_ControlThreadStart, name, fCurrentPriority, this);
+    if (fControlThread < 0) {
+        fprintf(stderr, "BMediaEventLooper: Failed to spawn the control thread: %s\n",
+            strerror(fControlThread));
+        SetRunState(B_IN_DISTRESS);
+        return;
+    }
+    fSchedulingLatency = estimate_max_scheduling_latency(fControlThread);
+    resume_thread(fControlThread);
+}
+
+
+// Unlike Haiku, queued events are cleaned up here, while the buffers they
+// refer to still exist
+void
+BMediaEventLooper::Quit()
+{
+    if (RunState() == B_TERMINATED)
+        return;
+
+    SetRunState(B_QUITTING);
+    close_port(ControlPort());
+    if (fControlThread >= 0)
+        wait_for_thread(fControlThread, NULL);
+    fControlThread = -1;
+
+    fEventQueue.FlushEvents(0, BTimedEventQueue::B_ALWAYS);
+    SetRunState(B_TERMINATED);
+}
+
+
+void
+BMediaEventLooper::DispatchEvent(const media_timed_event* event, bigtime_t lateness,
+    bool realTimeEvent)
+{
+    if (event == NULL)
+        return;
+
+    switch (event->type) {
+        case BTimedEventQueue::B_START:
+            SetRunState(B_STARTED);
+            break;
+        case BTimedEventQueue::B_STOP:
+            SetRunState(B_STOPPED);
+            break;
+        default:
+            break;
+    }
+
+    const bigtime_t start = system_time_nsecs();
+    sInEventHandler = true;
+    HandleEvent(event, lateness, realTimeEvent);
+    sInEventHandler = false;
+    if (event->type == BTimedEventQueue::B_HANDLE_BUFFER)
+        HostMediaServer::AccountBuffer(this, system_time_nsecs() - start, true);
+    else if (event->type == BTimedEventQueue::B_STOP)
+        HostMediaServer::StopHandled(this);
+}
+
+
+int32
+BMediaEventLooper::_ControlThreadStart(void* cookie)
+{
+    static_cast<BMediaEventLooper*>(cookie)->ControlLoop();
+    return 0;
+}
+
+
+void
+BMediaEventLooper::_CleanUpEntry(const media_timed_event* event, void* context)
+{
+    static_cast<BMediaEventLooper*>(context)->CleanUpEvent(event);
+}
+
+
+// #pragma mark - BBuffer
+
+
+static std::atomic<media_buffer_id> sNextBufferID(1);
+
+
+BBuffer::BBuffer(BBufferGroup* group, const buffer_clone_info& info, void* data)
+    : fGroup(group),
+      fData(data),
+      fSize(info.size),
+      fOffset(info.offset),
+      fArea(info.area),
+      fFlags(info.flags),
+      fBufferID(sNextBufferID++),
+      fInUse(false)
+{
+    memset(static_cast<void*>(&fMediaHeader), 0, sizeof(fMediaHeader));
+    fMediaHeader.buffer = fBufferID;
+    fMediaHeader.owner = info.area;
+}
+
+
+BBuffer::~BBuffer()
+{
+}
+
+
+void
+BBuffer::Recycle()
+{
+    fGroup->_Recycle(this);
+}
+
+
+buffer_clone_info
+BBuffer::CloneInfo() const
+{
+    buffer_clone_info info;
+    info.buffer = fBufferID;
+    info.area = fArea;
+    info.offset = fOffset;
+    info.size = fSize;
+    info.flags = fFlags;
+    return info;
+}
+
+
+// #pragma mark - BBufferGroup
+
+
+BBufferGroup::BBufferGroup()
+    : fLock("buffer group"),
+      fBufferCount(0),
+      fOwnArea(-1),
+      fRequestError(B_OK)
+{
+    memset(fBuffers, 0, sizeof(fBuffers));
+    fFreeSem = create_sem(0, "buffer group");
+    fInitError = fFreeSem >= B_OK ? B_OK : fFreeSem;
+}
+
+
+BBufferGroup::BBufferGroup(size_t size, int32 count, uint32 placement, uint32 lock)
+    : BBufferGroup()
+{
+    if (fInitError != B_OK)
+        return;
+    if (size == 0 || count < 1 || count > kMaxBuffers) {
+        fInitError = B_BAD_VALUE;
+        return;
+    }
+
+    // Every buffer starts on a cache line
+    const size_t stride = (size + 63) & ~static_cast<size_t>(63);
+    const size_t areaSize = (stride * count + B_PAGE_SIZE - 1) / B_PAGE_SIZE * B_PAGE_SIZE;
+    void* address = NULL;
+    fOwnArea = create_area("buffer group", &address, placement, areaSize, lock,
+        B_READ_AREA | B_WRITE_AREA);
+    if (fOwnArea < 0) {
+        fInitError = fOwnArea;
+        return;
+    }
+
+    for (int32 i = 0; i < count && fInitError == B_OK; i++) {
+        buffer_clone_info info;
+        info.area = fOwnArea;
+        info.offset = i * stride;
+        info.size = size;
+        fInitError = AddBuffer(info);
+    }
+}
+
+
+BBufferGroup::~BBufferGroup()
+{
+    for (int32 i = 0; i < fBufferCount; i++)
+        delete fBuffers[i];
+    if (fFreeSem >= B_OK)
+        delete_sem(fFreeSem);
+    if (fOwnArea >= 0)
+        delete_area(fOwnArea);
+}
+
+
+status_t
+BBufferGroup::AddBuffer(const buffer_clone_info& info, BBuffer** _buffer)
+{
+    if (fInitError != B_OK && fFreeSem < B_OK)
+        return B_NO_INIT;
+
+    area_info areaInfo;
+    status_t status = get_area_info(info.area, &areaInfo);
+    if (status != B_OK)
+        return status;
+    if (info.size == 0 || info.offset + info.size > areaInfo.size)
+        return B_BAD_VALUE;
+
+    BAutolock locker(fLock);
+    if (fBufferCount == kMaxBuffers)
+        return B_MEDIA_TOO_MANY_BUFFERS;
+
+    BBuffer* buffer = new(std::nothrow) BBuffer(this, info,
+        static_cast<uint8*>(areaInfo.address) + info.offset);
+    if (buffer == NULL)
+        return B_NO_MEMORY;
+    fBuffers[fBufferCount++] = buffer;
+    release_sem(fFreeSem);
+
+    if (_buffer != NULL)
+        *_buffer = buffer;
+    return B_OK;
+}
+
+
+BBuffer*
+BBufferGroup::RequestBuffer(size_t size, bigtime_t timeout)
+{
+    status_t status = acquire_sem_etc(fFreeSem, 1, B_RELATIVE_TIMEOUT, timeout);
+    if (status != B_OK) {
+        fRequestError = status;
+        return NULL;
+    }
+
+    BAutolock locker(fLock);
+    for (int32 i = 0; i < fBufferCount; i++) {
+        BBuffer* buffer = fBuffers[i];
+        if (!buffer->fInUse && buffer->fSize >= size) {
+            buffer->fInUse = true;
+            buffer->fMediaHeader.size_used = 0;
+            fRequestError = B_OK;
+            return buffer;
+        }
+    }
+
+    // Only buffers that are too small are free
+    release_sem(fFreeSem);
+    fRequestError = B_MEDIA_BAD_BUFFER;
+    return NULL;
+}
+
+
+status_t
+BBufferGroup::CountBuffers(int32* _count)
+{
+    if (_count == NULL)
+        return B_BAD_VALUE;
+
+    BAutolock locker(fLock);
+    *_count = fBufferCount;
+    return B_OK;
+}
+
+
+status_t
+BBufferGroup::GetBufferList(int32 bufferCount, BBuffer** _buffers)
+{
+    if (_buffers == NULL || bufferCount < 1)
+        return B_BAD_VALUE;
+
+    BAutolock locker(fLock);
+    for (int32 i = 0; i < bufferCount && i < fBufferCount; i++)
+        _buffers[i] = fBuffers[i];
+    return B_OK;
+}
+
+
+status_t
+BBufferGroup::ReclaimAllBuffers()
+{
+    int32 count;
+    {
+        BAutolock locker(fLock);
+        count = fBufferCount;
+    }
+    if (count == 0)
+        return B_OK;
+
+    status_t status = acquire_sem_etc(fFreeSem, count, 0, 0);
+    if (status != B_OK)
+        return status;
+    return release_sem_etc(fFreeSem, count, 0);
+}
+
+
+void
+BBufferGroup::_Recycle(BBuffer* buffer)
+{
+    {
+        BAutolock locker(fLock);
+        if (!buffer->fInUse)
+            return;
+        buffer->fInUse = false;
+    }
+    release_sem(fFreeSem);
+}
+
+
+// #pragma mark - BBufferConsumer
+
+
+BBufferConsumer::BBufferConsumer(media_type type)
+    : BMediaNode("called by BBufferConsumer"),
+      fConsumerType(type)
+{
+    AddNodeKind(B_BUFFER_CONSUMER);
+}
+
+
+BBufferConsumer::~BBufferConsumer()
+{
+}
+
+
+status_t
+BBufferConsumer::SetOutputBuffersFor(const media_source& source,
+    const media_destination& destination, BBufferGroup* group, void* /*userData*/, int32* changeTag,
+    bool /*willReclaim*/, void* /*_reserved_*/)
+{
+    return HostMediaServer::SetOutputBuffersFor(source, destination, group, changeTag);
+}
+
+
+status_t
+BBufferConsumer::HandleMessage(int32 /*message*/, const void* /*data*/, size_t /*size*/)
+{
+    return B_ERROR;
+}
+
+
+// #pragma mark - BMediaRoster
+
+
+static BMediaRoster* sRoster = NULL;
+
+
+BMediaRoster::BMediaRoster()
+{
+}
+
+
+BMediaRoster::~BMediaRoster()
+{
+}
+
+
+BMediaRoster*
+BMediaRoster::Roster(status_t* _error)
+{
+    static BLocker lock("roster");
+    BAutolock locker(lock);
+    if (sRoster == NULL)
+        sRoster = new(std::nothrow) BMediaRoster();
+    if (_error != NULL)
+        *_error = sRoster != NULL ? B_OK : B_NO_MEMORY;
+    return sRoster;
+}
+
+
+BMediaRoster*
+BMediaRoster::CurrentRoster()
+{
+    return sRoster;
+}
+
+
+status_t
+BMediaRoster::GetVideoInput(media_node* _node)
+{
+    return HostMediaServer::GetVideoInput(_node);
+}
+
+
+status_t
+BMediaRoster::GetAudioInput(media_node* _node)
+{
+    return HostMediaServer::GetAudioInput(_node);
+}
+
+
+status_t
+BMediaRoster::GetTimeSource(media_node* _node)
+{
+    if (_node == NULL)
+        return B_BAD_VALUE;
+
+    *_node = HostMediaServer::TimeSource()->Node();
+    return B_OK;
+}
+
+
+status_t
+BMediaRoster::ReleaseNode(const media_node& /*node*/)
+{
+    return B_OK;
+}
+
+
+BTimeSource*
+BMediaRoster::MakeTimeSourceFor(const media_node& /*timeSource*/)
+{
+    return HostMediaServer::TimeSource();
+}
+
+
+status_t
+BMediaRoster::Connect(const media_source& from, const media_destination& to,
+    media_format* _inOutFormat, media_output* _output, media_input* _input)
+{
+    return HostMediaServer::Connect(from, to, _inOutFormat, _output, _input);
+}
+
+
+status_t
+BMediaRoster::Disconnect(media_node_id /*sourceNode*/, const media_source& source,
+    media_node_id /*destinationNode*/, const media_destination& destination)
+{
+    return HostMediaServer::Disconnect(source, destination);
+}
+
+
+status_t
+BMediaRoster::StartNode(const media_node& node, bigtime_t atPerformanceTime)
+{
+    return HostMediaServer::StartNode(node, atPerformanceTime);
+}
+
+
+status_t
+BMediaRoster::StopNode(const media_node& node, bigtime_t atPerformanceTime, bool immediate)
+{
+    return HostMediaServer::StopNode(node, atPerformanceTime, immediate);
+}
+
+
+status_t
+BMediaRoster::RegisterNode(BMediaNode* node)
+{
+    return HostMediaServer::RegisterNode(node);
+}
+
+
+status_t
+BMediaRoster::UnregisterNode(BMediaNode* node)
+{
+    return HostMediaServer::UnregisterNode(node);
+}
+
+
+status_t
+BMediaRoster::GetLiveNodeInfo(const media_node& node, live_node_info* _liveInfo)
+{
+    return HostMediaServer::GetLiveNodeInfo(node, _liveInfo);
+}
+
+
+status_t
+BMediaRoster::GetLiveNodes(live_node_info* _liveNodes, int32* inOutTotalCount,
+    const media_format* hasInput, const media_format* hasOutput, const char* name,
+    uint64 nodeKinds)
+{
+    return HostMediaServer::GetLiveNodes(_liveNodes, inOutTotalCount, hasInput, hasOutput, name,
+        nodeKinds);
+}
+
+
+status_t
+BMediaRoster::GetFreeInputsFor(const media_node& node, media_input* _freeInputsBuffer,
+    int32 bufferCapacity, int32* _foundCount, media_type filterType)
+{
+    return HostMediaServer::GetFreeInputsFor(node, _freeInputsBuffer, bufferCapacity, _foundCount,
+        filterType);
+}
+
+
+status_t
+BMediaRoster::GetFreeOutputsFor(const media_node& node, media_output* _freeOutputsBuffer,
+    int32 bufferCapacity, int32* _foundCount, media_type filterType)
+{
+    return HostMediaServer::GetFreeOutputsFor(node, _freeOutputsBuffer, bufferCapacity,
+        _foundCount, filterType);
+}
+
+
+// #pragma mark - BMediaRecorder
+
+
+BMediaRecorder::BMediaRecorder(const char* name, media_type type)
+    : fInitErr(B_OK),
+      fType(type),
+      fConnected(false),
+      fRunning(false),
+      fStopping(false),
+      fThread(-1),
+      fRecordHook(NULL),
+      fNotifyHook(NULL),
+      fCookie(NULL),
+      fSource(NULL)
+{
+    copyName(fName, name);
+    if (type != B_MEDIA_RAW_AUDIO && type != B_MEDIA_UNKNOWN_TYPE)
+        fInitErr = B_NOT_SUPPORTED;
+}
+
+
+BMediaRecorder::~BMediaRecorder()
+{
+    Disconnect();
+}
+
+
+status_t
+BMediaRecorder::SetHooks(ProcessFunc recordFunc, NotifyFunc notifyFunc, void* cookie)
+{
+    fRecordHook = recordFunc;
+    fNotifyHook = notifyFunc;
+    fCookie = cookie;
+    return B_OK;
+}
+
+
+status_t
+BMediaRecorder::Start(bool /*force*/)
+{
+    if (!fConnected)
+        return B_MEDIA_NOT_CONNECTED;
+    if (fRunning)
+        return B_OK;
+
+    if (fNotifyHook != NULL)
+        fNotifyHook(fCookie, B_WILL_START);
+
+    // The last recorder thread ended on its own
+    if (fThread >= 0)
+        wait_for_thread(fThread, NULL);
+
+    fStopping = false;
+    fRunning = true;
+    fThread = spawn_thread(_RecordThread, fName, suggest_thread_priority(B_AUDIO_RECORDING), this);
+    if (fThread < 0) {
+        const status_t status = fThread;
+        fThread = -1;
+        fRunning = false;
+        return status;
+    }
+    return resume_thread(fThread);
+}
+
+
+status_t
+BMediaRecorder::Stop(bool /*force*/)
+{
+    fStopping = true;
+    if (fThread >= 0) {
+        wait_for_thread(fThread, NULL);
+        fThread = -1;
+    }
+    fRunning = false;
+    return B_OK;
+}
+
+
+status_t
+BMediaRecorder::Connect(const media_node& node, const media_output* output,
+    const media_format* format)
+{
+    if (fInitErr != B_OK)
+        return fInitErr;
+    if (fConnected)
+        return B_MEDIA_ALREADY_CONNECTED;
+
+    media_output deviceOutput;
+    status_t status = HostMediaServer::OpenAudioInput(node, output, format, fSource,
+        deviceOutput);
+    if (status != B_OK)
+        return status;
+
+    fAcceptedFormat = fSource->format;
+    fOutput = deviceOutput;
+    fOutput.format = fAcceptedFormat;
+    fInput.node = node;
+    fInput.source = fOutput.source;
+    fInput.format = fAcceptedFormat;
+    copyName(fInput.name, fName);
+    fConnected = true;
+    return B_OK;
+}
+
+
+status_t
+BMediaRecorder::Disconnect()
+{
+    if (!fConnected)
+        return B_MEDIA_NOT_CONNECTED;
+
+    Stop();
+    HostMediaServer::CloseAudioInput(fSource);
+    fSource = NULL;
+    fConnected = false;
+    return B_OK;
+}
+
+
+void
+BMediaRecorder::BufferReceived(void* buffer, size_t size, const media_header& header)
+{
+    if (fRecordHook != NULL)
+        fRecordHook(fCookie, header.start_time, buffer, size, fAcceptedFormat);
+}
+
+
+// Replays the pre-rendered buffers, stamped with the device timeline. Paced
+// buffers arrive once the device would have filled them, the others as soon
+// as the previous one was taken.
+int32
+BMediaRecorder::_RecordThread(void* cookie)
+{
+    BMediaRecorder* recorder = static_cast<BMediaRecorder*>(cookie);
+    const HostRecorderSource& source = *recorder->fSource;
+    const double frameRate = source.format.u.raw_audio.frame_rate;
+
+    media_header header;
+    memset(static_cast<void*>(&header), 0, sizeof(header));
+    header.type = B_MEDIA_RAW_AUDIO;
+
+    const bigtime_t start = system_time();
+    uint64 index = 0;
+    for (; !recorder->fStopping
+            && (source.input.bufferCount == 0 || index < source.input.bufferCount); index++) {
+        const bool switched = source.input.switchAfter > 0 && index >= source.input.switchAfter;
+        if (switched && index == source.input.switchAfter)
+            recorder->fAcceptedFormat = source.switchFormat;
+
+        const uint64 firstFrame = index * source.frameCount;
+        header.start_time = start + static_cast<bigtime_t>(firstFrame * 1000000.0 / frameRate);
+        // The device takes a buffer's time to fill the first one in any case
+        if (source.input.realtime || index == 0) {
+            snooze_until(start + static_cast<bigtime_t>(
+                (firstFrame + source.frameCount) * 1000000.0 / frameRate), B_SYSTEM_TIMEBASE);
+        }
+
+        const media_format& format = switched ? source.switchFormat : source.format;
+        uint8* const* buffers = switched ? source.switchBuffers : source.buffers;
+        header.size_used = static_cast<uint32>(format.u.raw_audio.buffer_size);
+        recorder->BufferReceived(buffers[index % source.bufferCount], header.size_used, header);
+    }
+
+    // Ran dry, not stopped
+    if (!recorder->fStopping && recorder->fNotifyHook != NULL)
+        recorder->fNotifyHook(recorder->fCookie, B_WILL_STOP);
+    recorder->fRunning = false;
+    return B_OK;
+}
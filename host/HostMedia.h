@@ -0,0 +1,99 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef HOST_MEDIA_H
+#define HOST_MEDIA_H
+
+// MediaKit stand-in for building and running the library on other hosts.
+// host/include holds thin versions of the Haiku headers the library uses,
+// with just enough behind them to run AudioCapture and VideoConsumer
+// unchanged: kernel threads, semaphores, ports and areas on pthreads and
+// mmap(), BBitmap, and a roster that connects BMediaRecorder and consumer
+// nodes to synthetic devices instead of the media server. The devices are
+// set up here, before the roster is first asked for them.
+//
+// Buffers travel the way they do on Haiku: a recorder thread calls the
+// process hook, video buffers arrive on the consumer's control port and
+// become BTimedEventQueue events, the consumer's buffers are used when it
+// asks for that. There is a single time source, performance time is system
+// time. Nothing here aims to reproduce Haiku's scheduling.
+
+#include <MediaDefs.h>
+
+// Fills frameCount device frames in format, starting at frame firstFrame of
+// the stream. Called before the recorder starts, never while it runs.
+typedef void (*HostAudioFillFunc)(void* data, size_t frameCount,
+    const media_multi_audio_format& format, uint64 firstFrame, void* cookie);
+
+struct HostAudioInput {
+    const char*       name;
+    // buffer_size is the size of every device buffer
+    media_multi_audio_format format;
+    // Buffers arrive when a device would have filled them, or as soon as the
+    // process hook returns. Either way the first one takes a buffer's time.
+    bool              realtime;
+    // The device runs dry after this many buffers and the recorder notifies
+    // B_WILL_STOP, 0 never
+    uint64            bufferCount;
+    // After this many buffers the device switches to the switchFormat sample
+    // type, keeping the frame count of its buffers; 0 never
+    uint64            switchAfter;
+    uint32            switchFormat;
+    // NULL for a 440 Hz sine on every channel, silent for the second half of
+    // every second
+    HostAudioFillFunc fill;
+    void*             cookie;
+};
+
+struct HostVideoInput {
+    const char*       name;
+    uint32            width;
+    uint32            height;
+    color_space       colorSpace;
+    float             fieldRate;
+    // Frames are sent one field period apart and stamped with that time, or
+    // as soon as a buffer is free and stamped with the current time
+    bool              realtime;
+    // Frames to send after StartNode(), 0 until StopNode()
+    uint64            frameCount;
+    // Fill the buffers SetOutputBuffersFor() hands over, or ignore them and
+    // send buffers of a group of its own
+    bool              useConsumerBuffers;
+};
+
+// Sent by the video input since the last StartNode()
+struct HostVideoStats {
+    uint64            framesSent;
+    // No free buffer within a field period
+    uint64            framesDropped;
+};
+
+// Time a node's control thread spent on received buffers, from the message
+// to the end of the B_HANDLE_BUFFER event, since the last StartNode()
+struct HostNodeStats {
+    uint64            buffers;
+    // Nanoseconds
+    bigtime_t         bufferTime;
+    bigtime_t         maxBufferTime;
+};
+
+// 48 kHz stereo int16 in 1024 frame buffers, realtime, never stops
+void hostDefaultAudioInput(HostAudioInput& input);
+// 640x480 B_RGB32 at 30 fps, realtime, consumer buffers, never stops
+void hostDefaultVideoInput(HostVideoInput& input);
+
+// Replace the devices, the first audio input being the default one. Both
+// fail with B_BUSY while a device is connected.
+status_t hostSetAudioInputs(const HostAudioInput* inputs, int32 count);
+status_t hostSetVideoInput(const HostVideoInput& input);
+
+status_t hostGetVideoStats(HostVideoStats& stats);
+status_t hostGetNodeStats(const media_node& node, HostNodeStats& stats);
+
+// True on a control thread while it handles a message or an event, meant
+// for counting allocations like AudioCapture::InRealtimeCallback()
+bool hostInEventHandler();
+
+#endif // HOST_MEDIA_H
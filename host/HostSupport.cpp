@@ -0,0 +1,203 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+// BLocker and BString of the support kit, see host/HostMedia.h
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <Locker.h>
+#include <String.h>
+
+// #pragma mark - BLocker
+
+
+BLocker::BLocker()
+    : fOwner(-1),
+      fCount(0)
+{
+    pthread_mutex_init(&fMutex, NULL);
+}
+
+
+BLocker::BLocker(const char* /*name*/)
+    : BLocker()
+{
+}
+
+
+BLocker::BLocker(bool /*benaphoreStyle*/)
+    : BLocker()
+{
+}
+
+
+BLocker::BLocker(const char* /*name*/, bool /*benaphoreStyle*/)
+    : BLocker()
+{
+}
+
+
+BLocker::~BLocker()
+{
+    pthread_mutex_destroy(&fMutex);
+}
+
+
+bool
+BLocker::Lock()
+{
+    return LockWithTimeout(B_INFINITE_TIMEOUT) == B_OK;
+}
+
+
+status_t
+BLocker::LockWithTimeout(bigtime_t timeout)
+{
+    const thread_id thread = find_thread(NULL);
+    if (fOwner == thread) {
+        fCount++;
+        return B_OK;
+    }
+
+    if (timeout == B_INFINITE_TIMEOUT) {
+        if (pthread_mutex_lock(&fMutex) != 0)
+            return B_ERROR;
+    } else {
+        // pthread deadlines run on the realtime clock
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        const bigtime_t nanoseconds = deadline.tv_nsec + (timeout > 0 ? timeout : 0) * 1000;
+        deadline.tv_sec += nanoseconds / 1000000000;
+        deadline.tv_nsec = nanoseconds % 1000000000;
+        if (pthread_mutex_timedlock(&fMutex, &deadline) != 0)
+            return timeout > 0 ? B_TIMED_OUT : B_WOULD_BLOCK;
+    }
+
+    fOwner = thread;
+    fCount = 1;
+    return B_OK;
+}
+
+
+void
+BLocker::Unlock()
+{
+    if (fOwner != find_thread(NULL))
+        return;
+
+    if (--fCount == 0) {
+        fOwner = -1;
+        pthread_mutex_unlock(&fMutex);
+    }
+}
+
+
+thread_id
+BLocker::LockingThread() const
+{
+    return fOwner;
+}
+
+
+bool
+BLocker::IsLocked() const
+{
+    return fOwner == find_thread(NULL);
+}
+
+
+int32
+BLocker::CountLocks() const
+{
+    return fCount;
+}
+
+
+// #pragma mark - BString
+
+
+BString::BString()
+    : fPrivateData(NULL),
+      fLength(0)
+{
+}
+
+
+BString::BString(const char* string)
+    : BString()
+{
+    SetTo(string);
+}
+
+
+BString::BString(const BString& string)
+    : BString()
+{
+    SetTo(string.String());
+}
+
+
+BString::~BString()
+{
+    free(fPrivateData);
+}
+
+
+BString&
+BString::SetTo(const char* string)
+{
+    return SetTo(string, string != NULL ? static_cast<int32>(strlen(string)) : 0);
+}
+
+
+BString&
+BString::SetTo(const char* string, int32 maxLength)
+{
+    if (string == NULL || maxLength <= 0) {
+        free(fPrivateData);
+        fPrivateData = NULL;
+        fLength = 0;
+        return *this;
+    }
+
+    const int32 length = static_cast<int32>(strnlen(string, maxLength));
+    // string may point into the current data
+    char* data = static_cast<char*>(malloc(length + 1));
+    if (data == NULL)
+        return *this;
+    memcpy(data, string, length);
+    data[length] = '\0';
+
+    free(fPrivateData);
+    fPrivateData = data;
+    fLength = length;
+    return *this;
+}
+
+
+BString&
+BString::operator+=(const char* string)
+{
+    if (string == NULL || string[0] == '\0')
+        return *this;
+
+    const int32 length = static_cast<int32>(strlen(string));
+    char* data = static_cast<char*>(realloc(fPrivateData, fLength + length + 1));
+    if (data == NULL)
+        return *this;
+    memcpy(data + fLength, string, length + 1);
+    fPrivateData = data;
+    fLength += length;
+    return *this;
+}
+
+
+bool
+BString::operator==(const char* string) const
+{
+    return strcmp(String(), string != NULL ? string : "") == 0;
+}
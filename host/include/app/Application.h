@@ -0,0 +1,32 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef _APPLICATION_H
+#define _APPLICATION_H
+
+// Host stand-in for the Haiku header of the same name, see host/HostMedia.h.
+// The media stand-in needs no application, this only lets code that
+// creates one build.
+
+#include <OS.h>
+
+class BApplication;
+
+extern BApplication* be_app;
+
+class BApplication {
+public:
+    BApplication(const char* signature) : fSignature(signature) { be_app = this; }
+    virtual ~BApplication() { be_app = NULL; }
+
+    const char* Signature() const { return fSignature; }
+    virtual thread_id Run() { return find_thread(NULL); }
+    virtual void Quit() {}
+
+private:
+    const char*       fSignature;
+};
+
+#endif // _APPLICATION_H
@@ -0,0 +1,14 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef _ROSTER_H
+#define _ROSTER_H
+
+// Host stand-in for the Haiku header of the same name, see host/HostMedia.h.
+// Nothing built against the stand-in launches applications.
+
+#include <SupportDefs.h>
+
+#endif // _ROSTER_H
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef _BITMAP_H
+#define _BITMAP_H
+
+// Host stand-in for the Haiku header of the same name, see host/HostMedia.h.
+// Bits always live in an area of their own, as with B_BITMAP_IS_AREA, so
+// area_for() finds them. Views can't be attached.
+
+#include <OS.h>
+
+#include <GraphicsDefs.h>
+#include <Rect.h>
+
+enum {
+    B_BITMAP_CLEAR_TO_WHITE             = 0x00000001,
+    B_BITMAP_ACCEPTS_VIEWS              = 0x00000002,
+    B_BITMAP_IS_AREA                    = 0x00000004,
+    B_BITMAP_IS_LOCKED                  = 0x00000008 | B_BITMAP_IS_AREA,
+    B_BITMAP_IS_CONTIGUOUS              = 0x00000010 | B_BITMAP_IS_LOCKED,
+    B_BITMAP_IS_OFFSCREEN               = 0x00000020,
+    B_BITMAP_WILL_OVERLAY               = 0x00000040 | B_BITMAP_IS_OFFSCREEN,
+    B_BITMAP_RESERVE_OVERLAY_CHANNEL    = 0x00000080,
+    B_BITMAP_NO_SERVER_LINK             = 0x00000100
+};
+
+#define B_ANY_BYTES_PER_ROW -1
+
+class BBitmap {
+public:
+    BBitmap(BRect bounds, uint32 flags, color_space colorSpace,
+        int32 bytesPerRow = B_ANY_BYTES_PER_ROW);
+    BBitmap(BRect bounds, color_space colorSpace, bool acceptsViews = false,
+        bool needsContiguous = false);
+    virtual ~BBitmap();
+
+    status_t InitCheck() const { return fInitError; }
+    bool IsValid() const { return fInitError == B_OK; }
+
+    void* Bits() const { return fBits; }
+    int32 BitsLength() const { return fBytesPerRow * (fBounds.IntegerHeight() + 1); }
+    int32 BytesPerRow() const { return fBytesPerRow; }
+    color_space ColorSpace() const { return fColorSpace; }
+    BRect Bounds() const { return fBounds; }
+    uint32 Flags() const { return fFlags; }
+    area_id Area() const { return fArea; }
+
+    status_t LockBits(uint32* state = NULL);
+    void UnlockBits();
+
+    BBitmap(const BBitmap&) = delete;
+    BBitmap& operator=(const BBitmap&) = delete;
+
+private:
+    void _InitObject(BRect bounds, color_space colorSpace, uint32 flags, int32 bytesPerRow);
+
+    area_id           fArea;
+    uint8*            fBits;
+    BRect             fBounds;
+    color_space       fColorSpace;
+    uint32            fFlags;
+    int32             fBytesPerRow;
+    status_t          fInitError;
+};
+
+#endif // _BITMAP_H
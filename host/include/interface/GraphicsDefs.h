@@ -0,0 +1,55 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef _GRAPHICS_DEFS_H
+#define _GRAPHICS_DEFS_H
+
+// Host stand-in for the Haiku header of the same name, see host/HostMedia.h.
+// Color spaces only.
+
+#include <SupportDefs.h>
+
+enum color_space {
+    B_NO_COLOR_SPACE    = 0x0000,
+
+    B_RGB32             = 0x0008,
+    B_RGBA32            = 0x2008,
+    B_RGB24             = 0x0003,
+    B_RGB16             = 0x0005,
+    B_RGB15             = 0x0010,
+    B_RGBA15            = 0x2010,
+    B_CMAP8             = 0x0004,
+    B_GRAY8             = 0x0002,
+    B_GRAY1             = 0x0001,
+
+    B_RGB32_BIG         = 0x1008,
+    B_RGBA32_BIG        = 0x3008,
+    B_RGB24_BIG         = 0x1003,
+    B_RGB16_BIG         = 0x1005,
+    B_RGB15_BIG         = 0x1010,
+    B_RGBA15_BIG        = 0x3010,
+
+    B_YCbCr422          = 0x4000,
+    B_YCbCr411          = 0x4001,
+    B_YCbCr444          = 0x4003,
+    B_YCbCr420          = 0x4004,
+    B_YUV422            = 0x4020,
+    B_YUV411            = 0x4021,
+    B_YUV444            = 0x4023,
+    B_YUV420            = 0x4024
+};
+
+enum {
+    B_VIEWS_SUPPORT_DRAW_BITMAP         = 0x1,
+    B_BITMAPS_SUPPORT_ATTACHED_VIEWS    = 0x2,
+    B_BITMAPS_SUPPORT_OVERLAY           = 0x4
+};
+
+// Every packed RGB, gray and 4:2:2 space, planar ones aren't
+bool bitmaps_support_space(color_space space, uint32* supportFlags);
+status_t get_pixel_size_for(color_space space, size_t* pixelChunk, size_t* rowAlignment,
+    size_t* pixelsPerChunk);
+
+#endif // _GRAPHICS_DEFS_H
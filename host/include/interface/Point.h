@@ -0,0 +1,24 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef _POINT_H
+#define _POINT_H
+
+// Host stand-in for the Haiku header of the same name, see host/HostMedia.h
+
+#include <SupportDefs.h>
+
+class BPoint {
+public:
+    BPoint() : x(0.0f), y(0.0f) {}
+    BPoint(float x, float y) : x(x), y(y) {}
+
+    void Set(float x, float y) { this->x = x; this->y = y; }
+
+    float             x;
+    float             y;
+};
+
+#endif // _POINT_H
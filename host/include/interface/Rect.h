@@ -0,0 +1,40 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef _RECT_H
+#define _RECT_H
+
+// Host stand-in for the Haiku header of the same name, see host/HostMedia.h
+
+#include <math.h>
+
+#include <Point.h>
+
+// Edges are inclusive, a rect from 0 to 639 is 640 pixels wide
+class BRect {
+public:
+    BRect() : left(0.0f), top(0.0f), right(-1.0f), bottom(-1.0f) {}
+    BRect(float left, float top, float right, float bottom)
+        : left(left), top(top), right(right), bottom(bottom) {}
+    BRect(BPoint leftTop, BPoint rightBottom)
+        : left(leftTop.x), top(leftTop.y), right(rightBottom.x), bottom(rightBottom.y) {}
+
+    void Set(float l, float t, float r, float b) { left = l; top = t; right = r; bottom = b; }
+    BPoint LeftTop() const { return BPoint(left, top); }
+    BPoint RightBottom() const { return BPoint(right, bottom); }
+
+    float Width() const { return right - left; }
+    int32 IntegerWidth() const { return static_cast<int32>(ceilf(right - left)); }
+    float Height() const { return bottom - top; }
+    int32 IntegerHeight() const { return static_cast<int32>(ceilf(bottom - top)); }
+    bool IsValid() const { return left <= right && top <= bottom; }
+
+    float             left;
+    float             top;
+    float             right;
+    float             bottom;
+};
+
+#endif // _RECT_H
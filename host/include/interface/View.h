@@ -0,0 +1,16 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef _VIEW_H
+#define _VIEW_H
+
+// Host stand-in for the Haiku header of the same name, see host/HostMedia.h.
+// There is nothing to draw on, only the definitions views share with
+// bitmaps.
+
+#include <GraphicsDefs.h>
+#include <Rect.h>
+
+#endif // _VIEW_H
@@ -0,0 +1,146 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef _OS_H
+#define _OS_H
+
+// Host stand-in for the Haiku header of the same name, see host/HostMedia.h.
+// Threads, semaphores, ports and areas run on pthreads and mmap().
+// Priorities are accepted and ignored.
+
+#include <unistd.h>
+
+#include <SupportDefs.h>
+
+#define B_OS_NAME_LENGTH        32
+#define B_PAGE_SIZE             4096
+#define B_INFINITE_TIMEOUT      (9223372036854775807LL)
+#define B_SYSTEM_TIMEBASE       0
+// Largest message a host port takes, Haiku allows far more
+#define HOST_PORT_MESSAGE_SIZE  256
+
+typedef int32 area_id;
+typedef int32 port_id;
+typedef int32 sem_id;
+typedef int32 team_id;
+typedef int32 thread_id;
+
+// Timeout flags
+enum {
+    B_CAN_INTERRUPT             = 0x01,
+    B_CHECK_PERMISSION          = 0x04,
+    B_KILL_CAN_INTERRUPT        = 0x20,
+    B_DO_NOT_RESCHEDULE         = 0x02,
+    B_RELEASE_ALL               = 0x08,
+    B_RELEASE_IF_WAITING_ONLY   = 0x10,
+    B_RELATIVE_TIMEOUT          = 0x08,
+    B_ABSOLUTE_TIMEOUT          = 0x10
+};
+
+// Thread priorities
+enum {
+    B_IDLE_PRIORITY             = 0,
+    B_LOWEST_ACTIVE_PRIORITY    = 1,
+    B_LOW_PRIORITY              = 5,
+    B_NORMAL_PRIORITY           = 10,
+    B_DISPLAY_PRIORITY          = 15,
+    B_URGENT_DISPLAY_PRIORITY   = 20,
+    B_REAL_TIME_DISPLAY_PRIORITY = 100,
+    B_URGENT_PRIORITY           = 110,
+    B_REAL_TIME_PRIORITY        = 120
+};
+
+// Area address specifications, locking and protection
+enum {
+    B_ANY_ADDRESS               = 0,
+    B_EXACT_ADDRESS             = 1,
+    B_BASE_ADDRESS              = 2,
+    B_CLONE_ADDRESS             = 3,
+    B_ANY_KERNEL_ADDRESS        = 4
+};
+
+enum {
+    B_NO_LOCK                   = 0,
+    B_LAZY_LOCK                 = 1,
+    B_FULL_LOCK                 = 2,
+    B_CONTIGUOUS                = 3,
+    B_LOMEM                     = 4
+};
+
+#define B_READ_AREA             1
+#define B_WRITE_AREA            2
+#define B_EXECUTE_AREA          4
+
+typedef int32 (*thread_func)(void* data);
+
+typedef struct area_info {
+    area_id     area;
+    char        name[B_OS_NAME_LENGTH];
+    size_t      size;
+    uint32      lock;
+    uint32      protection;
+    team_id     team;
+    uint32      ram_size;
+    uint32      copy_count;
+    uint32      in_count;
+    uint32      out_count;
+    void*       address;
+} area_info;
+
+typedef struct system_info {
+    bigtime_t   boot_time;
+    uint32      cpu_count;
+    uint64      max_pages;
+    uint64      used_pages;
+    char        kernel_name[B_OS_NAME_LENGTH];
+} system_info;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bigtime_t system_time(void);
+nanotime_t system_time_nsecs(void);
+status_t snooze(bigtime_t amount);
+status_t snooze_until(bigtime_t time, int timeBase);
+
+thread_id spawn_thread(thread_func function, const char* name, int32 priority, void* data);
+status_t resume_thread(thread_id thread);
+status_t wait_for_thread(thread_id thread, status_t* returnValue);
+status_t set_thread_priority(thread_id thread, int32 newPriority);
+thread_id find_thread(const char* name);
+status_t rename_thread(thread_id thread, const char* newName);
+
+port_id create_port(int32 capacity, const char* name);
+status_t close_port(port_id port);
+status_t delete_port(port_id port);
+status_t write_port(port_id port, int32 code, const void* buffer, size_t bufferSize);
+status_t write_port_etc(port_id port, int32 code, const void* buffer, size_t bufferSize,
+    uint32 flags, bigtime_t timeout);
+ssize_t read_port(port_id port, int32* code, void* buffer, size_t bufferSize);
+ssize_t read_port_etc(port_id port, int32* code, void* buffer, size_t bufferSize,
+    uint32 flags, bigtime_t timeout);
+
+sem_id create_sem(int32 count, const char* name);
+status_t delete_sem(sem_id id);
+status_t acquire_sem(sem_id id);
+status_t acquire_sem_etc(sem_id id, int32 count, uint32 flags, bigtime_t timeout);
+status_t release_sem(sem_id id);
+status_t release_sem_etc(sem_id id, int32 count, uint32 flags);
+status_t get_sem_count(sem_id id, int32* threadCount);
+
+area_id create_area(const char* name, void** startAddress, uint32 addressSpec, size_t size,
+    uint32 lock, uint32 protection);
+status_t delete_area(area_id area);
+area_id area_for(void* address);
+status_t get_area_info(area_id area, area_info* areaInfo);
+
+status_t get_system_info(system_info* info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _OS_H
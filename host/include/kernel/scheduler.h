@@ -0,0 +1,42 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef _KERNEL_SCHEDULER_H
+#define _KERNEL_SCHEDULER_H
+
+// Host stand-in for the Haiku header of the same name, see host/HostMedia.h
+
+#include <OS.h>
+
+enum be_task_flags {
+    B_DEFAULT_MEDIA_PRIORITY    = 0x000,
+    B_OFFLINE_PROCESSING        = 0x001,
+    B_STATUS_RENDERING          = 0x002,
+    B_USER_INPUT_HANDLING       = 0x004,
+    B_LIVE_VIDEO_MANIPULATION   = 0x008,
+    B_VIDEO_PLAYBACK            = 0x010,
+    B_VIDEO_RECORDING           = 0x020,
+    B_LIVE_AUDIO_MANIPULATION   = 0x040,
+    B_AUDIO_PLAYBACK            = 0x080,
+    B_AUDIO_RECORDING           = 0x100,
+    B_LIVE_3D_RENDERING         = 0x200,
+    B_NUMBER_CRUNCHING          = 0x400,
+    B_MIDI_PROCESSING           = 0x800
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Always B_NORMAL_PRIORITY, host threads don't get priorities
+int32 suggest_thread_priority(uint32 task_flags = B_DEFAULT_MEDIA_PRIORITY, int32 period = 0,
+    bigtime_t jitter = 0, bigtime_t length = 0);
+bigtime_t estimate_max_scheduling_latency(thread_id thread = -1);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _KERNEL_SCHEDULER_H
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef _BUFFER_H
+#define _BUFFER_H
+
+// Host stand-in for the Haiku header of the same name, see host/HostMedia.h.
+// A buffer is a piece of an area owned by a BBufferGroup, which creates and
+// deletes it.
+
+#include <MediaDefs.h>
+
+class BBufferGroup;
+
+class BBuffer {
+public:
+    enum {
+        B_F1_VIDEO = 1,
+        B_F2_VIDEO = 2,
+        B_SMALL_BUFFER = 0x80000000
+    };
+
+    void* Data() { return fData; }
+    size_t SizeAvailable() { return fSize; }
+    size_t SizeUsed() { return fMediaHeader.size_used; }
+    void SetSizeUsed(size_t used) { fMediaHeader.size_used = used > fSize ? fSize : used; }
+    uint32 Flags() { return fFlags; }
+
+    // Hands the buffer back to its group
+    void Recycle();
+    buffer_clone_info CloneInfo() const;
+
+    media_buffer_id ID() { return fBufferID; }
+    media_type Type() { return fMediaHeader.type; }
+    media_header* Header() { return &fMediaHeader; }
+    media_audio_header* AudioHeader() { return &fMediaHeader.u.raw_audio; }
+    media_video_header* VideoHeader() { return &fMediaHeader.u.raw_video; }
+
+    size_t Size() { return SizeAvailable(); }
+
+private:
+    friend class BBufferGroup;
+
+    BBuffer(BBufferGroup* group, const buffer_clone_info& info, void* data);
+    ~BBuffer();
+
+    BBuffer(const BBuffer&) = delete;
+    BBuffer& operator=(const BBuffer&) = delete;
+
+    BBufferGroup*     fGroup;
+    media_header      fMediaHeader;
+    void*             fData;
+    size_t            fSize;
+    size_t            fOffset;
+    area_id           fArea;
+    uint32            fFlags;
+    media_buffer_id   fBufferID;
+    bool              fInUse;
+};
+
+#endif // _BUFFER_H
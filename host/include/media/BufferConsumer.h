@@ -0,0 +1,57 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef _BUFFER_CONSUMER_H
+#define _BUFFER_CONSUMER_H
+
+// Host stand-in for the Haiku header of the same name, see host/HostMedia.h.
+// The roster calls the connection hooks on the thread that makes the
+// connection, buffers arrive on the control port like on Haiku.
+
+#include <MediaNode.h>
+
+class BBuffer;
+class BBufferGroup;
+
+class BBufferConsumer : public virtual BMediaNode {
+protected:
+    virtual ~BBufferConsumer();
+
+public:
+    media_type ConsumerType() { return fConsumerType; }
+
+protected:
+    explicit BBufferConsumer(media_type type);
+
+    // Tells the producer feeding destination to fill the buffers of group,
+    // NULL for its own ones. Completes with a B_SET_OUTPUT_BUFFERS_FOR
+    // RequestCompleted().
+    static status_t SetOutputBuffersFor(const media_source& source,
+        const media_destination& destination, BBufferGroup* group, void* userData,
+        int32* changeTag, bool willReclaim = false, void* _reserved_ = NULL);
+
+    virtual status_t HandleMessage(int32 message, const void* data, size_t size);
+
+    virtual status_t AcceptFormat(const media_destination& destination, media_format* format) = 0;
+    virtual status_t GetNextInput(int32* cookie, media_input* _input) = 0;
+    virtual void DisposeInputCookie(int32 cookie) = 0;
+    virtual void BufferReceived(BBuffer* buffer) = 0;
+    virtual void ProducerDataStatus(const media_destination& forWhom, int32 status,
+        bigtime_t atPerformanceTime) = 0;
+    virtual status_t GetLatencyFor(const media_destination& forWhom, bigtime_t* _latency,
+        media_node_id* _timesource) = 0;
+    virtual status_t Connected(const media_source& producer, const media_destination& where,
+        const media_format& withFormat, media_input* _input) = 0;
+    virtual void Disconnected(const media_source& producer, const media_destination& where) = 0;
+    virtual status_t FormatChanged(const media_source& producer, const media_destination& consumer,
+        int32 changeTag, const media_format& format) = 0;
+
+private:
+    friend class HostMediaServer;
+
+    media_type        fConsumerType;
+};
+
+#endif // _BUFFER_CONSUMER_H
@@ -0,0 +1,57 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef _BUFFER_GROUP_H
+#define _BUFFER_GROUP_H
+
+// Host stand-in for the Haiku header of the same name, see host/HostMedia.h.
+// A group holds up to kMaxBuffers buffers, a semaphore counts the free
+// ones. Deleting the group deletes its buffers and the areas it created.
+
+#include <Buffer.h>
+#include <Locker.h>
+
+class BBufferGroup {
+public:
+    BBufferGroup(size_t size, int32 count = 3, uint32 placement = B_ANY_ADDRESS,
+        uint32 lock = B_FULL_LOCK);
+    explicit BBufferGroup();
+    ~BBufferGroup();
+
+    status_t InitCheck() { return fInitError; }
+
+    status_t AddBuffer(const buffer_clone_info& info, BBuffer** _buffer = NULL);
+
+    // Waits up to timeout microseconds for a free buffer of at least size
+    // bytes, NULL with RequestError() set if there is none
+    BBuffer* RequestBuffer(size_t size, bigtime_t timeout = B_INFINITE_TIMEOUT);
+    status_t RequestError() { return fRequestError; }
+
+    status_t CountBuffers(int32* _count);
+    status_t GetBufferList(int32 bufferCount, BBuffer** _buffers);
+
+    // Waits until every buffer is back in the group
+    status_t ReclaimAllBuffers();
+
+    BBufferGroup(const BBufferGroup&) = delete;
+    BBufferGroup& operator=(const BBufferGroup&) = delete;
+
+private:
+    friend class BBuffer;
+
+    static const int32 kMaxBuffers = 32;
+
+    void _Recycle(BBuffer* buffer);
+
+    BLocker           fLock;
+    sem_id            fFreeSem;
+    BBuffer*          fBuffers[kMaxBuffers];
+    int32             fBufferCount;
+    area_id           fOwnArea;
+    status_t          fInitError;
+    status_t          fRequestError;
+};
+
+#endif // _BUFFER_GROUP_H
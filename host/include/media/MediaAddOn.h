@@ -0,0 +1,16 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef _MEDIA_ADD_ON_H
+#define _MEDIA_ADD_ON_H
+
+// Host stand-in for the Haiku header of the same name, see host/HostMedia.h.
+// Add-ons can't be loaded on the host, nodes only name the type.
+
+#include <MediaDefs.h>
+
+class BMediaAddOn;
+
+#endif // _MEDIA_ADD_ON_H
@@ -0,0 +1,303 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef _MEDIA_DEFS_H
+#define _MEDIA_DEFS_H
+
+// Host stand-in for the Haiku header of the same name, see host/HostMedia.h.
+// Raw audio and raw video only, laid out like Haiku's so aggregate
+// initializers written for Haiku compile unchanged.
+
+#include <string.h>
+
+#include <OS.h>
+
+#include <GraphicsDefs.h>
+#include <Point.h>
+
+#define B_MEDIA_NAME_LENGTH 64
+
+typedef int32 media_node_id;
+typedef int32 media_buffer_id;
+
+enum media_type {
+    B_MEDIA_NO_TYPE             = -1,
+    B_MEDIA_UNKNOWN_TYPE        = 0,
+    B_MEDIA_RAW_AUDIO           = 1,
+    B_MEDIA_RAW_VIDEO,
+    B_MEDIA_VBL,
+    B_MEDIA_TIMECODE,
+    B_MEDIA_MIDI,
+    B_MEDIA_TEXT,
+    B_MEDIA_HTML,
+    B_MEDIA_MULTISTREAM,
+    B_MEDIA_PARAMETERS,
+    B_MEDIA_ENCODED_AUDIO,
+    B_MEDIA_ENCODED_VIDEO,
+    B_MEDIA_PRIVATE             = 90000,
+    B_MEDIA_FIRST_USER_TYPE     = 100000
+};
+
+enum node_kind {
+    B_BUFFER_PRODUCER           = 0x1,
+    B_BUFFER_CONSUMER           = 0x2,
+    B_TIME_SOURCE               = 0x4,
+    B_CONTROLLABLE              = 0x8,
+    B_FILE_INTERFACE            = 0x10,
+    B_ENTITY_INTERFACE          = 0x20,
+
+    B_PHYSICAL_INPUT            = 0x10000,
+    B_PHYSICAL_OUTPUT           = 0x20000,
+    B_SYSTEM_MIXER              = 0x40000
+};
+
+enum {
+    B_MEDIA_BIG_ENDIAN          = 1,
+    B_MEDIA_LITTLE_ENDIAN       = 2,
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    B_MEDIA_HOST_ENDIAN         = B_MEDIA_BIG_ENDIAN
+#else
+    B_MEDIA_HOST_ENDIAN         = B_MEDIA_LITTLE_ENDIAN
+#endif
+};
+
+// Speaker positions of media_multi_audio_info::channel_mask
+enum {
+    B_CHANNEL_LEFT                  = 0x00001,
+    B_CHANNEL_RIGHT                 = 0x00002,
+    B_CHANNEL_CENTER                = 0x00004,
+    B_CHANNEL_SUB                   = 0x00008,
+    B_CHANNEL_REARLEFT              = 0x00010,
+    B_CHANNEL_REARRIGHT             = 0x00020,
+    B_CHANNEL_FRONT_LEFT_CENTER     = 0x00040,
+    B_CHANNEL_FRONT_RIGHT_CENTER    = 0x00080,
+    B_CHANNEL_BACK_CENTER           = 0x00100,
+    B_CHANNEL_SIDE_LEFT             = 0x00200,
+    B_CHANNEL_SIDE_RIGHT            = 0x00400,
+    B_CHANNEL_TOP_CENTER            = 0x00800,
+    B_CHANNEL_TOP_FRONT_LEFT        = 0x01000,
+    B_CHANNEL_TOP_FRONT_CENTER      = 0x02000,
+    B_CHANNEL_TOP_FRONT_RIGHT       = 0x04000,
+    B_CHANNEL_TOP_BACK_LEFT         = 0x08000,
+    B_CHANNEL_TOP_BACK_CENTER       = 0x10000,
+    B_CHANNEL_TOP_BACK_RIGHT        = 0x20000
+};
+
+enum {
+    B_VIDEO_TOP_LEFT_RIGHT      = 1,
+    B_VIDEO_BOTTOM_LEFT_RIGHT   = 2
+};
+
+// Default constructed ones are null
+struct media_node {
+    media_node();
+
+    media_node_id     node;
+    port_id           port;
+    uint32            kind;
+
+    static media_node null;
+};
+
+struct media_source {
+    media_source();
+
+    port_id           port;
+    int32             id;
+
+    static media_source null;
+};
+
+struct media_destination {
+    media_destination();
+
+    port_id           port;
+    int32             id;
+
+    static media_destination null;
+};
+
+bool operator==(const media_node& a, const media_node& b);
+bool operator!=(const media_node& a, const media_node& b);
+bool operator==(const media_source& a, const media_source& b);
+bool operator!=(const media_source& a, const media_source& b);
+bool operator==(const media_destination& a, const media_destination& b);
+bool operator!=(const media_destination& a, const media_destination& b);
+
+struct media_raw_audio_format {
+    // The low bits are the sample size
+    enum {
+        B_AUDIO_FLOAT           = 0x24,
+        B_AUDIO_DOUBLE          = 0x28,
+        B_AUDIO_INT             = 0x4,
+        B_AUDIO_SHORT           = 0x2,
+        B_AUDIO_CHAR            = 0x11,
+        B_AUDIO_UCHAR           = 0x1,
+
+        B_AUDIO_SIZE_MASK       = 0xf
+    };
+
+    float             frame_rate;
+    uint32            channel_count;
+    uint32            format;
+    uint32            byte_order;
+    size_t            buffer_size;
+
+    static media_raw_audio_format wildcard;
+};
+
+struct media_multi_audio_info {
+    uint32            channel_mask;
+    int16             valid_bits;
+    uint16            matrix_mask;
+    uint32            _reserved_b[3];
+};
+
+struct media_multi_audio_format : public media_raw_audio_format, public media_multi_audio_info {
+    static media_multi_audio_format wildcard;
+};
+
+struct media_audio_header {
+    int32             _reserved_[14];
+    float             frame_rate;
+    uint32            channel_count;
+};
+
+struct media_video_display_info {
+    color_space       format;
+    uint32            line_width;
+    uint32            line_count;
+    uint32            bytes_per_row;
+    uint32            pixel_offset;
+    uint32            line_offset;
+    uint32            flags;
+};
+
+struct media_raw_video_format {
+    float             field_rate;
+    uint32            interlace;
+    uint32            first_active;
+    uint32            last_active;
+    uint32            orientation;
+    uint16            pixel_width_aspect;
+    uint16            pixel_height_aspect;
+    media_video_display_info display;
+
+    static media_raw_video_format wildcard;
+};
+
+struct media_video_header {
+    uint32            _reserved_[12];
+    float             field_gamma;
+    uint32            field_sequence;
+    uint16            field_number;
+    uint16            pulldown_number;
+    uint16            first_active_line;
+    uint16            line_count;
+};
+
+struct media_format {
+    media_type        type;
+    type_code         user_data_type;
+    uchar             user_data[48];
+    uint32            _reserved_[3];
+    uint16            require_flags;
+    uint16            deny_flags;
+
+    union {
+        media_multi_audio_format raw_audio;
+        media_raw_video_format raw_video;
+        uint32        _reserved_[96];
+    } u;
+
+    // All zero, which leaves every field a wildcard
+    media_format() { memset(static_cast<void*>(this), 0, sizeof(*this)); }
+};
+
+struct media_input {
+    media_input();
+
+    media_node        node;
+    media_source      source;
+    media_destination destination;
+    media_format      format;
+    char              name[B_MEDIA_NAME_LENGTH];
+};
+
+struct media_output {
+    media_output();
+
+    media_node        node;
+    media_source      source;
+    media_destination destination;
+    media_format      format;
+    char              name[B_MEDIA_NAME_LENGTH];
+};
+
+struct live_node_info {
+    live_node_info();
+
+    media_node        node;
+    BPoint            hint_point;
+    char              name[B_MEDIA_NAME_LENGTH];
+};
+
+struct buffer_clone_info {
+    buffer_clone_info();
+
+    media_buffer_id   buffer;
+    area_id           area;
+    size_t            offset;
+    size_t            size;
+    int32             flags;
+    int32             _reserved_[4];
+};
+
+struct media_header {
+    media_type        type;
+    media_buffer_id   buffer;
+    int32             destination;
+    media_node_id     time_source;
+    uint32            _deprecated_;
+    uint32            size_used;
+    bigtime_t         start_time;
+    area_id           owner;
+    type_code         user_data_type;
+    uchar             user_data[64];
+    int32             source;
+    port_id           source_port;
+    off_t             file_pos;
+    size_t            orig_size;
+    uint32            data_offset;
+
+    union {
+        media_audio_header raw_audio;
+        media_video_header raw_video;
+        uint32        _reserved_[16];
+    } u;
+};
+
+struct media_request_info {
+    enum what_code {
+        B_SET_VIDEO_CLIPPING_FOR = 1,
+        B_REQUEST_FORMAT_CHANGE,
+        B_SET_OUTPUT_ENABLED,
+        B_SET_OUTPUT_BUFFERS_FOR,
+
+        B_FORMAT_CHANGED        = 4097
+    };
+
+    what_code         what;
+    int32             change_tag;
+    status_t          status;
+    void*             cookie;
+    void*             user_data;
+    media_source      source;
+    media_destination destination;
+    media_format      format;
+    uint32            _reserved_[32];
+};
+
+#endif // _MEDIA_DEFS_H
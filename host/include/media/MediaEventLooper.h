@@ -0,0 +1,84 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef _MEDIA_EVENT_LOOPER_H
+#define _MEDIA_EVENT_LOOPER_H
+
+// Host stand-in for the Haiku header of the same name, see host/HostMedia.h.
+// Run() starts a control thread that handles port messages and dispatches
+// each event once its performance time, less the event and scheduling
+// latency, has come. There is no separate realtime queue.
+
+#include <MediaNode.h>
+#include <TimedEventQueue.h>
+
+class BMediaEventLooper : public virtual BMediaNode {
+protected:
+    enum run_state {
+        B_IN_DISTRESS = -1,
+        B_UNREGISTERED,
+        B_STOPPED,
+        B_STARTED,
+        B_QUITTING,
+        B_TERMINATED,
+        B_USER_RUN_STATES = 0x4000
+    };
+
+    explicit BMediaEventLooper(uint32 apiVersion = B_BEOS_VERSION);
+    virtual ~BMediaEventLooper();
+
+    virtual void NodeRegistered();
+    virtual void Start(bigtime_t performanceTime);
+    virtual void Stop(bigtime_t performanceTime, bool immediate);
+    virtual void Seek(bigtime_t mediaTime, bigtime_t performanceTime);
+    virtual void TimeWarp(bigtime_t atRealTime, bigtime_t toPerformanceTime);
+    virtual status_t AddTimer(bigtime_t atPerformanceTime, int32 cookie);
+    virtual void SetRunMode(run_mode mode);
+
+    virtual void HandleEvent(const media_timed_event* event, bigtime_t lateness,
+        bool realTimeEvent = false) = 0;
+    virtual void CleanUpEvent(const media_timed_event* event);
+    virtual void ControlLoop();
+
+    thread_id ControlThread() const { return fControlThread; }
+    BTimedEventQueue* EventQueue() { return &fEventQueue; }
+
+    int32 Priority() const { return fCurrentPriority; }
+    int32 RunState() const;
+    bigtime_t EventLatency() const { return fEventLatency; }
+    bigtime_t BufferDuration() const { return fBufferDuration; }
+    bigtime_t SchedulingLatency() const { return fSchedulingLatency; }
+
+    status_t SetPriority(int32 priority);
+    void SetRunState(run_state state);
+    void SetEventLatency(bigtime_t latency);
+    void SetBufferDuration(bigtime_t duration);
+
+    void Run();
+    void Quit();
+
+    void DispatchEvent(const media_timed_event* event, bigtime_t lateness,
+        bool realTimeEvent = false);
+
+private:
+    friend class HostMediaServer;
+
+    static int32 _ControlThreadStart(void* cookie);
+    static void _CleanUpEntry(const media_timed_event* event, void* context);
+
+    BTimedEventQueue  fEventQueue;
+    thread_id         fControlThread;
+    int32             fCurrentPriority;
+    int32             fSetPriority;
+    int32             fRunState;
+    bigtime_t         fEventLatency;
+    bigtime_t         fSchedulingLatency;
+    bigtime_t         fBufferDuration;
+    // Bumped after every B_STOP event has been handled, see
+    // BMediaRoster::StopNode()
+    int32             fStopsHandled;
+};
+
+#endif // _MEDIA_EVENT_LOOPER_H
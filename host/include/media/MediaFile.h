@@ -0,0 +1,18 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef _MEDIA_FILE_H
+#define _MEDIA_FILE_H
+
+// Host stand-in for the Haiku header of the same name, see host/HostMedia.h.
+// There are no codecs on the host, nothing built against the stand-in
+// reads or writes media files.
+
+#include <MediaDefs.h>
+
+class BMediaFile;
+class BMediaTrack;
+
+#endif // _MEDIA_FILE_H
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef _MEDIA_NODE_H
+#define _MEDIA_NODE_H
+
+// Host stand-in for the Haiku header of the same name, see host/HostMedia.h.
+// Every node gets a control port at construction and an id from
+// BMediaRoster::RegisterNode(). Messages arrive from the roster and from
+// producers, WaitForMessage() hands them to the node like on Haiku.
+
+#include <MediaDefs.h>
+
+class BMediaAddOn;
+class BTimeSource;
+
+class BMediaNode {
+protected:
+    BMediaNode(const char* name);
+    virtual ~BMediaNode();
+
+public:
+    enum run_mode {
+        B_OFFLINE = 1,
+        B_DECREASE_PRECISION,
+        B_INCREASE_LATENCY,
+        B_DROP_DATA,
+        B_RECORDING
+    };
+
+    const char* Name() const { return fName; }
+    media_node_id ID() const { return fNodeID; }
+    uint64 Kinds() const { return fKinds; }
+    media_node Node() const;
+    run_mode RunMode() const { return fRunMode; }
+    BTimeSource* TimeSource() const;
+
+    virtual port_id ControlPort() const { return fControlPort; }
+    virtual BMediaAddOn* AddOn(int32* internalID) const = 0;
+
+    virtual status_t HandleMessage(int32 message, const void* data, size_t size);
+
+protected:
+    virtual status_t RequestCompleted(const media_request_info& info);
+
+    virtual void Start(bigtime_t atPerformanceTime);
+    virtual void Stop(bigtime_t atPerformanceTime, bool immediate);
+    virtual void Seek(bigtime_t toMediaTime, bigtime_t atPerformanceTime);
+    virtual void TimeWarp(bigtime_t atRealTime, bigtime_t toPerformanceTime);
+    virtual void SetRunMode(run_mode mode);
+    virtual void NodeRegistered();
+
+    // Reads the next message from the control port and handles it, waits
+    // until the absolute system time waitUntil at most
+    status_t WaitForMessage(bigtime_t waitUntil, uint32 flags = 0, void* _reserved_ = 0);
+
+    void AddNodeKind(uint64 kind) { fKinds |= kind; }
+
+    BMediaNode(const BMediaNode&) = delete;
+    BMediaNode& operator=(const BMediaNode&) = delete;
+
+private:
+    friend class HostMediaServer;
+
+    char              fName[B_MEDIA_NAME_LENGTH];
+    media_node_id     fNodeID;
+    port_id           fControlPort;
+    uint64            fKinds;
+    run_mode          fRunMode;
+
+    // For hostGetNodeStats()
+    uint64            fBuffersHandled;
+    bigtime_t         fBufferTime;
+    bigtime_t         fMaxBufferTime;
+};
+
+#endif // _MEDIA_NODE_H
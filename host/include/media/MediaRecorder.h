@@ -0,0 +1,83 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef _MEDIA_RECORDER_H
+#define _MEDIA_RECORDER_H
+
+// Host stand-in for the Haiku header of the same name, see host/HostMedia.h.
+// Connects to one of the synthetic audio inputs of HostMedia.h only, whose
+// buffers a thread of the recorder hands to the process hook.
+
+#include <atomic>
+
+#include <MediaDefs.h>
+
+struct HostRecorderSource;
+
+class BMediaRecorder {
+public:
+    enum notification {
+        B_WILL_START = 1,
+        B_WILL_STOP,
+        B_WILL_SEEK,
+        B_WILL_TIMEWARP
+    };
+
+    typedef void (*ProcessFunc)(void* cookie, bigtime_t timestamp, void* data, size_t size,
+        const media_format& format);
+    typedef void (*NotifyFunc)(void* cookie, notification what, ...);
+
+    BMediaRecorder(const char* name, media_type type = B_MEDIA_UNKNOWN_TYPE);
+    virtual ~BMediaRecorder();
+
+    status_t InitCheck() const { return fInitErr; }
+
+    status_t SetHooks(ProcessFunc recordFunc = NULL, NotifyFunc notifyFunc = NULL,
+        void* cookie = NULL);
+
+    void SetAcceptedFormat(const media_format& format) { fAcceptedFormat = format; }
+    const media_format& AcceptedFormat() const { return fAcceptedFormat; }
+
+    virtual status_t Start(bool force = false);
+    virtual status_t Stop(bool force = false);
+
+    virtual status_t Connect(const media_node& node, const media_output* output = NULL,
+        const media_format* format = NULL);
+    virtual status_t Disconnect();
+
+    bool IsConnected() const { return fConnected; }
+    bool IsRunning() const { return fRunning; }
+
+    const media_output& MediaOutput() const { return fOutput; }
+    const media_input& MediaInput() const { return fInput; }
+
+    BMediaRecorder(const BMediaRecorder&) = delete;
+    BMediaRecorder& operator=(const BMediaRecorder&) = delete;
+
+protected:
+    virtual void BufferReceived(void* buffer, size_t size, const media_header& header);
+
+private:
+    static int32 _RecordThread(void* cookie);
+
+    status_t          fInitErr;
+    char              fName[B_MEDIA_NAME_LENGTH];
+    media_type        fType;
+    bool              fConnected;
+    std::atomic<bool> fRunning;
+    std::atomic<bool> fStopping;
+    thread_id         fThread;
+
+    ProcessFunc       fRecordHook;
+    NotifyFunc        fNotifyHook;
+    void*             fCookie;
+
+    media_format      fAcceptedFormat;
+    media_output      fOutput;
+    media_input       fInput;
+    HostRecorderSource* fSource;
+};
+
+#endif // _MEDIA_RECORDER_H
@@ -0,0 +1,62 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef _MEDIA_ROSTER_H
+#define _MEDIA_ROSTER_H
+
+// Host stand-in for the Haiku header of the same name, see host/HostMedia.h.
+// The roster knows the synthetic devices set up through HostMedia.h and the
+// nodes registered with it, and connects them without a media server.
+
+#include <MediaDefs.h>
+
+class BMediaNode;
+class BTimeSource;
+
+class BMediaRoster {
+public:
+    static BMediaRoster* Roster(status_t* _error = NULL);
+    static BMediaRoster* CurrentRoster();
+
+    status_t GetVideoInput(media_node* _node);
+    status_t GetAudioInput(media_node* _node);
+    status_t GetTimeSource(media_node* _node);
+
+    status_t ReleaseNode(const media_node& node);
+    BTimeSource* MakeTimeSourceFor(const media_node& timeSource);
+
+    status_t Connect(const media_source& from, const media_destination& to,
+        media_format* _inOutFormat, media_output* _output, media_input* _input);
+    status_t Disconnect(media_node_id sourceNode, const media_source& source,
+        media_node_id destinationNode, const media_destination& destination);
+
+    status_t StartNode(const media_node& node, bigtime_t atPerformanceTime);
+    // Immediate stops of registered nodes return once the node has handled
+    // the B_STOP event
+    status_t StopNode(const media_node& node, bigtime_t atPerformanceTime, bool immediate = false);
+
+    status_t RegisterNode(BMediaNode* node);
+    status_t UnregisterNode(BMediaNode* node);
+
+    status_t GetLiveNodeInfo(const media_node& node, live_node_info* _liveInfo);
+    // Matches name exactly, or up to a trailing '*'
+    status_t GetLiveNodes(live_node_info* _liveNodes, int32* inOutTotalCount,
+        const media_format* hasInput = NULL, const media_format* hasOutput = NULL,
+        const char* name = NULL, uint64 nodeKinds = 0);
+
+    status_t GetFreeInputsFor(const media_node& node, media_input* _freeInputsBuffer,
+        int32 bufferCapacity, int32* _foundCount, media_type filterType = B_MEDIA_UNKNOWN_TYPE);
+    status_t GetFreeOutputsFor(const media_node& node, media_output* _freeOutputsBuffer,
+        int32 bufferCapacity, int32* _foundCount, media_type filterType = B_MEDIA_UNKNOWN_TYPE);
+
+private:
+    BMediaRoster();
+    ~BMediaRoster();
+
+    BMediaRoster(const BMediaRoster&) = delete;
+    BMediaRoster& operator=(const BMediaRoster&) = delete;
+};
+
+#endif // _MEDIA_ROSTER_H
@@ -0,0 +1,14 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef _MEDIA_TRACK_H
+#define _MEDIA_TRACK_H
+
+// Host stand-in for the Haiku header of the same name, see host/HostMedia.h.
+// Declares the type only, see MediaFile.h.
+
+#include <MediaFile.h>
+
+#endif // _MEDIA_TRACK_H
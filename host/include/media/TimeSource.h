@@ -0,0 +1,30 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef _TIME_SOURCE_H
+#define _TIME_SOURCE_H
+
+// Host stand-in for the Haiku header of the same name, see host/HostMedia.h.
+// There is one time source, the system clock: performance time is system
+// time and it never stops.
+
+#include <MediaNode.h>
+
+class BTimeSource : public BMediaNode {
+protected:
+    BTimeSource();
+    virtual ~BTimeSource();
+
+public:
+    bigtime_t Now() { return system_time(); }
+    bigtime_t PerformanceTimeFor(bigtime_t realTime) { return realTime; }
+    bigtime_t RealTimeFor(bigtime_t performanceTime, bigtime_t withLatency)
+        { return performanceTime - withLatency; }
+    bool IsRunning() { return true; }
+
+    static bigtime_t RealTime() { return system_time(); }
+};
+
+#endif // _TIME_SOURCE_H
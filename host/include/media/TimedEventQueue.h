@@ -0,0 +1,104 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef _TIMED_EVENT_QUEUE_H
+#define _TIMED_EVENT_QUEUE_H
+
+// Host stand-in for the Haiku header of the same name, see host/HostMedia.h.
+// The queue is a fixed array kept in time order, so adding and removing
+// events never allocates. AddEvent() fails with B_NO_MEMORY once it is full.
+
+#include <Locker.h>
+#include <MediaDefs.h>
+
+struct media_timed_event {
+    media_timed_event();
+    media_timed_event(bigtime_t inTime, int32 inType);
+    media_timed_event(bigtime_t inTime, int32 inType, void* inPointer, uint32 inCleanup);
+    media_timed_event(bigtime_t inTime, int32 inType, void* inPointer, uint32 inCleanup,
+        int32 inData, int64 inBigdata, const char* inUserData, size_t dataSize = 0);
+
+    bigtime_t         event_time;
+    int32             type;
+    void*             pointer;
+    uint32            cleanup;
+    int32             data;
+    int64             bigdata;
+    char              user_data[64];
+    uint32            _reserved_media_timed_event_[8];
+};
+
+class BTimedEventQueue {
+public:
+    enum event_type {
+        B_NO_EVENT = -1,
+        B_ANY_EVENT = 0,
+
+        B_START,
+        B_STOP,
+        B_SEEK,
+        B_WARP,
+        B_TIMER,
+        B_HANDLE_BUFFER,
+        B_DATA_STATUS,
+        B_HARDWARE,
+        B_PARAMETER,
+
+        B_USER_EVENT = 0x4000
+    };
+
+    enum cleanup_flag {
+        B_NO_CLEANUP = 0,
+        B_RECYCLE_BUFFER,
+        B_EXPIRE_TIMER,
+        B_USER_CLEANUP = 0x4000
+    };
+
+    enum time_direction {
+        B_ALWAYS = -1,
+        B_BEFORE_TIME = 0,
+        B_AT_TIME,
+        B_AFTER_TIME
+    };
+
+    typedef void (*cleanup_hook)(const media_timed_event* event, void* context);
+
+    BTimedEventQueue();
+    virtual ~BTimedEventQueue();
+
+    status_t AddEvent(const media_timed_event& event);
+    status_t RemoveEvent(const media_timed_event* event);
+    status_t RemoveFirstEvent(media_timed_event* _event = NULL);
+
+    bool HasEvents() const;
+    int32 EventCount() const;
+    const media_timed_event* FirstEvent() const;
+    bigtime_t FirstEventTime() const;
+    const media_timed_event* LastEvent() const;
+    bigtime_t LastEventTime() const;
+
+    void SetCleanupHook(cleanup_hook hook, void* context);
+    // Removes and cleans up the matching events
+    status_t FlushEvents(bigtime_t eventTime, time_direction direction, bool inclusive = true,
+        int32 eventType = B_ANY_EVENT);
+
+    BTimedEventQueue(const BTimedEventQueue&) = delete;
+    BTimedEventQueue& operator=(const BTimedEventQueue&) = delete;
+
+private:
+    static const int32 kCapacity = 256;
+
+    bool _Matches(const media_timed_event& event, bigtime_t eventTime, time_direction direction,
+        bool inclusive, int32 eventType) const;
+    void _CleanUp(const media_timed_event& event);
+
+    mutable BLocker   fLock;
+    media_timed_event fEvents[kCapacity];
+    int32             fCount;
+    cleanup_hook      fCleanupHook;
+    void*             fCleanupContext;
+};
+
+#endif // _TIMED_EVENT_QUEUE_H
@@ -0,0 +1,16 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef _NODE_INFO_H
+#define _NODE_INFO_H
+
+// Host stand-in for the Haiku header of the same name, see host/HostMedia.h.
+// Files have no MIME types on the host.
+
+#include <SupportDefs.h>
+
+class BNodeInfo;
+
+#endif // _NODE_INFO_H
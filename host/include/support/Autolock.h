@@ -0,0 +1,33 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef _AUTOLOCK_H
+#define _AUTOLOCK_H
+
+// Host stand-in for the Haiku header of the same name, see host/HostMedia.h
+
+#include <Locker.h>
+
+class BAutolock {
+public:
+    BAutolock(BLocker* locker) : fLocker(locker), fIsLocked(locker->Lock()) {}
+    BAutolock(BLocker& locker) : fLocker(&locker), fIsLocked(locker.Lock()) {}
+    ~BAutolock() { Unlock(); }
+
+    bool IsLocked() { return fIsLocked; }
+    void Unlock()
+    {
+        if (fIsLocked) {
+            fLocker->Unlock();
+            fIsLocked = false;
+        }
+    }
+
+private:
+    BLocker*          fLocker;
+    bool              fIsLocked;
+};
+
+#endif // _AUTOLOCK_H
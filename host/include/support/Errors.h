@@ -0,0 +1,96 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef _ERRORS_H
+#define _ERRORS_H
+
+// Host stand-in for the Haiku header of the same name, see host/HostMedia.h.
+// The B_ codes are negative like on Haiku, POSIX calls still return the
+// host's positive errno values.
+
+#include <errno.h>
+#include <limits.h>
+
+#define B_GENERAL_ERROR_BASE    INT_MIN
+#define B_OS_ERROR_BASE         (B_GENERAL_ERROR_BASE + 0x1000)
+#define B_APP_ERROR_BASE        (B_GENERAL_ERROR_BASE + 0x2000)
+#define B_INTERFACE_ERROR_BASE  (B_GENERAL_ERROR_BASE + 0x3000)
+#define B_MEDIA_ERROR_BASE      (B_GENERAL_ERROR_BASE + 0x4000)
+#define B_STORAGE_ERROR_BASE    (B_GENERAL_ERROR_BASE + 0x6000)
+#define B_POSIX_ERROR_BASE      (B_GENERAL_ERROR_BASE + 0x7000)
+#define B_DEVICE_ERROR_BASE     (B_GENERAL_ERROR_BASE + 0xa000)
+
+#define B_OK                    ((int)0)
+#define B_ERROR                 (-1)
+
+#define B_NO_MEMORY             (B_GENERAL_ERROR_BASE + 0)
+#define B_IO_ERROR              (B_GENERAL_ERROR_BASE + 1)
+#define B_PERMISSION_DENIED     (B_GENERAL_ERROR_BASE + 2)
+#define B_BAD_INDEX             (B_GENERAL_ERROR_BASE + 3)
+#define B_BAD_TYPE              (B_GENERAL_ERROR_BASE + 4)
+#define B_BAD_VALUE             (B_GENERAL_ERROR_BASE + 5)
+#define B_MISMATCHED_VALUES     (B_GENERAL_ERROR_BASE + 6)
+#define B_NAME_NOT_FOUND        (B_GENERAL_ERROR_BASE + 7)
+#define B_NAME_IN_USE           (B_GENERAL_ERROR_BASE + 8)
+#define B_TIMED_OUT             (B_GENERAL_ERROR_BASE + 9)
+#define B_INTERRUPTED           (B_GENERAL_ERROR_BASE + 10)
+#define B_WOULD_BLOCK           (B_GENERAL_ERROR_BASE + 11)
+#define B_CANCELED              (B_GENERAL_ERROR_BASE + 12)
+#define B_NO_INIT               (B_GENERAL_ERROR_BASE + 13)
+#define B_NOT_INITIALIZED       B_NO_INIT
+#define B_BUSY                  (B_GENERAL_ERROR_BASE + 14)
+#define B_NOT_ALLOWED           (B_GENERAL_ERROR_BASE + 15)
+#define B_BAD_DATA              (B_GENERAL_ERROR_BASE + 16)
+#define B_DONT_DO_THAT          (B_GENERAL_ERROR_BASE + 17)
+#define B_NOT_SUPPORTED         (B_POSIX_ERROR_BASE + 45)
+
+#define B_BAD_SEM_ID            (B_OS_ERROR_BASE + 0)
+#define B_NO_MORE_SEMS          (B_OS_ERROR_BASE + 1)
+#define B_BAD_THREAD_ID         (B_OS_ERROR_BASE + 0x100)
+#define B_NO_MORE_THREADS       (B_OS_ERROR_BASE + 0x101)
+#define B_BAD_THREAD_STATE      (B_OS_ERROR_BASE + 0x102)
+#define B_BAD_PORT_ID           (B_OS_ERROR_BASE + 0x300)
+#define B_BAD_ADDRESS           (B_OS_ERROR_BASE + 0x301)
+
+#define B_STREAM_NOT_FOUND      (B_MEDIA_ERROR_BASE + 0)
+#define B_SERVER_NOT_FOUND      (B_MEDIA_ERROR_BASE + 1)
+#define B_RESOURCE_NOT_FOUND    (B_MEDIA_ERROR_BASE + 2)
+#define B_RESOURCE_UNAVAILABLE  (B_MEDIA_ERROR_BASE + 3)
+#define B_BAD_SUBSCRIBER        (B_MEDIA_ERROR_BASE + 4)
+#define B_SUBSCRIBER_NOT_ENTERED (B_MEDIA_ERROR_BASE + 5)
+#define B_BUFFER_NOT_AVAILABLE  (B_MEDIA_ERROR_BASE + 6)
+#define B_LAST_BUFFER_ERROR     (B_MEDIA_ERROR_BASE + 7)
+#define B_MEDIA_SYSTEM_FAILURE  (B_MEDIA_ERROR_BASE + 100)
+#define B_MEDIA_BAD_NODE        (B_MEDIA_ERROR_BASE + 101)
+#define B_MEDIA_NODE_BUSY       (B_MEDIA_ERROR_BASE + 102)
+#define B_MEDIA_BAD_FORMAT      (B_MEDIA_ERROR_BASE + 103)
+#define B_MEDIA_BAD_BUFFER      (B_MEDIA_ERROR_BASE + 104)
+#define B_MEDIA_TOO_MANY_NODES  (B_MEDIA_ERROR_BASE + 105)
+#define B_MEDIA_TOO_MANY_BUFFERS (B_MEDIA_ERROR_BASE + 106)
+#define B_MEDIA_NODE_ALREADY_EXISTS (B_MEDIA_ERROR_BASE + 107)
+#define B_MEDIA_BUFFER_ALREADY_EXISTS (B_MEDIA_ERROR_BASE + 108)
+#define B_MEDIA_CANNOT_SEEK     (B_MEDIA_ERROR_BASE + 109)
+#define B_MEDIA_CANNOT_CHANGE_RUN_MODE (B_MEDIA_ERROR_BASE + 110)
+#define B_MEDIA_APP_ALREADY_REGISTERED (B_MEDIA_ERROR_BASE + 111)
+#define B_MEDIA_APP_NOT_REGISTERED (B_MEDIA_ERROR_BASE + 112)
+#define B_MEDIA_CANNOT_RECLAIM_BUFFERS (B_MEDIA_ERROR_BASE + 113)
+#define B_MEDIA_BUFFERS_NOT_RECLAIMED (B_MEDIA_ERROR_BASE + 114)
+#define B_MEDIA_TIME_SOURCE_STOPPED (B_MEDIA_ERROR_BASE + 115)
+#define B_MEDIA_TIME_SOURCE_BUSY (B_MEDIA_ERROR_BASE + 116)
+#define B_MEDIA_BAD_SOURCE      (B_MEDIA_ERROR_BASE + 117)
+#define B_MEDIA_BAD_DESTINATION (B_MEDIA_ERROR_BASE + 118)
+#define B_MEDIA_ALREADY_CONNECTED (B_MEDIA_ERROR_BASE + 119)
+#define B_MEDIA_NOT_CONNECTED   (B_MEDIA_ERROR_BASE + 120)
+
+#define B_FILE_ERROR            (B_STORAGE_ERROR_BASE + 0)
+#define B_FILE_EXISTS           (B_STORAGE_ERROR_BASE + 2)
+#define B_ENTRY_NOT_FOUND       (B_STORAGE_ERROR_BASE + 3)
+#define B_NAME_TOO_LONG         (B_STORAGE_ERROR_BASE + 4)
+#define B_DEVICE_FULL           (B_STORAGE_ERROR_BASE + 10)
+
+#define B_DEV_INVALID_IOCTL     (B_DEVICE_ERROR_BASE + 0)
+#define B_DEVICE_NOT_FOUND      (B_DEVICE_ERROR_BASE + 19)
+
+#endif // _ERRORS_H
@@ -0,0 +1,41 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef _LOCKER_H
+#define _LOCKER_H
+
+// Host stand-in for the Haiku header of the same name, see host/HostMedia.h
+
+#include <pthread.h>
+
+#include <OS.h>
+
+// Recursive like Haiku's, on a pthread mutex
+class BLocker {
+public:
+    BLocker();
+    BLocker(const char* name);
+    BLocker(bool benaphoreStyle);
+    BLocker(const char* name, bool benaphoreStyle);
+    virtual ~BLocker();
+
+    bool Lock();
+    status_t LockWithTimeout(bigtime_t timeout);
+    void Unlock();
+
+    thread_id LockingThread() const;
+    bool IsLocked() const;
+    int32 CountLocks() const;
+
+    BLocker(const BLocker&) = delete;
+    BLocker& operator=(const BLocker&) = delete;
+
+private:
+    pthread_mutex_t   fMutex;
+    thread_id         fOwner;
+    int32             fCount;
+};
+
+#endif // _LOCKER_H
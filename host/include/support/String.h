@@ -0,0 +1,40 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef _B_STRING_H
+#define _B_STRING_H
+
+// Host stand-in for the Haiku header of the same name, see host/HostMedia.h.
+// Only the basics.
+
+#include <SupportDefs.h>
+
+class BString {
+public:
+    BString();
+    BString(const char* string);
+    BString(const BString& string);
+    ~BString();
+
+    const char* String() const { return fPrivateData != NULL ? fPrivateData : ""; }
+    int32 Length() const { return fLength; }
+    bool IsEmpty() const { return fLength == 0; }
+
+    BString& SetTo(const char* string);
+    BString& SetTo(const char* string, int32 maxLength);
+    BString& operator=(const BString& string) { return SetTo(string.String()); }
+    BString& operator=(const char* string) { return SetTo(string); }
+    BString& operator+=(const char* string);
+
+    bool operator==(const char* string) const;
+    bool operator!=(const char* string) const { return !(*this == string); }
+    operator const char*() const { return String(); }
+
+private:
+    char*             fPrivateData;
+    int32             fLength;
+};
+
+#endif // _B_STRING_H
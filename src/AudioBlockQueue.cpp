@@ -0,0 +1,99 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#include <new>
+
+#include "AudioBlockQueue.h"
+
+
+AudioBlockQueue::AudioBlockQueue()
+    : mSlots(NULL),
+      mCapacity(0),
+      mTail(0),
+      mHead(0)
+{
+}
+
+
+AudioBlockQueue::~AudioBlockQueue()
+{
+    delete[] mSlots;
+}
+
+
+bool
+AudioBlockQueue::Init(size_t capacity)
+{
+    delete[] mSlots;
+    mSlots = NULL;
+    mCapacity = 0;
+
+    if (capacity == 0)
+        return false;
+
+    size_t rounded = 1;
+    while (rounded < capacity)
+        rounded <<= 1;
+
+    mSlots = new(std::nothrow) std::atomic<uint32_t>[rounded];
+    if (mSlots == NULL)
+        return false;
+
+    mCapacity = rounded;
+    Reset();
+    return true;
+}
+
+
+void
+AudioBlockQueue::Reset()
+{
+    mTail.store(0, std::memory_order_relaxed);
+    mHead.store(0, std::memory_order_relaxed);
+}
+
+
+size_t
+AudioBlockQueue::Count() const
+{
+    const size_t head = mHead.load(std::memory_order_acquire);
+    const size_t tail = mTail.load(std::memory_order_acquire);
+    return tail - head;
+}
+
+
+bool
+AudioBlockQueue::Push(uint32_t index)
+{
+    const size_t tail = mTail.load(std::memory_order_relaxed);
+    const size_t head = mHead.load(std::memory_order_acquire);
+    if (tail - head >= mCapacity)
+        return false;
+
+    mSlots[tail & (mCapacity - 1)].store(index, std::memory_order_relaxed);
+    mTail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+
+bool
+AudioBlockQueue::Pop(uint32_t& index)
+{
+    size_t head = mHead.load(std::memory_order_acquire);
+    while (true) {
+        const size_t tail = mTail.load(std::memory_order_acquire);
+        if (head == tail)
+            return false;
+
+        // The slot can't be reused before the head moves past it, so a value
+        // read here is only stale if the exchange below fails
+        const uint32_t value = mSlots[head & (mCapacity - 1)].load(std::memory_order_relaxed);
+        if (mHead.compare_exchange_weak(head, head + 1, std::memory_order_acq_rel,
+                std::memory_order_acquire)) {
+            index = value;
+            return true;
+        }
+    }
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef AUDIO_BLOCK_QUEUE_H
+#define AUDIO_BLOCK_QUEUE_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Lock-free bounded FIFO of block indices with a single producer. Pop() may
+// be called from several threads at once, so the producer can take back the
+// oldest entry while a consumer drains the queue. Never blocks or allocates
+// after Init(). The capacity is rounded up to a power of two.
+class AudioBlockQueue {
+public:
+    AudioBlockQueue();
+    ~AudioBlockQueue();
+
+    bool Init(size_t capacity);
+    // Not thread safe, only call while no other thread uses the queue
+    void Reset();
+
+    // Producer side, fails when the queue is full
+    bool Push(uint32_t index);
+    // Any thread, fails when the queue is empty
+    bool Pop(uint32_t& index);
+
+    size_t Count() const;
+    size_t Capacity() const { return mCapacity; }
+
+    AudioBlockQueue(const AudioBlockQueue&) = delete;
+    AudioBlockQueue& operator=(const AudioBlockQueue&) = delete;
+
+private:
+    std::atomic<uint32_t>* mSlots;
+    size_t              mCapacity;
+
+    // Free-running counters like AudioRingBuffer, the head only ever moves
+    // forward by compare-and-swap
+    alignas(64) std::atomic<size_t> mTail;
+    alignas(64) std::atomic<size_t> mHead;
+};
+
+#endif // AUDIO_BLOCK_QUEUE_H
@@ -8,12 +8,43 @@
 #include <string.h>
 #include <math.h>
 
+#include <new>
+
 #include "AudioCapture.h"
+#include "LinearResampler.h"
+
+// Device buffers are expected to stay at the negotiated size, but keep room
+// for producers that deliver a few times more before chunking kicks in
+static const size_t kBufferHeadroom = 4;
+static const size_t kDefaultChunkFrames = 2048;
+static const size_t kBufferAlignment = 64;
+// Loop bandwidth of the drift estimate, low enough to average out timestamp
+// jitter, and the largest clock error it is allowed to correct
+static const double kDriftLoopBandwidth = 0.05;
+static const double kMaxDriftPPM = 1000.0;
+
+static thread_local bool sInRealtimeCallback = false;
+
+
+// Every counter has a single writer, so a plain load and store does the job
+// of fetch_add without a locked instruction on the realtime path
+template<typename Type>
+static inline void
+statsAdd(std::atomic<Type>& counter, Type value)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
 
-inline float int16ToFloat(int16 sample) { return sample / 32768.0f; }
-inline float int8ToFloat(int8 sample) { return sample / 128.0f; }
-inline float uint8ToFloat(uint8 sample) { return (static_cast<int16>(sample) - 128) / 128.0f; }
-inline float int32ToFloat(int32 sample) { return sample / 2147483648.0f; }
+static inline uint32
+histogramBucket(bigtime_t nanoseconds)
+{
+    const uint64 microseconds = nanoseconds > 0 ? nanoseconds / 1000 : 0;
+    if (microseconds < 2)
+        return 0;
+    const uint32 bucket = 63 - __builtin_clzll(microseconds);
+    return bucket < kAudioStatsHistogramSize ? bucket : kAudioStatsHistogramSize - 1;
+}
 
 inline size_t getSampleSize(uint32 formatCode)
 {
@@ -27,10 +58,30 @@ inline size_t getSampleSize(uint32 formatCode)
     }
 }
 
+inline SampleType getSampleType(uint32 formatCode)
+{
+     switch(formatCode) {
+        case media_raw_audio_format::B_AUDIO_FLOAT: return SAMPLE_FLOAT;
+        case media_raw_audio_format::B_AUDIO_INT:   return SAMPLE_INT32;
+        case media_raw_audio_format::B_AUDIO_SHORT: return SAMPLE_INT16;
+        case media_raw_audio_format::B_AUDIO_CHAR:  return SAMPLE_INT8;
+        case media_raw_audio_format::B_AUDIO_UCHAR: return SAMPLE_UINT8;
+        default: return SAMPLE_TYPE_COUNT;
+    }
+}
+
 
-AudioCapture::AudioCapture(AudioCallbackFunc callback, void* userData, float targetSampleRate, const char* nodeName)
+AudioCapture::AudioCapture(AudioCallbackFunc callback, void* userData, float targetSampleRate, const char* nodeName,
+        size_t ringBufferFrames)
     : mUserCallback(callback),
       mUserData(userData),
+      mPlanarCallback(NULL),
+      mPlanarUserData(NULL),
+      mTimedCallback(NULL),
+      mTimedUserData(NULL),
+      mPCMCallback(NULL),
+      mPCMUserData(NULL),
+      mPCMFormat(SAMPLE_INT16),
       mNodeName(nodeName),
       mRoster(NULL),
       mRecorder(NULL),
@@ -40,14 +91,122 @@ AudioCapture::AudioCapture(AudioCallbackFunc callback, void* userData, float tar
       mIsInitialized(false),
       mIsRecording(false),
       mLastStatus(B_NO_INIT),
+      mMixBuffer(NULL),
       mDeviceFloatBuffer(NULL),
-      mDeviceFloatBufferSize(0),
       mResampledBuffer(NULL),
-      mResampledBufferSize(0),
+      mPlanes(NULL),
+      mResampledPlanes(NULL),
+      mChunkFrames(0),
+      mResampledBufferFrames(0),
+      mBlockFrames(0),
+      mBlockFill(0),
+      mBlockBuffer(NULL),
+      mBlockPlanes(NULL),
+      mBlockPlaneView(NULL),
+      mFrameConverter(NULL),
+      mPlanarConverter(NULL),
+      mConverterFormatCode(0),
+      mConverterChannelCount(0),
+      mPassthrough(false),
+      mPCMDirect(false),
+      mPCMConverter(NULL),
+      mQuantizer(NULL),
+      mDitherEnabled(false),
+      mPCMBuffer(NULL),
+      mPCMResampledBuffer(NULL),
+      mPCMResampler(NULL),
+      mChannelLayout(AUDIO_CHANNELS_STEREO),
+      mOutputChannels(2),
+      mUserMatrix(NULL),
+      mUserMatrixInputs(0),
+      mUserMatrixOutputs(0),
+      mMixMatrix(NULL),
+      mMatrixMixer(NULL),
       mTargetSampleRate(targetSampleRate),
+      mRequestedSampleRate(targetSampleRate),
       mResamplingRatio(1.0),
-      mInputBufferOffset(0.0)
+      mResamplerQuality(RESAMPLER_LINEAR),
+      mResampler(NULL),
+      mPlaneResamplers(NULL),
+      mInputFrames(0),
+      mOutputFrames(0),
+      mOutputPosition(0.0),
+      mBufferStartFrame(0),
+      mBufferTime(0),
+      mNextBufferTime(-1),
+      mDiscontinuity(false),
+      mDriftCompensation(false),
+      mDllTime(0.0),
+      mDllPeriod(0.0),
+      mNominalPeriod(0.0),
+      mDllFrames(0),
+      mRateAdjustment(1.0),
+      mDriftPPM(0.0),
+      mDispatchDepth(0),
+      mDispatchPolicy(AUDIO_DISPATCH_DROP_OLDEST),
+      mDispatchBlocks(NULL),
+      mDispatchData(NULL),
+      mDispatchPlanes(NULL),
+      mDispatchBlockFrames(0),
+      mDispatchThread(-1),
+      mDispatchSem(-1),
+      mDispatchWaiting(false),
+      mDispatchQuit(false),
+      mDispatchDrops(0),
+      mDispatchDroppedFrames(0),
+      mMeterWindow(0),
+      mMeterDecay(20.0f),
+      mLevelMeter(NULL),
+      mMeterChannels(0),
+      mMeterWindowFrames(0),
+      mMeterFrames(0),
+      mLevelSequence(0),
+      mLevelWindows(0),
+      mGateMode(AUDIO_GATE_OFF),
+      mGateThreshold(-50.0f),
+      mGateHangover(500000),
+      mGatePreRoll(200000),
+      mGateVoice(false),
+      mGateActive(false),
+      mGateClosed(false),
+      mPreRollFrames(0),
+      mPreRollChunk(NULL),
+      mGateOpen(true),
+      mTriggerPreRoll(0),
+      mTriggerHistory(NULL),
+      mTriggerCapacity(0),
+      mTriggerWrite(0),
+      mTriggerFill(0),
+      mTriggerCallback(NULL),
+      mTriggerUserData(NULL),
+      mTriggerState(TRIGGER_IDLE),
+      mTriggerBusy(false),
+      mSinks(NULL),
+      mSinkCount(0),
+      mNextSinkId(1),
+      mSinkStages(NULL),
+      mSinkStageCount(0),
+      mSinkInput(NULL),
+      mSinkConverter(NULL),
+      mRingSem(-1),
+      mReaderWaiting(false),
+      mOverrunCount(0),
+      mOverrunFrames(0)
 {
+    if (ringBufferFrames > 0) {
+        if (!mRingBuffer.Init(ringBufferFrames, 2 * sizeof(float))) {
+            mLastStatus = B_NO_MEMORY;
+            fprintf(stderr, "AudioCapture: Error - Failed to allocate ring buffer (%lu frames)\n", ringBufferFrames);
+            return;
+        }
+        mRingSem = create_sem(0, "AudioCapture ring");
+        if (mRingSem < B_OK) {
+            mLastStatus = mRingSem;
+            fprintf(stderr, "AudioCapture: Error - Failed to create ring semaphore: %s\n", strerror(mLastStatus));
+            return;
+        }
+    }
+
     mLastStatus = initializeDevice();
     if (mLastStatus == B_OK) {
         mIsInitialized = true;
@@ -67,6 +226,12 @@ AudioCapture::AudioCapture(AudioCallbackFunc callback, void* userData, float tar
 AudioCapture::~AudioCapture()
 {
     Stop();
+
+    if (mRingSem >= B_OK)
+        delete_sem(mRingSem);
+
+    free(mUserMatrix);
+    free(mSinks);
 }
 
 
@@ -90,6 +255,16 @@ AudioCapture::initializeDevice()
     if (mAudioInputNode == media_node::null)
 		return B_DEVICE_NOT_FOUND;
 
+    return queryInput();
+}
+
+
+// Reads the name and raw audio format of mAudioInputNode
+status_t
+AudioCapture::queryInput()
+{
+    status_t status = B_OK;
+
     live_node_info liveInfo;
     status = mRoster->GetLiveNodeInfo(mAudioInputNode, &liveInfo);
     if (status == B_OK)
@@ -123,6 +298,61 @@ AudioCapture::initializeDevice()
 }
 
 
+status_t
+AudioCapture::SetInput(const media_node& node)
+{
+    if (node == media_node::null)
+        return B_BAD_VALUE;
+
+    if (mIsRecording)
+        return B_BUSY;
+
+    if (mRoster == NULL)
+        return B_NO_INIT;
+
+    const media_node previousNode = mAudioInputNode;
+    mAudioInputNode = node;
+    mTargetSampleRate = mRequestedSampleRate;
+    status_t status = queryInput();
+    if (status != B_OK) {
+        fprintf(stderr, "AudioCapture: Can't capture from the selected node: %s\n", strerror(status));
+        mAudioInputNode = previousNode;
+        mTargetSampleRate = mRequestedSampleRate;
+        if (previousNode != media_node::null)
+            queryInput();
+        return status;
+    }
+
+    mIsInitialized = true;
+    mLastStatus = B_OK;
+    return B_OK;
+}
+
+
+status_t
+AudioCapture::SetInput(const char* liveNodeName)
+{
+    if (liveNodeName == NULL)
+        return B_BAD_VALUE;
+
+    if (mRoster == NULL)
+        return B_NO_INIT;
+
+    media_format output;
+    output.type = B_MEDIA_RAW_AUDIO;
+    live_node_info liveInfo;
+    int32 count = 1;
+    status_t status = mRoster->GetLiveNodes(&liveInfo, &count, NULL, &output, liveNodeName,
+        B_BUFFER_PRODUCER);
+    if (status != B_OK)
+        return status;
+    if (count < 1)
+        return B_NAME_NOT_FOUND;
+
+    return SetInput(liveInfo.node);
+}
+
+
 status_t
 AudioCapture::Start()
 {
@@ -207,7 +437,79 @@ AudioCapture::Start()
         }
     }
 
-    mInputBufferOffset = 0.0;
+    status = configureChannelLayout();
+    if (status != B_OK) {
+        Stop();
+        mLastStatus = status;
+        fprintf(stderr, "AudioCapture: Failed to set up the output channel layout: %s\n", strerror(status));
+        return status;
+    }
+
+    status = configurePCMOutput();
+    if (status != B_OK) {
+        Stop();
+        mLastStatus = status;
+        fprintf(stderr, "AudioCapture: Failed to set up PCM output: %s\n", strerror(status));
+        return status;
+    }
+
+    status = createResamplers();
+    if (status != B_OK) {
+        Stop();
+        mLastStatus = status;
+        fprintf(stderr, "AudioCapture: Failed to create resampler\n");
+        return mLastStatus;
+    }
+
+    status = allocateBuffers();
+    if (status != B_OK) {
+        Stop();
+        mLastStatus = status;
+        fprintf(stderr, "AudioCapture: Failed to allocate processing buffers\n");
+        return status;
+    }
+
+    status = createSinkStages();
+    if (status != B_OK) {
+        Stop();
+        mLastStatus = status;
+        fprintf(stderr, "AudioCapture: Failed to set up the sinks\n");
+        return status;
+    }
+
+    status = configureGate();
+    if (status != B_OK) {
+        Stop();
+        mLastStatus = status;
+        fprintf(stderr, "AudioCapture: Failed to set up the input gate\n");
+        return status;
+    }
+
+    selectFrameConverter(mDeviceMediaFormatCode, mDeviceChannelCount);
+
+    mInputFrames = 0;
+    mOutputFrames = 0;
+    mOutputPosition = 0.0;
+    mBufferStartFrame = 0;
+    mBufferTime = 0;
+    mNextBufferTime = -1;
+    mDiscontinuity = false;
+
+    mNominalPeriod = 1000000.0 / mDeviceSampleRate;
+    mDllPeriod = mNominalPeriod;
+    mDllFrames = 0;
+    mRateAdjustment = 1.0;
+    mDriftPPM.store(0.0, std::memory_order_relaxed);
+    resetStats();
+    configureMetering();
+
+    status = startDispatcher();
+    if (status != B_OK) {
+        Stop();
+        mLastStatus = status;
+        fprintf(stderr, "AudioCapture: Failed to start the dispatch thread: %s\n", strerror(status));
+        return status;
+    }
 
     status = mRecorder->Start();
     if (status != B_OK) {
@@ -224,228 +526,2091 @@ AudioCapture::Start()
 
 
 status_t
-AudioCapture::Stop()
+AudioCapture::SetResamplingQuality(ResamplerQuality quality)
 {
-    mIsRecording = false;
+    if (quality < RESAMPLER_LINEAR || quality > RESAMPLER_SINC_BEST)
+        return B_BAD_VALUE;
 
-    if (mRecorder) {
-		cleanupMediaResources();
-		cleanupBuffers();
-		mLastStatus = B_OK;
-		return mLastStatus;
-    } else {
-        cleanupBuffers();
+    if (mIsRecording)
+        return B_BUSY;
+
+    mResamplerQuality = quality;
+    return B_OK;
+}
+
+
+status_t
+AudioCapture::SetDriftCompensation(bool enabled)
+{
+    if (mIsRecording)
+        return B_BUSY;
+
+    mDriftCompensation = enabled;
+    return B_OK;
+}
+
+
+status_t
+AudioCapture::SetChannelLayout(AudioChannelLayout layout)
+{
+    if (layout < AUDIO_CHANNELS_STEREO || layout > AUDIO_CHANNELS_MATRIX)
+        return B_BAD_VALUE;
+
+    if (layout == AUDIO_CHANNELS_MATRIX && mUserMatrix == NULL)
+        return B_NO_INIT;
+
+    if (mIsRecording)
+        return B_BUSY;
+
+    mChannelLayout = layout;
+    return B_OK;
+}
+
+
+status_t
+AudioCapture::SetMixMatrix(const float* matrix, uint32 inputChannels, uint32 outputChannels)
+{
+    if (matrix == NULL || inputChannels == 0 || outputChannels == 0)
+        return B_BAD_VALUE;
+
+    if (mIsRecording)
+        return B_BUSY;
+
+    const size_t size = inputChannels * outputChannels * sizeof(float);
+    float* copy = static_cast<float*>(malloc(size));
+    if (copy == NULL)
+        return B_NO_MEMORY;
+    memcpy(copy, matrix, size);
+
+    free(mUserMatrix);
+    mUserMatrix = copy;
+    mUserMatrixInputs = inputChannels;
+    mUserMatrixOutputs = outputChannels;
+    mChannelLayout = AUDIO_CHANNELS_MATRIX;
+    return B_OK;
+}
+
+
+uint32
+AudioCapture::OutputChannelCount() const
+{
+    switch (mChannelLayout) {
+        case AUDIO_CHANNELS_MONO:   return 1;
+        case AUDIO_CHANNELS_NATIVE: return mDeviceChannelCount;
+        case AUDIO_CHANNELS_MATRIX: return mUserMatrixOutputs;
+        default:                    return 2;
     }
+}
+
 
+status_t
+AudioCapture::SetPlanarCallback(AudioPlanarCallbackFunc callback, void* userData)
+{
+    if (mIsRecording)
+        return B_BUSY;
+
+    if (callback != NULL && mPCMCallback != NULL)
+        return B_NOT_ALLOWED;
+
+    mPlanarCallback = callback;
+    mPlanarUserData = userData;
     return B_OK;
 }
 
 
 void
-AudioCapture::cleanupMediaResources()
+AudioCapture::resetStats()
 {
-     if (!mRecorder)
-     	return;
+    mStats.buffersIn.store(0);
+    mStats.framesIn.store(0);
+    mStats.buffersOut.store(0);
+    mStats.framesOut.store(0);
+    mStats.droppedBuffers.store(0);
+    mStats.oversizedBuffers.store(0);
+    mStats.discontinuities.store(0);
+    mStats.gatedFrames.store(0);
+    mStats.processTime.store(0);
+    mStats.convertTime.store(0);
+    mStats.resampleTime.store(0);
+    mStats.callbackTime.store(0);
+    mStats.callbackOverruns.store(0);
+    mStats.maxBufferGap.store(0);
+    mStats.lastArrival.store(0);
+    mStats.resamplePosition.store(0.0);
+    for (uint32 i = 0; i < kAudioStatsHistogramSize; i++) {
+        mStats.processHistogram[i].store(0);
+        mStats.callbackHistogram[i].store(0);
+    }
+}
 
-    mRecorder->Stop();
-    if (mRecorder->IsConnected()) {
-        mRecorder->Disconnect();
+
+void
+AudioCapture::GetStats(AudioCaptureStats& stats) const
+{
+    const std::memory_order relaxed = std::memory_order_relaxed;
+    stats.buffersIn = mStats.buffersIn.load(relaxed);
+    stats.framesIn = mStats.framesIn.load(relaxed);
+    stats.buffersOut = mStats.buffersOut.load(relaxed);
+    stats.framesOut = mStats.framesOut.load(relaxed);
+    stats.droppedBuffers = mStats.droppedBuffers.load(relaxed);
+    stats.oversizedBuffers = mStats.oversizedBuffers.load(relaxed);
+    stats.discontinuities = mStats.discontinuities.load(relaxed);
+    stats.gatedFrames = mStats.gatedFrames.load(relaxed);
+    stats.ringOverruns = mOverrunCount.load(relaxed);
+    stats.dispatchDrops = mDispatchDrops.load(relaxed);
+    stats.processTime = mStats.processTime.load(relaxed);
+    stats.convertTime = mStats.convertTime.load(relaxed);
+    stats.resampleTime = mStats.resampleTime.load(relaxed);
+    stats.callbackTime = mStats.callbackTime.load(relaxed);
+    stats.callbackOverruns = mStats.callbackOverruns.load(relaxed);
+    stats.maxBufferGap = mStats.maxBufferGap.load(relaxed);
+    stats.resamplePosition = mStats.resamplePosition.load(relaxed);
+    stats.driftPPM = mDriftPPM.load(relaxed);
+    for (uint32 i = 0; i < kAudioStatsHistogramSize; i++) {
+        stats.processHistogram[i] = mStats.processHistogram[i].load(relaxed);
+        stats.callbackHistogram[i] = mStats.callbackHistogram[i].load(relaxed);
     }
+}
 
-    mRecorder->SetHooks(NULL, NULL, NULL);
 
-    delete mRecorder;
-    mRecorder = NULL;
+status_t
+AudioCapture::SetMetering(bigtime_t window, float peakDecay)
+{
+    if (window < 0 || peakDecay < 0.0f)
+        return B_BAD_VALUE;
+
+    if (mIsRecording)
+        return B_BUSY;
+
+    mMeterWindow = window;
+    mMeterDecay = peakDecay;
+    return B_OK;
 }
 
 
 void
-AudioCapture::cleanupBuffers()
+AudioCapture::GetLevels(AudioLevels& levels) const
 {
-    free(mDeviceFloatBuffer);
-    mDeviceFloatBuffer = NULL;
-    mDeviceFloatBufferSize = 0;
-    
-    free(mResampledBuffer);
-    mResampledBuffer = NULL;
-    mResampledBufferSize = 0;
-    mInputBufferOffset = 0.0;
+    const std::memory_order relaxed = std::memory_order_relaxed;
+    const uint32 channels = mMeterChannels;
+    levels.channelCount = channels;
+
+    // Windows are far apart, a retry is rare and never repeats for long
+    uint32 sequence;
+    do {
+        sequence = mLevelSequence.load(std::memory_order_acquire);
+        levels.windows = mLevelWindows.load(relaxed);
+        for (uint32 c = 0; c < channels; c++) {
+            levels.peak[c] = mLevelPeak[c].load(relaxed);
+            levels.rms[c] = mLevelRMS[c].load(relaxed);
+            levels.clips[c] = mLevelClips[c].load(relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((sequence & 1) != 0 || mLevelSequence.load(relaxed) != sequence);
+
+    for (uint32 c = channels; c < kAudioMaxMeterChannels; c++) {
+        levels.peak[c] = 0.0f;
+        levels.rms[c] = 0.0f;
+        levels.clips[c] = 0;
+    }
 }
 
 
+// Metering follows the delivered sample format: integer frames on the direct
+// PCM path, float frames everywhere else, one plane at a time in planar mode
 void
-AudioCapture::readCallbackC(void* cookie, bigtime_t /*timestamp*/, void* data, size_t size, const media_format& format) noexcept
+AudioCapture::configureMetering()
 {
-    AudioCapture* self = static_cast<AudioCapture*>(cookie);
-    if (self && self->mIsRecording && format.type == B_MEDIA_RAW_AUDIO) {
-        self->processData(data, size, format.u.raw_audio);
+    mLevelMeter = NULL;
+    mMeterChannels = 0;
+    if (mMeterWindow > 0 && mOutputChannels > kAudioMaxMeterChannels) {
+        fprintf(stderr, "AudioCapture: Warning - Metering supports up to %u channels, not %u.\n",
+            kAudioMaxMeterChannels, mOutputChannels);
+    } else if (mMeterWindow > 0) {
+        mLevelMeter = getLevelMeter(mPCMDirect ? mPCMFormat : SAMPLE_FLOAT,
+            mPlanarCallback != NULL ? 1 : mOutputChannels);
     }
+
+    const size_t windowFrames = static_cast<size_t>(mMeterWindow * mDeviceSampleRate / 1000000.0);
+    mMeterWindowFrames = windowFrames > 0 ? windowFrames : 1;
+    mMeterFrames = 0;
+    for (uint32 c = 0; c < kAudioMaxMeterChannels; c++) {
+        mMeterPeak[c] = 0.0f;
+        mMeterSum[c] = 0.0;
+        mMeterClips[c] = 0;
+        mMeterHeld[c] = 0.0f;
+        mLevelPeak[c].store(0.0f);
+        mLevelRMS[c].store(0.0f);
+        mLevelClips[c].store(0);
+    }
+    mLevelWindows.store(0);
+    if (mLevelMeter != NULL)
+        mMeterChannels = mOutputChannels;
 }
 
+
 void
-AudioCapture::notifyCallbackC(void* cookie, BMediaRecorder::notification code, ...)
+AudioCapture::meterFrames(const void* data, size_t frameCount)
 {
-     AudioCapture* self = static_cast<AudioCapture*>(cookie);
-     if (!self)
-     	return;
+    if (mLevelMeter == NULL)
+        return;
 
-     switch (code) {
-        case BMediaRecorder::B_WILL_STOP:
-            if (self->mIsRecording)
-                self->mIsRecording = false;
-            break;
-        default:
-            break;
-    }
+    mLevelMeter(mMeterPeak, mMeterSum, mMeterClips, data, frameCount, mMeterChannels);
+    finishMeterChunk(frameCount);
 }
 
 
 void
-AudioCapture::processData(void* data, size_t size, const media_raw_audio_format& inputFormat) noexcept
+AudioCapture::meterPlanes(const float* const* planes, size_t frameCount)
 {
-    if (!mUserCallback || size == 0 || !data)
-    	return;
+    if (mLevelMeter == NULL)
+        return;
 
-    // Get input buffer details
-    const uint32 inputChannels = inputFormat.channel_count;
-    const size_t bytesPerSample = getSampleSize(inputFormat.format);
-    if (inputChannels == 0 || bytesPerSample == 0) {
-        fprintf(stderr, "AudioCapture: processData - Invalid input format (channels=%u, sampleSize=%lu).\n", inputChannels, bytesPerSample);
+    for (uint32 c = 0; c < mMeterChannels; c++)
+        mLevelMeter(mMeterPeak + c, mMeterSum + c, mMeterClips + c, planes[c], frameCount, 1);
+    finishMeterChunk(frameCount);
+}
+
+
+// Publishes the window once it is complete. The sequence goes odd before the
+// first value is written and even again after the last, so GetLevels() can
+// tell a torn read.
+void
+AudioCapture::finishMeterChunk(size_t frameCount)
+{
+    mMeterFrames += frameCount;
+    if (mMeterFrames < mMeterWindowFrames)
         return;
+
+    const std::memory_order relaxed = std::memory_order_relaxed;
+    const float decay = powf(10.0f, -mMeterDecay / 20.0f * mMeterFrames / mDeviceSampleRate);
+    const uint32 sequence = mLevelSequence.load(relaxed);
+    mLevelSequence.store(sequence + 1, relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (uint32 c = 0; c < mMeterChannels; c++) {
+        const float held = mMeterHeld[c] * decay;
+        mMeterHeld[c] = mMeterPeak[c] > held ? mMeterPeak[c] : held;
+        mLevelPeak[c].store(mMeterHeld[c], relaxed);
+        mLevelRMS[c].store(static_cast<float>(sqrt(mMeterSum[c] / mMeterFrames)), relaxed);
+        mLevelClips[c].store(mLevelClips[c].load(relaxed) + mMeterClips[c], relaxed);
+        mMeterPeak[c] = 0.0f;
+        mMeterSum[c] = 0.0;
+        mMeterClips[c] = 0;
     }
-    const size_t inputFrameSize = inputChannels * bytesPerSample;
-    const size_t inputFrameCount = size / inputFrameSize;
+    mLevelWindows.store(mLevelWindows.load(relaxed) + 1, relaxed);
+    mLevelSequence.store(sequence + 2, std::memory_order_release);
+    mMeterFrames = 0;
+}
 
-    if (inputFrameCount == 0)
-    	return;
 
-    // Ensure intermediate buffer is large enough
-    const size_t deviceFloatChannels = 2; // Convert to stereo
-    const size_t deviceFrameSize = deviceFloatChannels * sizeof(float);
-    const size_t neededDeviceBufferSize = inputFrameCount * deviceFrameSize;
+status_t
+AudioCapture::SetGate(AudioGateMode mode, float thresholdDB, bigtime_t hangover, bigtime_t preRoll,
+    bool voiceDetection)
+{
+    if (mode < AUDIO_GATE_OFF || mode > AUDIO_GATE_MARK || hangover < 0 || preRoll < 0)
+        return B_BAD_VALUE;
 
-    if (mDeviceFloatBufferSize < neededDeviceBufferSize) {
-        void* newBuffer = realloc(mDeviceFloatBuffer, neededDeviceBufferSize);
-        if (!newBuffer) {
-            fprintf(stderr, "AudioCapture: Failed to realloc device float buffer (size %lu)!\n", neededDeviceBufferSize);
-            return;
-        }
-        mDeviceFloatBuffer = static_cast<float*>(newBuffer);
-        mDeviceFloatBufferSize = neededDeviceBufferSize;
-    }
+    if (mIsRecording)
+        return B_BUSY;
 
-    // Convert input data -> mDeviceFloatBuffer
-    float* deviceFloatData = mDeviceFloatBuffer;
-    const char* inputData = static_cast<const char*>(data);
+    mGateMode = mode;
+    mGateThreshold = thresholdDB;
+    mGateHangover = hangover;
+    mGatePreRoll = preRoll;
+    mGateVoice = voiceDetection;
+    return B_OK;
+}
 
-    for (size_t i = 0; i < inputFrameCount; ++i) {
-        float left = 0.0f, right = 0.0f;
-        const void* framePtr = inputData + i * inputFrameSize;
 
-        // Convert left channel
-        if (inputChannels >= 1) {
-            switch(inputFormat.format) {
-                case media_raw_audio_format::B_AUDIO_FLOAT: left = static_cast<const float*>(framePtr)[0]; break;
-                case media_raw_audio_format::B_AUDIO_INT:   left = int32ToFloat(reinterpret_cast<const int32*>(framePtr)[0]); break;
-                case media_raw_audio_format::B_AUDIO_SHORT: left = int16ToFloat(reinterpret_cast<const int16*>(framePtr)[0]); break;
-                case media_raw_audio_format::B_AUDIO_UCHAR: left = uint8ToFloat(reinterpret_cast<const uint8*>(framePtr)[0]); break;
-                case media_raw_audio_format::B_AUDIO_CHAR:  left = int8ToFloat(reinterpret_cast<const int8*>(framePtr)[0]); break;
-                default: left = 0.0f; break;
-            }
-        }
-        // Convert right channel (or duplicate left for mono)
-        if (inputChannels >= 2) {
-             const void* sample2Ptr = static_cast<const char*>(framePtr) + bytesPerSample;
-             switch(inputFormat.format) {
-                case media_raw_audio_format::B_AUDIO_FLOAT: right = static_cast<const float*>(sample2Ptr)[0]; break;
-                case media_raw_audio_format::B_AUDIO_INT:   right = int32ToFloat(reinterpret_cast<const int32*>(sample2Ptr)[0]); break;
-                case media_raw_audio_format::B_AUDIO_SHORT: right = int16ToFloat(reinterpret_cast<const int16*>(sample2Ptr)[0]); break;
-                case media_raw_audio_format::B_AUDIO_UCHAR: right = uint8ToFloat(reinterpret_cast<const uint8*>(sample2Ptr)[0]); break;
-                case media_raw_audio_format::B_AUDIO_CHAR:  right = int8ToFloat(reinterpret_cast<const int8*>(sample2Ptr)[0]); break;
-                 default: right = 0.0f; break;
-            }
-        } else {
-            right = left; // Mono -> Stereo
-        }        
-        // Write stereo float frame
-        deviceFloatData[i * deviceFloatChannels + 0] = left;
-        deviceFloatData[i * deviceFloatChannels + 1] = right;
+status_t
+AudioCapture::configureGate()
+{
+    mGateActive = false;
+    mGateClosed = false;
+    mPreRollFrames = 0;
+    mGateOpen.store(true, std::memory_order_relaxed);
+    if (mGateMode == AUDIO_GATE_OFF)
+        return B_OK;
+
+    const SampleType deviceType = getSampleType(mDeviceMediaFormatCode);
+    if (getLevelMeter(deviceType, mDeviceChannelCount) == NULL) {
+        fprintf(stderr, "AudioCapture: Warning - The input gate doesn't support the device format, "
+            "capturing ungated.\n");
+        return B_OK;
+    }
+    if (!mGate.Init(deviceType, mDeviceChannelCount, mDeviceSampleRate, mGateThreshold,
+            mGateHangover / 1000000.0, mGateVoice)) {
+        return B_NO_MEMORY;
     }
 
-    // Resample if needed
-    bool resamplingNeeded = (mResamplingRatio != 1.0);
-    if (resamplingNeeded) {
-        size_t outputFramesAvailable = 0;
+    const size_t frameSize = mDeviceChannelCount * getSampleSize(mDeviceMediaFormatCode);
+    const size_t preRollFrames = static_cast<size_t>(mGatePreRoll * mDeviceSampleRate / 1000000.0);
+    if (mGateMode == AUDIO_GATE_SUPPRESS && preRollFrames > 0) {
+        mPreRollChunk = static_cast<uint8*>(malloc(mChunkFrames * frameSize));
+        if (mPreRollChunk == NULL || !mPreRoll.Init(preRollFrames, frameSize))
+            return B_NO_MEMORY;
+        mPreRollFrames = preRollFrames;
+    }
 
-        // Estimate max output frames for buffer allocation
-        size_t maxOutputFrames = static_cast<size_t>(ceil((inputFrameCount + mInputBufferOffset) / mResamplingRatio)) + 2; // Add padding
-        size_t neededResampledBufferSize = maxOutputFrames * deviceFrameSize;
+    mGateActive = true;
+    mGateOpen.store(false, std::memory_order_relaxed);
+    return B_OK;
+}
 
-        // Ensure output buffer is large enough
-        if (mResampledBufferSize < neededResampledBufferSize) {
-             void* newBuffer = realloc(mResampledBuffer, neededResampledBufferSize);
-             if (!newBuffer) {
-                fprintf(stderr, "AudioCapture: Failed to realloc resampled buffer (size %lu)!\n", neededResampledBufferSize);
-                return;
-            }
-            mResampledBuffer = static_cast<float*>(newBuffer);
-            mResampledBufferSize = neededResampledBufferSize;
-        }
 
-        // Perform linear resampling
-        linearResample(mResampledBuffer, outputFramesAvailable, mDeviceFloatBuffer, inputFrameCount);
+// Returns whether the device buffer goes on. A closed gate in suppress mode
+// keeps the newest mPreRollFrames of what it holds back. Buffers that aren't
+// measurable, from a device that switched its sample type mid-stream, hold
+// the gate open, the meter only reads the negotiated type.
+bool
+AudioCapture::passGate(const void* data, size_t frameCount, size_t frameSize, bool measurable)
+{
+    const bool wasOpen = mGate.IsOpen();
+    bool open = true;
+    if (measurable) {
+        open = mGate.Process(data, frameCount);
+    } else {
+        mGate.Open();
+        // Held back frames of the old type can't be replayed
+        if (mPreRollFrames > 0)
+            mPreRoll.Discard(mPreRoll.Available());
+    }
+    mGateOpen.store(open, std::memory_order_relaxed);
+    if (mGateMode == AUDIO_GATE_MARK) {
+        mGateClosed = !open;
+        return true;
+    }
+
+    if (open) {
+        if (!wasOpen)
+            reopenGate(frameSize);
+        return true;
+    }
 
-        // Call user callback with RESAMPLED data
-        if (mUserCallback && outputFramesAvailable > 0) {
-            mUserCallback(mResampledBuffer, outputFramesAvailable, mUserData);
-        }
+    if (wasOpen)
+        flushBlock();
+    statsAdd(mStats.gatedFrames, static_cast<uint64>(frameCount));
 
-    } else {
-        // Resampling disabled, call user callback with data device rate
-        if (mUserCallback && inputFrameCount > 0) {
-            mUserCallback(mDeviceFloatBuffer, inputFrameCount, mUserData);
-        }
+    if (mPreRollFrames == 0)
+        return false;
+
+    const uint8* input = static_cast<const uint8*>(data);
+    if (frameCount > mPreRollFrames) {
+        input += (frameCount - mPreRollFrames) * frameSize;
+        frameCount = mPreRollFrames;
     }
+    const size_t held = mPreRoll.Available();
+    if (held + frameCount > mPreRollFrames)
+        mPreRoll.Discard(held + frameCount - mPreRollFrames);
+    mPreRoll.Write(input, frameCount);
+    return false;
 }
 
 
+// Moves the output timeline over the frames that were held back up to the
+// first pre-roll frame, with block delivery in whole blocks, then replays the
+// pre-roll ahead of the buffer that opened the gate. The resamplers restart
+// there, lining their next output frame up with the first replayed one.
 void
-AudioCapture::linearResample(float* outBuffer, size_t& outFrameCount, const float* inBuffer, size_t inFrameCount)
+AudioCapture::reopenGate(size_t frameSize)
 {
-    outFrameCount = 0;
-    if (inFrameCount == 0)
-    	return;
+    size_t preRollFrames = mPreRollFrames > 0 ? mPreRoll.Available() : 0;
+    const double resumeFrame = static_cast<double>(mBufferStartFrame - preRollFrames);
+    if (resumeFrame > mOutputPosition) {
+        const double ratio = mResamplingRatio * mRateAdjustment;
+        uint64 skipped = static_cast<uint64>(ceil((resumeFrame - mOutputPosition) / ratio));
+        if (mBlockFrames > 0)
+            skipped = (skipped + mBlockFrames - 1) / mBlockFrames * mBlockFrames;
+        mOutputFrames += skipped;
+        mOutputPosition += skipped * ratio;
+        // Whole output frames or blocks can land past the first held frames
+        const double ahead = mOutputPosition - resumeFrame;
+        if (ahead >= 1.0)
+            preRollFrames -= mPreRoll.Discard(static_cast<size_t>(ahead));
+        mDiscontinuity = true;
+        resetResamplers();
+    }
 
-    // Current position in the input buffer, considering offset from previous buffer
-    double currentInputPos = mInputBufferOffset;
+    if (preRollFrames == 0)
+        return;
+
+    // The replayed frames sit right before the current buffer
+    const uint64 bufferStartFrame = mBufferStartFrame;
+    const bigtime_t bufferTime = mBufferTime;
+    mBufferStartFrame -= preRollFrames;
+    mBufferTime -= static_cast<bigtime_t>(preRollFrames * 1000000.0 / mDeviceSampleRate);
+    size_t frames;
+    while ((frames = mPreRoll.Read(mPreRollChunk, mChunkFrames)) > 0)
+        processFrames(mPreRollChunk, frames, mDeviceChannelCount, frameSize);
+    mBufferStartFrame = bufferStartFrame;
+    mBufferTime = bufferTime;
+}
 
-    while (true) {
-        // Calculate integer index and fractional part for interpolation
-        size_t index1 = static_cast<size_t>(floor(currentInputPos));
-        double alpha = currentInputPos - index1;
-
-        // Check if we have enough input samples for interpolation
-        // Need sample at index1 and index1 + 1
-        if (index1 + 1 >= inFrameCount) {
-             // Not enough data in the current input buffer to generate more output samples
-            break;
-        }
 
-        // Get the two stereo sample pairs
-        const float* sample1Pair = &inBuffer[index1 * 2];
-        const float* sample2Pair = &inBuffer[(index1 + 1) * 2];
+// Completes a partial block with silence, so the output after a closed gate
+// starts on a block boundary
+void
+AudioCapture::flushBlock()
+{
+    if (mBlockFrames == 0 || mBlockFill == 0)
+        return;
 
-        // Perform linear interpolation for left and right channels
-        float outL = static_cast<float>(sample1Pair[0] * (1.0 - alpha) + sample2Pair[0] * alpha);
-        float outR = static_cast<float>(sample1Pair[1] * (1.0 - alpha) + sample2Pair[1] * alpha);
+    const size_t missing = mBlockFrames - mBlockFill;
+    if (mPlanarCallback != NULL) {
+        for (uint32 c = 0; c < mOutputChannels; c++)
+            memset(mBlockPlanes[c] + mBlockFill, 0, missing * sizeof(float));
+        deliverPlanes(mBlockPlanes, mBlockFrames);
+    } else {
+        const size_t frameBytes = mOutputChannels * (mPCMDirect ? sampleTypeSize(mPCMFormat) : sizeof(float));
+        memset(static_cast<uint8*>(mBlockBuffer) + mBlockFill * frameBytes, 0, missing * frameBytes);
+        deliverInterleaved(mBlockBuffer, mBlockFrames);
+    }
+    mBlockFill = 0;
+}
 
-        outBuffer[outFrameCount * 2 + 0] = outL;
-        outBuffer[outFrameCount * 2 + 1] = outR;
-        outFrameCount++;
 
-        currentInputPos += mResamplingRatio; // mResamplingRatio = InputRate / OutputRate
+void
+AudioCapture::resetResamplers()
+{
+    if (mResampler != NULL)
+        mResampler->Reset();
+    if (mPlaneResamplers != NULL) {
+        for (uint32 c = 0; c < mOutputChannels; c++)
+            mPlaneResamplers[c]->Reset();
     }
+    if (mPCMResampler != NULL)
+        mPCMResampler->Reset();
+    for (uint32 s = 0; s < mSinkStageCount; s++) {
+        if (mSinkStages[s].resampler != NULL)
+            mSinkStages[s].resampler->Reset();
+    }
+}
 
-    mInputBufferOffset = currentInputPos - inFrameCount;
-    mInputBufferOffset = fmax(0.0, mInputBufferOffset);
+
+// Callers time the callback from start, an overrun is a callback slower than
+// the audio it got
+void
+AudioCapture::recordCallback(bigtime_t start, size_t frameCount)
+{
+    const bigtime_t elapsed = system_time_nsecs() - start;
+    const double outputRate = mTargetSampleRate > 0.0f ? mTargetSampleRate : mDeviceSampleRate;
+    statsAdd(mStats.callbackTime, elapsed);
+    statsAdd(mStats.callbackHistogram[histogramBucket(elapsed)], static_cast<uint64>(1));
+    if (elapsed > frameCount * 1000000000.0 / outputRate)
+        statsAdd(mStats.callbackOverruns, static_cast<uint64>(1));
+}
+
+
+void
+AudioCapture::advanceOutput(size_t frameCount)
+{
+    mOutputFrames += frameCount;
+    mOutputPosition += frameCount * mResamplingRatio * mRateAdjustment;
+    statsAdd(mStats.buffersOut, static_cast<uint64>(1));
+    statsAdd(mStats.framesOut, static_cast<uint64>(frameCount));
+    mStats.resamplePosition.store(mOutputPosition - static_cast<double>(mInputFrames),
+        std::memory_order_relaxed);
+}
+
+
+status_t
+AudioCapture::SetDispatchMode(size_t queueDepth, AudioDispatchPolicy policy)
+{
+    if (policy != AUDIO_DISPATCH_DROP_NEWEST && policy != AUDIO_DISPATCH_DROP_OLDEST)
+        return B_BAD_VALUE;
+
+    if (mIsRecording)
+        return B_BUSY;
+
+    mDispatchDepth = queueDepth;
+    mDispatchPolicy = policy;
+    return B_OK;
+}
+
+
+status_t
+AudioCapture::SetBlockSize(size_t frameCount)
+{
+    if (mIsRecording)
+        return B_BUSY;
+
+    mBlockFrames = frameCount;
+    return B_OK;
+}
+
+
+status_t
+AudioCapture::SetTimedCallback(AudioTimedCallbackFunc callback, void* userData)
+{
+    if (mIsRecording)
+        return B_BUSY;
+
+    mTimedCallback = callback;
+    mTimedUserData = userData;
+    return B_OK;
+}
+
+
+int32
+AudioCapture::AddSink(AudioCallbackFunc callback, void* userData, float sampleRate,
+    AudioChannelLayout layout)
+{
+    if (callback == NULL || sampleRate < 0.0f
+        || (layout != AUDIO_CHANNELS_STEREO && layout != AUDIO_CHANNELS_MONO
+            && layout != AUDIO_CHANNELS_NATIVE)) {
+        return B_BAD_VALUE;
+    }
+
+    if (mIsRecording)
+        return B_BUSY;
+
+    Sink* sinks = static_cast<Sink*>(realloc(mSinks, (mSinkCount + 1) * sizeof(Sink)));
+    if (sinks == NULL)
+        return B_NO_MEMORY;
+    mSinks = sinks;
+
+    Sink& sink = mSinks[mSinkCount++];
+    sink.id = mNextSinkId++;
+    sink.callback = callback;
+    sink.userData = userData;
+    sink.sampleRate = sampleRate;
+    sink.layout = layout;
+    sink.stage = -1;
+    return sink.id;
+}
+
+
+status_t
+AudioCapture::RemoveSink(int32 id)
+{
+    if (mIsRecording)
+        return B_BUSY;
+
+    for (uint32 i = 0; i < mSinkCount; i++) {
+        if (mSinks[i].id == id) {
+            memmove(mSinks + i, mSinks + i + 1, (mSinkCount - i - 1) * sizeof(Sink));
+            mSinkCount--;
+            return B_OK;
+        }
+    }
+    return B_BAD_VALUE;
+}
+
+
+status_t
+AudioCapture::SetPCMCallback(AudioPCMCallbackFunc callback, SampleType format, void* userData)
+{
+    if (format != SAMPLE_INT16 && format != SAMPLE_INT32)
+        return B_BAD_VALUE;
+
+    if (mIsRecording)
+        return B_BUSY;
+
+    if (callback != NULL && mPlanarCallback != NULL)
+        return B_NOT_ALLOWED;
+
+    mPCMCallback = callback;
+    mPCMFormat = format;
+    mPCMUserData = userData;
+    return B_OK;
+}
+
+
+status_t
+AudioCapture::SetDither(bool enabled)
+{
+    if (mIsRecording)
+        return B_BUSY;
+
+    mDitherEnabled = enabled;
+    return B_OK;
+}
+
+
+status_t
+AudioCapture::SetTriggerPreRoll(bigtime_t duration)
+{
+    if (duration < 0)
+        return B_BAD_VALUE;
+
+    if (mIsRecording)
+        return B_BUSY;
+
+    mTriggerPreRoll = duration;
+    return B_OK;
+}
+
+
+status_t
+AudioCapture::Trigger(AudioCallbackFunc callback, void* userData)
+{
+    if (callback == NULL)
+        return B_BAD_VALUE;
+
+    if (mPlanarCallback != NULL || mPCMCallback != NULL)
+        return B_NOT_ALLOWED;
+
+    int32 expected = TRIGGER_IDLE;
+    if (!mTriggerState.compare_exchange_strong(expected, TRIGGER_ARMING))
+        return B_BUSY;
+
+    // A callback released from inside itself may still be running and
+    // reading the old ones. The realtime thread leaves them alone while
+    // arming, so once it is out they are free to change. A capture callback
+    // can't wait for it.
+    if (mTriggerBusy.load()) {
+        if (InRealtimeCallback()) {
+            mTriggerState.store(TRIGGER_IDLE);
+            return B_BUSY;
+        }
+        while (mTriggerBusy.load())
+            snooze(1000);
+    }
+
+    // Published by the state, the realtime thread reads them after it
+    mTriggerCallback = callback;
+    mTriggerUserData = userData;
+    mTriggerState.store(TRIGGER_PENDING, std::memory_order_release);
+    return B_OK;
+}
+
+
+status_t
+AudioCapture::ReleaseTrigger()
+{
+    // The realtime thread sets busy before it looks at the state, so once
+    // busy reads false after the state changed it won't call the callback
+    // again. The wait only covers a callback that is running right now, and
+    // is skipped on a realtime thread: from inside the trigger callback it
+    // would wait for itself.
+    mTriggerState.store(TRIGGER_IDLE);
+    if (InRealtimeCallback())
+        return B_OK;
+    while (mTriggerBusy.load())
+        snooze(1000);
+    return B_OK;
+}
+
+
+status_t
+AudioCapture::Stop()
+{
+    mIsRecording = false;
+    mPassthrough = false;
+
+    // Let a blocked Read() notice that no more data is coming
+    if (mRingSem >= B_OK && mReaderWaiting.exchange(false))
+        release_sem(mRingSem);
+
+    if (mRecorder) {
+		cleanupMediaResources();
+		cleanupBuffers();
+		mLastStatus = B_OK;
+		return mLastStatus;
+    } else {
+        cleanupBuffers();
+    }
+
+    return B_OK;
+}
+
+
+void
+AudioCapture::cleanupMediaResources()
+{
+     if (!mRecorder)
+     	return;
+
+    mRecorder->Stop();
+    if (mRecorder->IsConnected()) {
+        mRecorder->Disconnect();
+    }
+
+    mRecorder->SetHooks(NULL, NULL, NULL);
+
+    delete mRecorder;
+    mRecorder = NULL;
+}
+
+
+// Downmix gains of a channel_mask position as {left, right}
+static void
+getChannelGains(uint32 position, float& left, float& right)
+{
+    const float kHalfPower = 0.70710678f;
+
+    switch (position) {
+        case B_CHANNEL_LEFT:
+            left = 1.0f; right = 0.0f;
+            break;
+        case B_CHANNEL_RIGHT:
+            left = 0.0f; right = 1.0f;
+            break;
+        case B_CHANNEL_CENTER:
+            left = kHalfPower; right = kHalfPower;
+            break;
+        case B_CHANNEL_SUB:
+            left = 0.0f; right = 0.0f;
+            break;
+        case B_CHANNEL_REARLEFT:
+        case B_CHANNEL_FRONT_LEFT_CENTER:
+        case B_CHANNEL_SIDE_LEFT:
+            left = kHalfPower; right = 0.0f;
+            break;
+        case B_CHANNEL_REARRIGHT:
+        case B_CHANNEL_FRONT_RIGHT_CENTER:
+        case B_CHANNEL_SIDE_RIGHT:
+            left = 0.0f; right = kHalfPower;
+            break;
+        default:
+            left = 0.5f; right = 0.5f;
+            break;
+    }
+}
+
+
+// Fills a mono or stereo downmix matrix for the channels named by
+// channelMask, interleaved in the order of their mask bits. Rows are scaled
+// down where needed so a full scale input can't clip. Returns false if the
+// mask doesn't describe inputChannels channels.
+static bool
+buildDownmixMatrix(float* matrix, uint32 channelMask, uint32 inputChannels, uint32 outputChannels)
+{
+    if (static_cast<uint32>(__builtin_popcount(channelMask)) != inputChannels)
+        return false;
+
+    uint32 channel = 0;
+    for (uint32 bit = 0; bit < 32; bit++) {
+        if ((channelMask & (1u << bit)) == 0)
+            continue;
+
+        float left, right;
+        getChannelGains(1u << bit, left, right);
+        if (outputChannels == 1) {
+            matrix[channel] = (left + right) * 0.5f;
+        } else {
+            matrix[channel] = left;
+            matrix[inputChannels + channel] = right;
+        }
+        channel++;
+    }
+
+    for (uint32 o = 0; o < outputChannels; o++) {
+        float* row = matrix + o * inputChannels;
+        float sum = 0.0f;
+        for (uint32 i = 0; i < inputChannels; i++)
+            sum += row[i];
+        if (sum > 1.0f) {
+            for (uint32 i = 0; i < inputChannels; i++)
+                row[i] /= sum;
+        }
+    }
+    return true;
+}
+
+
+status_t
+AudioCapture::configureChannelLayout()
+{
+    free(mMixMatrix);
+    mMixMatrix = NULL;
+    mMatrixMixer = NULL;
+
+    const uint32 inputChannels = mDeviceChannelCount;
+    if (inputChannels == 0)
+        return B_MISMATCHED_VALUES;
+
+    mOutputChannels = OutputChannelCount();
+
+    // Layouts the frame converters produce on their own
+    switch (mChannelLayout) {
+        case AUDIO_CHANNELS_NATIVE:
+            return B_OK;
+        case AUDIO_CHANNELS_MONO:
+            if (inputChannels == 1)
+                return B_OK;
+            break;
+        case AUDIO_CHANNELS_MATRIX:
+            if (mUserMatrix == NULL)
+                return B_NO_INIT;
+            if (mUserMatrixInputs != inputChannels) {
+                fprintf(stderr, "AudioCapture: Mix matrix expects %u channels, device has %u\n",
+                    mUserMatrixInputs, inputChannels);
+                return B_MISMATCHED_VALUES;
+            }
+            break;
+        default:
+            if (inputChannels <= 2)
+                return B_OK;
+            break;
+    }
+
+    const size_t matrixSize = inputChannels * mOutputChannels;
+    mMixMatrix = static_cast<float*>(calloc(matrixSize, sizeof(float)));
+    if (mMixMatrix == NULL)
+        return B_NO_MEMORY;
+
+    if (mChannelLayout == AUDIO_CHANNELS_MATRIX) {
+        memcpy(mMixMatrix, mUserMatrix, matrixSize * sizeof(float));
+    } else if (!buildDownmixMatrix(mMixMatrix, mNegotiatedFormat.u.raw_audio.channel_mask,
+            inputChannels, mOutputChannels)) {
+        if (mOutputChannels == 2) {
+            // Unknown layout, keep the first two channels as before
+            free(mMixMatrix);
+            mMixMatrix = NULL;
+            return B_OK;
+        }
+        for (uint32 i = 0; i < inputChannels; i++)
+            mMixMatrix[i] = 1.0f / inputChannels;
+    }
+
+    // Planar output mixes one row at a time straight into its plane
+    mMatrixMixer = getMatrixMixer(inputChannels, mPlanarCallback != NULL ? 1 : mOutputChannels);
+    return mMatrixMixer != NULL ? B_OK : B_ERROR;
+}
+
+
+status_t
+AudioCapture::configurePCMOutput()
+{
+    mPCMDirect = false;
+    mQuantizer = NULL;
+    if (mPCMCallback == NULL)
+        return B_OK;
+
+    // Integer devices skip float entirely unless a mix needs it or the
+    // resampler has no integer mode for the output format
+    const SampleType deviceType = getSampleType(mDeviceMediaFormatCode);
+    const bool integerResampling = mPCMFormat == SAMPLE_INT16 && mResamplerQuality == RESAMPLER_LINEAR;
+    if (mMatrixMixer == NULL && (!resamplingEnabled() || integerResampling)
+        && getPCMFrameConverter(deviceType, mPCMFormat, mDeviceChannelCount, mOutputChannels) != NULL) {
+        mPCMDirect = true;
+        return B_OK;
+    }
+
+    mQuantizer = getQuantizer(mPCMFormat);
+    if (mQuantizer == NULL)
+        return B_ERROR;
+
+    seedDither(mDither, static_cast<uint32>(system_time()));
+    return B_OK;
+}
+
+
+status_t
+AudioCapture::createResamplers()
+{
+    if (!resamplingEnabled())
+        return B_OK;
+
+    // Drift compensation alone resamples to the nominal device rate
+    const double outputRate = mTargetSampleRate > 0.0f ? mTargetSampleRate : mDeviceSampleRate;
+
+    if (mPCMDirect) {
+        mPCMResampler = new(std::nothrow) LinearResampler();
+        if (mPCMResampler == NULL
+            || !mPCMResampler->Init(mOutputChannels, mDeviceSampleRate, outputRate)) {
+            return B_NO_MEMORY;
+        }
+        return B_OK;
+    }
+
+    if (mPlanarCallback == NULL) {
+        mResampler = AudioResampler::Create(mResamplerQuality, mOutputChannels, mDeviceSampleRate,
+            outputRate);
+        return mResampler != NULL ? B_OK : B_NO_MEMORY;
+    }
+
+    mPlaneResamplers = static_cast<AudioResampler**>(calloc(mOutputChannels, sizeof(AudioResampler*)));
+    if (mPlaneResamplers == NULL)
+        return B_NO_MEMORY;
+
+    for (uint32 c = 0; c < mOutputChannels; c++) {
+        mPlaneResamplers[c] = AudioResampler::Create(mResamplerQuality, 1, mDeviceSampleRate,
+            outputRate);
+        if (mPlaneResamplers[c] == NULL)
+            return B_NO_MEMORY;
+    }
+    return B_OK;
+}
+
+
+// One aligned block holding the plane pointers followed by the planes, each
+// plane starting on its own cache line. Released with free().
+static float**
+allocatePlanes(uint32 channels, size_t frameCount)
+{
+    const size_t headerSize = (channels * sizeof(float*) + kBufferAlignment - 1) & ~(kBufferAlignment - 1);
+    const size_t planeSize = (frameCount * sizeof(float) + kBufferAlignment - 1) & ~(kBufferAlignment - 1);
+    void* block = NULL;
+    if (posix_memalign(&block, kBufferAlignment, headerSize + channels * planeSize) != 0)
+        return NULL;
+
+    float** planes = static_cast<float**>(block);
+    uint8* data = static_cast<uint8*>(block) + headerSize;
+    for (uint32 c = 0; c < channels; c++)
+        planes[c] = reinterpret_cast<float*>(data + c * planeSize);
+    return planes;
+}
+
+
+status_t
+AudioCapture::allocateBuffers()
+{
+    // Size for the negotiated buffer, falling back to a sane default when the
+    // producer doesn't announce one
+    size_t chunkFrames = kDefaultChunkFrames;
+    const size_t deviceFrameSize = mDeviceChannelCount * getSampleSize(mDeviceMediaFormatCode);
+    if (mInputFormatDetails.buffer_size > 0 && deviceFrameSize > 0)
+        chunkFrames = mInputFormatDetails.buffer_size / deviceFrameSize;
+    if (chunkFrames == 0)
+        chunkFrames = kDefaultChunkFrames;
+    chunkFrames *= kBufferHeadroom;
+
+    mChunkFrames = chunkFrames;
+    mBlockFill = 0;
+    // Every run starts with an empty ring, or Read() would hand out what the
+    // last one left ahead of the new data with nothing marking the gap
+    mRingBuffer.Reset();
+
+    if (mBlockFrames > 0) {
+        if (mPlanarCallback != NULL) {
+            mBlockPlanes = allocatePlanes(mOutputChannels, mBlockFrames);
+            mBlockPlaneView = static_cast<const float**>(malloc(mOutputChannels * sizeof(float*)));
+            if (mBlockPlanes == NULL || mBlockPlaneView == NULL)
+                return B_NO_MEMORY;
+        } else {
+            const size_t sampleSize = mPCMDirect ? sampleTypeSize(mPCMFormat) : sizeof(float);
+            if (posix_memalign(&mBlockBuffer, kBufferAlignment,
+                    mBlockFrames * mOutputChannels * sampleSize) != 0) {
+                mBlockBuffer = NULL;
+                return B_NO_MEMORY;
+            }
+        }
+    }
+
+    // Room for the output of a chunk at the most the drift trim can speed
+    // the resampler up
+    const size_t resamplerInputFrames = mDriftCompensation
+        ? chunkFrames + static_cast<size_t>(chunkFrames * kMaxDriftPPM / 1000000.0) + 1 : chunkFrames;
+
+    if (mMatrixMixer != NULL) {
+        void* mixBuffer = NULL;
+        if (posix_memalign(&mixBuffer, kBufferAlignment,
+                chunkFrames * mDeviceChannelCount * sizeof(float)) != 0) {
+            return B_NO_MEMORY;
+        }
+        mMixBuffer = static_cast<float*>(mixBuffer);
+    }
+
+    if (mPlanarCallback != NULL) {
+        mPlanes = allocatePlanes(mOutputChannels, chunkFrames);
+        if (mPlanes == NULL)
+            return B_NO_MEMORY;
+
+        if (mPlaneResamplers != NULL) {
+            mResampledBufferFrames = mPlaneResamplers[0]->MaxOutputFrames(resamplerInputFrames);
+            mResampledPlanes = allocatePlanes(mOutputChannels, mResampledBufferFrames);
+            if (mResampledPlanes == NULL)
+                return B_NO_MEMORY;
+        }
+        return B_OK;
+    }
+
+    const size_t pcmFrameBytes = mOutputChannels * sampleTypeSize(mPCMFormat);
+    if (mPCMDirect) {
+        mPCMBuffer = malloc(chunkFrames * pcmFrameBytes);
+        if (mPCMBuffer == NULL)
+            return B_NO_MEMORY;
+
+        if (mPCMResampler != NULL) {
+            mResampledBufferFrames = mPCMResampler->MaxOutputFrames(resamplerInputFrames);
+            mPCMResampledBuffer = static_cast<int16*>(malloc(mResampledBufferFrames * pcmFrameBytes));
+            if (mPCMResampledBuffer == NULL)
+                return B_NO_MEMORY;
+        }
+        return B_OK;
+    }
+
+    // Mono input expanded to stereo converts into the upper half of the
+    // output, so the stereo size covers that case as well
+    const size_t deviceFrameBytes = mOutputChannels * sizeof(float);
+    void* deviceBuffer = NULL;
+    if (posix_memalign(&deviceBuffer, kBufferAlignment, chunkFrames * deviceFrameBytes) != 0)
+        return B_NO_MEMORY;
+
+    mDeviceFloatBuffer = static_cast<float*>(deviceBuffer);
+
+    if (mRingBuffer.Capacity() > 0 && mRingBuffer.FrameSize() != deviceFrameBytes) {
+        if (!mRingBuffer.Init(mRingBuffer.Capacity(), deviceFrameBytes))
+            return B_NO_MEMORY;
+    }
+
+    mTriggerWrite = 0;
+    mTriggerFill = 0;
+    // Trigger() is not allowed in planar or PCM mode, planar and direct PCM
+    // output returned above already
+    if (mTriggerPreRoll > 0 && mPCMCallback == NULL) {
+        const double outputRate = mTargetSampleRate > 0.0f ? mTargetSampleRate : mDeviceSampleRate;
+        const size_t frames = static_cast<size_t>(ceil(mTriggerPreRoll * outputRate / 1000000.0));
+        mTriggerHistory = static_cast<float*>(malloc(frames * deviceFrameBytes));
+        if (mTriggerHistory == NULL)
+            return B_NO_MEMORY;
+        mTriggerCapacity = frames;
+    }
+
+    if (mResampler != NULL) {
+        const size_t resampledFrames = mResampler->MaxOutputFrames(resamplerInputFrames);
+        void* resampledBuffer = NULL;
+        if (posix_memalign(&resampledBuffer, kBufferAlignment, resampledFrames * deviceFrameBytes) != 0)
+            return B_NO_MEMORY;
+
+        mResampledBuffer = static_cast<float*>(resampledBuffer);
+        mResampledBufferFrames = resampledFrames;
+    }
+
+    // Quantized output of whichever float buffer gets delivered
+    if (mPCMCallback != NULL) {
+        size_t pcmFrames = mResampledBufferFrames > chunkFrames ? mResampledBufferFrames : chunkFrames;
+        if (mBlockFrames > 0)
+            pcmFrames = mBlockFrames;
+        mPCMBuffer = malloc(pcmFrames * pcmFrameBytes);
+        if (mPCMBuffer == NULL)
+            return B_NO_MEMORY;
+    }
+
+    return B_OK;
+}
+
+
+// Mix matrix taking the device channels to a sink layout, mixing the way
+// the frame converters and configureChannelLayout() do for the capture
+// itself. Returns false when the device frames are already in the layout.
+static bool
+buildSinkMatrix(float* matrix, uint32 channelMask, uint32 inputChannels, uint32 outputChannels)
+{
+    if (inputChannels == outputChannels)
+        return false;
+
+    if (inputChannels == 1) {
+        matrix[0] = matrix[1] = 1.0f;
+        return true;
+    }
+
+    if (!buildDownmixMatrix(matrix, channelMask, inputChannels, outputChannels)) {
+        if (outputChannels == 2) {
+            matrix[0] = 1.0f;
+            matrix[inputChannels + 1] = 1.0f;
+        } else {
+            for (uint32 i = 0; i < inputChannels; i++)
+                matrix[i] = 1.0f / inputChannels;
+        }
+    }
+    return true;
+}
+
+
+status_t
+AudioCapture::createSinkStages()
+{
+    if (mSinkCount == 0)
+        return B_OK;
+
+    mSinkStages = static_cast<SinkStage*>(calloc(mSinkCount, sizeof(SinkStage)));
+    if (mSinkStages == NULL)
+        return B_NO_MEMORY;
+
+    // Float interleaved output of the capture itself can be shared as it is
+    const bool sharedOutput = mPlanarCallback == NULL && mPCMCallback == NULL
+        && mChannelLayout != AUDIO_CHANNELS_MATRIX;
+    const float outputRate = mTargetSampleRate > 0.0f ? mTargetSampleRate : mDeviceSampleRate;
+    const size_t resamplerInputFrames = mDriftCompensation
+        ? mChunkFrames + static_cast<size_t>(mChunkFrames * kMaxDriftPPM / 1000000.0) + 1 : mChunkFrames;
+
+    for (uint32 i = 0; i < mSinkCount; i++) {
+        Sink& sink = mSinks[i];
+        const float sampleRate = sink.sampleRate > 0.0f ? sink.sampleRate : mDeviceSampleRate;
+        sink.stage = -1;
+        if (sharedOutput && sink.layout == mChannelLayout && sampleRate == outputRate)
+            continue;
+
+        for (uint32 s = 0; s < mSinkStageCount; s++) {
+            if (mSinkStages[s].sampleRate == sampleRate && mSinkStages[s].layout == sink.layout) {
+                sink.stage = s;
+                break;
+            }
+        }
+        if (sink.stage >= 0)
+            continue;
+
+        SinkStage& stage = mSinkStages[mSinkStageCount];
+        sink.stage = mSinkStageCount++;
+        stage.sampleRate = sampleRate;
+        stage.layout = sink.layout;
+        stage.channels = sink.layout == AUDIO_CHANNELS_MONO ? 1
+            : sink.layout == AUDIO_CHANNELS_NATIVE ? mDeviceChannelCount : 2;
+
+        stage.matrix = static_cast<float*>(calloc(mDeviceChannelCount * stage.channels, sizeof(float)));
+        if (stage.matrix == NULL)
+            return B_NO_MEMORY;
+        if (buildSinkMatrix(stage.matrix, mNegotiatedFormat.u.raw_audio.channel_mask,
+                mDeviceChannelCount, stage.channels)) {
+            stage.mixer = getMatrixMixer(mDeviceChannelCount, stage.channels);
+            void* mixBuffer = NULL;
+            if (stage.mixer == NULL || posix_memalign(&mixBuffer, kBufferAlignment,
+                    mChunkFrames * stage.channels * sizeof(float)) != 0) {
+                return B_NO_MEMORY;
+            }
+            stage.mixBuffer = static_cast<float*>(mixBuffer);
+        } else {
+            free(stage.matrix);
+            stage.matrix = NULL;
+        }
+
+        // Like the capture itself, drift compensation resamples even at the
+        // nominal device rate
+        if (sampleRate != mDeviceSampleRate || mDriftCompensation) {
+            stage.resampler = AudioResampler::Create(mResamplerQuality, stage.channels,
+                mDeviceSampleRate, sampleRate);
+            if (stage.resampler == NULL)
+                return B_NO_MEMORY;
+            stage.resampledBufferFrames = stage.resampler->MaxOutputFrames(resamplerInputFrames);
+            void* resampledBuffer = NULL;
+            if (posix_memalign(&resampledBuffer, kBufferAlignment,
+                    stage.resampledBufferFrames * stage.channels * sizeof(float)) != 0) {
+                return B_NO_MEMORY;
+            }
+            stage.resampledBuffer = static_cast<float*>(resampledBuffer);
+        }
+    }
+
+    if (mSinkStageCount > 0 && mDeviceMediaFormatCode != media_raw_audio_format::B_AUDIO_FLOAT) {
+        void* input = NULL;
+        if (posix_memalign(&input, kBufferAlignment, mChunkFrames * mDeviceChannelCount * sizeof(float)) != 0)
+            return B_NO_MEMORY;
+        mSinkInput = static_cast<float*>(input);
+    }
+    return B_OK;
+}
+
+
+void
+AudioCapture::cleanupSinkStages()
+{
+    for (uint32 s = 0; s < mSinkStageCount; s++) {
+        SinkStage& stage = mSinkStages[s];
+        free(stage.matrix);
+        free(stage.mixBuffer);
+        delete stage.resampler;
+        free(stage.resampledBuffer);
+    }
+    free(mSinkStages);
+    mSinkStages = NULL;
+    mSinkStageCount = 0;
+
+    free(mSinkInput);
+    mSinkInput = NULL;
+    mSinkConverter = NULL;
+}
+
+
+void
+AudioCapture::cleanupBuffers()
+{
+    // The worker may still be reading from the blocks
+    stopDispatcher();
+
+    cleanupSinkStages();
+
+    free(mMixBuffer);
+    mMixBuffer = NULL;
+
+    free(mDeviceFloatBuffer);
+    mDeviceFloatBuffer = NULL;
+
+    free(mResampledBuffer);
+    mResampledBuffer = NULL;
+
+    free(mPlanes);
+    mPlanes = NULL;
+
+    free(mResampledPlanes);
+    mResampledPlanes = NULL;
+
+    free(mPCMBuffer);
+    mPCMBuffer = NULL;
+
+    free(mPCMResampledBuffer);
+    mPCMResampledBuffer = NULL;
+
+    free(mBlockBuffer);
+    mBlockBuffer = NULL;
+
+    free(mBlockPlanes);
+    mBlockPlanes = NULL;
+
+    free(mBlockPlaneView);
+    mBlockPlaneView = NULL;
+
+    free(mPreRollChunk);
+    mPreRollChunk = NULL;
+    mPreRollFrames = 0;
+    mGateActive = false;
+
+    free(mTriggerHistory);
+    mTriggerHistory = NULL;
+    mTriggerCapacity = 0;
+
+    mBlockFill = 0;
+    mChunkFrames = 0;
+    mResampledBufferFrames = 0;
+
+    delete mResampler;
+    mResampler = NULL;
+
+    delete mPCMResampler;
+    mPCMResampler = NULL;
+
+    if (mPlaneResamplers != NULL) {
+        for (uint32 c = 0; c < mOutputChannels; c++)
+            delete mPlaneResamplers[c];
+        free(mPlaneResamplers);
+        mPlaneResamplers = NULL;
+    }
+
+    free(mMixMatrix);
+    mMixMatrix = NULL;
+    mMatrixMixer = NULL;
+}
+
+
+status_t
+AudioCapture::startDispatcher()
+{
+    if (mDispatchDepth == 0)
+        return B_OK;
+
+    // The largest delivery any mode makes from one chunk, or the fixed block
+    size_t frames = mResampledBufferFrames > mChunkFrames ? mResampledBufferFrames : mChunkFrames;
+    if (mBlockFrames > 0)
+        frames = mBlockFrames;
+    const bool planar = mPlanarCallback != NULL;
+    // Planar blocks keep every plane on its own cache line
+    const size_t planeFrames = (frames + 15) & ~static_cast<size_t>(15);
+    const size_t blockSize = (planar ? planeFrames : frames) * mOutputChannels * sizeof(float);
+    // Queued blocks plus the one the worker is busy with
+    const size_t blockCount = mDispatchDepth + 1;
+
+    mDispatchBlocks = static_cast<DispatchBlock*>(calloc(blockCount, sizeof(DispatchBlock)));
+    void* data = NULL;
+    if (mDispatchBlocks == NULL || posix_memalign(&data, kBufferAlignment, blockCount * blockSize) != 0)
+        return B_NO_MEMORY;
+    mDispatchData = static_cast<uint8*>(data);
+
+    if (planar) {
+        mDispatchPlanes = static_cast<float**>(malloc(blockCount * mOutputChannels * sizeof(float*)));
+        if (mDispatchPlanes == NULL)
+            return B_NO_MEMORY;
+    }
+
+    if (!mFreeBlocks.Init(blockCount) || !mReadyBlocks.Init(blockCount))
+        return B_NO_MEMORY;
+
+    for (size_t i = 0; i < blockCount; i++) {
+        DispatchBlock& block = mDispatchBlocks[i];
+        block.data = mDispatchData + i * blockSize;
+        if (planar) {
+            block.planes = mDispatchPlanes + i * mOutputChannels;
+            for (uint32 c = 0; c < mOutputChannels; c++)
+                block.planes[c] = reinterpret_cast<float*>(block.data) + c * planeFrames;
+        }
+        mFreeBlocks.Push(i);
+    }
+    mDispatchBlockFrames = frames;
+
+    mDispatchSem = create_sem(0, "AudioCapture dispatch");
+    if (mDispatchSem < B_OK)
+        return mDispatchSem;
+
+    mDispatchQuit.store(false);
+    mDispatchWaiting.store(false);
+    mDispatchThread = spawn_thread(dispatchThreadC, "AudioCapture dispatch", B_NORMAL_PRIORITY, this);
+    if (mDispatchThread < B_OK)
+        return mDispatchThread;
+
+    return resume_thread(mDispatchThread);
+}
+
+
+void
+AudioCapture::stopDispatcher()
+{
+    if (mDispatchThread >= B_OK) {
+        // The worker delivers whatever is still queued before it exits
+        mDispatchQuit.store(true);
+        release_sem(mDispatchSem);
+        status_t result;
+        wait_for_thread(mDispatchThread, &result);
+        mDispatchThread = -1;
+    }
+
+    if (mDispatchSem >= B_OK) {
+        delete_sem(mDispatchSem);
+        mDispatchSem = -1;
+    }
+
+    free(mDispatchBlocks);
+    mDispatchBlocks = NULL;
+    free(mDispatchData);
+    mDispatchData = NULL;
+    free(mDispatchPlanes);
+    mDispatchPlanes = NULL;
+    mDispatchBlockFrames = 0;
+}
+
+
+int32
+AudioCapture::dispatchThreadC(void* cookie)
+{
+    return static_cast<AudioCapture*>(cookie)->dispatchLoop();
+}
+
+
+int32
+AudioCapture::dispatchLoop()
+{
+    while (true) {
+        uint32 index;
+        if (mReadyBlocks.Pop(index)) {
+            runDispatchBlock(index);
+            mFreeBlocks.Push(index);
+            continue;
+        }
+        if (mDispatchQuit.load())
+            break;
+
+        // Same handshake as Read(), the producer only signals a waiting worker
+        mDispatchWaiting.store(true);
+        if (mReadyBlocks.Count() > 0 || mDispatchQuit.load()) {
+            mDispatchWaiting.store(false);
+            continue;
+        }
+        acquire_sem(mDispatchSem);
+        mDispatchWaiting.store(false);
+    }
+    return B_OK;
+}
+
+
+// Realtime side: a free block, or with DROP_OLDEST the oldest queued one.
+// Returns -1 when the new buffer has to be dropped.
+int32
+AudioCapture::acquireDispatchBlock()
+{
+    uint32 index;
+    if (mFreeBlocks.Pop(index))
+        return index;
+
+    if (mDispatchPolicy == AUDIO_DISPATCH_DROP_OLDEST && mReadyBlocks.Pop(index)) {
+        mDispatchDrops.fetch_add(1, std::memory_order_relaxed);
+        mDispatchDroppedFrames.fetch_add(mDispatchBlocks[index].frameCount, std::memory_order_relaxed);
+        return index;
+    }
+    return -1;
+}
+
+
+void
+AudioCapture::submitDispatchBlock(uint32 index, size_t frameCount)
+{
+    mDispatchBlocks[index].frameCount = frameCount;
+    mReadyBlocks.Push(index);
+    if (mDispatchWaiting.exchange(false))
+        release_sem_etc(mDispatchSem, 1, B_DO_NOT_RESCHEDULE);
+}
+
+
+void
+AudioCapture::runDispatchBlock(uint32 index)
+{
+    const DispatchBlock& block = mDispatchBlocks[index];
+    const bigtime_t start = system_time_nsecs();
+    if (mPlanarCallback != NULL) {
+        mPlanarCallback(block.planes, block.frameCount, mOutputChannels, mPlanarUserData);
+    } else if (mPCMCallback != NULL) {
+        mPCMCallback(block.data, block.frameCount, mOutputChannels, mPCMFormat, mPCMUserData);
+    } else {
+        const float* frames = reinterpret_cast<const float*>(block.data);
+        if (mUserCallback)
+            mUserCallback(frames, block.frameCount, mOutputChannels, mUserData);
+        if (mTimedCallback)
+            mTimedCallback(frames, block.frameCount, mOutputChannels, block.info, mTimedUserData);
+    }
+    recordCallback(start, block.frameCount);
+}
+
+
+void
+AudioCapture::readCallbackC(void* cookie, bigtime_t timestamp, void* data, size_t size, const media_format& format) noexcept
+{
+    AudioCapture* self = static_cast<AudioCapture*>(cookie);
+    if (self && self->mIsRecording && format.type == B_MEDIA_RAW_AUDIO) {
+        StatsCounters& stats = self->mStats;
+        const bigtime_t start = system_time_nsecs();
+        const bigtime_t lastArrival = stats.lastArrival.load(std::memory_order_relaxed);
+        if (lastArrival != 0 && (start - lastArrival) / 1000 > stats.maxBufferGap.load(std::memory_order_relaxed))
+            stats.maxBufferGap.store((start - lastArrival) / 1000, std::memory_order_relaxed);
+        stats.lastArrival.store(start, std::memory_order_relaxed);
+        statsAdd(stats.buffersIn, static_cast<uint64>(1));
+
+        sInRealtimeCallback = true;
+        self->processData(data, size, format.u.raw_audio, timestamp);
+        sInRealtimeCallback = false;
+
+        const bigtime_t elapsed = system_time_nsecs() - start;
+        statsAdd(stats.processTime, elapsed);
+        statsAdd(stats.processHistogram[histogramBucket(elapsed)], static_cast<uint64>(1));
+    }
+}
+
+
+bool
+AudioCapture::InRealtimeCallback()
+{
+    return sInRealtimeCallback;
+}
+
+void
+AudioCapture::notifyCallbackC(void* cookie, BMediaRecorder::notification code, ...)
+{
+     AudioCapture* self = static_cast<AudioCapture*>(cookie);
+     if (!self)
+     	return;
+
+     switch (code) {
+        case BMediaRecorder::B_WILL_STOP:
+            if (self->mIsRecording)
+                self->mIsRecording = false;
+            if (self->mRingSem >= B_OK && self->mReaderWaiting.exchange(false))
+                release_sem(self->mRingSem);
+            break;
+        default:
+            break;
+    }
+}
+
+
+ssize_t
+AudioCapture::Read(float* buffer, size_t maxFrames, bigtime_t timeout)
+{
+    if (mRingBuffer.Capacity() == 0 || mRingSem < B_OK)
+        return B_NO_INIT;
+    if (buffer == NULL)
+        return B_BAD_VALUE;
+    if (maxFrames == 0)
+        return 0;
+
+    const bigtime_t deadline = timeout == B_INFINITE_TIMEOUT
+        ? B_INFINITE_TIMEOUT : system_time() + timeout;
+
+    while (true) {
+        size_t frames = mRingBuffer.Read(buffer, maxFrames);
+        if (frames > 0)
+            return frames;
+        if (!mIsRecording)
+            return 0;
+        if (timeout <= 0)
+            return B_WOULD_BLOCK;
+
+        // Announce the wait, then check again so a write in between can't be missed
+        mReaderWaiting.store(true);
+        if (mRingBuffer.Available() > 0 || !mIsRecording) {
+            mReaderWaiting.store(false);
+            continue;
+        }
+
+        status_t status = deadline == B_INFINITE_TIMEOUT
+            ? acquire_sem(mRingSem)
+            : acquire_sem_etc(mRingSem, 1, B_ABSOLUTE_TIMEOUT, deadline);
+        mReaderWaiting.store(false);
+        if (status == B_TIMED_OUT) {
+            frames = mRingBuffer.Read(buffer, maxFrames);
+            return frames > 0 ? static_cast<ssize_t>(frames) : B_TIMED_OUT;
+        }
+        if (status != B_OK && status != B_INTERRUPTED)
+            return status;
+    }
+}
+
+
+// Cuts interleaved output into fixed blocks when a block size is set. Only
+// the part of a block that straddles two calls is copied.
+void
+AudioCapture::emitInterleaved(const void* data, size_t frameCount)
+{
+    if (mBlockFrames == 0) {
+        deliverInterleaved(data, frameCount);
+        return;
+    }
+
+    const size_t frameBytes = mOutputChannels * (mPCMDirect ? sampleTypeSize(mPCMFormat) : sizeof(float));
+    const uint8* input = static_cast<const uint8*>(data);
+    uint8* block = static_cast<uint8*>(mBlockBuffer);
+
+    if (mBlockFill > 0) {
+        size_t frames = mBlockFrames - mBlockFill;
+        if (frames > frameCount)
+            frames = frameCount;
+        memcpy(block + mBlockFill * frameBytes, input, frames * frameBytes);
+        mBlockFill += frames;
+        input += frames * frameBytes;
+        frameCount -= frames;
+        if (mBlockFill < mBlockFrames)
+            return;
+        deliverInterleaved(block, mBlockFrames);
+        mBlockFill = 0;
+    }
+
+    for (; frameCount >= mBlockFrames; frameCount -= mBlockFrames) {
+        deliverInterleaved(input, mBlockFrames);
+        input += mBlockFrames * frameBytes;
+    }
+
+    if (frameCount > 0) {
+        memcpy(block, input, frameCount * frameBytes);
+        mBlockFill = frameCount;
+    }
+}
+
+
+void
+AudioCapture::emitPlanes(const float* const* planes, size_t frameCount)
+{
+    if (mBlockFrames == 0) {
+        deliverPlanes(planes, frameCount);
+        return;
+    }
+
+    size_t offset = 0;
+    if (mBlockFill > 0) {
+        size_t frames = mBlockFrames - mBlockFill;
+        if (frames > frameCount)
+            frames = frameCount;
+        for (uint32 c = 0; c < mOutputChannels; c++)
+            memcpy(mBlockPlanes[c] + mBlockFill, planes[c], frames * sizeof(float));
+        mBlockFill += frames;
+        offset = frames;
+        if (mBlockFill < mBlockFrames)
+            return;
+        deliverPlanes(mBlockPlanes, mBlockFrames);
+        mBlockFill = 0;
+    }
+
+    for (; offset + mBlockFrames <= frameCount; offset += mBlockFrames) {
+        for (uint32 c = 0; c < mOutputChannels; c++)
+            mBlockPlaneView[c] = planes[c] + offset;
+        deliverPlanes(mBlockPlaneView, mBlockFrames);
+    }
+
+    if (offset < frameCount) {
+        mBlockFill = frameCount - offset;
+        for (uint32 c = 0; c < mOutputChannels; c++)
+            memcpy(mBlockPlanes[c], planes[c] + offset, mBlockFill * sizeof(float));
+    }
+}
+
+
+void
+AudioCapture::deliverInterleaved(const void* data, size_t frameCount)
+{
+    if (mPCMDirect)
+        deliverPCM(data, frameCount);
+    else
+        deliverFrames(static_cast<const float*>(data), frameCount);
+}
+
+
+void
+AudioCapture::deliverFrames(const float* frames, size_t frameCount)
+{
+    if (mPCMCallback != NULL) {
+        const bigtime_t start = system_time_nsecs();
+        mQuantizer(mPCMBuffer, frames, frameCount * mOutputChannels, mDitherEnabled ? &mDither : NULL);
+        statsAdd(mStats.convertTime, system_time_nsecs() - start);
+        deliverPCM(mPCMBuffer, frameCount);
+        return;
+    }
+
+    if (mRingBuffer.Capacity() > 0) {
+        size_t written = mRingBuffer.Write(frames, frameCount);
+        if (written < frameCount) {
+            mOverrunCount.fetch_add(1, std::memory_order_relaxed);
+            mOverrunFrames.fetch_add(frameCount - written, std::memory_order_relaxed);
+        }
+        if (written > 0 && mReaderWaiting.exchange(false))
+            release_sem_etc(mRingSem, 1, B_DO_NOT_RESCHEDULE);
+    }
+
+    feedTrigger(frames, frameCount);
+
+    AudioBufferInfo info = {};
+    if (mTimedCallback) {
+        // The resamplers line output frame 0 up with input frame 0, so the
+        // first frame here sits this far from the start of the device buffer,
+        // negative while the resampler still holds back earlier input
+        const double inputOffset = mOutputPosition - static_cast<double>(mBufferStartFrame);
+        info.performanceTime = mBufferTime
+            + static_cast<bigtime_t>(llround(inputOffset * 1000000.0 / mDeviceSampleRate));
+        info.frameIndex = mOutputFrames;
+        info.discontinuity = mDiscontinuity;
+        info.gated = mGateClosed;
+        mDiscontinuity = false;
+    }
+
+    if (mDispatchThread >= B_OK) {
+        if (mUserCallback || mTimedCallback) {
+            const int32 index = acquireDispatchBlock();
+            if (index >= 0) {
+                memcpy(mDispatchBlocks[index].data, frames, frameCount * mOutputChannels * sizeof(float));
+                mDispatchBlocks[index].info = info;
+                submitDispatchBlock(index, frameCount);
+            } else {
+                mDispatchDrops.fetch_add(1, std::memory_order_relaxed);
+                mDispatchDroppedFrames.fetch_add(frameCount, std::memory_order_relaxed);
+            }
+        }
+    } else if (mUserCallback || mTimedCallback) {
+        const bigtime_t start = system_time_nsecs();
+        if (mUserCallback)
+            mUserCallback(frames, frameCount, mOutputChannels, mUserData);
+        if (mTimedCallback)
+            mTimedCallback(frames, frameCount, mOutputChannels, info, mTimedUserData);
+        recordCallback(start, frameCount);
+    }
+
+    for (uint32 i = 0; i < mSinkCount; i++) {
+        if (mSinks[i].stage < 0)
+            mSinks[i].callback(frames, frameCount, mOutputChannels, mSinks[i].userData);
+    }
+
+    advanceOutput(frameCount);
+}
+
+
+void
+AudioCapture::deliverPCM(const void* data, size_t frameCount)
+{
+    advanceOutput(frameCount);
+
+    if (mDispatchThread < B_OK) {
+        const bigtime_t start = system_time_nsecs();
+        mPCMCallback(data, frameCount, mOutputChannels, mPCMFormat, mPCMUserData);
+        recordCallback(start, frameCount);
+        return;
+    }
+
+    const int32 index = acquireDispatchBlock();
+    if (index < 0) {
+        mDispatchDrops.fetch_add(1, std::memory_order_relaxed);
+        mDispatchDroppedFrames.fetch_add(frameCount, std::memory_order_relaxed);
+        return;
+    }
+    memcpy(mDispatchBlocks[index].data, data, frameCount * mOutputChannels * sampleTypeSize(mPCMFormat));
+    submitDispatchBlock(index, frameCount);
+}
+
+
+void
+AudioCapture::deliverPlanes(const float* const* planes, size_t frameCount)
+{
+    advanceOutput(frameCount);
+
+    if (mDispatchThread < B_OK) {
+        const bigtime_t start = system_time_nsecs();
+        mPlanarCallback(planes, frameCount, mOutputChannels, mPlanarUserData);
+        recordCallback(start, frameCount);
+        return;
+    }
+
+    const int32 index = acquireDispatchBlock();
+    if (index < 0) {
+        mDispatchDrops.fetch_add(1, std::memory_order_relaxed);
+        mDispatchDroppedFrames.fetch_add(frameCount, std::memory_order_relaxed);
+        return;
+    }
+    for (uint32 c = 0; c < mOutputChannels; c++)
+        memcpy(mDispatchBlocks[index].planes[c], planes[c], frameCount * sizeof(float));
+    submitDispatchBlock(index, frameCount);
+}
+
+
+// Called with every interleaved float output buffer. The history is copied
+// into the ring once and handed to the trigger callback from there, at most
+// in two parts where it wraps.
+void
+AudioCapture::feedTrigger(const float* frames, size_t frameCount)
+{
+    if (mTriggerCapacity == 0 && mTriggerState.load(std::memory_order_relaxed) == TRIGGER_IDLE)
+        return;
+
+    const uint32 channels = mOutputChannels;
+    mTriggerBusy.store(true);
+    int32 state = mTriggerState.load();
+    if (state == TRIGGER_PENDING) {
+        if (mTriggerFill > 0) {
+            const size_t start = (mTriggerWrite + mTriggerCapacity - mTriggerFill) % mTriggerCapacity;
+            const size_t first = mTriggerFill < mTriggerCapacity - start ? mTriggerFill : mTriggerCapacity - start;
+            mTriggerCallback(mTriggerHistory + start * channels, first, channels, mTriggerUserData);
+            if (first < mTriggerFill && mTriggerState.load() == TRIGGER_PENDING)
+                mTriggerCallback(mTriggerHistory, mTriggerFill - first, channels, mTriggerUserData);
+        }
+        // Released meanwhile, the live part is not wanted anymore
+        int32 expected = TRIGGER_PENDING;
+        if (mTriggerState.compare_exchange_strong(expected, TRIGGER_ACTIVE))
+            state = TRIGGER_ACTIVE;
+    }
+    if (state == TRIGGER_ACTIVE)
+        mTriggerCallback(frames, frameCount, channels, mTriggerUserData);
+    mTriggerBusy.store(false, std::memory_order_release);
+
+    if (mTriggerCapacity == 0)
+        return;
+
+    // Only the newest frames of a buffer longer than the history matter
+    if (frameCount > mTriggerCapacity) {
+        frames += (frameCount - mTriggerCapacity) * channels;
+        frameCount = mTriggerCapacity;
+    }
+    const size_t first = frameCount < mTriggerCapacity - mTriggerWrite
+        ? frameCount : mTriggerCapacity - mTriggerWrite;
+    memcpy(mTriggerHistory + mTriggerWrite * channels, frames, first * channels * sizeof(float));
+    memcpy(mTriggerHistory, frames + first * channels, (frameCount - first) * channels * sizeof(float));
+    mTriggerWrite = (mTriggerWrite + frameCount) % mTriggerCapacity;
+    mTriggerFill = mTriggerFill + frameCount < mTriggerCapacity ? mTriggerFill + frameCount : mTriggerCapacity;
+}
+
+
+// Second order DLL: the error between the predicted and the reported buffer
+// start corrects the time directly and the period through the integrator
+void
+AudioCapture::updateDriftEstimate(bigtime_t timestamp, size_t frameCount, bool restart)
+{
+    if (mDllFrames == 0 || restart) {
+        // Lock onto this buffer, a jump keeps the period measured so far
+        mDllTime = timestamp;
+    } else {
+        const double error = timestamp - mDllTime;
+        const double omega = 2.0 * M_PI * kDriftLoopBandwidth * mDllFrames * mDllPeriod / 1000000.0;
+        mDllTime += M_SQRT2 * omega * error;
+        mDllPeriod += omega * omega * error / mDllFrames;
+    }
+    mDllTime += frameCount * mDllPeriod;
+    mDllFrames = frameCount;
+
+    // Actual rate over nominal rate
+    double drift = mNominalPeriod / mDllPeriod - 1.0;
+    if (drift > kMaxDriftPPM / 1000000.0)
+        drift = kMaxDriftPPM / 1000000.0;
+    else if (drift < -kMaxDriftPPM / 1000000.0)
+        drift = -kMaxDriftPPM / 1000000.0;
+    mDriftPPM.store(drift * 1000000.0, std::memory_order_relaxed);
+
+    if (!mDriftCompensation)
+        return;
+
+    // A faster device needs more input per output frame
+    mRateAdjustment = 1.0 + drift;
+    if (mResampler != NULL)
+        mResampler->SetRateAdjustment(mRateAdjustment);
+    if (mPCMResampler != NULL)
+        mPCMResampler->SetRateAdjustment(mRateAdjustment);
+    if (mPlaneResamplers != NULL) {
+        for (uint32 c = 0; c < mOutputChannels; c++)
+            mPlaneResamplers[c]->SetRateAdjustment(mRateAdjustment);
+    }
+    for (uint32 s = 0; s < mSinkStageCount; s++) {
+        if (mSinkStages[s].resampler != NULL)
+            mSinkStages[s].resampler->SetRateAdjustment(mRateAdjustment);
+    }
+}
+
+
+void
+AudioCapture::processData(void* data, size_t size, const media_raw_audio_format& inputFormat,
+    bigtime_t timestamp) noexcept
+{
+    if ((!mUserCallback && !mTimedCallback && !mPlanarCallback && !mPCMCallback
+            && mRingBuffer.Capacity() == 0 && mSinkCount == 0 && mTriggerCapacity == 0
+            && mTriggerState.load(std::memory_order_relaxed) == TRIGGER_IDLE)
+        || size == 0 || !data)
+    	return;
+
+    // Get input buffer details
+    const uint32 inputChannels = inputFormat.channel_count;
+    const size_t bytesPerSample = getSampleSize(inputFormat.format);
+    if (inputChannels == 0 || bytesPerSample == 0) {
+        fprintf(stderr, "AudioCapture: processData - Invalid input format (channels=%u, sampleSize=%lu).\n", inputChannels, bytesPerSample);
+        statsAdd(mStats.droppedBuffers, static_cast<uint64>(1));
+        return;
+    }
+    const size_t inputFrameSize = inputChannels * bytesPerSample;
+    const size_t inputFrameCount = size / inputFrameSize;
+
+    if (inputFrameCount == 0)
+    	return;
+
+    if (mChunkFrames == 0)
+        return;
+
+    // Buffers and the mix matrix were set up for the negotiated channel count
+    if (inputChannels != mDeviceChannelCount) {
+        statsAdd(mStats.droppedBuffers, static_cast<uint64>(1));
+        return;
+    }
+
+    if (inputFormat.format != mConverterFormatCode || inputChannels != mConverterChannelCount)
+        selectFrameConverter(inputFormat.format, inputChannels);
+    statsAdd(mStats.framesIn, static_cast<uint64>(inputFrameCount));
+
+    // Small timestamp jitter is normal, being off by more than half a buffer
+    // means input was lost or repeated
+    const bigtime_t bufferDuration = static_cast<bigtime_t>(inputFrameCount * 1000000.0 / mDeviceSampleRate);
+    const bool jumped = mNextBufferTime >= 0 && llabs(timestamp - mNextBufferTime) > bufferDuration / 2;
+    if (jumped) {
+        mDiscontinuity = true;
+        statsAdd(mStats.discontinuities, static_cast<uint64>(1));
+    }
+    mNextBufferTime = timestamp + bufferDuration;
+    mBufferTime = timestamp;
+    mBufferStartFrame = mInputFrames;
+    mInputFrames += inputFrameCount;
+    updateDriftEstimate(timestamp, inputFrameCount, jumped);
+
+    if (mGateActive && !passGate(data, inputFrameCount, inputFrameSize,
+            inputFormat.format == mDeviceMediaFormatCode)) {
+        return;
+    }
+
+    processFrames(data, inputFrameCount, inputChannels, inputFrameSize);
+}
+
+
+// Everything past the gate, for device buffers and replayed pre-roll alike
+void
+AudioCapture::processFrames(const void* data, size_t inputFrameCount, uint32 inputChannels,
+    size_t inputFrameSize)
+{
+    if (mSinkStageCount > 0) {
+        const uint8* input = static_cast<const uint8*>(data);
+        for (size_t offset = 0; offset < inputFrameCount; offset += mChunkFrames) {
+            const size_t frameCount = inputFrameCount - offset < mChunkFrames
+                ? inputFrameCount - offset : mChunkFrames;
+            processSinkChunk(input + offset * inputFrameSize, frameCount, inputChannels);
+        }
+        // Nothing else to feed when every sink has a stage of its own
+        if (!mUserCallback && !mTimedCallback && !mPlanarCallback && !mPCMCallback
+            && mRingBuffer.Capacity() == 0 && mSinkStageCount == mSinkCount
+            && mTriggerCapacity == 0 && mTriggerState.load(std::memory_order_relaxed) == TRIGGER_IDLE) {
+            return;
+        }
+    }
+
+    // Device buffers that are already the output go out as they are, in
+    // chunks so that a dispatch block can still hold each delivery
+    if (mPassthrough) {
+        const float* frames = static_cast<const float*>(data);
+        for (size_t offset = 0; offset < inputFrameCount; offset += mChunkFrames) {
+            const size_t frameCount = inputFrameCount - offset < mChunkFrames
+                ? inputFrameCount - offset : mChunkFrames;
+            meterFrames(frames + offset * mOutputChannels, frameCount);
+            emitInterleaved(frames + offset * mOutputChannels, frameCount);
+        }
+        return;
+    }
+
+    if (mPCMDirect ? mPCMConverter == NULL
+            : mFrameConverter == NULL || (mPlanarCallback != NULL && mPlanarConverter == NULL)) {
+        statsAdd(mStats.droppedBuffers, static_cast<uint64>(1));
+        return;
+    }
+
+    if (inputFrameCount > mChunkFrames)
+        statsAdd(mStats.oversizedBuffers, static_cast<uint64>(1));
+
+    // Oversized device buffers are split rather than growing the buffers here
+    const uint8* input = static_cast<const uint8*>(data);
+    size_t remaining = inputFrameCount;
+    while (remaining > 0) {
+        const size_t chunk = remaining < mChunkFrames ? remaining : mChunkFrames;
+        if (mPlanarCallback != NULL)
+            processPlanarChunk(input, chunk, inputChannels);
+        else if (mPCMDirect)
+            processPCMChunk(input, chunk, inputChannels);
+        else
+            processChunk(input, chunk, inputChannels);
+        input += chunk * inputFrameSize;
+        remaining -= chunk;
+    }
+}
+
+
+void
+AudioCapture::processChunk(const void* data, size_t frameCount, uint32 inputChannels)
+{
+    const bigtime_t start = system_time_nsecs();
+
+    // Convert input data -> mDeviceFloatBuffer, through the mix if needed
+    if (mMatrixMixer != NULL) {
+        mFrameConverter(mMixBuffer, data, frameCount, inputChannels);
+        mMatrixMixer(mDeviceFloatBuffer, mMixBuffer, frameCount, mMixMatrix, inputChannels,
+            mOutputChannels);
+    } else {
+        mFrameConverter(mDeviceFloatBuffer, data, frameCount, inputChannels);
+    }
+    meterFrames(mDeviceFloatBuffer, frameCount);
+
+    const bigtime_t converted = system_time_nsecs();
+    statsAdd(mStats.convertTime, converted - start);
+
+    // Resample if needed
+    if (mResampler != NULL) {
+        size_t outputFramesAvailable = mResampler->Process(mResampledBuffer, mResampledBufferFrames,
+            mDeviceFloatBuffer, frameCount);
+        statsAdd(mStats.resampleTime, system_time_nsecs() - converted);
+
+        // Deliver RESAMPLED data
+        if (outputFramesAvailable > 0)
+            emitInterleaved(mResampledBuffer, outputFramesAvailable);
+
+    } else {
+        // Resampling disabled, deliver data at device rate
+        emitInterleaved(mDeviceFloatBuffer, frameCount);
+    }
+}
+
+
+void
+AudioCapture::processPlanarChunk(const void* data, size_t frameCount, uint32 inputChannels)
+{
+    const bigtime_t start = system_time_nsecs();
+
+    // Convert input data -> mPlanes, mixing row by row if needed
+    if (mMatrixMixer != NULL) {
+        mFrameConverter(mMixBuffer, data, frameCount, inputChannels);
+        for (uint32 c = 0; c < mOutputChannels; c++) {
+            mMatrixMixer(mPlanes[c], mMixBuffer, frameCount, mMixMatrix + c * inputChannels,
+                inputChannels, 1);
+        }
+    } else {
+        mPlanarConverter(mPlanes, data, frameCount, inputChannels);
+    }
+    meterPlanes(mPlanes, frameCount);
+
+    const bigtime_t converted = system_time_nsecs();
+    statsAdd(mStats.convertTime, converted - start);
+
+    if (mPlaneResamplers != NULL) {
+        // Identical resamplers fed the same frame counts stay in lockstep
+        size_t outputFramesAvailable = 0;
+        for (uint32 c = 0; c < mOutputChannels; c++) {
+            outputFramesAvailable = mPlaneResamplers[c]->Process(mResampledPlanes[c],
+                mResampledBufferFrames, mPlanes[c], frameCount);
+        }
+        statsAdd(mStats.resampleTime, system_time_nsecs() - converted);
+        if (outputFramesAvailable > 0)
+            emitPlanes(mResampledPlanes, outputFramesAvailable);
+    } else {
+        emitPlanes(mPlanes, frameCount);
+    }
+}
+
+
+void
+AudioCapture::processPCMChunk(const void* data, size_t frameCount, uint32 inputChannels)
+{
+    const bigtime_t start = system_time_nsecs();
+    mPCMConverter(mPCMBuffer, data, frameCount, inputChannels);
+    meterFrames(mPCMBuffer, frameCount);
+    const bigtime_t converted = system_time_nsecs();
+    statsAdd(mStats.convertTime, converted - start);
+
+    if (mPCMResampler != NULL) {
+        size_t outputFramesAvailable = mPCMResampler->Process(mPCMResampledBuffer, mResampledBufferFrames,
+            static_cast<const int16*>(mPCMBuffer), frameCount);
+        statsAdd(mStats.resampleTime, system_time_nsecs() - converted);
+        if (outputFramesAvailable > 0)
+            emitInterleaved(mPCMResampledBuffer, outputFramesAvailable);
+    } else {
+        emitInterleaved(mPCMBuffer, frameCount);
+    }
+}
+
+
+void
+AudioCapture::processSinkChunk(const void* data, size_t frameCount, uint32 inputChannels)
+{
+    const bigtime_t start = system_time_nsecs();
+
+    const float* input = static_cast<const float*>(data);
+    if (mConverterFormatCode != media_raw_audio_format::B_AUDIO_FLOAT) {
+        // Device changed to a format the stages weren't set up for
+        if (mSinkConverter == NULL)
+            return;
+        mSinkConverter(mSinkInput, data, frameCount, inputChannels);
+        input = mSinkInput;
+    }
+
+    statsAdd(mStats.convertTime, system_time_nsecs() - start);
+
+    for (uint32 s = 0; s < mSinkStageCount; s++) {
+        SinkStage& stage = mSinkStages[s];
+        const float* frames = input;
+        size_t outputFrames = frameCount;
+
+        const bigtime_t stageStart = system_time_nsecs();
+        if (stage.mixer != NULL) {
+            stage.mixer(stage.mixBuffer, input, frameCount, stage.matrix, inputChannels, stage.channels);
+            frames = stage.mixBuffer;
+        }
+        const bigtime_t mixed = system_time_nsecs();
+        statsAdd(mStats.convertTime, mixed - stageStart);
+
+        if (stage.resampler != NULL) {
+            outputFrames = stage.resampler->Process(stage.resampledBuffer, stage.resampledBufferFrames,
+                frames, frameCount);
+            frames = stage.resampledBuffer;
+            statsAdd(mStats.resampleTime, system_time_nsecs() - mixed);
+        }
+
+        if (outputFrames == 0)
+            continue;
+        for (uint32 i = 0; i < mSinkCount; i++) {
+            if (mSinks[i].stage == static_cast<int32>(s))
+                mSinks[i].callback(frames, outputFrames, stage.channels, mSinks[i].userData);
+        }
+    }
+}
+
+
+void
+AudioCapture::selectFrameConverter(uint32 formatCode, uint32 channelCount)
+{
+    // The mix takes float frames in the device layout
+    const uint32 convertedChannels = mMatrixMixer != NULL ? channelCount : mOutputChannels;
+    mFrameConverter = getFrameConverter(getSampleType(formatCode), channelCount, convertedChannels);
+    mPlanarConverter = mPlanarCallback != NULL
+        ? getPlanarConverter(getSampleType(formatCode), channelCount, convertedChannels) : NULL;
+    // A device that switches to float mid-stream can't use the direct path,
+    // its buffers are dropped until the next Start()
+    mPCMConverter = mPCMDirect
+        ? getPCMFrameConverter(getSampleType(formatCode), mPCMFormat, channelCount, mOutputChannels) : NULL;
+    mPassthrough = mPlanarCallback == NULL && mPCMCallback == NULL && mMatrixMixer == NULL
+        && !resamplingEnabled() && getSampleType(formatCode) == SAMPLE_FLOAT
+        && channelCount == mOutputChannels;
+    // Float devices hand their frames to the sink stages as they are
+    mSinkConverter = mSinkInput != NULL
+        ? getFrameConverter(getSampleType(formatCode), channelCount, channelCount) : NULL;
+    mConverterFormatCode = formatCode;
+    mConverterChannelCount = channelCount;
 }
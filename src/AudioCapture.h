@@ -7,6 +7,7 @@
 #define AUDIO_CAPTURE_H
 
 #pragma GCC visibility push(default)
+#include <kernel/OS.h>
 #include <media/MediaAddOn.h>
 #include <media/MediaDefs.h>
 #include <media/MediaNode.h>
@@ -17,22 +18,294 @@
 #include <support/Errors.h>
 #pragma GCC visibility pop
 
+#include "AudioBlockQueue.h"
+#include "AudioConvert.h"
+#include "AudioGate.h"
+#include "AudioLevel.h"
+#include "AudioMix.h"
+#include "AudioPCM.h"
+#include "AudioResampler.h"
+#include "AudioRingBuffer.h"
+
+#include <atomic>
+
 class BMediaRoster;
+class LinearResampler;
+
+// data holds frameCount interleaved frames of channelCount floats
+typedef void (*AudioCallbackFunc)(const float* data, size_t frameCount, uint32 channelCount, void* userData);
+
+// planes holds channelCount pointers to frameCount floats each
+typedef void (*AudioPlanarCallbackFunc)(const float* const* planes, size_t frameCount, uint32 channelCount,
+    void* userData);
+
+struct AudioBufferInfo {
+    // Performance time of the first frame, mapped back through the resampler
+    // to the device buffer it came from
+    bigtime_t         performanceTime;
+    // Frames delivered since Start() before this buffer, plus the frames a
+    // closed gate held back
+    uint64            frameIndex;
+    // Device timestamps jumped since the previous buffer, the capture lost or
+    // repeated data, or a closed gate held data back
+    bool              discontinuity;
+    // AUDIO_GATE_MARK only, the gate was closed for the device buffer
+    bool              gated;
+};
+
+// Same as AudioCallbackFunc, with the timing of the buffer
+typedef void (*AudioTimedCallbackFunc)(const float* data, size_t frameCount, uint32 channelCount,
+    const AudioBufferInfo& info, void* userData);
+
+// data holds frameCount interleaved frames of channelCount int16 or int32
+// samples, as given by format
+typedef void (*AudioPCMCallbackFunc)(const void* data, size_t frameCount, uint32 channelCount, SampleType format,
+    void* userData);
+
+enum AudioGateMode {
+    AUDIO_GATE_OFF = 0,
+    AUDIO_GATE_SUPPRESS,        // Nothing past the gate runs while it is closed
+    AUDIO_GATE_MARK             // Everything runs, AudioBufferInfo::gated tells
+};
+
+enum AudioChannelLayout {
+    AUDIO_CHANNELS_STEREO = 0,  // Downmixed or duplicated to stereo
+    AUDIO_CHANNELS_MONO,        // Downmixed to a single channel
+    AUDIO_CHANNELS_NATIVE,      // Every device channel, unmixed
+    AUDIO_CHANNELS_MATRIX       // Custom matrix, see SetMixMatrix()
+};
+
+static const uint32 kAudioStatsHistogramSize = 16;
+
+// Snapshot returned by AudioCapture::GetStats(), counted from the last Start()
+struct AudioCaptureStats {
+    uint64            buffersIn;          // Device buffers received
+    uint64            framesIn;
+    uint64            buffersOut;         // Output buffers, dispatch drops included
+    uint64            framesOut;
+    uint64            droppedBuffers;     // Device buffers that couldn't be processed
+    uint64            oversizedBuffers;   // Device buffers split into chunks
+    uint64            discontinuities;    // Timestamp jumps between device buffers
+    uint64            gatedFrames;        // Device frames a closed gate held back
+    // Same totals as OverrunCount() and DispatchDropCount(), not reset
+    uint64            ringOverruns;
+    uint64            dispatchDrops;
 
-typedef void (*AudioCallbackFunc)(const float* stereoData, size_t frameCount, void* userData);
+    // Accumulated time in nanoseconds
+    bigtime_t         processTime;        // The whole capture hook
+    bigtime_t         convertTime;        // Conversion, mixing and quantization
+    bigtime_t         resampleTime;
+    bigtime_t         callbackTime;
+    // Callbacks that ran longer than the audio they were given
+    uint64            callbackOverruns;
+    // Longest wait between two device buffers, microseconds
+    bigtime_t         maxBufferGap;
+
+    // Input frame the next output frame falls on, relative to the end of the
+    // input so far: negative while the resampler holds back input, with the
+    // interpolation phase as its fraction
+    double            resamplePosition;
+    double            driftPPM;
+
+    // Bucket i counts durations of 2^i up to 2^(i + 1) microseconds, the
+    // first one also shorter and the last one also longer ones
+    uint64            processHistogram[kAudioStatsHistogramSize];
+    uint64            callbackHistogram[kAudioStatsHistogramSize];
+};
+
+static const uint32 kAudioMaxMeterChannels = 32;
+
+// Snapshot returned by AudioCapture::GetLevels(), linear with 1.0 as full
+// scale, counted from the last Start()
+struct AudioLevels {
+    uint32            channelCount;       // 0 while metering is off
+    uint64            windows;            // Windows measured so far
+    // Largest magnitude of the last window, or the falling previous peak
+    float             peak[kAudioMaxMeterChannels];
+    float             rms[kAudioMaxMeterChannels];     // Of the last window
+    uint64            clips[kAudioMaxMeterChannels];   // Samples at full scale
+};
+
+enum AudioDispatchPolicy {
+    AUDIO_DISPATCH_DROP_NEWEST = 0, // Full queue: the new buffer is lost
+    AUDIO_DISPATCH_DROP_OLDEST      // Full queue: the oldest queued buffer is lost
+};
 
 class AudioCapture {
 public:
     AudioCapture(AudioCallbackFunc callback = NULL,
                  void* userData = NULL,
                  float targetSampleRate = 0.0f,
-                 const char* nodeName = "AudioCaptureClient");
+                 const char* nodeName = "AudioCaptureClient",
+                 size_t ringBufferFrames = 0);
     ~AudioCapture();
 
     status_t Start();
     status_t Stop();
 
+    // Captures from node instead of the default audio input, or from the
+    // first live raw audio producer called liveNodeName. Also makes an
+    // instance usable that found no default input. Takes effect on the next
+    // Start(), returns B_BUSY while running.
+    status_t SetInput(const media_node& node);
+    status_t SetInput(const char* liveNodeName);
+
+    // Takes effect on the next Start(), returns B_BUSY while running
+    status_t SetResamplingQuality(ResamplerQuality quality);
+    ResamplerQuality ResamplingQuality() const { return mResamplerQuality; }
+
+    // Follows the device clock: the real device rate is estimated from the
+    // buffer timestamps with a delay-locked loop and the resampling ratio is
+    // trimmed to match, so output at the nominal rate neither gains nor loses
+    // frames against system time. Runs the resampler even without a target
+    // rate. Takes effect on the next Start(), returns B_BUSY while running.
+    status_t SetDriftCompensation(bool enabled);
+    bool DriftCompensation() const { return mDriftCompensation; }
+    // Measured deviation of the device clock from its nominal rate, updated
+    // for every buffer whether or not compensation is on
+    double DriftPPM() const { return mDriftPPM.load(std::memory_order_relaxed); }
+
+    // Stereo and mono downmix according to the device channel_mask, devices
+    // without a usable mask keep the first two channels or get averaged. Both
+    // take effect on the next Start() and return B_BUSY while running.
+    status_t SetChannelLayout(AudioChannelLayout layout);
+    AudioChannelLayout ChannelLayout() const { return mChannelLayout; }
+    // Row-major outputChannels x inputChannels coefficients, selects
+    // AUDIO_CHANNELS_MATRIX. Start() fails with B_MISMATCHED_VALUES when the
+    // device doesn't have inputChannels channels.
+    status_t SetMixMatrix(const float* matrix, uint32 inputChannels, uint32 outputChannels);
+    // Channels per delivered frame for the current layout and device
+    uint32 OutputChannelCount() const;
+
+    // Switches to planar delivery: device samples are converted straight into
+    // one 64-byte aligned plane per output channel and every plane is
+    // resampled on its own. The interleaved callback and the ring buffer are
+    // not fed while a planar callback is set, NULL switches back. Takes effect
+    // on the next Start(), returns B_BUSY while running.
+    status_t SetPlanarCallback(AudioPlanarCallbackFunc callback, void* userData = NULL);
+
+    // Switches to integer delivery in SAMPLE_INT16 or SAMPLE_INT32. Integer
+    // devices are converted straight to the output format when no matrix mix
+    // is involved, with int16 resampled in fixed point by the linear
+    // resampler; other setups run the float path and quantize at the end.
+    // Like planar mode this replaces the float callback and the ring buffer,
+    // and the two can't be combined (B_NOT_ALLOWED). Takes effect on the next
+    // Start(), returns B_BUSY while running.
+    status_t SetPCMCallback(AudioPCMCallbackFunc callback, SampleType format, void* userData = NULL);
+    // TPDF dither when quantizing float to int16, off by default. Takes
+    // effect on the next Start(), returns B_BUSY while running.
+    status_t SetDither(bool enabled);
+
+    // Called after the interleaved callback with the same frames, so like it
+    // not fed in planar or PCM mode. Takes effect on the next Start(),
+    // returns B_BUSY while running.
+    status_t SetTimedCallback(AudioTimedCallbackFunc callback, void* userData = NULL);
+
+    // Further consumers of the same device connection, each getting
+    // interleaved floats at its own sampleRate (0 for the device rate) in
+    // the STEREO, MONO or NATIVE layout. The device buffer is converted once
+    // for all sinks, and sinks asking for the same rate and layout share the
+    // mix and the resampler. A sink matching the float output of the
+    // capture itself is fed from that output, block size included. Sinks
+    // are always called on the MediaKit thread. Returns the sink id, or an
+    // error; B_BUSY while running, like RemoveSink().
+    int32 AddSink(AudioCallbackFunc callback, void* userData = NULL, float sampleRate = 0.0f,
+        AudioChannelLayout layout = AUDIO_CHANNELS_STEREO);
+    status_t RemoveSink(int32 id);
+
+    // Input gate, decided on every device buffer before it is converted. It
+    // opens when the loudest channel reaches thresholdDB dBFS RMS and closes
+    // after hangover microseconds without that. voiceDetection also wants the
+    // level clearly above the tracked noise floor and a zero crossing rate in
+    // the range of speech. In AUDIO_GATE_SUPPRESS mode a closed gate skips
+    // conversion, resampling, the callbacks, the sinks and the ring buffer
+    // alike. The last preRoll microseconds of held back input are kept, and
+    // go out ahead of the buffer that opens the gate, so onsets aren't cut.
+    // Frame indices and performance times skip over what was left out, a
+    // partial block is completed with silence when the gate closes.
+    // AUDIO_GATE_MARK only flags buffers in AudioBufferInfo. Float, int16 and
+    // int32 devices are supported, others run ungated. Takes effect on the
+    // next Start(), returns B_BUSY while running.
+    status_t SetGate(AudioGateMode mode, float thresholdDB = -50.0f, bigtime_t hangover = 500000,
+        bigtime_t preRoll = 200000, bool voiceDetection = false);
+    AudioGateMode GateMode() const { return mGateMode; }
+    bool IsGateOpen() const { return mGateOpen.load(std::memory_order_relaxed); }
+
+    // Keeps the last duration microseconds of interleaved float output, so
+    // that Trigger() can start a recording from before the event that caused
+    // it. Neither allocated nor fed in planar or PCM mode, where Trigger()
+    // is not allowed. 0, the default, keeps nothing. Takes effect on the next Start(), returns
+    // B_BUSY while running.
+    status_t SetTriggerPreRoll(bigtime_t duration);
+    // Hands the kept output to callback, oldest first, straight out of the
+    // pre-roll ring, followed by every buffer delivered from then on, with
+    // no frame missing or repeated in between. Happens on the MediaKit
+    // thread with the next output buffer, so the history arrives in one or
+    // two large calls the callback has to be able to take. Lasts until
+    // ReleaseTrigger(), Stop() included. B_BUSY while triggered,
+    // B_NOT_ALLOWED in planar or PCM mode. Waits for a released callback
+    // that is still running, B_BUSY instead from a capture callback.
+    status_t Trigger(AudioCallbackFunc callback, void* userData = NULL);
+    // Returns once the capture no longer calls the trigger callback. From a
+    // capture callback, the trigger callback included, it only stops the
+    // calls after the one running and doesn't wait.
+    status_t ReleaseTrigger();
+    bool IsTriggered() const { return mTriggerState.load(std::memory_order_relaxed) != TRIGGER_IDLE; }
+
+    // Moves the callbacks off the MediaKit thread: the finished output is
+    // copied into a pool of preallocated blocks and a worker thread calls the
+    // callbacks, so a slow consumer can't hold up capture. Once the worker is
+    // queueDepth buffers behind, policy decides which buffer is dropped. The
+    // ring buffer is still written directly. 0 calls the callbacks on the
+    // MediaKit thread again. Takes effect on the next Start(), returns B_BUSY
+    // while running.
+    status_t SetDispatchMode(size_t queueDepth, AudioDispatchPolicy policy = AUDIO_DISPATCH_DROP_OLDEST);
+    uint64 DispatchDropCount() const { return mDispatchDrops.load(std::memory_order_relaxed); }
+    uint64 DispatchDroppedFrameCount() const { return mDispatchDroppedFrames.load(std::memory_order_relaxed); }
+
+    // Hands every callback and the ring buffer exactly frameCount frames, so
+    // block k always starts at output frame k * frameCount. Output is
+    // collected until a block is full; whole blocks that lie in one
+    // processed buffer go out from there without a copy. A partial block is
+    // dropped at Stop(). 0, the default, delivers whatever each device
+    // buffer produced. Takes effect on the next Start(), returns B_BUSY
+    // while running.
+    status_t SetBlockSize(size_t frameCount);
+    size_t BlockSize() const { return mBlockFrames; }
+
+    // Pull interface, only available when constructed with ringBufferFrames.
+    // Waits up to timeout for data and returns the number of frames of
+    // OutputChannelCount() floats read, 0 once capture has stopped and the
+    // ring is drained, or an error.
+    // Frames that don't fit into the ring are dropped and counted as overruns.
+    // Start() empties the ring, frames a stopped capture left unread are
+    // gone then. Must not run concurrently with Start(), which may also
+    // reallocate the ring.
+    ssize_t Read(float* buffer, size_t maxFrames, bigtime_t timeout = B_INFINITE_TIMEOUT);
+    size_t Available() const { return mRingBuffer.Available(); }
+    uint64 OverrunCount() const { return mOverrunCount.load(std::memory_order_relaxed); }
+    uint64 OverrunFrameCount() const { return mOverrunFrames.load(std::memory_order_relaxed); }
+
+    // Always collected, the counters are relaxed atomics updated from a
+    // single thread each, so reading them never disturbs capture
+    void GetStats(AudioCaptureStats& stats) const;
+
+    // Per-channel peak, RMS and clip metering of the output layout, taken
+    // while the converted device frames are still in cache, before
+    // resampling. Sums run over at least window microseconds and are then
+    // published together; in between the peak falls by peakDecay dB per
+    // second. 0, the default, turns metering off. Layouts wider than
+    // kAudioMaxMeterChannels aren't metered. Takes effect on the next
+    // Start(), returns B_BUSY while running.
+    status_t SetMetering(bigtime_t window, float peakDecay = 20.0f);
+    // Lock-free and consistent across channels, the capture never waits for
+    // a reader
+    void GetLevels(AudioLevels& levels) const;
+
     bool IsRunning() const { return mIsRecording; }
+    // True while float device buffers already in the output layout and rate
+    // are handed to the callback and the ring without a copy
+    bool IsPassthrough() const { return mPassthrough; }
     status_t Status() const { return mLastStatus; }
     float DeviceSampleRate() const { return mDeviceSampleRate; }
     float TargetSampleRate() const { return mTargetSampleRate; }
@@ -40,6 +313,11 @@ public:
     uint32 InputFormatCode() const { return mDeviceMediaFormatCode; }
     const char* InputDeviceName() const { return mDeviceName.String(); }
 
+    // True on the thread that is currently inside the capture hook, including
+    // the user callback. Meant for debug allocators that want to count or trap
+    // allocations on the realtime path.
+    static bool InRealtimeCallback();
+
     AudioCapture(const AudioCapture&) = delete;
     AudioCapture& operator=(const AudioCapture&) = delete;
     AudioCapture(AudioCapture&&) = delete;
@@ -47,16 +325,125 @@ public:
 
 private:
     status_t initializeDevice();
+    status_t queryInput();
     void cleanupMediaResources();
+    status_t configureChannelLayout();
+    status_t configurePCMOutput();
+    status_t createResamplers();
+    status_t allocateBuffers();
+    status_t createSinkStages();
     void cleanupBuffers();
-    void processData(void* data, size_t size, const media_raw_audio_format& format) noexcept;
-    void linearResample(float* outBuffer, size_t& outFrameCount, const float* inBuffer, size_t inFrameCount);
+    void cleanupSinkStages();
+    void selectFrameConverter(uint32 formatCode, uint32 channelCount);
+    status_t startDispatcher();
+    void stopDispatcher();
+    int32 acquireDispatchBlock();
+    void submitDispatchBlock(uint32 index, size_t frameCount);
+    void runDispatchBlock(uint32 index);
+    int32 dispatchLoop();
+    void resetStats();
+    void configureMetering();
+    void meterFrames(const void* data, size_t frameCount);
+    void meterPlanes(const float* const* planes, size_t frameCount);
+    void finishMeterChunk(size_t frameCount);
+    status_t configureGate();
+    bool passGate(const void* data, size_t frameCount, size_t frameSize, bool measurable);
+    void reopenGate(size_t frameSize);
+    void flushBlock();
+    void resetResamplers();
+    void recordCallback(bigtime_t start, size_t frameCount);
+    void advanceOutput(size_t frameCount);
+    void emitInterleaved(const void* data, size_t frameCount);
+    void emitPlanes(const float* const* planes, size_t frameCount);
+    void deliverInterleaved(const void* data, size_t frameCount);
+    void deliverFrames(const float* frames, size_t frameCount);
+    void deliverPCM(const void* data, size_t frameCount);
+    void deliverPlanes(const float* const* planes, size_t frameCount);
+    void feedTrigger(const float* frames, size_t frameCount);
+    void processChunk(const void* data, size_t frameCount, uint32 inputChannels);
+    void processPlanarChunk(const void* data, size_t frameCount, uint32 inputChannels);
+    void processPCMChunk(const void* data, size_t frameCount, uint32 inputChannels);
+    void processSinkChunk(const void* data, size_t frameCount, uint32 inputChannels);
+    void processFrames(const void* data, size_t frameCount, uint32 inputChannels, size_t inputFrameSize);
+    void updateDriftEstimate(bigtime_t timestamp, size_t frameCount, bool restart);
+    void processData(void* data, size_t size, const media_raw_audio_format& format,
+        bigtime_t timestamp) noexcept;
+    bool resamplingEnabled() const { return mResamplingRatio != 1.0 || mDriftCompensation; }
 
     static void readCallbackC(void* cookie, bigtime_t timestamp, void* data, size_t size, const media_format& format) noexcept;
     static void notifyCallbackC(void* cookie, BMediaRecorder::notification code, ...);
+    static int32 dispatchThreadC(void* cookie);
+
+    enum {
+        TRIGGER_IDLE = 0,
+        TRIGGER_ARMING,     // Trigger() setting the callback, not used yet
+        TRIGGER_PENDING,    // Trigger() called, history not handed over yet
+        TRIGGER_ACTIVE      // Live output goes to the trigger callback
+    };
+
+    struct StatsCounters {
+        std::atomic<uint64>    buffersIn;
+        std::atomic<uint64>    framesIn;
+        std::atomic<uint64>    buffersOut;
+        std::atomic<uint64>    framesOut;
+        std::atomic<uint64>    droppedBuffers;
+        std::atomic<uint64>    oversizedBuffers;
+        std::atomic<uint64>    discontinuities;
+        std::atomic<uint64>    gatedFrames;
+        std::atomic<bigtime_t> processTime;
+        std::atomic<bigtime_t> convertTime;
+        std::atomic<bigtime_t> resampleTime;
+        std::atomic<bigtime_t> callbackTime;
+        std::atomic<uint64>    callbackOverruns;
+        std::atomic<bigtime_t> maxBufferGap;
+        std::atomic<bigtime_t> lastArrival;
+        std::atomic<double>    resamplePosition;
+        std::atomic<uint64>    processHistogram[kAudioStatsHistogramSize];
+        std::atomic<uint64>    callbackHistogram[kAudioStatsHistogramSize];
+    };
+
+    struct Sink {
+        int32             id;
+        AudioCallbackFunc callback;
+        void*             userData;
+        float             sampleRate;
+        AudioChannelLayout layout;
+        // Index into mSinkStages, -1 while fed from the capture's own output
+        int32             stage;
+    };
+
+    // Mix and resampler shared by the sinks of one rate and layout
+    struct SinkStage {
+        float             sampleRate;
+        AudioChannelLayout layout;
+        uint32            channels;
+        // NULL when the device frames are already in the layout
+        float*            matrix;
+        MatrixMixFunc     mixer;
+        float*            mixBuffer;
+        AudioResampler*   resampler;
+        float*            resampledBuffer;
+        size_t            resampledBufferFrames;
+    };
+
+    // One buffer of finished output waiting for the worker
+    struct DispatchBlock {
+        uint8*            data;
+        // Planar mode, the planes inside data
+        float**           planes;
+        size_t            frameCount;
+        AudioBufferInfo   info;
+    };
 
     AudioCallbackFunc mUserCallback;
     void*             mUserData;
+    AudioPlanarCallbackFunc mPlanarCallback;
+    void*             mPlanarUserData;
+    AudioTimedCallbackFunc mTimedCallback;
+    void*             mTimedUserData;
+    AudioPCMCallbackFunc mPCMCallback;
+    void*             mPCMUserData;
+    SampleType        mPCMFormat;
     BString           mNodeName;
 
     BMediaRoster*     mRoster;
@@ -74,15 +461,164 @@ private:
     bool              mIsRecording;
     status_t          mLastStatus;
 
+    // Sized at Start(), never reallocated while running. Larger device
+    // buffers are processed in chunks of mChunkFrames.
+    float*            mMixBuffer;
     float*            mDeviceFloatBuffer;
-    size_t            mDeviceFloatBufferSize;
     float*            mResampledBuffer;
-    size_t            mResampledBufferSize;
+    // Planar mode only, pointer arrays with the planes in the same block
+    float**           mPlanes;
+    float**           mResampledPlanes;
+    size_t            mChunkFrames;
+    size_t            mResampledBufferFrames;
+
+    // Fixed block delivery, output frames collected until mBlockFrames are
+    // there. Interleaved in the delivered sample format, or planar.
+    size_t            mBlockFrames;
+    size_t            mBlockFill;
+    void*             mBlockBuffer;
+    float**           mBlockPlanes;
+    const float**     mBlockPlaneView;
+
+    FrameConvertFunc  mFrameConverter;
+    PlanarConvertFunc mPlanarConverter;
+    uint32            mConverterFormatCode;
+    uint32            mConverterChannelCount;
+    bool              mPassthrough;
+
+    // PCM mode only. The direct path converts integer device frames with
+    // mPCMConverter, otherwise float frames are quantized into mPCMBuffer.
+    bool              mPCMDirect;
+    PCMFrameConvertFunc mPCMConverter;
+    QuantizeFunc      mQuantizer;
+    bool              mDitherEnabled;
+    DitherState       mDither;
+    void*             mPCMBuffer;
+    int16*            mPCMResampledBuffer;
+    LinearResampler*  mPCMResampler;
+
+    AudioChannelLayout mChannelLayout;
+    uint32            mOutputChannels;
+    float*            mUserMatrix;
+    uint32            mUserMatrixInputs;
+    uint32            mUserMatrixOutputs;
+    // Active matrix, NULL when the converter produces the layout directly
+    float*            mMixMatrix;
+    MatrixMixFunc     mMatrixMixer;
 
     float             mTargetSampleRate;
+    // As passed to the constructor, mTargetSampleRate is 0 while it matches
+    // the device
+    float             mRequestedSampleRate;
     double            mResamplingRatio;
+    ResamplerQuality  mResamplerQuality;
+    AudioResampler*   mResampler;
+    // Planar mode only, one mono resampler per plane
+    AudioResampler**  mPlaneResamplers;
+
+    // Timing, reset at Start(). mOutputPosition is the input frame the next
+    // output frame lies at, both counted from the start of the capture.
+    uint64            mInputFrames;
+    uint64            mOutputFrames;
+    double            mOutputPosition;
+    uint64            mBufferStartFrame;
+    bigtime_t         mBufferTime;
+    bigtime_t         mNextBufferTime;
+    bool              mDiscontinuity;
+
+    // Delay-locked loop on the buffer timestamps: predicted start of the next
+    // buffer and the measured time per frame, both in microseconds
+    bool              mDriftCompensation;
+    double            mDllTime;
+    double            mDllPeriod;
+    double            mNominalPeriod;
+    size_t            mDllFrames;
+    double            mRateAdjustment;
+    std::atomic<double> mDriftPPM;
+
+    // Dispatch mode only. Blocks cycle from mFreeBlocks through mReadyBlocks
+    // back to mFreeBlocks, the worker holds at most one in between.
+    size_t            mDispatchDepth;
+    AudioDispatchPolicy mDispatchPolicy;
+    DispatchBlock*    mDispatchBlocks;
+    uint8*            mDispatchData;
+    float**           mDispatchPlanes;
+    size_t            mDispatchBlockFrames;
+    AudioBlockQueue   mFreeBlocks;
+    AudioBlockQueue   mReadyBlocks;
+    thread_id         mDispatchThread;
+    sem_id            mDispatchSem;
+    std::atomic<bool> mDispatchWaiting;
+    std::atomic<bool> mDispatchQuit;
+    std::atomic<uint64> mDispatchDrops;
+    std::atomic<uint64> mDispatchDroppedFrames;
+
+    StatsCounters     mStats;
+
+    // Metering, off while mLevelMeter is NULL. The sums of the current window
+    // belong to the realtime thread, every finished window is published
+    // through a sequence lock: odd while the values are being written.
+    bigtime_t         mMeterWindow;
+    float             mMeterDecay;
+    LevelMeterFunc    mLevelMeter;
+    uint32            mMeterChannels;
+    size_t            mMeterWindowFrames;
+    size_t            mMeterFrames;
+    float             mMeterPeak[kAudioMaxMeterChannels];
+    double            mMeterSum[kAudioMaxMeterChannels];
+    uint32            mMeterClips[kAudioMaxMeterChannels];
+    float             mMeterHeld[kAudioMaxMeterChannels];
+    std::atomic<uint32> mLevelSequence;
+    std::atomic<uint64> mLevelWindows;
+    std::atomic<float> mLevelPeak[kAudioMaxMeterChannels];
+    std::atomic<float> mLevelRMS[kAudioMaxMeterChannels];
+    std::atomic<uint64> mLevelClips[kAudioMaxMeterChannels];
+
+    // Input gate, mGateActive once Start() could set it up for the device.
+    // Held back device frames wait in mPreRoll, raw, and are replayed
+    // through mPreRollChunk.
+    AudioGateMode     mGateMode;
+    float             mGateThreshold;
+    bigtime_t         mGateHangover;
+    bigtime_t         mGatePreRoll;
+    bool              mGateVoice;
+    bool              mGateActive;
+    bool              mGateClosed;
+    AudioGate         mGate;
+    AudioRingBuffer   mPreRoll;
+    size_t            mPreRollFrames;
+    uint8*            mPreRollChunk;
+    std::atomic<bool> mGateOpen;
+
+    // Pre-roll history for Trigger(), a circular buffer of output frames
+    // that only the realtime thread touches while running. mTriggerBusy is
+    // set around every look at mTriggerState there, so ReleaseTrigger() can
+    // tell when the callback is no longer in use.
+    bigtime_t         mTriggerPreRoll;
+    float*            mTriggerHistory;
+    size_t            mTriggerCapacity;
+    size_t            mTriggerWrite;
+    size_t            mTriggerFill;
+    AudioCallbackFunc mTriggerCallback;
+    void*             mTriggerUserData;
+    std::atomic<int32> mTriggerState;
+    std::atomic<bool> mTriggerBusy;
+
+    Sink*             mSinks;
+    uint32            mSinkCount;
+    int32             mNextSinkId;
+    // Built at Start() for the sinks not sharing the capture's output
+    SinkStage*        mSinkStages;
+    uint32            mSinkStageCount;
+    // Device frames as floats in the device layout, float devices skip it
+    float*            mSinkInput;
+    FrameConvertFunc  mSinkConverter;
 
-    double            mInputBufferOffset;
+    AudioRingBuffer   mRingBuffer;
+    sem_id            mRingSem;
+    std::atomic<bool> mReaderWaiting;
+    std::atomic<uint64> mOverrunCount;
+    std::atomic<uint64> mOverrunFrames;
 };
 
 #endif // AUDIO_CAPTURE_H
@@ -0,0 +1,428 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <new>
+
+#include "AudioCaptureGroup.h"
+
+static const size_t kDefaultBlockFrames = 512;
+// Each input buffers up to about a second ahead of the slowest one
+static const double kInputBufferSeconds = 1.0;
+
+
+AudioCaptureGroup::AudioCaptureGroup(AudioCallbackFunc callback, void* userData, float sampleRate,
+        const char* nodeName)
+    : mCallback(callback),
+      mUserData(userData),
+      mRequestedSampleRate(sampleRate),
+      mSampleRate(sampleRate),
+      mNodeName(nodeName),
+      mInputs(NULL),
+      mInputCount(0),
+      mAligned(false),
+      mBlockFrames(kDefaultBlockFrames),
+      mOutputChannels(0),
+      mOutputBuffer(NULL),
+      mIsRunning(false),
+      mMixThread(-1),
+      mMixSem(-1),
+      mMixWaiting(false),
+      mMixQuit(false),
+      mOverrunFrames(0),
+      mRealignCount(0)
+{
+}
+
+
+AudioCaptureGroup::~AudioCaptureGroup()
+{
+    Stop();
+    cleanupInputs();
+}
+
+
+status_t
+AudioCaptureGroup::AddInput(const media_node& node, AudioChannelLayout layout)
+{
+    if (mIsRunning)
+        return B_BUSY;
+
+    // Inputs after the first are resampled to its rate unless one was given
+    AudioCapture* capture = new(std::nothrow) AudioCapture(NULL, NULL, mSampleRate, mNodeName.String());
+    if (capture == NULL)
+        return B_NO_MEMORY;
+
+    status_t status = capture->SetInput(node);
+    if (status == B_OK)
+        status = addInput(capture, layout);
+    if (status != B_OK)
+        delete capture;
+    return status;
+}
+
+
+status_t
+AudioCaptureGroup::AddInput(const char* liveNodeName, AudioChannelLayout layout)
+{
+    if (mIsRunning)
+        return B_BUSY;
+
+    AudioCapture* capture = new(std::nothrow) AudioCapture(NULL, NULL, mSampleRate, mNodeName.String());
+    if (capture == NULL)
+        return B_NO_MEMORY;
+
+    status_t status = capture->SetInput(liveNodeName);
+    if (status == B_OK)
+        status = addInput(capture, layout);
+    if (status != B_OK)
+        delete capture;
+    return status;
+}
+
+
+status_t
+AudioCaptureGroup::addInput(AudioCapture* capture, AudioChannelLayout layout)
+{
+    if (layout == AUDIO_CHANNELS_MATRIX)
+        return B_BAD_VALUE;
+
+    status_t status = capture->SetChannelLayout(layout);
+    if (status != B_OK)
+        return status;
+
+    // Resampling against the system clock is what keeps the inputs together
+    status = capture->SetDriftCompensation(true);
+    if (status != B_OK)
+        return status;
+
+    Input** inputs = static_cast<Input**>(realloc(mInputs, (mInputCount + 1) * sizeof(Input*)));
+    if (inputs == NULL)
+        return B_NO_MEMORY;
+    mInputs = inputs;
+
+    Input* input = new(std::nothrow) Input();
+    if (input == NULL)
+        return B_NO_MEMORY;
+
+    input->group = this;
+    input->capture = capture;
+    input->layout = layout;
+    input->channels = 0;
+    input->channelOffset = 0;
+    input->block = NULL;
+    input->silence = NULL;
+    input->startTime.store(-1);
+    input->written = 0;
+    input->skip = 0;
+    capture->SetTimedCallback(inputCallbackC, input);
+
+    if (mSampleRate <= 0.0f)
+        mSampleRate = capture->DeviceSampleRate();
+
+    mInputs[mInputCount++] = input;
+    return B_OK;
+}
+
+
+void
+AudioCaptureGroup::cleanupInputs()
+{
+    for (int32 i = 0; i < mInputCount; i++) {
+        delete mInputs[i]->capture;
+        delete mInputs[i];
+    }
+    free(mInputs);
+    mInputs = NULL;
+    mInputCount = 0;
+    mSampleRate = mRequestedSampleRate;
+}
+
+
+AudioCapture*
+AudioCaptureGroup::InputAt(int32 index) const
+{
+    if (index < 0 || index >= mInputCount)
+        return NULL;
+    return mInputs[index]->capture;
+}
+
+
+status_t
+AudioCaptureGroup::SetBlockSize(size_t frameCount)
+{
+    if (frameCount == 0)
+        return B_BAD_VALUE;
+
+    if (mIsRunning)
+        return B_BUSY;
+
+    mBlockFrames = frameCount;
+    return B_OK;
+}
+
+
+status_t
+AudioCaptureGroup::Start()
+{
+    if (mIsRunning)
+        return B_OK;
+
+    if (mCallback == NULL || mInputCount == 0)
+        return B_NO_INIT;
+
+    const size_t ringFrames = mBlockFrames * 4 + static_cast<size_t>(mSampleRate * kInputBufferSeconds);
+
+    mOutputChannels = 0;
+    for (int32 i = 0; i < mInputCount; i++) {
+        Input* input = mInputs[i];
+        input->channels = input->capture->OutputChannelCount();
+        input->channelOffset = mOutputChannels;
+        mOutputChannels += input->channels;
+
+        const size_t frameSize = input->channels * sizeof(float);
+        input->block = static_cast<float*>(malloc(mBlockFrames * frameSize));
+        input->silence = static_cast<float*>(calloc(mBlockFrames, frameSize));
+        if (input->block == NULL || input->silence == NULL || !input->ring.Init(ringFrames, frameSize)) {
+            Stop();
+            return B_NO_MEMORY;
+        }
+        input->startTime.store(-1);
+        input->written = 0;
+        input->skip = 0;
+    }
+
+    mOutputBuffer = static_cast<float*>(malloc(mBlockFrames * mOutputChannels * sizeof(float)));
+    if (mOutputBuffer == NULL) {
+        Stop();
+        return B_NO_MEMORY;
+    }
+
+    mAligned = false;
+    mOverrunFrames.store(0);
+    mRealignCount.store(0);
+
+    mMixSem = create_sem(0, "AudioCaptureGroup mix");
+    if (mMixSem < B_OK) {
+        status_t status = mMixSem;
+        Stop();
+        return status;
+    }
+
+    mMixQuit.store(false);
+    mMixWaiting.store(false);
+    mMixThread = spawn_thread(mixThreadC, "AudioCaptureGroup mix", B_NORMAL_PRIORITY, this);
+    if (mMixThread < B_OK) {
+        status_t status = mMixThread;
+        Stop();
+        return status;
+    }
+    resume_thread(mMixThread);
+
+    for (int32 i = 0; i < mInputCount; i++) {
+        Input* input = mInputs[i];
+        status_t status = input->capture->Start();
+        if (status == B_OK && input->capture->OutputChannelCount() != input->channels) {
+            // The negotiated format differs from what the device announced
+            status = B_MISMATCHED_VALUES;
+        }
+        if (status != B_OK) {
+            fprintf(stderr, "AudioCaptureGroup: Failed to start input %s: %s\n",
+                input->capture->InputDeviceName(), strerror(status));
+            Stop();
+            return status;
+        }
+    }
+
+    mIsRunning = true;
+    return B_OK;
+}
+
+
+status_t
+AudioCaptureGroup::Stop()
+{
+    mIsRunning = false;
+
+    // No producer may be left when the worker and the buffers go away
+    for (int32 i = 0; i < mInputCount; i++)
+        mInputs[i]->capture->Stop();
+
+    if (mMixThread >= B_OK) {
+        mMixQuit.store(true);
+        release_sem(mMixSem);
+        status_t result;
+        wait_for_thread(mMixThread, &result);
+        mMixThread = -1;
+    }
+
+    if (mMixSem >= B_OK) {
+        delete_sem(mMixSem);
+        mMixSem = -1;
+    }
+
+    for (int32 i = 0; i < mInputCount; i++) {
+        free(mInputs[i]->block);
+        mInputs[i]->block = NULL;
+        free(mInputs[i]->silence);
+        mInputs[i]->silence = NULL;
+    }
+
+    free(mOutputBuffer);
+    mOutputBuffer = NULL;
+    return B_OK;
+}
+
+
+// MediaKit thread of one input. Keeps the frames in the ring in step with
+// the performance time they belong to, then wakes the worker.
+void
+AudioCaptureGroup::inputCallbackC(const float* data, size_t frameCount, uint32 channelCount,
+    const AudioBufferInfo& info, void* cookie)
+{
+    Input* input = static_cast<Input*>(cookie);
+    AudioCaptureGroup* group = input->group;
+    if (channelCount != input->channels)
+        return;
+
+    const bigtime_t startTime = input->startTime.load(std::memory_order_relaxed);
+    if (startTime < 0) {
+        input->startTime.store(info.performanceTime, std::memory_order_release);
+    } else {
+        // Small timing jitter is normal, half a buffer off means lost or
+        // repeated data, or frames the ring had no room for
+        const int64 expected = llround((info.performanceTime - startTime) * group->mSampleRate / 1000000.0);
+        const int64 offset = expected - static_cast<int64>(input->written);
+        const int64 tolerance = frameCount / 2 + 1;
+        if (offset > tolerance) {
+            size_t padding = offset;
+            while (padding > 0) {
+                const size_t frames = padding < group->mBlockFrames ? padding : group->mBlockFrames;
+                const size_t written = input->ring.Write(input->silence, frames);
+                input->written += written;
+                padding -= written;
+                if (written < frames)
+                    break;
+            }
+            group->mOverrunFrames.fetch_add(padding, std::memory_order_relaxed);
+            group->mRealignCount.fetch_add(1, std::memory_order_relaxed);
+        } else if (offset < -tolerance) {
+            const size_t excess = -offset < static_cast<int64>(frameCount) ? static_cast<size_t>(-offset) : frameCount;
+            data += excess * channelCount;
+            frameCount -= excess;
+            group->mRealignCount.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    const size_t written = input->ring.Write(data, frameCount);
+    input->written += written;
+    if (written < frameCount)
+        group->mOverrunFrames.fetch_add(frameCount - written, std::memory_order_relaxed);
+
+    if (group->mMixWaiting.exchange(false))
+        release_sem_etc(group->mMixSem, 1, B_DO_NOT_RESCHEDULE);
+}
+
+
+// Once every input has started, the later start sets frame 0 of the output
+// and the inputs that started earlier skip what lies before it
+bool
+AudioCaptureGroup::alignInputs()
+{
+    bigtime_t groupStart = 0;
+    for (int32 i = 0; i < mInputCount; i++) {
+        const bigtime_t startTime = mInputs[i]->startTime.load(std::memory_order_acquire);
+        if (startTime < 0)
+            return false;
+        if (i == 0 || startTime > groupStart)
+            groupStart = startTime;
+    }
+
+    for (int32 i = 0; i < mInputCount; i++) {
+        Input* input = mInputs[i];
+        const bigtime_t startTime = input->startTime.load(std::memory_order_relaxed);
+        input->skip = llround((groupStart - startTime) * mSampleRate / 1000000.0);
+    }
+    mAligned = true;
+    return true;
+}
+
+
+bool
+AudioCaptureGroup::blockReady()
+{
+    if (!mAligned && !alignInputs())
+        return false;
+
+    for (int32 i = 0; i < mInputCount; i++) {
+        Input* input = mInputs[i];
+        while (input->skip > 0) {
+            const size_t frames = input->skip < mBlockFrames ? input->skip : mBlockFrames;
+            const size_t read = input->ring.Read(input->block, frames);
+            if (read == 0)
+                return false;
+            input->skip -= read;
+        }
+        if (input->ring.Available() < mBlockFrames)
+            return false;
+    }
+    return true;
+}
+
+
+void
+AudioCaptureGroup::mixBlock()
+{
+    for (int32 i = 0; i < mInputCount; i++) {
+        Input* input = mInputs[i];
+        input->ring.Read(input->block, mBlockFrames);
+
+        const uint32 channels = input->channels;
+        const float* source = input->block;
+        float* destination = mOutputBuffer + input->channelOffset;
+        for (size_t f = 0; f < mBlockFrames; f++) {
+            for (uint32 c = 0; c < channels; c++)
+                destination[c] = source[c];
+            source += channels;
+            destination += mOutputChannels;
+        }
+    }
+
+    mCallback(mOutputBuffer, mBlockFrames, mOutputChannels, mUserData);
+}
+
+
+int32
+AudioCaptureGroup::mixThreadC(void* cookie)
+{
+    return static_cast<AudioCaptureGroup*>(cookie)->mixLoop();
+}
+
+
+int32
+AudioCaptureGroup::mixLoop()
+{
+    while (!mMixQuit.load()) {
+        if (blockReady()) {
+            mixBlock();
+            continue;
+        }
+
+        // Same handshake as AudioCapture::Read(), inputs only signal a
+        // waiting worker
+        mMixWaiting.store(true);
+        if (blockReady() || mMixQuit.load()) {
+            mMixWaiting.store(false);
+            continue;
+        }
+        acquire_sem(mMixSem);
+        mMixWaiting.store(false);
+    }
+    return B_OK;
+}
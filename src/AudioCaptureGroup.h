@@ -0,0 +1,109 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef AUDIO_CAPTURE_GROUP_H
+#define AUDIO_CAPTURE_GROUP_H
+
+#include "AudioCapture.h"
+
+#include <atomic>
+
+// Captures several input nodes at once into one multichannel stream. Every
+// input runs its own AudioCapture, drift compensated and resampled to the
+// group rate, so all of them advance at the nominal rate on the system
+// clock. The first frames are lined up by their performance time, and an
+// input that loses or repeats data is padded or trimmed back onto its
+// timeline. Output frames hold the channels of each input one after the
+// other, in the order the inputs were added, and reach the callback in
+// blocks of BlockSize() frames from a worker thread.
+class AudioCaptureGroup {
+public:
+    // sampleRate 0 takes the rate of the first input
+    AudioCaptureGroup(AudioCallbackFunc callback, void* userData = NULL, float sampleRate = 0.0f,
+        const char* nodeName = "AudioCaptureGroup");
+    ~AudioCaptureGroup();
+
+    // Adds an input by media_node or by live node name, see
+    // AudioCapture::SetInput(). Returns B_BUSY while running.
+    status_t AddInput(const media_node& node, AudioChannelLayout layout = AUDIO_CHANNELS_NATIVE);
+    status_t AddInput(const char* liveNodeName, AudioChannelLayout layout = AUDIO_CHANNELS_NATIVE);
+    int32 CountInputs() const { return mInputCount; }
+    // For per-input settings such as the resampling quality, and for
+    // statistics. The group owns the capture.
+    AudioCapture* InputAt(int32 index) const;
+
+    // Returns B_BUSY while running
+    status_t SetBlockSize(size_t frameCount);
+    size_t BlockSize() const { return mBlockFrames; }
+
+    status_t Start();
+    status_t Stop();
+
+    bool IsRunning() const { return mIsRunning; }
+    float SampleRate() const { return mSampleRate; }
+    uint32 OutputChannelCount() const { return mOutputChannels; }
+    // Frames an input had to drop because the worker fell behind
+    uint64 OverrunFrameCount() const { return mOverrunFrames.load(std::memory_order_relaxed); }
+    // Times an input was padded or trimmed back onto its timeline
+    uint64 RealignCount() const { return mRealignCount.load(std::memory_order_relaxed); }
+
+    AudioCaptureGroup(const AudioCaptureGroup&) = delete;
+    AudioCaptureGroup& operator=(const AudioCaptureGroup&) = delete;
+
+private:
+    struct Input {
+        AudioCaptureGroup* group;
+        AudioCapture*     capture;
+        AudioChannelLayout layout;
+        uint32            channels;
+        uint32            channelOffset;
+        AudioRingBuffer   ring;
+        // Block read from the ring, also the silence written when padding
+        float*            block;
+        float*            silence;
+        // Performance time of frame 0, -1 until the first buffer arrived
+        std::atomic<bigtime_t> startTime;
+        // Producer side: frames written since startTime
+        uint64            written;
+        // Consumer side: frames still to skip to line up with the others
+        uint64            skip;
+    };
+
+    status_t addInput(AudioCapture* capture, AudioChannelLayout layout);
+    void cleanupInputs();
+    bool alignInputs();
+    bool blockReady();
+    void mixBlock();
+    int32 mixLoop();
+
+    static void inputCallbackC(const float* data, size_t frameCount, uint32 channelCount,
+        const AudioBufferInfo& info, void* cookie);
+    static int32 mixThreadC(void* cookie);
+
+    AudioCallbackFunc mCallback;
+    void*             mUserData;
+    float             mRequestedSampleRate;
+    float             mSampleRate;
+    BString           mNodeName;
+
+    Input**           mInputs;
+    int32             mInputCount;
+    bool              mAligned;
+
+    size_t            mBlockFrames;
+    uint32            mOutputChannels;
+    float*            mOutputBuffer;
+
+    bool              mIsRunning;
+    thread_id         mMixThread;
+    sem_id            mMixSem;
+    std::atomic<bool> mMixWaiting;
+    std::atomic<bool> mMixQuit;
+
+    std::atomic<uint64> mOverrunFrames;
+    std::atomic<uint64> mRealignCount;
+};
+
+#endif // AUDIO_CAPTURE_GROUP_H
@@ -0,0 +1,879 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#include <string.h>
+
+#include "AudioConvert.h"
+#include "AudioSimd.h"
+
+// All scale factors are powers of two, so multiplying by the reciprocal gives
+// bit-identical results to the division used by the scalar helpers.
+static const float kInt32Scale = 1.0f / 2147483648.0f;
+static const float kInt16Scale = 1.0f / 32768.0f;
+static const float kInt8Scale = 1.0f / 128.0f;
+
+
+// #pragma mark - Scalar
+
+
+static void
+convertFloatScalar(float* dst, const void* src, size_t count)
+{
+    if (dst != src)
+        memmove(dst, src, count * sizeof(float));
+}
+
+
+static void
+convertInt32Scalar(float* dst, const void* src, size_t count)
+{
+    const int32_t* in = static_cast<const int32_t*>(src);
+    for (size_t i = 0; i < count; i++)
+        dst[i] = in[i] * kInt32Scale;
+}
+
+
+static void
+convertInt16Scalar(float* dst, const void* src, size_t count)
+{
+    const int16_t* in = static_cast<const int16_t*>(src);
+    for (size_t i = 0; i < count; i++)
+        dst[i] = in[i] * kInt16Scale;
+}
+
+
+static void
+convertInt8Scalar(float* dst, const void* src, size_t count)
+{
+    const int8_t* in = static_cast<const int8_t*>(src);
+    for (size_t i = 0; i < count; i++)
+        dst[i] = in[i] * kInt8Scale;
+}
+
+
+static void
+convertUInt8Scalar(float* dst, const void* src, size_t count)
+{
+    const uint8_t* in = static_cast<const uint8_t*>(src);
+    for (size_t i = 0; i < count; i++)
+        dst[i] = (static_cast<int16_t>(in[i]) - 128) * kInt8Scale;
+}
+
+
+static void
+expandMonoScalar(float* dst, const float* src, size_t frameCount)
+{
+    for (size_t i = 0; i < frameCount; i++) {
+        const float sample = src[i];
+        dst[i * 2 + 0] = sample;
+        dst[i * 2 + 1] = sample;
+    }
+}
+
+
+// #pragma mark - SSE2
+
+
+#ifdef AUDIO_SIMD_SSE2
+
+TARGET_SSE2 static void
+convertInt32SSE2(float* dst, const void* src, size_t count)
+{
+    const int32_t* in = static_cast<const int32_t*>(src);
+    const __m128 scale = _mm_set1_ps(kInt32Scale);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 4));
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(a), scale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(b), scale));
+    }
+    convertInt32Scalar(dst + i, in + i, count - i);
+}
+
+
+TARGET_SSE2 static void
+convertInt16SSE2(float* dst, const void* src, size_t count)
+{
+    const int16_t* in = static_cast<const int16_t*>(src);
+    const __m128 scale = _mm_set1_ps(kInt16Scale);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        // Sign-extend by placing each sample in the upper half and shifting
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+    convertInt16Scalar(dst + i, in + i, count - i);
+}
+
+
+TARGET_SSE2 static inline void
+storeInt8x16SSE2(float* dst, __m128i x, __m128 scale)
+{
+    __m128i lo16 = _mm_srai_epi16(_mm_unpacklo_epi8(x, x), 8);
+    __m128i hi16 = _mm_srai_epi16(_mm_unpackhi_epi8(x, x), 8);
+    _mm_storeu_ps(dst + 0, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(lo16, lo16), 16)), scale));
+    _mm_storeu_ps(dst + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(lo16, lo16), 16)), scale));
+    _mm_storeu_ps(dst + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(hi16, hi16), 16)), scale));
+    _mm_storeu_ps(dst + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(hi16, hi16), 16)), scale));
+}
+
+
+TARGET_SSE2 static void
+convertInt8SSE2(float* dst, const void* src, size_t count)
+{
+    const int8_t* in = static_cast<const int8_t*>(src);
+    const __m128 scale = _mm_set1_ps(kInt8Scale);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+        storeInt8x16SSE2(dst + i, _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)), scale);
+    convertInt8Scalar(dst + i, in + i, count - i);
+}
+
+
+TARGET_SSE2 static void
+convertUInt8SSE2(float* dst, const void* src, size_t count)
+{
+    const uint8_t* in = static_cast<const uint8_t*>(src);
+    const __m128 scale = _mm_set1_ps(kInt8Scale);
+    // Flipping the top bit maps unsigned offset-128 samples onto int8
+    const __m128i bias = _mm_set1_epi8(static_cast<char>(0x80));
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        storeInt8x16SSE2(dst + i, _mm_xor_si128(x, bias), scale);
+    }
+    convertUInt8Scalar(dst + i, in + i, count - i);
+}
+
+
+TARGET_SSE2 static void
+expandMonoSSE2(float* dst, const float* src, size_t frameCount)
+{
+    size_t i = 0;
+    for (; i + 4 <= frameCount; i += 4) {
+        __m128 x = _mm_loadu_ps(src + i);
+        _mm_storeu_ps(dst + i * 2, _mm_unpacklo_ps(x, x));
+        _mm_storeu_ps(dst + i * 2 + 4, _mm_unpackhi_ps(x, x));
+    }
+    expandMonoScalar(dst + i * 2, src + i, frameCount - i);
+}
+
+#endif // AUDIO_SIMD_SSE2
+
+
+// #pragma mark - AVX2
+
+
+#ifdef AUDIO_SIMD_AVX2
+
+TARGET_AVX2 static void
+convertInt32AVX2(float* dst, const void* src, size_t count)
+{
+    const int32_t* in = static_cast<const int32_t*>(src);
+    const __m256 scale = _mm256_set1_ps(kInt32Scale);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i + 8));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(a), scale));
+        _mm256_storeu_ps(dst + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(b), scale));
+    }
+    convertInt32Scalar(dst + i, in + i, count - i);
+}
+
+
+TARGET_AVX2 static void
+convertInt16AVX2(float* dst, const void* src, size_t count)
+{
+    const int16_t* in = static_cast<const int16_t*>(src);
+    const __m256 scale = _mm256_set1_ps(kInt16Scale);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 8));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(a)), scale));
+        _mm256_storeu_ps(dst + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(b)), scale));
+    }
+    convertInt16Scalar(dst + i, in + i, count - i);
+}
+
+
+TARGET_AVX2 static inline void
+storeInt8x16AVX2(float* dst, __m128i x, __m256 scale)
+{
+    _mm256_storeu_ps(dst, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(x)), scale));
+    _mm256_storeu_ps(dst + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(
+        _mm256_cvtepi8_epi32(_mm_srli_si128(x, 8))), scale));
+}
+
+
+TARGET_AVX2 static void
+convertInt8AVX2(float* dst, const void* src, size_t count)
+{
+    const int8_t* in = static_cast<const int8_t*>(src);
+    const __m256 scale = _mm256_set1_ps(kInt8Scale);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+        storeInt8x16AVX2(dst + i, _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)), scale);
+    convertInt8Scalar(dst + i, in + i, count - i);
+}
+
+
+TARGET_AVX2 static void
+convertUInt8AVX2(float* dst, const void* src, size_t count)
+{
+    const uint8_t* in = static_cast<const uint8_t*>(src);
+    const __m256 scale = _mm256_set1_ps(kInt8Scale);
+    const __m128i bias = _mm_set1_epi8(static_cast<char>(0x80));
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        storeInt8x16AVX2(dst + i, _mm_xor_si128(x, bias), scale);
+    }
+    convertUInt8Scalar(dst + i, in + i, count - i);
+}
+
+#endif // AUDIO_SIMD_AVX2
+
+
+// #pragma mark - NEON
+
+
+#ifdef AUDIO_SIMD_NEON
+
+static void
+convertInt32NEON(float* dst, const void* src, size_t count)
+{
+    const int32_t* in = static_cast<const int32_t*>(src);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(in + i)), kInt32Scale));
+        vst1q_f32(dst + i + 4, vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(in + i + 4)), kInt32Scale));
+    }
+    convertInt32Scalar(dst + i, in + i, count - i);
+}
+
+
+static void
+convertInt16NEON(float* dst, const void* src, size_t count)
+{
+    const int16_t* in = static_cast<const int16_t*>(src);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t x = vld1q_s16(in + i);
+        vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))), kInt16Scale));
+        vst1q_f32(dst + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x))), kInt16Scale));
+    }
+    convertInt16Scalar(dst + i, in + i, count - i);
+}
+
+
+static inline void
+storeInt8x16NEON(float* dst, int8x16_t x)
+{
+    int16x8_t lo = vmovl_s8(vget_low_s8(x));
+    int16x8_t hi = vmovl_s8(vget_high_s8(x));
+    vst1q_f32(dst + 0, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(lo))), kInt8Scale));
+    vst1q_f32(dst + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(lo))), kInt8Scale));
+    vst1q_f32(dst + 8, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(hi))), kInt8Scale));
+    vst1q_f32(dst + 12, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(hi))), kInt8Scale));
+}
+
+
+static void
+convertInt8NEON(float* dst, const void* src, size_t count)
+{
+    const int8_t* in = static_cast<const int8_t*>(src);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+        storeInt8x16NEON(dst + i, vld1q_s8(in + i));
+    convertInt8Scalar(dst + i, in + i, count - i);
+}
+
+
+static void
+convertUInt8NEON(float* dst, const void* src, size_t count)
+{
+    const uint8_t* in = static_cast<const uint8_t*>(src);
+    const uint8x16_t bias = vdupq_n_u8(0x80);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+        storeInt8x16NEON(dst + i, vreinterpretq_s8_u8(veorq_u8(vld1q_u8(in + i), bias)));
+    convertUInt8Scalar(dst + i, in + i, count - i);
+}
+
+
+static void
+expandMonoNEON(float* dst, const float* src, size_t frameCount)
+{
+    size_t i = 0;
+    for (; i + 4 <= frameCount; i += 4) {
+        float32x4_t x = vld1q_f32(src + i);
+        float32x4x2_t pair = { { x, x } };
+        vst2q_f32(dst + i * 2, pair);
+    }
+    expandMonoScalar(dst + i * 2, src + i, frameCount - i);
+}
+
+#endif // AUDIO_SIMD_NEON
+
+
+// #pragma mark - Dispatch
+
+
+static const SampleConvertFunc kScalarKernels[SAMPLE_TYPE_COUNT] = {
+    convertFloatScalar,
+    convertInt32Scalar,
+    convertInt16Scalar,
+    convertInt8Scalar,
+    convertUInt8Scalar
+};
+
+#ifdef AUDIO_SIMD_SSE2
+static const SampleConvertFunc kSSE2Kernels[SAMPLE_TYPE_COUNT] = {
+    convertFloatScalar,
+    convertInt32SSE2,
+    convertInt16SSE2,
+    convertInt8SSE2,
+    convertUInt8SSE2
+};
+#endif
+
+#ifdef AUDIO_SIMD_AVX2
+static const SampleConvertFunc kAVX2Kernels[SAMPLE_TYPE_COUNT] = {
+    convertFloatScalar,
+    convertInt32AVX2,
+    convertInt16AVX2,
+    convertInt8AVX2,
+    convertUInt8AVX2
+};
+#endif
+
+#ifdef AUDIO_SIMD_NEON
+static const SampleConvertFunc kNEONKernels[SAMPLE_TYPE_COUNT] = {
+    convertFloatScalar,
+    convertInt32NEON,
+    convertInt16NEON,
+    convertInt8NEON,
+    convertUInt8NEON
+};
+#endif
+
+
+bool
+isSampleKernelISASupported(SampleKernelISA isa)
+{
+    switch (isa) {
+        case SAMPLE_KERNEL_SCALAR:
+            return true;
+#ifdef AUDIO_SIMD_SSE2
+        case SAMPLE_KERNEL_SSE2:
+#ifdef __SSE2__
+            return true;
+#else
+            return __builtin_cpu_supports("sse2");
+#endif
+#endif
+#ifdef AUDIO_SIMD_AVX2
+        case SAMPLE_KERNEL_AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+#ifdef AUDIO_SIMD_NEON
+        case SAMPLE_KERNEL_NEON:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+
+SampleKernelISA
+bestSampleKernelISA()
+{
+    static const SampleKernelISA kPreference[] = {
+        SAMPLE_KERNEL_AVX2,
+        SAMPLE_KERNEL_NEON,
+        SAMPLE_KERNEL_SSE2
+    };
+    for (size_t i = 0; i < sizeof(kPreference) / sizeof(kPreference[0]); i++) {
+        if (isSampleKernelISASupported(kPreference[i]))
+            return kPreference[i];
+    }
+    return SAMPLE_KERNEL_SCALAR;
+}
+
+
+const char*
+sampleKernelISAName(SampleKernelISA isa)
+{
+    switch (isa) {
+        case SAMPLE_KERNEL_SCALAR: return "scalar";
+        case SAMPLE_KERNEL_SSE2:   return "sse2";
+        case SAMPLE_KERNEL_AVX2:   return "avx2";
+        case SAMPLE_KERNEL_NEON:   return "neon";
+        default:                   return "auto";
+    }
+}
+
+
+size_t
+sampleTypeSize(SampleType type)
+{
+    switch (type) {
+        case SAMPLE_FLOAT: return sizeof(float);
+        case SAMPLE_INT32: return sizeof(int32_t);
+        case SAMPLE_INT16: return sizeof(int16_t);
+        case SAMPLE_INT8:  return sizeof(int8_t);
+        case SAMPLE_UINT8: return sizeof(uint8_t);
+        default:           return 0;
+    }
+}
+
+
+SampleConvertFunc
+getSampleConverter(SampleType type, SampleKernelISA isa)
+{
+    if (type < 0 || type >= SAMPLE_TYPE_COUNT)
+        return NULL;
+
+    if (isa == SAMPLE_KERNEL_AUTO)
+        isa = bestSampleKernelISA();
+    else if (!isSampleKernelISASupported(isa))
+        return NULL;
+
+    switch (isa) {
+#ifdef AUDIO_SIMD_AVX2
+        case SAMPLE_KERNEL_AVX2: return kAVX2Kernels[type];
+#endif
+#ifdef AUDIO_SIMD_SSE2
+        case SAMPLE_KERNEL_SSE2: return kSSE2Kernels[type];
+#endif
+#ifdef AUDIO_SIMD_NEON
+        case SAMPLE_KERNEL_NEON: return kNEONKernels[type];
+#endif
+        default:                 return kScalarKernels[type];
+    }
+}
+
+
+void
+expandMonoToStereo(float* dst, const float* src, size_t frameCount)
+{
+#if defined(AUDIO_SIMD_NEON)
+    expandMonoNEON(dst, src, frameCount);
+#elif defined(AUDIO_SIMD_SSE2) && defined(__SSE2__)
+    expandMonoSSE2(dst, src, frameCount);
+#else
+    expandMonoScalar(dst, src, frameCount);
+#endif
+}
+
+
+// #pragma mark - Frame converters
+
+
+template<typename Sample> struct SampleTraits;
+
+template<> struct SampleTraits<float> {
+    static const SampleType kType = SAMPLE_FLOAT;
+    static inline float ToFloat(float sample) { return sample; }
+};
+
+template<> struct SampleTraits<int32_t> {
+    static const SampleType kType = SAMPLE_INT32;
+    static inline float ToFloat(int32_t sample) { return sample * kInt32Scale; }
+};
+
+template<> struct SampleTraits<int16_t> {
+    static const SampleType kType = SAMPLE_INT16;
+    static inline float ToFloat(int16_t sample) { return sample * kInt16Scale; }
+};
+
+template<> struct SampleTraits<int8_t> {
+    static const SampleType kType = SAMPLE_INT8;
+    static inline float ToFloat(int8_t sample) { return sample * kInt8Scale; }
+};
+
+template<> struct SampleTraits<uint8_t> {
+    static const SampleType kType = SAMPLE_UINT8;
+    static inline float ToFloat(uint8_t sample)
+        { return (static_cast<int16_t>(sample) - 128) * kInt8Scale; }
+};
+
+
+// Filled by getFrameConverter() before any converter is handed out
+static SampleConvertFunc sBestKernels[SAMPLE_TYPE_COUNT];
+
+
+// InChannels == 0 selects the variant that takes the channel count at runtime
+template<typename Sample, uint32_t InChannels, uint32_t OutChannels>
+struct FrameConverter {
+    static void Convert(float* dst, const void* src, size_t frameCount,
+        uint32_t inputChannels)
+    {
+        const uint32_t stride = InChannels != 0 ? InChannels : inputChannels;
+        const Sample* in = static_cast<const Sample*>(src);
+        for (size_t i = 0; i < frameCount; i++) {
+            for (uint32_t c = 0; c < OutChannels; c++)
+                dst[c] = SampleTraits<Sample>::ToFloat(in[c]);
+            dst += OutChannels;
+            in += stride;
+        }
+    }
+};
+
+template<typename Sample>
+struct FrameConverter<Sample, 2, 2> {
+    static void Convert(float* dst, const void* src, size_t frameCount, uint32_t)
+    {
+        sBestKernels[SampleTraits<Sample>::kType](dst, src, frameCount * 2);
+    }
+};
+
+template<typename Sample>
+struct FrameConverter<Sample, 1, 2> {
+    static void Convert(float* dst, const void* src, size_t frameCount, uint32_t)
+    {
+        // Convert into the upper half, then expand in place
+        sBestKernels[SampleTraits<Sample>::kType](dst + frameCount, src, frameCount);
+        expandMonoToStereo(dst, dst + frameCount, frameCount);
+    }
+};
+
+
+// Output in the device layout, a straight conversion of every sample
+template<typename Sample>
+struct NativeFrameConverter {
+    static void Convert(float* dst, const void* src, size_t frameCount, uint32_t inputChannels)
+    {
+        sBestKernels[SampleTraits<Sample>::kType](dst, src, frameCount * inputChannels);
+    }
+};
+
+
+template<typename Sample, uint32_t OutChannels>
+static FrameConvertFunc
+frameConverterFor(uint32_t inputChannels)
+{
+    switch (inputChannels) {
+        case 1: return FrameConverter<Sample, 1, OutChannels>::Convert;
+        case 2: return FrameConverter<Sample, 2, OutChannels>::Convert;
+        case 4: return FrameConverter<Sample, 4, OutChannels>::Convert;
+        case 6: return FrameConverter<Sample, 6, OutChannels>::Convert;
+        case 8: return FrameConverter<Sample, 8, OutChannels>::Convert;
+        default: return FrameConverter<Sample, 0, OutChannels>::Convert;
+    }
+}
+
+
+static FrameConvertFunc
+nativeFrameConverterFor(SampleType type)
+{
+    switch (type) {
+        case SAMPLE_FLOAT: return NativeFrameConverter<float>::Convert;
+        case SAMPLE_INT32: return NativeFrameConverter<int32_t>::Convert;
+        case SAMPLE_INT16: return NativeFrameConverter<int16_t>::Convert;
+        case SAMPLE_INT8:  return NativeFrameConverter<int8_t>::Convert;
+        case SAMPLE_UINT8: return NativeFrameConverter<uint8_t>::Convert;
+        default:           return NULL;
+    }
+}
+
+
+template<uint32_t OutChannels>
+static FrameConvertFunc
+frameConverterFor(SampleType type, uint32_t inputChannels)
+{
+    switch (type) {
+        case SAMPLE_FLOAT: return frameConverterFor<float, OutChannels>(inputChannels);
+        case SAMPLE_INT32: return frameConverterFor<int32_t, OutChannels>(inputChannels);
+        case SAMPLE_INT16: return frameConverterFor<int16_t, OutChannels>(inputChannels);
+        case SAMPLE_INT8:  return frameConverterFor<int8_t, OutChannels>(inputChannels);
+        case SAMPLE_UINT8: return frameConverterFor<uint8_t, OutChannels>(inputChannels);
+        default:           return NULL;
+    }
+}
+
+
+FrameConvertFunc
+getFrameConverter(SampleType type, uint32_t inputChannels, uint32_t outputChannels)
+{
+    if (type < 0 || type >= SAMPLE_TYPE_COUNT || inputChannels == 0)
+        return NULL;
+
+    if (sBestKernels[0] == NULL) {
+        for (int i = 0; i < SAMPLE_TYPE_COUNT; i++)
+            sBestKernels[i] = getSampleConverter(static_cast<SampleType>(i));
+    }
+
+    if (outputChannels == 2)
+        return frameConverterFor<2>(type, inputChannels);
+    if (outputChannels == inputChannels)
+        return nativeFrameConverterFor(type);
+    return NULL;
+}
+
+
+// #pragma mark - Planar converters
+
+
+// Splits interleaved stereo into two planes while converting
+typedef void (*StereoSplitFunc)(float* left, float* right, const void* src, size_t frameCount);
+
+
+template<typename Sample>
+static void
+splitStereoScalar(float* left, float* right, const void* src, size_t frameCount)
+{
+    const Sample* in = static_cast<const Sample*>(src);
+    for (size_t i = 0; i < frameCount; i++) {
+        left[i] = SampleTraits<Sample>::ToFloat(in[i * 2 + 0]);
+        right[i] = SampleTraits<Sample>::ToFloat(in[i * 2 + 1]);
+    }
+}
+
+
+#ifdef AUDIO_SIMD_SSE2
+
+TARGET_SSE2 static inline void
+storeSplitSSE2(float* left, float* right, __m128 a, __m128 b)
+{
+    _mm_storeu_ps(left, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm_storeu_ps(right, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+}
+
+
+TARGET_SSE2 static void
+splitStereoFloatSSE2(float* left, float* right, const void* src, size_t frameCount)
+{
+    const float* in = static_cast<const float*>(src);
+    size_t i = 0;
+    for (; i + 4 <= frameCount; i += 4)
+        storeSplitSSE2(left + i, right + i, _mm_loadu_ps(in + i * 2), _mm_loadu_ps(in + i * 2 + 4));
+    splitStereoScalar<float>(left + i, right + i, in + i * 2, frameCount - i);
+}
+
+
+TARGET_SSE2 static void
+splitStereoInt32SSE2(float* left, float* right, const void* src, size_t frameCount)
+{
+    const int32_t* in = static_cast<const int32_t*>(src);
+    const __m128 scale = _mm_set1_ps(kInt32Scale);
+    size_t i = 0;
+    for (; i + 4 <= frameCount; i += 4) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 2));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 2 + 4));
+        storeSplitSSE2(left + i, right + i, _mm_mul_ps(_mm_cvtepi32_ps(a), scale),
+            _mm_mul_ps(_mm_cvtepi32_ps(b), scale));
+    }
+    splitStereoScalar<int32_t>(left + i, right + i, in + i * 2, frameCount - i);
+}
+
+
+TARGET_SSE2 static void
+splitStereoInt16SSE2(float* left, float* right, const void* src, size_t frameCount)
+{
+    const int16_t* in = static_cast<const int16_t*>(src);
+    const __m128 scale = _mm_set1_ps(kInt16Scale);
+    size_t i = 0;
+    for (; i + 4 <= frameCount; i += 4) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 2));
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+        storeSplitSSE2(left + i, right + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale),
+            _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+    splitStereoScalar<int16_t>(left + i, right + i, in + i * 2, frameCount - i);
+}
+
+#endif // AUDIO_SIMD_SSE2
+
+
+#ifdef AUDIO_SIMD_NEON
+
+static void
+splitStereoFloatNEON(float* left, float* right, const void* src, size_t frameCount)
+{
+    const float* in = static_cast<const float*>(src);
+    size_t i = 0;
+    for (; i + 4 <= frameCount; i += 4) {
+        float32x4x2_t x = vld2q_f32(in + i * 2);
+        vst1q_f32(left + i, x.val[0]);
+        vst1q_f32(right + i, x.val[1]);
+    }
+    splitStereoScalar<float>(left + i, right + i, in + i * 2, frameCount - i);
+}
+
+
+static void
+splitStereoInt32NEON(float* left, float* right, const void* src, size_t frameCount)
+{
+    const int32_t* in = static_cast<const int32_t*>(src);
+    size_t i = 0;
+    for (; i + 4 <= frameCount; i += 4) {
+        int32x4x2_t x = vld2q_s32(in + i * 2);
+        vst1q_f32(left + i, vmulq_n_f32(vcvtq_f32_s32(x.val[0]), kInt32Scale));
+        vst1q_f32(right + i, vmulq_n_f32(vcvtq_f32_s32(x.val[1]), kInt32Scale));
+    }
+    splitStereoScalar<int32_t>(left + i, right + i, in + i * 2, frameCount - i);
+}
+
+
+static void
+splitStereoInt16NEON(float* left, float* right, const void* src, size_t frameCount)
+{
+    const int16_t* in = static_cast<const int16_t*>(src);
+    size_t i = 0;
+    for (; i + 8 <= frameCount; i += 8) {
+        int16x8x2_t x = vld2q_s16(in + i * 2);
+        vst1q_f32(left + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x.val[0]))), kInt16Scale));
+        vst1q_f32(left + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x.val[0]))), kInt16Scale));
+        vst1q_f32(right + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x.val[1]))), kInt16Scale));
+        vst1q_f32(right + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x.val[1]))), kInt16Scale));
+    }
+    splitStereoScalar<int16_t>(left + i, right + i, in + i * 2, frameCount - i);
+}
+
+#endif // AUDIO_SIMD_NEON
+
+
+// Filled by getPlanarConverter() before any converter is handed out. The
+// 8 bit types are rare enough on capture devices to stay scalar.
+static StereoSplitFunc sStereoSplit[SAMPLE_TYPE_COUNT];
+
+
+static void
+initStereoSplit()
+{
+    sStereoSplit[SAMPLE_FLOAT] = splitStereoScalar<float>;
+    sStereoSplit[SAMPLE_INT32] = splitStereoScalar<int32_t>;
+    sStereoSplit[SAMPLE_INT16] = splitStereoScalar<int16_t>;
+    sStereoSplit[SAMPLE_INT8] = splitStereoScalar<int8_t>;
+    sStereoSplit[SAMPLE_UINT8] = splitStereoScalar<uint8_t>;
+
+    switch (bestSampleKernelISA()) {
+#ifdef AUDIO_SIMD_SSE2
+        case SAMPLE_KERNEL_AVX2:
+        case SAMPLE_KERNEL_SSE2:
+            sStereoSplit[SAMPLE_FLOAT] = splitStereoFloatSSE2;
+            sStereoSplit[SAMPLE_INT32] = splitStereoInt32SSE2;
+            sStereoSplit[SAMPLE_INT16] = splitStereoInt16SSE2;
+            break;
+#endif
+#ifdef AUDIO_SIMD_NEON
+        case SAMPLE_KERNEL_NEON:
+            sStereoSplit[SAMPLE_FLOAT] = splitStereoFloatNEON;
+            sStereoSplit[SAMPLE_INT32] = splitStereoInt32NEON;
+            sStereoSplit[SAMPLE_INT16] = splitStereoInt16NEON;
+            break;
+#endif
+        default:
+            break;
+    }
+}
+
+
+// OutChannels is 2 or 0 for every input channel, InChannels == 0 takes the
+// channel count at runtime
+template<typename Sample, uint32_t InChannels, uint32_t OutChannels>
+struct PlanarConverter {
+    static void Convert(float* const* planes, const void* src, size_t frameCount,
+        uint32_t inputChannels)
+    {
+        const uint32_t stride = InChannels != 0 ? InChannels : inputChannels;
+        const Sample* in = static_cast<const Sample*>(src);
+        if (OutChannels == 2) {
+            float* left = planes[0];
+            float* right = planes[1];
+            for (size_t i = 0; i < frameCount; i++) {
+                left[i] = SampleTraits<Sample>::ToFloat(in[0]);
+                right[i] = SampleTraits<Sample>::ToFloat(in[1]);
+                in += stride;
+            }
+            return;
+        }
+
+        // All channels: one plane at a time keeps the stores sequential, the
+        // strided reads keep hitting the same few cache lines
+        for (uint32_t c = 0; c < stride; c++) {
+            float* plane = planes[c];
+            for (size_t i = 0; i < frameCount; i++)
+                plane[i] = SampleTraits<Sample>::ToFloat(in[i * stride + c]);
+        }
+    }
+};
+
+template<typename Sample, uint32_t OutChannels>
+struct PlanarConverter<Sample, 2, OutChannels> {
+    static void Convert(float* const* planes, const void* src, size_t frameCount, uint32_t)
+    {
+        sStereoSplit[SampleTraits<Sample>::kType](planes[0], planes[1], src, frameCount);
+    }
+};
+
+template<typename Sample, uint32_t OutChannels>
+struct PlanarConverter<Sample, 1, OutChannels> {
+    static void Convert(float* const* planes, const void* src, size_t frameCount, uint32_t)
+    {
+        sBestKernels[SampleTraits<Sample>::kType](planes[0], src, frameCount);
+        if (OutChannels == 2)
+            memcpy(planes[1], planes[0], frameCount * sizeof(float));
+    }
+};
+
+
+template<typename Sample, uint32_t OutChannels>
+static PlanarConvertFunc
+planarConverterFor(uint32_t inputChannels)
+{
+    switch (inputChannels) {
+        case 1: return PlanarConverter<Sample, 1, OutChannels>::Convert;
+        case 2: return PlanarConverter<Sample, 2, OutChannels>::Convert;
+        case 4: return PlanarConverter<Sample, 4, OutChannels>::Convert;
+        case 6: return PlanarConverter<Sample, 6, OutChannels>::Convert;
+        case 8: return PlanarConverter<Sample, 8, OutChannels>::Convert;
+        default: return PlanarConverter<Sample, 0, OutChannels>::Convert;
+    }
+}
+
+
+template<uint32_t OutChannels>
+static PlanarConvertFunc
+planarConverterFor(SampleType type, uint32_t inputChannels)
+{
+    switch (type) {
+        case SAMPLE_FLOAT: return planarConverterFor<float, OutChannels>(inputChannels);
+        case SAMPLE_INT32: return planarConverterFor<int32_t, OutChannels>(inputChannels);
+        case SAMPLE_INT16: return planarConverterFor<int16_t, OutChannels>(inputChannels);
+        case SAMPLE_INT8:  return planarConverterFor<int8_t, OutChannels>(inputChannels);
+        case SAMPLE_UINT8: return planarConverterFor<uint8_t, OutChannels>(inputChannels);
+        default:           return NULL;
+    }
+}
+
+
+PlanarConvertFunc
+getPlanarConverter(SampleType type, uint32_t inputChannels, uint32_t outputChannels)
+{
+    if (type < 0 || type >= SAMPLE_TYPE_COUNT || inputChannels == 0)
+        return NULL;
+
+    if (sStereoSplit[0] == NULL) {
+        for (int i = 0; i < SAMPLE_TYPE_COUNT; i++)
+            sBestKernels[i] = getSampleConverter(static_cast<SampleType>(i));
+        initStereoSplit();
+    }
+
+    if (outputChannels == 2)
+        return planarConverterFor<2>(type, inputChannels);
+    if (outputChannels == inputChannels)
+        return planarConverterFor<0>(type, inputChannels);
+    return NULL;
+}
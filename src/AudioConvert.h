@@ -0,0 +1,77 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef AUDIO_CONVERT_H
+#define AUDIO_CONVERT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Sample conversion kernels used by AudioCapture. This header deliberately
+// depends on nothing but the C library so the kernels can be built and
+// benchmarked on any host (see examples/AudioBenchmark).
+
+enum SampleType {
+    SAMPLE_FLOAT = 0,
+    SAMPLE_INT32,
+    SAMPLE_INT16,
+    SAMPLE_INT8,
+    SAMPLE_UINT8,
+    SAMPLE_TYPE_COUNT
+};
+
+enum SampleKernelISA {
+    SAMPLE_KERNEL_SCALAR = 0,
+    SAMPLE_KERNEL_SSE2,
+    SAMPLE_KERNEL_AVX2,
+    SAMPLE_KERNEL_NEON,
+    SAMPLE_KERNEL_ISA_COUNT,
+    SAMPLE_KERNEL_AUTO = SAMPLE_KERNEL_ISA_COUNT
+};
+
+// Converts sampleCount contiguous samples to float in [-1, 1).
+typedef void (*SampleConvertFunc)(float* dst, const void* src, size_t sampleCount);
+
+// Returns the kernel for the given type, or NULL if the requested ISA is not
+// compiled in or not supported by the running CPU. SAMPLE_KERNEL_AUTO picks
+// the fastest available one.
+SampleConvertFunc getSampleConverter(SampleType type, SampleKernelISA isa = SAMPLE_KERNEL_AUTO);
+
+SampleKernelISA bestSampleKernelISA();
+bool isSampleKernelISASupported(SampleKernelISA isa);
+const char* sampleKernelISAName(SampleKernelISA isa);
+size_t sampleTypeSize(SampleType type);
+
+// Converts frameCount interleaved device frames into interleaved float frames
+// of the output layout. inputChannels is only consulted by the generic
+// variant; specialized ones have the channel count baked in.
+typedef void (*FrameConvertFunc)(float* dst, const void* src, size_t frameCount,
+    uint32_t inputChannels);
+
+// Returns a converter specialized for the sample type, input channel count
+// and output channel count, or NULL if the combination is not supported.
+// Stereo output keeps the first two input channels and duplicates mono input,
+// output with the input's channel count converts every sample as is. Other
+// layouts need a conversion to the native layout followed by a matrix mix,
+// see AudioMix.h.
+// Meant to be resolved once per negotiated format, outside the realtime path.
+FrameConvertFunc getFrameConverter(SampleType type, uint32_t inputChannels,
+    uint32_t outputChannels = 2);
+
+// Same as FrameConvertFunc, but writes every output channel to its own
+// plane of frameCount floats.
+typedef void (*PlanarConvertFunc)(float* const* planes, const void* src, size_t frameCount,
+    uint32_t inputChannels);
+
+// Planar counterpart of getFrameConverter(), supporting the same layouts.
+PlanarConvertFunc getPlanarConverter(SampleType type, uint32_t inputChannels,
+    uint32_t outputChannels = 2);
+
+// Duplicates every mono sample into an interleaved stereo frame. src may
+// alias dst + frameCount, which lets callers convert into the upper half of
+// the stereo buffer and expand in place.
+void expandMonoToStereo(float* dst, const float* src, size_t frameCount);
+
+#endif // AUDIO_CONVERT_H
@@ -0,0 +1,711 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "AudioFileSink.h"
+
+// Buffers, the header and every write offset are aligned to this
+static const size_t kFileAlignment = 4096;
+// The header takes the first page, so the data starts page aligned as well
+static const size_t kHeaderBytes = kFileAlignment;
+static const bigtime_t kDefaultCheckpointInterval = 1000000;
+
+static const uint16 kWaveFormatPCM = 1;
+static const uint16 kWaveFormatIEEEFloat = 3;
+static const uint16 kWaveFormatExtensible = 0xfffe;
+// Tail of the KSDATAFORMAT_SUBTYPE GUIDs, the format tag goes in front
+static const uint8 kSubFormatGUIDTail[12] = {
+    0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71
+};
+
+// Header layout: RIFF header, a JUNK chunk the size of a ds64 chunk that
+// becomes one for RF64, fmt, a JUNK chunk filling up the page and the data
+// chunk header right before the page ends
+static const size_t kDs64Offset = 12;
+static const size_t kDs64Size = 28;
+static const size_t kFmtOffset = kDs64Offset + 8 + kDs64Size;
+static const size_t kFmtSize = 18;
+static const size_t kFmtExtensibleSize = 40;
+static const size_t kDataOffset = kHeaderBytes - 8;
+
+
+// The first channelCount speaker positions of the WAVE order, which the
+// B_CHANNEL_* bits follow, mono being the center
+static uint32
+defaultChannelMask(uint32 channelCount)
+{
+    if (channelCount == 1)
+        return B_CHANNEL_CENTER;
+    return channelCount < 32 ? (1u << channelCount) - 1 : 0xffffffff;
+}
+
+
+static inline void
+putLE16(uint8* p, uint16 value)
+{
+    p[0] = value & 0xff;
+    p[1] = value >> 8;
+}
+
+
+static inline void
+putLE32(uint8* p, uint32 value)
+{
+    putLE16(p, value & 0xffff);
+    putLE16(p + 2, value >> 16);
+}
+
+
+static inline void
+putLE64(uint8* p, uint64 value)
+{
+    putLE32(p, value & 0xffffffff);
+    putLE32(p + 4, value >> 32);
+}
+
+
+AudioFileSink::AudioFileSink()
+    : mFile(-1),
+      mExtentSize(0),
+      mWindowSize(0),
+      mCheckpointInterval(kDefaultCheckpointInterval),
+      mChannels(0),
+      mSampleRate(0.0f),
+      mFormat(SAMPLE_FLOAT),
+      mChannelMask(0),
+      mSampleSize(0),
+      mDither(false),
+      mQuantizer(NULL),
+      mBuffers(NULL),
+      mBufferFill(NULL),
+      mBufferSize(0),
+      mBufferCount(0),
+      mCurrent(-1),
+      mCurrentFill(0),
+      mCurrentStarted(0),
+      mHeader(NULL),
+      mDataBytes(0),
+      mFileSize(0),
+      mWindow(NULL),
+      mWindowOffset(0),
+      mLastCheckpoint(0),
+      mCheckpointBytes(0),
+      mRF64(false),
+      mWriterThread(-1),
+      mWriterSem(-1),
+      mWriterWaiting(false),
+      mWriterQuit(false),
+      mFrames(0),
+      mDroppedFrames(0),
+      mStatus(B_OK)
+{
+}
+
+
+AudioFileSink::~AudioFileSink()
+{
+    Close();
+}
+
+
+status_t
+AudioFileSink::Open(const char* path, uint32 channelCount, float sampleRate, SampleType format,
+    size_t bufferSize, uint32 bufferCount)
+{
+    if (path == NULL || channelCount == 0 || channelCount > 0xffff || !(sampleRate > 0.0f)
+        || bufferSize == 0 || bufferCount < 2) {
+        return B_BAD_VALUE;
+    }
+    if (format != SAMPLE_FLOAT && format != SAMPLE_INT16 && format != SAMPLE_INT32)
+        return B_BAD_VALUE;
+
+    if (IsOpen())
+        return B_BUSY;
+
+    mChannels = channelCount;
+    mSampleRate = sampleRate;
+    mFormat = format;
+    mSampleSize = sampleTypeSize(format);
+    mQuantizer = format == SAMPLE_FLOAT ? NULL : getQuantizer(format);
+    seedDither(mDitherState, static_cast<uint32>(system_time()));
+
+    mBufferSize = (bufferSize + kFileAlignment - 1) & ~(kFileAlignment - 1);
+    mBufferCount = bufferCount;
+    mBuffers = static_cast<uint8**>(calloc(bufferCount, sizeof(uint8*)));
+    mBufferFill = static_cast<size_t*>(calloc(bufferCount, sizeof(size_t)));
+    if (mBuffers == NULL || mBufferFill == NULL
+        || posix_memalign(reinterpret_cast<void**>(&mHeader), kFileAlignment, kHeaderBytes) != 0
+        || !mFreeBuffers.Init(bufferCount) || !mFullBuffers.Init(bufferCount)) {
+        cleanup();
+        return B_NO_MEMORY;
+    }
+    for (uint32 i = 0; i < bufferCount; i++) {
+        if (posix_memalign(reinterpret_cast<void**>(&mBuffers[i]), kFileAlignment, mBufferSize) != 0) {
+            cleanup();
+            return B_NO_MEMORY;
+        }
+        mFreeBuffers.Push(i);
+    }
+    mCurrent = -1;
+    mCurrentFill = 0;
+
+    mDataBytes = 0;
+    mCheckpointBytes = 0;
+    mFileSize = 0;
+    mRF64 = false;
+    mFrames.store(0);
+    mDroppedFrames.store(0);
+    mStatus.store(B_OK);
+
+    // Read access too, for mapping the file
+    mFile = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (mFile < 0) {
+        const status_t status = errno;
+        fprintf(stderr, "AudioFileSink: Failed to create %s: %s\n", path, strerror(status));
+        cleanup();
+        return status;
+    }
+
+    buildHeader();
+    patchHeader();
+    mLastCheckpoint = system_time();
+    if (mStatus.load() != B_OK) {
+        const status_t status = mStatus.load();
+        cleanup();
+        return status;
+    }
+
+    mWriterSem = create_sem(0, "AudioFileSink writer");
+    if (mWriterSem < B_OK) {
+        const status_t status = mWriterSem;
+        cleanup();
+        return status;
+    }
+
+    mWriterQuit.store(false);
+    mWriterWaiting.store(false);
+    mWriterThread = spawn_thread(writerThreadC, "AudioFileSink writer", B_NORMAL_PRIORITY, this);
+    if (mWriterThread < B_OK) {
+        const status_t status = mWriterThread;
+        cleanup();
+        return status;
+    }
+    resume_thread(mWriterThread);
+    return B_OK;
+}
+
+
+status_t
+AudioFileSink::Close()
+{
+    if (!IsOpen())
+        return B_NO_INIT;
+
+    // The realtime side is gone, this thread takes over as the producer
+    if (mCurrent >= 0 && mCurrentFill > 0)
+        submitBuffer();
+
+    cleanup();
+    return mStatus.load();
+}
+
+
+void
+AudioFileSink::cleanup()
+{
+    // The writer drains every submitted buffer before it quits
+    if (mWriterThread >= B_OK) {
+        mWriterQuit.store(true);
+        release_sem(mWriterSem);
+        status_t result;
+        wait_for_thread(mWriterThread, &result);
+        mWriterThread = -1;
+    }
+
+    if (mWriterSem >= B_OK) {
+        delete_sem(mWriterSem);
+        mWriterSem = -1;
+    }
+
+    if (mFile >= 0) {
+        unmapWindow(true);
+        // Preallocated extents past the data go, the header follows
+        const off_t end = kHeaderBytes + mDataBytes;
+        if (mFileSize > end && ftruncate(mFile, end) != 0)
+            setError(errno, "Failed to trim file");
+        checkpoint();
+        close(mFile);
+        mFile = -1;
+    }
+
+    for (uint32 i = 0; mBuffers != NULL && i < mBufferCount; i++)
+        free(mBuffers[i]);
+    free(mBuffers);
+    mBuffers = NULL;
+    free(mBufferFill);
+    mBufferFill = NULL;
+    mBufferCount = 0;
+    free(mHeader);
+    mHeader = NULL;
+    mCurrent = -1;
+    mCurrentFill = 0;
+}
+
+
+status_t
+AudioFileSink::SetDither(bool enabled)
+{
+    if (IsOpen())
+        return B_BUSY;
+
+    mDither = enabled;
+    return B_OK;
+}
+
+
+status_t
+AudioFileSink::SetPreallocation(off_t extentSize)
+{
+    if (extentSize < 0)
+        return B_BAD_VALUE;
+
+    if (IsOpen())
+        return B_BUSY;
+
+    mExtentSize = (extentSize + kFileAlignment - 1) & ~static_cast<off_t>(kFileAlignment - 1);
+    return B_OK;
+}
+
+
+status_t
+AudioFileSink::SetMappedWrites(size_t windowSize)
+{
+    if (IsOpen())
+        return B_BUSY;
+
+    mWindowSize = (windowSize + kFileAlignment - 1) & ~(kFileAlignment - 1);
+    return B_OK;
+}
+
+
+status_t
+AudioFileSink::SetCheckpointInterval(bigtime_t interval)
+{
+    if (interval <= 0)
+        return B_BAD_VALUE;
+
+    if (IsOpen())
+        return B_BUSY;
+
+    mCheckpointInterval = interval;
+    return B_OK;
+}
+
+
+status_t
+AudioFileSink::SetChannelMask(uint32 channelMask)
+{
+    if (IsOpen())
+        return B_BUSY;
+
+    mChannelMask = channelMask;
+    return B_OK;
+}
+
+
+int32
+AudioFileSink::AttachTo(AudioCapture& capture)
+{
+    if (!IsOpen())
+        return B_NO_INIT;
+
+    AudioChannelLayout layout = AUDIO_CHANNELS_NATIVE;
+    if (mChannels == 1)
+        layout = AUDIO_CHANNELS_MONO;
+    else if (mChannels == 2)
+        layout = AUDIO_CHANNELS_STEREO;
+    else if (capture.InputChannelCount() != mChannels)
+        return B_MISMATCHED_VALUES;
+
+    return capture.AddSink(WriteCallback, this, mSampleRate, layout);
+}
+
+
+size_t
+AudioFileSink::Write(const float* frames, size_t frameCount)
+{
+    if (!IsOpen() || frameCount == 0)
+        return 0;
+
+    // Only this thread takes free buffers, so there are at least as many as
+    // counted now. Whole frames go in or none, or the file would lose its
+    // channel order.
+    const size_t frameSize = mChannels * mSampleSize;
+    size_t space = mFreeBuffers.Count() * mBufferSize;
+    if (mCurrent >= 0)
+        space += mBufferSize - mCurrentFill;
+    const size_t taken = frameCount < space / frameSize ? frameCount : space / frameSize;
+    if (taken < frameCount)
+        mDroppedFrames.fetch_add(frameCount - taken, std::memory_order_relaxed);
+
+    // Buffers hold whole samples, a frame may continue in the next one
+    size_t samples = taken * mChannels;
+    while (samples > 0) {
+        if (mCurrent < 0) {
+            uint32 index;
+            if (!mFreeBuffers.Pop(index))
+                break;
+            mCurrent = index;
+            mCurrentFill = 0;
+            mCurrentStarted = system_time();
+        }
+
+        uint8* destination = mBuffers[mCurrent] + mCurrentFill;
+        const size_t room = (mBufferSize - mCurrentFill) / mSampleSize;
+        const size_t count = samples < room ? samples : room;
+        if (mQuantizer != NULL)
+            mQuantizer(destination, frames, count, mDither ? &mDitherState : NULL);
+        else
+            memcpy(destination, frames, count * sizeof(float));
+        frames += count;
+        samples -= count;
+        mCurrentFill += count * mSampleSize;
+
+        if (mCurrentFill == mBufferSize)
+            submitBuffer();
+    }
+
+    // A buffer filling slower than checkpoints come goes out as it is, or a
+    // crash could take more than an interval of frames with it
+    if (mCurrent >= 0 && system_time() - mCurrentStarted >= mCheckpointInterval / 2)
+        submitBuffer();
+
+    // Single writer, like the AudioCapture statistics
+    mFrames.store(mFrames.load(std::memory_order_relaxed) + taken, std::memory_order_relaxed);
+    return taken;
+}
+
+
+void
+AudioFileSink::WriteCallback(const float* data, size_t frameCount, uint32 channelCount,
+    void* userData)
+{
+    AudioFileSink* sink = static_cast<AudioFileSink*>(userData);
+    if (channelCount != sink->mChannels) {
+        sink->mDroppedFrames.fetch_add(frameCount, std::memory_order_relaxed);
+        return;
+    }
+    sink->Write(data, frameCount);
+}
+
+
+void
+AudioFileSink::submitBuffer()
+{
+    mBufferFill[mCurrent] = mCurrentFill;
+    mFullBuffers.Push(mCurrent);
+    mCurrent = -1;
+    mCurrentFill = 0;
+
+    if (mWriterWaiting.exchange(false))
+        release_sem_etc(mWriterSem, 1, B_DO_NOT_RESCHEDULE);
+}
+
+
+// #pragma mark - Writer
+
+
+void
+AudioFileSink::buildHeader()
+{
+    memset(mHeader, 0, kHeaderBytes);
+    memcpy(mHeader + 8, "WAVE", 4);
+
+    // Readers only take more than two channels or more than 16-bit PCM
+    // reliably with WAVE_FORMAT_EXTENSIBLE
+    const bool extensible = mChannels > 2 || mFormat == SAMPLE_INT32;
+    const uint16 formatTag = mFormat == SAMPLE_FLOAT ? kWaveFormatIEEEFloat : kWaveFormatPCM;
+    const uint32 sampleRate = static_cast<uint32>(lroundf(mSampleRate));
+    const uint16 blockAlign = mChannels * mSampleSize;
+    const size_t fmtSize = extensible ? kFmtExtensibleSize : kFmtSize;
+    uint8* fmt = mHeader + kFmtOffset;
+    memcpy(fmt, "fmt ", 4);
+    putLE32(fmt + 4, fmtSize);
+    putLE16(fmt + 8, extensible ? kWaveFormatExtensible : formatTag);
+    putLE16(fmt + 10, mChannels);
+    putLE32(fmt + 12, sampleRate);
+    putLE32(fmt + 16, sampleRate * blockAlign);
+    putLE16(fmt + 20, blockAlign);
+    putLE16(fmt + 22, mSampleSize * 8);
+    if (extensible) {
+        putLE16(fmt + 24, kFmtExtensibleSize - kFmtSize);
+        putLE16(fmt + 26, mSampleSize * 8);
+        putLE32(fmt + 28, mChannelMask != 0 ? mChannelMask : defaultChannelMask(mChannels));
+        putLE32(fmt + 32, formatTag);
+        memcpy(fmt + 36, kSubFormatGUIDTail, sizeof(kSubFormatGUIDTail));
+    }
+    // Otherwise cbSize stays 0
+
+    const size_t padOffset = kFmtOffset + 8 + fmtSize;
+    memcpy(mHeader + padOffset, "JUNK", 4);
+    putLE32(mHeader + padOffset + 4, kDataOffset - padOffset - 8);
+    memcpy(mHeader + kDataOffset, "data", 4);
+}
+
+
+// Rewrites the whole header page with the data written so far. Past 4 GB
+// the 32-bit sizes are set to -1 and the ds64 chunk holds the real ones,
+// as RF64 (EBU Tech 3306) has it.
+void
+AudioFileSink::patchHeader()
+{
+    const uint64 riffSize = kHeaderBytes - 8 + mDataBytes;
+    uint8* ds64 = mHeader + kDs64Offset;
+    if (riffSize > 0xffffffff && !mRF64) {
+        // The page may be torn between its first and last sector. Switching
+        // to RF64 first, with the data size of the last header still in the
+        // data chunk, keeps every mix of old and new sectors readable.
+        memcpy(mHeader, "RF64", 4);
+        putLE32(mHeader + 4, 0xffffffff);
+        memcpy(ds64, "ds64", 4);
+        putLE64(ds64 + 8, riffSize);
+        putLE64(ds64 + 16, mDataBytes);
+        putLE64(ds64 + 24, mDataBytes / (mChannels * mSampleSize));
+        putLE32(ds64 + 32, 0);
+        if (pwrite(mFile, mHeader, kHeaderBytes, 0) != static_cast<ssize_t>(kHeaderBytes))
+            setError(errno != 0 ? errno : B_IO_ERROR, "Failed to write header");
+        else if (fsync(mFile) != 0)
+            setError(errno, "Failed to sync file");
+        mRF64 = true;
+    }
+
+    if (mRF64) {
+        putLE64(ds64 + 8, riffSize);
+        putLE64(ds64 + 16, mDataBytes);
+        putLE64(ds64 + 24, mDataBytes / (mChannels * mSampleSize));
+        putLE32(mHeader + kDataOffset + 4, 0xffffffff);
+    } else {
+        memcpy(mHeader, "RIFF", 4);
+        putLE32(mHeader + 4, riffSize);
+        memcpy(ds64, "JUNK", 4);
+        putLE32(mHeader + kDataOffset + 4, mDataBytes);
+    }
+    putLE32(ds64 + 4, kDs64Size);
+
+    if (pwrite(mFile, mHeader, kHeaderBytes, 0) != static_cast<ssize_t>(kHeaderBytes))
+        setError(errno != 0 ? errno : B_IO_ERROR, "Failed to write header");
+}
+
+
+// The data goes to disk before the header that includes it, so whatever
+// state a crash leaves the header in, it only covers data that is there
+void
+AudioFileSink::checkpoint()
+{
+    if (mWindow != NULL && msync(mWindow, mWindowSize, MS_SYNC) != 0)
+        setError(errno, "Failed to sync mapped data");
+    if (fsync(mFile) != 0)
+        setError(errno, "Failed to sync file");
+
+    patchHeader();
+    if (fsync(mFile) != 0)
+        setError(errno, "Failed to sync file");
+    mLastCheckpoint = system_time();
+    mCheckpointBytes = mDataBytes;
+}
+
+
+// Every half interval, which with buffers reaching the writer within half an
+// interval keeps what is not on disk under one. Without new data there is
+// nothing to sync.
+void
+AudioFileSink::checkpointIfDue()
+{
+    const bigtime_t now = system_time();
+    if (now - mLastCheckpoint < mCheckpointInterval / 2)
+        return;
+
+    if (mDataBytes == mCheckpointBytes)
+        mLastCheckpoint = now;
+    else
+        checkpoint();
+}
+
+
+// Keeps the first error only
+void
+AudioFileSink::setError(status_t status, const char* what)
+{
+    status_t expected = B_OK;
+    if (mStatus.compare_exchange_strong(expected, status))
+        fprintf(stderr, "AudioFileSink: %s: %s\n", what, strerror(status));
+}
+
+
+// Makes sure the file reaches end, a whole number of extents at a time
+status_t
+AudioFileSink::reserve(off_t end)
+{
+    const off_t extent = mExtentSize > 0 ? mExtentSize : static_cast<off_t>(mWindowSize);
+    if (extent == 0 || end <= mFileSize)
+        return B_OK;
+
+    const off_t size = (end + extent - 1) / extent * extent;
+    const int error = posix_fallocate(mFile, mFileSize, size - mFileSize);
+    if (error != 0) {
+        // File systems without it still have to grow the file for a mapping
+        if (error != EINVAL && error != EOPNOTSUPP)
+            return error;
+        if (ftruncate(mFile, size) != 0)
+            return errno;
+    }
+    mFileSize = size;
+    return B_OK;
+}
+
+
+// Windows are aligned to their size, so one never straddles two extents
+status_t
+AudioFileSink::mapWindow(off_t offset)
+{
+    unmapWindow(false);
+
+    const off_t windowOffset = offset - offset % mWindowSize;
+    status_t status = reserve(windowOffset + mWindowSize);
+    if (status != B_OK)
+        return status;
+
+    void* window = mmap(NULL, mWindowSize, PROT_READ | PROT_WRITE, MAP_SHARED, mFile, windowOffset);
+    if (window == MAP_FAILED)
+        return errno;
+
+    // Filled front to back exactly once
+    posix_madvise(window, mWindowSize, POSIX_MADV_SEQUENTIAL);
+    mWindow = static_cast<uint8*>(window);
+    mWindowOffset = windowOffset;
+    return B_OK;
+}
+
+
+// Starts writeback of the window and lets its pages go, nothing reads them
+// again
+void
+AudioFileSink::unmapWindow(bool sync)
+{
+    if (mWindow == NULL)
+        return;
+
+    if (msync(mWindow, mWindowSize, sync ? MS_SYNC : MS_ASYNC) != 0)
+        setError(errno, "Failed to sync mapped data");
+    posix_madvise(mWindow, mWindowSize, POSIX_MADV_DONTNEED);
+    munmap(mWindow, mWindowSize);
+    mWindow = NULL;
+}
+
+
+status_t
+AudioFileSink::writeDirect(const uint8* data, size_t bytes)
+{
+    const off_t offset = kHeaderBytes + mDataBytes;
+    status_t status = reserve(offset + bytes);
+    if (status != B_OK)
+        return status;
+
+    const ssize_t written = pwrite(mFile, data, bytes, offset);
+    if (written != static_cast<ssize_t>(bytes)) {
+        // A short write means the disk is full
+        return written < 0 ? errno : B_DEVICE_FULL;
+    }
+    mDataBytes += bytes;
+    return B_OK;
+}
+
+
+status_t
+AudioFileSink::writeMapped(const uint8* data, size_t bytes)
+{
+    while (bytes > 0) {
+        const off_t offset = kHeaderBytes + mDataBytes;
+        if (mWindow == NULL || offset >= mWindowOffset + static_cast<off_t>(mWindowSize)) {
+            status_t status = mapWindow(offset);
+            if (status != B_OK)
+                return status;
+        }
+
+        const size_t position = offset - mWindowOffset;
+        const size_t count = bytes < mWindowSize - position ? bytes : mWindowSize - position;
+        memcpy(mWindow + position, data, count);
+        data += count;
+        bytes -= count;
+        mDataBytes += count;
+    }
+    return B_OK;
+}
+
+
+void
+AudioFileSink::writeBuffer(uint32 index)
+{
+    const size_t bytes = mBufferFill[index];
+    if (mStatus.load(std::memory_order_relaxed) == B_OK) {
+        const status_t status = mWindowSize > 0
+            ? writeMapped(mBuffers[index], bytes) : writeDirect(mBuffers[index], bytes);
+        if (status != B_OK)
+            setError(status, "Failed to write audio data");
+    }
+    if (mStatus.load(std::memory_order_relaxed) != B_OK)
+        mDroppedFrames.fetch_add(bytes / (mChannels * mSampleSize), std::memory_order_relaxed);
+
+    mFreeBuffers.Push(index);
+    checkpointIfDue();
+}
+
+
+int32
+AudioFileSink::writerThreadC(void* cookie)
+{
+    return static_cast<AudioFileSink*>(cookie)->writerLoop();
+}
+
+
+int32
+AudioFileSink::writerLoop()
+{
+    while (true) {
+        // Read before looking at the queue, so quitting never leaves a
+        // buffer submitted ahead of it behind
+        const bool quit = mWriterQuit.load();
+        uint32 index;
+        if (mFullBuffers.Pop(index)) {
+            writeBuffer(index);
+            continue;
+        }
+        if (quit)
+            break;
+
+        // Same handshake as AudioCapture::Read(), the realtime side only
+        // signals a waiting writer
+        mWriterWaiting.store(true);
+        if (mFullBuffers.Count() > 0 || mWriterQuit.load()) {
+            mWriterWaiting.store(false);
+            continue;
+        }
+        // Wakes up for the next checkpoint too, the capture may have paused
+        // with data written since the last one
+        acquire_sem_etc(mWriterSem, 1, B_ABSOLUTE_TIMEOUT,
+            mLastCheckpoint + mCheckpointInterval / 2);
+        mWriterWaiting.store(false);
+        checkpointIfDue();
+    }
+    return B_OK;
+}
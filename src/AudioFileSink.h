@@ -0,0 +1,162 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef AUDIO_FILE_SINK_H
+#define AUDIO_FILE_SINK_H
+
+#include "AudioCapture.h"
+
+#include <atomic>
+
+static const size_t kAudioFileDefaultBufferSize = 1024 * 1024;
+static const uint32 kAudioFileDefaultBufferCount = 3;
+
+// Streams interleaved float frames into a WAV file. The realtime side only
+// converts into one of a few preallocated, page aligned buffers; a writer
+// thread takes full buffers and writes each with one large aligned write, or
+// copies it into a mapped window of the file, so neither memory use nor the
+// capture ever depends on the disk. At every checkpoint the data is synced to
+// disk before the header is rewritten to include it. A buffer goes to the
+// writer half a checkpoint interval after it took its first frames at the
+// latest, full or not, and the writer checkpoints every half interval, so a
+// crash loses at most one interval. Recordings that outgrow 4 GB turn into
+// RF64 in place.
+class AudioFileSink {
+public:
+    AudioFileSink();
+    ~AudioFileSink();
+
+    // Creates path and starts the writer. format is the sample format in the
+    // file: SAMPLE_FLOAT, SAMPLE_INT16 or SAMPLE_INT32. bufferSize is rounded
+    // up to whole pages, bufferCount buffers of it bound the memory used and
+    // how long the disk may stall before frames are dropped.
+    status_t Open(const char* path, uint32 channelCount, float sampleRate,
+        SampleType format = SAMPLE_FLOAT, size_t bufferSize = kAudioFileDefaultBufferSize,
+        uint32 bufferCount = kAudioFileDefaultBufferCount);
+    // Writes out what is buffered, finalizes the header and closes the file.
+    // Whatever calls Write() has to be stopped first. Returns the first
+    // write error, if any.
+    status_t Close();
+    bool IsOpen() const { return mFile >= 0; }
+
+    // TPDF dither when quantizing to int16, off by default. Returns B_BUSY
+    // while open.
+    status_t SetDither(bool enabled);
+    // Grows the file with posix_fallocate() in extents of extentSize bytes
+    // ahead of the data, so long recordings neither fragment nor run out of
+    // space mid-write. The file is cut to its data at Close(). 0, the
+    // default, extends it with every write. Returns B_BUSY while open.
+    status_t SetPreallocation(off_t extentSize);
+    // Copies the data into mmap()ed windows of windowSize bytes instead of
+    // calling pwrite() for every buffer. A window is hinted sequential when
+    // it is mapped and released with an asynchronous sync and DONTNEED once
+    // it is full. The file is grown in extents of at least one window. 0,
+    // the default, writes with pwrite(). Returns B_BUSY while open.
+    status_t SetMappedWrites(size_t windowSize);
+    // The most a crash may lose, one second by default. Data is synced and
+    // the header updated every half interval. Returns B_BUSY while open.
+    status_t SetCheckpointInterval(bigtime_t interval);
+    // Speaker positions in B_CHANNEL_* bits, which match the WAVE
+    // dwChannelMask, written for files with more than two channels or int32
+    // samples. Those use WAVE_FORMAT_EXTENSIBLE, others a plain fmt chunk.
+    // 0, the default, takes the first positions in order: 5.1 for six
+    // channels. Returns B_BUSY while open.
+    status_t SetChannelMask(uint32 channelMask);
+
+    // Adds the sink to capture at the sink's rate, in the mono, stereo or
+    // native layout matching its channel count. Returns the id from
+    // AudioCapture::AddSink(), or an error.
+    int32 AttachTo(AudioCapture& capture);
+
+    // Realtime side, from a single thread: converts frameCount frames of the
+    // sink's channel count into the current buffer. Never blocks, allocates
+    // or touches the file. Frames that find no free buffer are dropped and
+    // counted. Returns the frames taken.
+    size_t Write(const float* frames, size_t frameCount);
+    // AudioCallbackFunc forwarding to Write(), userData is the sink
+    static void WriteCallback(const float* data, size_t frameCount, uint32 channelCount,
+        void* userData);
+
+    uint32 ChannelCount() const { return mChannels; }
+    float SampleRate() const { return mSampleRate; }
+    // Frames taken by Write() since Open()
+    uint64 FrameCount() const { return mFrames.load(std::memory_order_relaxed); }
+    uint64 DroppedFrameCount() const { return mDroppedFrames.load(std::memory_order_relaxed); }
+    bool IsRF64() const { return mRF64; }
+    // B_OK, or the first error the writer ran into
+    status_t Status() const { return mStatus.load(std::memory_order_relaxed); }
+
+    AudioFileSink(const AudioFileSink&) = delete;
+    AudioFileSink& operator=(const AudioFileSink&) = delete;
+
+private:
+    void buildHeader();
+    void patchHeader();
+    void checkpoint();
+    void checkpointIfDue();
+    void setError(status_t status, const char* what);
+    void submitBuffer();
+    status_t reserve(off_t end);
+    status_t mapWindow(off_t offset);
+    void unmapWindow(bool sync);
+    status_t writeDirect(const uint8* data, size_t bytes);
+    status_t writeMapped(const uint8* data, size_t bytes);
+    void writeBuffer(uint32 index);
+    void cleanup();
+    int32 writerLoop();
+
+    static int32 writerThreadC(void* cookie);
+
+    int               mFile;
+    off_t             mExtentSize;
+    size_t            mWindowSize;
+    bigtime_t         mCheckpointInterval;
+    uint32            mChannels;
+    float             mSampleRate;
+    SampleType        mFormat;
+    uint32            mChannelMask;
+    size_t            mSampleSize;
+    bool              mDither;
+    QuantizeFunc      mQuantizer;
+    DitherState       mDitherState;
+
+    // Page aligned, mBufferCount of mBufferSize bytes each
+    uint8**           mBuffers;
+    size_t*           mBufferFill;
+    size_t            mBufferSize;
+    uint32            mBufferCount;
+    // Buffers ready to fill and buffers ready to write, each with a single
+    // producer: the writer and the realtime side
+    AudioBlockQueue   mFreeBuffers;
+    AudioBlockQueue   mFullBuffers;
+    // Realtime side: buffer being filled, -1 if none, its bytes so far and
+    // when it took the first ones
+    int32             mCurrent;
+    size_t            mCurrentFill;
+    bigtime_t         mCurrentStarted;
+
+    // Writer side
+    uint8*            mHeader;
+    uint64            mDataBytes;
+    // Bytes allocated for the file, only tracked with extents
+    off_t             mFileSize;
+    uint8*            mWindow;
+    off_t             mWindowOffset;
+    bigtime_t         mLastCheckpoint;
+    // mDataBytes at the last checkpoint
+    uint64            mCheckpointBytes;
+    bool              mRF64;
+
+    thread_id         mWriterThread;
+    sem_id            mWriterSem;
+    std::atomic<bool> mWriterWaiting;
+    std::atomic<bool> mWriterQuit;
+
+    std::atomic<uint64> mFrames;
+    std::atomic<uint64> mDroppedFrames;
+    std::atomic<status_t> mStatus;
+};
+
+#endif // AUDIO_FILE_SINK_H
@@ -0,0 +1,950 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "AudioFlac.h"
+#include "AudioSimd.h"
+
+static const uint32_t kMaxRiceParameter = 14;
+static const uint32_t kMaxExtendedRiceParameter = 30;
+static const int kMaxShift = 15;
+// LPC residuals beyond this are left to the fixed predictors, folded for Rice
+// coding they have to stay within 32 bits
+static const int64_t kMaxResidual = INT64_C(1) << 30;
+// Sync code and fixed block size strategy
+static const uint32_t kFrameSync = 0xfff8;
+
+enum {
+    SUBFRAME_CONSTANT = 0,
+    SUBFRAME_VERBATIM = 1,
+    SUBFRAME_FIXED = 8,
+    SUBFRAME_LPC = 32
+};
+
+enum {
+    CHANNELS_LEFT_SIDE = 8,
+    CHANNELS_RIGHT_SIDE = 9,
+    CHANNELS_MID_SIDE = 10
+};
+
+// Rates with a code of their own, indexed by it
+static const uint32_t kSampleRates[] = {
+    0, 88200, 176400, 192000, 8000, 16000, 22050, 24000, 32000, 44100, 48000, 96000
+};
+
+
+struct CRCTables {
+    uint8_t           crc8[256];
+    uint16_t          crc16[256];
+
+    // CRC-8 with polynomial 0x07 for frame headers, CRC-16 with 0x8005 for
+    // whole frames, both MSB first
+    CRCTables()
+    {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c8 = i;
+            uint32_t c16 = i << 8;
+            for (int bit = 0; bit < 8; bit++) {
+                c8 = (c8 & 0x80) != 0 ? (c8 << 1) ^ 0x07 : c8 << 1;
+                c16 = (c16 & 0x8000) != 0 ? (c16 << 1) ^ 0x8005 : c16 << 1;
+            }
+            crc8[i] = c8 & 0xff;
+            crc16[i] = c16 & 0xffff;
+        }
+    }
+};
+
+static const CRCTables sCRCTables;
+
+
+static uint8_t
+crc8(const uint8_t* data, size_t count)
+{
+    uint8_t crc = 0;
+    for (size_t i = 0; i < count; i++)
+        crc = sCRCTables.crc8[crc ^ data[i]];
+    return crc;
+}
+
+
+static uint16_t
+crc16(const uint8_t* data, size_t count)
+{
+    uint16_t crc = 0;
+    for (size_t i = 0; i < count; i++)
+        crc = (crc << 8) ^ sCRCTables.crc16[(crc >> 8) ^ data[i]];
+    return crc;
+}
+
+
+static inline void
+putBE(uint8_t* p, uint64_t value, size_t bytes)
+{
+    for (size_t i = bytes; i-- > 0; value >>= 8)
+        p[i] = value & 0xff;
+}
+
+
+// Signed residuals interleaved into unsigned: 0, -1, 1, -2, ...
+static inline uint32_t
+fold(int32_t value)
+{
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+
+// MSB first into a fixed buffer. Running past its end only sets overflow,
+// the bit count stays right so the caller can still compare and rewind.
+struct FlacFrameEncoder::BitWriter {
+    uint8_t*          data;
+    size_t            capacity;
+    size_t            bytes;
+    uint64_t          cache;
+    uint32_t          cacheBits;
+    bool              overflow;
+
+    BitWriter(uint8_t* buffer, size_t size)
+        : data(buffer), capacity(size), bytes(0), cache(0), cacheBits(0), overflow(false)
+    {
+    }
+
+    uint64_t BitCount() const { return bytes * 8 + cacheBits; }
+
+    // bits up to 32, value has to fit them
+    void Write(uint32_t value, uint32_t bits)
+    {
+        if (overflow)
+            return;
+        cache = (cache << bits) | value;
+        cacheBits += bits;
+        while (cacheBits >= 8) {
+            cacheBits -= 8;
+            if (bytes < capacity)
+                data[bytes] = static_cast<uint8_t>(cache >> cacheBits);
+            else
+                overflow = true;
+            bytes++;
+        }
+    }
+
+    void WriteSigned(int32_t value, uint32_t bits)
+    {
+        Write(static_cast<uint32_t>(value) & static_cast<uint32_t>((UINT64_C(1) << bits) - 1), bits);
+    }
+
+    void WriteZeros(uint64_t count)
+    {
+        if (count / 8 > capacity - (bytes < capacity ? bytes : capacity)) {
+            overflow = true;
+            return;
+        }
+        for (; count >= 32 && !overflow; count -= 32)
+            Write(0, 32);
+        Write(0, static_cast<uint32_t>(count));
+    }
+
+    // Quotient in unary, terminated by a one, then parameter low bits
+    void WriteRice(uint32_t value, uint32_t parameter)
+    {
+        WriteZeros(value >> parameter);
+        Write((1u << parameter) | (value & ((1u << parameter) - 1)), parameter + 1);
+    }
+
+    // Up to 31 bits in the UTF-8 like code of frame numbers
+    void WriteUTF8(uint32_t value)
+    {
+        if (value < 0x80) {
+            Write(value, 8);
+            return;
+        }
+        const uint32_t count = value < 0x800 ? 2 : value < 0x10000 ? 3
+            : value < 0x200000 ? 4 : value < 0x4000000 ? 5 : 6;
+        // count ones and a zero, then the top bits
+        Write(((0xff00 >> count) & 0xff) | (value >> (6 * (count - 1))), 8);
+        for (uint32_t i = count - 1; i-- > 0;)
+            Write(0x80 | ((value >> (6 * i)) & 0x3f), 8);
+    }
+
+    void Align()
+    {
+        if (cacheBits > 0)
+            Write(0, 8 - cacheBits);
+    }
+};
+
+
+static uint32_t
+blockSizeCode(size_t frameCount)
+{
+    if (frameCount == 192)
+        return 1;
+    for (uint32_t code = 2; code <= 5; code++) {
+        if (frameCount == static_cast<size_t>(576) << (code - 2))
+            return code;
+    }
+    for (uint32_t code = 8; code <= 15; code++) {
+        if (frameCount == static_cast<size_t>(256) << (code - 8))
+            return code;
+    }
+    // Stored after the frame number, 8 or 16 bits
+    return frameCount <= 256 ? 6 : 7;
+}
+
+
+static uint32_t
+sampleRateCode(uint32_t sampleRate)
+{
+    for (uint32_t code = 1; code < sizeof(kSampleRates) / sizeof(kSampleRates[0]); code++) {
+        if (sampleRate == kSampleRates[code])
+            return code;
+    }
+    // Stored after the block size: kHz, Hz or tens of Hz. 0 leaves it to
+    // STREAMINFO, which takes the stream out of the subset.
+    if (sampleRate % 1000 == 0 && sampleRate / 1000 <= 0xff)
+        return 12;
+    if (sampleRate <= 0xffff)
+        return 13;
+    if (sampleRate % 10 == 0 && sampleRate / 10 <= 0xffff)
+        return 14;
+    return 0;
+}
+
+
+static uint32_t
+sampleSizeCode(uint32_t bitsPerSample)
+{
+    switch (bitsPerSample) {
+        case 8:  return 1;
+        case 12: return 2;
+        case 16: return 4;
+        case 20: return 5;
+        case 24: return 6;
+        default: return 0;
+    }
+}
+
+
+// Quantized LPC coefficients for blocks up to these sizes, more pays off the
+// more samples share them
+static uint32_t
+coefficientPrecision(size_t blockSize, uint32_t bitsPerSample)
+{
+    uint32_t precision;
+    if (blockSize <= 192)
+        precision = 7;
+    else if (blockSize <= 384)
+        precision = 8;
+    else if (blockSize <= 576)
+        precision = 9;
+    else if (blockSize <= 1152)
+        precision = 10;
+    else if (blockSize <= 2304)
+        precision = 11;
+    else if (blockSize <= 4608)
+        precision = 12;
+    else
+        precision = 13;
+
+    if (bitsPerSample < 16) {
+        const uint32_t limit = 2 + bitsPerSample / 2 > 5 ? 2 + bitsPerSample / 2 : 5;
+        precision = precision < limit ? precision : limit;
+    }
+    return precision;
+}
+
+
+// Tukey window tapering a quarter of the block on either end
+static void
+tukeyWindow(float* window, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        window[i] = 1.0f;
+
+    const size_t taper = count / 4;
+    for (size_t i = 0; taper > 1 && i < taper; i++) {
+        const float w = static_cast<float>(0.5 - 0.5 * cos(M_PI * i / taper));
+        window[i] = w;
+        window[count - 1 - i] = w;
+    }
+}
+
+
+// Sums the absolute residuals of the fixed predictors of order 0 to 4 and
+// returns the smallest, its order goes to order
+static uint64_t
+bestFixedOrder(const int32_t* signal, size_t count, uint32_t& order)
+{
+    uint64_t sums[5] = {};
+    if (count <= 4) {
+        for (size_t i = 0; i < count; i++)
+            sums[0] += llabs(signal[i]);
+        order = 0;
+        return sums[0];
+    }
+
+    for (size_t i = 4; i < count; i++) {
+        const int64_t x0 = signal[i];
+        const int64_t x1 = signal[i - 1];
+        const int64_t x2 = signal[i - 2];
+        const int64_t x3 = signal[i - 3];
+        const int64_t x4 = signal[i - 4];
+        sums[0] += llabs(x0);
+        sums[1] += llabs(x0 - x1);
+        sums[2] += llabs(x0 - 2 * x1 + x2);
+        sums[3] += llabs(x0 - 3 * x1 + 3 * x2 - x3);
+        sums[4] += llabs(x0 - 4 * x1 + 6 * x2 - 4 * x3 + x4);
+    }
+
+    order = 0;
+    for (uint32_t o = 1; o < 5; o++) {
+        if (sums[o] < sums[order])
+            order = o;
+    }
+    return sums[order];
+}
+
+
+// Residual of the best fixed predictor, from sample order on
+static void
+fixedResidual(int32_t* residual, const int32_t* signal, size_t count, uint32_t& order)
+{
+    bestFixedOrder(signal, count, order);
+    for (size_t i = order; i < count; i++) {
+        const int32_t* x = signal + i;
+        int32_t r;
+        switch (order) {
+            case 0:  r = x[0]; break;
+            case 1:  r = x[0] - x[-1]; break;
+            case 2:  r = x[0] - 2 * x[-1] + x[-2]; break;
+            case 3:  r = x[0] - 3 * x[-1] + 3 * x[-2] - x[-3]; break;
+            default: r = x[0] - 4 * x[-1] + 6 * x[-2] - 4 * x[-3] + x[-4]; break;
+        }
+        residual[i - order] = r;
+    }
+}
+
+
+// Minimizes count * parameter + (sum >> parameter), what the quotients and
+// remainders of count folded residuals adding up to sum cost
+static uint32_t
+riceParameter(uint64_t sum, size_t count)
+{
+    uint32_t parameter = 0;
+    while (parameter < kMaxExtendedRiceParameter
+        && (static_cast<uint64_t>(count) << (parameter + 1)) < sum) {
+        parameter++;
+    }
+    return parameter;
+}
+
+
+// Bits a channel of bits wide samples would take, roughly: the residual of
+// its best fixed predictor Rice coded with a single parameter. Never more
+// than verbatim, which encodeSubframe() falls back to, or noise would pick
+// whichever channels it overrates least.
+static double
+estimateBits(const int32_t* signal, size_t count, uint32_t bits)
+{
+    uint32_t order;
+    // Folding doubles the magnitudes
+    const uint64_t sum = 2 * bestFixedOrder(signal, count, order);
+    const uint32_t parameter = riceParameter(sum, count);
+    const double estimate = static_cast<double>(count) * (parameter + 1) + (sum >> parameter);
+    const double verbatim = static_cast<double>(count) * bits;
+    return estimate < verbatim ? estimate : verbatim;
+}
+
+
+void
+flacStreamHeader(uint8_t* header, uint32_t channels, uint32_t bitsPerSample, uint32_t sampleRate,
+    uint32_t blockSize, uint32_t minFrameBytes, uint32_t maxFrameBytes, uint64_t totalFrames)
+{
+    memcpy(header, "fLaC", 4);
+    // Last metadata block, type STREAMINFO, 34 bytes
+    header[4] = 0x80;
+    putBE(header + 5, 34, 3);
+
+    uint8_t* info = header + 8;
+    putBE(info, blockSize, 2);
+    putBE(info + 2, blockSize, 2);
+    putBE(info + 4, minFrameBytes, 3);
+    putBE(info + 7, maxFrameBytes, 3);
+    putBE(info + 10, static_cast<uint64_t>(sampleRate) << 44
+        | static_cast<uint64_t>(channels - 1) << 41
+        | static_cast<uint64_t>(bitsPerSample - 1) << 36
+        | (totalFrames & UINT64_C(0xfffffffff)), 8);
+    // An all zero MD5 signature stands for none
+    memset(info + 18, 0, 16);
+}
+
+
+// #pragma mark - Autocorrelation
+
+
+static void
+autocorrelationScalar(double* autocorrelation, const float* data, size_t count,
+    uint32_t lagCount)
+{
+    for (uint32_t lag = 0; lag < lagCount; lag++) {
+        double sum = 0.0;
+        for (size_t i = lag; i < count; i++)
+            sum += static_cast<double>(data[i]) * data[i - lag];
+        autocorrelation[lag] = sum;
+    }
+}
+
+
+// The products are exact in double and 24 bit samples summed over a block
+// would lose bits in float, so the vector kernels widen before multiplying
+
+
+#ifdef AUDIO_SIMD_SSE2
+
+TARGET_SSE2 static void
+autocorrelationSSE2(double* autocorrelation, const float* data, size_t count,
+    uint32_t lagCount)
+{
+    for (uint32_t lag = 0; lag < lagCount; lag++) {
+        __m128d sum0 = _mm_setzero_pd();
+        __m128d sum1 = _mm_setzero_pd();
+        size_t i = lag;
+        for (; i + 4 <= count; i += 4) {
+            const __m128 x = _mm_loadu_ps(data + i);
+            const __m128 y = _mm_loadu_ps(data + i - lag);
+            sum0 = _mm_add_pd(sum0, _mm_mul_pd(_mm_cvtps_pd(x), _mm_cvtps_pd(y)));
+            sum1 = _mm_add_pd(sum1, _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(x, x)),
+                _mm_cvtps_pd(_mm_movehl_ps(y, y))));
+        }
+
+        double lanes[2];
+        _mm_storeu_pd(lanes, _mm_add_pd(sum0, sum1));
+        double sum = lanes[0] + lanes[1];
+        for (; i < count; i++)
+            sum += static_cast<double>(data[i]) * data[i - lag];
+        autocorrelation[lag] = sum;
+    }
+}
+
+#endif // AUDIO_SIMD_SSE2
+
+
+#ifdef AUDIO_SIMD_AVX2
+
+TARGET_AVX2 static void
+autocorrelationAVX2(double* autocorrelation, const float* data, size_t count,
+    uint32_t lagCount)
+{
+    for (uint32_t lag = 0; lag < lagCount; lag++) {
+        __m256d sum0 = _mm256_setzero_pd();
+        __m256d sum1 = _mm256_setzero_pd();
+        size_t i = lag;
+        for (; i + 8 <= count; i += 8) {
+            const __m256d x0 = _mm256_cvtps_pd(_mm_loadu_ps(data + i));
+            const __m256d x1 = _mm256_cvtps_pd(_mm_loadu_ps(data + i + 4));
+            const __m256d y0 = _mm256_cvtps_pd(_mm_loadu_ps(data + i - lag));
+            const __m256d y1 = _mm256_cvtps_pd(_mm_loadu_ps(data + i + 4 - lag));
+            sum0 = _mm256_add_pd(sum0, _mm256_mul_pd(x0, y0));
+            sum1 = _mm256_add_pd(sum1, _mm256_mul_pd(x1, y1));
+        }
+
+        const __m256d sum = _mm256_add_pd(sum0, sum1);
+        double lanes[2];
+        _mm_storeu_pd(lanes, _mm_add_pd(_mm256_castpd256_pd128(sum),
+            _mm256_extractf128_pd(sum, 1)));
+        double total = lanes[0] + lanes[1];
+        for (; i < count; i++)
+            total += static_cast<double>(data[i]) * data[i - lag];
+        autocorrelation[lag] = total;
+    }
+}
+
+#endif // AUDIO_SIMD_AVX2
+
+
+// Doubles in vectors need AArch64
+#if defined(AUDIO_SIMD_NEON) && defined(__aarch64__)
+#define AUDIO_FLAC_NEON 1
+
+static void
+autocorrelationNEON(double* autocorrelation, const float* data, size_t count,
+    uint32_t lagCount)
+{
+    for (uint32_t lag = 0; lag < lagCount; lag++) {
+        float64x2_t sum0 = vdupq_n_f64(0.0);
+        float64x2_t sum1 = vdupq_n_f64(0.0);
+        size_t i = lag;
+        for (; i + 4 <= count; i += 4) {
+            const float32x4_t x = vld1q_f32(data + i);
+            const float32x4_t y = vld1q_f32(data + i - lag);
+            sum0 = vfmaq_f64(sum0, vcvt_f64_f32(vget_low_f32(x)), vcvt_f64_f32(vget_low_f32(y)));
+            sum1 = vfmaq_f64(sum1, vcvt_high_f64_f32(x), vcvt_high_f64_f32(y));
+        }
+
+        double sum = vaddvq_f64(vaddq_f64(sum0, sum1));
+        for (; i < count; i++)
+            sum += static_cast<double>(data[i]) * data[i - lag];
+        autocorrelation[lag] = sum;
+    }
+}
+
+#endif // AUDIO_FLAC_NEON
+
+
+FlacAutocorrelationFunc
+getFlacAutocorrelation(SampleKernelISA isa)
+{
+    if (isa == SAMPLE_KERNEL_AUTO)
+        isa = bestSampleKernelISA();
+    else if (!isSampleKernelISASupported(isa))
+        return NULL;
+
+    switch (isa) {
+#ifdef AUDIO_SIMD_AVX2
+        case SAMPLE_KERNEL_AVX2: return autocorrelationAVX2;
+#endif
+#ifdef AUDIO_SIMD_SSE2
+        case SAMPLE_KERNEL_SSE2: return autocorrelationSSE2;
+#endif
+#ifdef AUDIO_FLAC_NEON
+        case SAMPLE_KERNEL_NEON: return autocorrelationNEON;
+#endif
+        default:                 return autocorrelationScalar;
+    }
+}
+
+
+// #pragma mark - FlacFrameEncoder
+
+
+FlacFrameEncoder::FlacFrameEncoder()
+    : mChannels(0),
+      mBits(0),
+      mSampleRate(0),
+      mBlockSize(0),
+      mMaxLPCOrder(0),
+      mPrecision(0),
+      mMaxFrameSize(0),
+      mAutocorrelation(NULL),
+      mSignal(NULL),
+      mFixedResidual(NULL),
+      mLPCResidual(NULL),
+      mWindow(NULL),
+      mWindowed(NULL),
+      mWindowFrames(0),
+      mPartitionSums(NULL)
+{
+}
+
+
+FlacFrameEncoder::~FlacFrameEncoder()
+{
+    free(mSignal);
+    free(mFixedResidual);
+    free(mLPCResidual);
+    free(mWindow);
+    free(mWindowed);
+    free(mPartitionSums);
+}
+
+
+bool
+FlacFrameEncoder::Init(uint32_t channels, uint32_t bitsPerSample, uint32_t sampleRate,
+    size_t blockSize, uint32_t maxLPCOrder)
+{
+    free(mSignal);
+    free(mFixedResidual);
+    free(mLPCResidual);
+    free(mWindow);
+    free(mWindowed);
+    free(mPartitionSums);
+    mSignal = NULL;
+    mFixedResidual = NULL;
+    mLPCResidual = NULL;
+    mWindow = NULL;
+    mWindowed = NULL;
+    mPartitionSums = NULL;
+    mWindowFrames = 0;
+
+    if (channels == 0 || channels > kFlacMaxChannels || bitsPerSample < 4 || bitsPerSample > 24
+        || sampleRate == 0 || sampleRate >= (1 << 20) || blockSize < kFlacMinBlockSize
+        || blockSize > kFlacMaxBlockSize || maxLPCOrder > kFlacMaxLPCOrder) {
+        return false;
+    }
+
+    // Mid and side need a block each
+    const size_t signals = channels == 2 ? 4 : channels;
+    mSignal = static_cast<int32_t*>(malloc(signals * blockSize * sizeof(int32_t)));
+    mFixedResidual = static_cast<int32_t*>(malloc(blockSize * sizeof(int32_t)));
+    mLPCResidual = static_cast<int32_t*>(malloc(blockSize * sizeof(int32_t)));
+    mWindow = static_cast<float*>(malloc(blockSize * sizeof(float)));
+    mWindowed = static_cast<float*>(malloc(blockSize * sizeof(float)));
+    mPartitionSums = static_cast<uint64_t*>(malloc(sizeof(uint64_t) << kFlacMaxPartitionOrder));
+    mAutocorrelation = getFlacAutocorrelation();
+    if (mSignal == NULL || mFixedResidual == NULL || mLPCResidual == NULL || mWindow == NULL
+        || mWindowed == NULL || mPartitionSums == NULL) {
+        free(mSignal);
+        mSignal = NULL;
+        return false;
+    }
+
+    mChannels = channels;
+    mBits = bitsPerSample;
+    mSampleRate = sampleRate;
+    mBlockSize = blockSize;
+    mMaxLPCOrder = maxLPCOrder;
+    mPrecision = coefficientPrecision(blockSize, bitsPerSample);
+
+    // No subframe is written larger than verbatim, a side channel takes a
+    // bit more per sample. The header is 16 bytes at most, the CRC 2.
+    const uint64_t subframeBits = channels * (8 + static_cast<uint64_t>(blockSize) * (bitsPerSample + 1));
+    mMaxFrameSize = 16 + (subframeBits + 7) / 8 + 2;
+    return true;
+}
+
+
+size_t
+FlacFrameEncoder::Encode(uint8_t* output, const int32_t* samples, size_t frameCount,
+    uint32_t frameNumber)
+{
+    if (mSignal == NULL || frameCount == 0 || frameCount > mBlockSize)
+        return 0;
+
+    for (uint32_t c = 0; c < mChannels; c++) {
+        int32_t* signal = mSignal + c * mBlockSize;
+        for (size_t f = 0; f < frameCount; f++)
+            signal[f] = samples[f * mChannels + c];
+    }
+    const uint32_t assignment = mChannels == 2 ? chooseStereo(frameCount) : mChannels - 1;
+
+    BitWriter writer(output, mMaxFrameSize);
+    const uint32_t blockCode = blockSizeCode(frameCount);
+    const uint32_t rateCode = sampleRateCode(mSampleRate);
+    writer.Write(kFrameSync, 16);
+    writer.Write(blockCode, 4);
+    writer.Write(rateCode, 4);
+    writer.Write(assignment, 4);
+    writer.Write(sampleSizeCode(mBits), 3);
+    writer.Write(0, 1);
+    writer.WriteUTF8(frameNumber);
+    if (blockCode == 6)
+        writer.Write(frameCount - 1, 8);
+    else if (blockCode == 7)
+        writer.Write(frameCount - 1, 16);
+    if (rateCode == 12)
+        writer.Write(mSampleRate / 1000, 8);
+    else if (rateCode == 13)
+        writer.Write(mSampleRate, 16);
+    else if (rateCode == 14)
+        writer.Write(mSampleRate / 10, 16);
+    // Every field so far is whole bytes
+    writer.Write(crc8(output, writer.bytes), 8);
+
+    const int32_t* left = mSignal;
+    const int32_t* right = mSignal + mBlockSize;
+    const int32_t* mid = mSignal + 2 * mBlockSize;
+    const int32_t* side = mSignal + 3 * mBlockSize;
+    switch (assignment) {
+        case CHANNELS_LEFT_SIDE:
+            encodeSubframe(writer, left, frameCount, mBits);
+            encodeSubframe(writer, side, frameCount, mBits + 1);
+            break;
+        case CHANNELS_RIGHT_SIDE:
+            encodeSubframe(writer, side, frameCount, mBits + 1);
+            encodeSubframe(writer, right, frameCount, mBits);
+            break;
+        case CHANNELS_MID_SIDE:
+            encodeSubframe(writer, mid, frameCount, mBits);
+            encodeSubframe(writer, side, frameCount, mBits + 1);
+            break;
+        default:
+            for (uint32_t c = 0; c < mChannels; c++)
+                encodeSubframe(writer, mSignal + c * mBlockSize, frameCount, mBits);
+            break;
+    }
+
+    writer.Align();
+    writer.Write(crc16(output, writer.bytes), 16);
+    return writer.bytes;
+}
+
+
+// Fills in mid and side and returns the cheapest channel assignment
+uint32_t
+FlacFrameEncoder::chooseStereo(size_t count)
+{
+    const int32_t* left = mSignal;
+    const int32_t* right = mSignal + mBlockSize;
+    int32_t* mid = mSignal + 2 * mBlockSize;
+    int32_t* side = mSignal + 3 * mBlockSize;
+    for (size_t i = 0; i < count; i++) {
+        mid[i] = (left[i] + right[i]) >> 1;
+        side[i] = left[i] - right[i];
+    }
+
+    // The side channel is one bit wider
+    const double leftBits = estimateBits(left, count, mBits);
+    const double rightBits = estimateBits(right, count, mBits);
+    const double midBits = estimateBits(mid, count, mBits);
+    const double sideBits = estimateBits(side, count, mBits + 1);
+
+    uint32_t assignment = 1;
+    double best = leftBits + rightBits;
+    if (leftBits + sideBits < best) {
+        assignment = CHANNELS_LEFT_SIDE;
+        best = leftBits + sideBits;
+    }
+    if (rightBits + sideBits < best) {
+        assignment = CHANNELS_RIGHT_SIDE;
+        best = rightBits + sideBits;
+    }
+    if (midBits + sideBits < best)
+        assignment = CHANNELS_MID_SIDE;
+    return assignment;
+}
+
+
+void
+FlacFrameEncoder::encodeSubframe(BitWriter& writer, const int32_t* signal, size_t count,
+    uint32_t bits)
+{
+    bool constant = true;
+    for (size_t i = 1; i < count && constant; i++)
+        constant = signal[i] == signal[0];
+    if (constant) {
+        writer.Write(SUBFRAME_CONSTANT << 1, 8);
+        writer.WriteSigned(signal[0], bits);
+        return;
+    }
+
+    const uint64_t verbatimBits = 8 + static_cast<uint64_t>(count) * bits;
+
+    uint32_t fixedOrder;
+    fixedResidual(mFixedResidual, signal, count, fixedOrder);
+    chooseRiceCoding(mFixedCoding, mFixedResidual, count, fixedOrder);
+    const uint64_t fixedBits = 8 + fixedOrder * bits + mFixedCoding.bits;
+
+    uint32_t lpcOrder = 0;
+    int32_t coefficients[kFlacMaxLPCOrder];
+    int shift = 0;
+    uint64_t lpcBits = UINT64_MAX;
+    if (mMaxLPCOrder > 0
+        && lpcResidual(mLPCResidual, signal, count, bits, lpcOrder, coefficients, shift)) {
+        chooseRiceCoding(mLPCCoding, mLPCResidual, count, lpcOrder);
+        lpcBits = 8 + lpcOrder * (bits + mPrecision) + 4 + 5 + mLPCCoding.bits;
+    }
+
+    const BitWriter start = writer;
+    if (lpcBits < fixedBits && lpcBits < verbatimBits) {
+        writer.Write((SUBFRAME_LPC | (lpcOrder - 1)) << 1, 8);
+        for (uint32_t i = 0; i < lpcOrder; i++)
+            writer.WriteSigned(signal[i], bits);
+        writer.Write(mPrecision - 1, 4);
+        writer.WriteSigned(shift, 5);
+        for (uint32_t i = 0; i < lpcOrder; i++)
+            writer.WriteSigned(coefficients[i], mPrecision);
+        writeResidual(writer, mLPCCoding, mLPCResidual, count, lpcOrder);
+    } else if (fixedBits < verbatimBits) {
+        writer.Write((SUBFRAME_FIXED | fixedOrder) << 1, 8);
+        for (uint32_t i = 0; i < fixedOrder; i++)
+            writer.WriteSigned(signal[i], bits);
+        writeResidual(writer, mFixedCoding, mFixedResidual, count, fixedOrder);
+    }
+
+    // The costs are estimates, verbatim is the upper bound
+    if (writer.BitCount() == start.BitCount()
+        || writer.overflow || writer.BitCount() - start.BitCount() > verbatimBits) {
+        writer = start;
+        writer.Write(SUBFRAME_VERBATIM << 1, 8);
+        for (size_t i = 0; i < count; i++)
+            writer.WriteSigned(signal[i], bits);
+    }
+}
+
+
+// Picks the order by the expected residual bits of each order's prediction
+// error plus the warm-up samples and coefficients it stores, quantizes the
+// coefficients and computes the residual. Fails where the fixed predictors
+// have to do.
+bool
+FlacFrameEncoder::lpcResidual(int32_t* residual, const int32_t* signal, size_t count,
+    uint32_t bits, uint32_t& order, int32_t* coefficients, int& shift)
+{
+    const uint32_t maxOrder = mMaxLPCOrder < count ? mMaxLPCOrder : count - 1;
+    if (maxOrder == 0)
+        return false;
+
+    if (count != mWindowFrames) {
+        tukeyWindow(mWindow, count);
+        mWindowFrames = count;
+    }
+    for (size_t i = 0; i < count; i++)
+        mWindowed[i] = signal[i] * mWindow[i];
+
+    double autocorrelation[kFlacMaxLPCOrder + 1];
+    mAutocorrelation(autocorrelation, mWindowed, count, maxOrder + 1);
+    if (!(autocorrelation[0] > 0.0))
+        return false;
+
+    // Levinson-Durbin, keeping the predictor and error of every order
+    double lpc[kFlacMaxLPCOrder];
+    double predictors[kFlacMaxLPCOrder][kFlacMaxLPCOrder];
+    double errors[kFlacMaxLPCOrder];
+    double error = autocorrelation[0];
+    uint32_t orders = maxOrder;
+    for (uint32_t i = 0; i < maxOrder; i++) {
+        double reflection = -autocorrelation[i + 1];
+        for (uint32_t j = 0; j < i; j++)
+            reflection -= lpc[j] * autocorrelation[i - j];
+        reflection /= error;
+
+        lpc[i] = reflection;
+        uint32_t j = 0;
+        for (; j < i / 2; j++) {
+            const double tmp = lpc[j];
+            lpc[j] += reflection * lpc[i - 1 - j];
+            lpc[i - 1 - j] += reflection * tmp;
+        }
+        if (i & 1)
+            lpc[j] += lpc[j] * reflection;
+
+        error *= 1.0 - reflection * reflection;
+        for (j = 0; j <= i; j++)
+            predictors[i][j] = -lpc[j];
+        errors[i] = error;
+        if (!(error > 0.0)) {
+            orders = i + 1;
+            break;
+        }
+    }
+
+    const double errorScale = 0.5 / count;
+    double bestBits = HUGE_VAL;
+    for (uint32_t i = 0; i < orders; i++) {
+        double residualBits = errors[i] > 0.0 ? 0.5 * log2(errorScale * errors[i]) : 0.0;
+        if (residualBits < 0.0)
+            residualBits = 0.0;
+        const double totalBits = residualBits * (count - i - 1) + (i + 1) * (bits + mPrecision);
+        if (totalBits < bestBits) {
+            bestBits = totalBits;
+            order = i + 1;
+        }
+    }
+
+    // Coefficients get mPrecision bits with the sign, the largest uses them
+    // all. The rounding error carries over to the next one.
+    const double* predictor = predictors[order - 1];
+    double largest = 0.0;
+    for (uint32_t j = 0; j < order; j++)
+        largest = fabs(predictor[j]) > largest ? fabs(predictor[j]) : largest;
+    if (!(largest > 0.0) || !isfinite(largest))
+        return false;
+
+    int exponent;
+    frexp(largest, &exponent);
+    shift = static_cast<int>(mPrecision) - 1 - exponent;
+    if (shift > kMaxShift)
+        shift = kMaxShift;
+    else if (shift < 0)
+        return false;
+
+    const int32_t maxCoefficient = (1 << (mPrecision - 1)) - 1;
+    const int32_t minCoefficient = -(1 << (mPrecision - 1));
+    double carry = 0.0;
+    for (uint32_t j = 0; j < order; j++) {
+        carry += predictor[j] * (1 << shift);
+        long q = lround(carry);
+        q = q > maxCoefficient ? maxCoefficient : q < minCoefficient ? minCoefficient : q;
+        carry -= q;
+        coefficients[j] = q;
+    }
+
+    for (size_t i = order; i < count; i++) {
+        int64_t sum = 0;
+        for (uint32_t j = 0; j < order; j++)
+            sum += static_cast<int64_t>(coefficients[j]) * signal[i - 1 - j];
+        const int64_t r = signal[i] - (sum >> shift);
+        if (r > kMaxResidual || r < -kMaxResidual)
+            return false;
+        residual[i - order] = static_cast<int32_t>(r);
+    }
+    return true;
+}
+
+
+// Tries every partition order the block allows, from the finest down, each
+// partition with its own parameter. Sums of the folded residual are taken
+// once per finest partition and merged pairwise for the coarser orders.
+void
+FlacFrameEncoder::chooseRiceCoding(RiceCoding& coding, const int32_t* residual, size_t count,
+    uint32_t order)
+{
+    // The first partition loses the warm-up samples and must keep some
+    uint32_t maxOrder = 0;
+    while (maxOrder < kFlacMaxPartitionOrder && count % (static_cast<size_t>(2) << maxOrder) == 0
+        && (count >> (maxOrder + 1)) > order) {
+        maxOrder++;
+    }
+
+    uint64_t* sums = mPartitionSums;
+    const int32_t* r = residual;
+    for (size_t p = 0; p < (static_cast<size_t>(1) << maxOrder); p++) {
+        const size_t samples = (count >> maxOrder) - (p == 0 ? order : 0);
+        uint64_t sum = 0;
+        for (size_t i = 0; i < samples; i++)
+            sum += fold(r[i]);
+        r += samples;
+        sums[p] = sum;
+    }
+
+    coding.bits = UINT64_MAX;
+    uint8_t parameters[1 << kFlacMaxPartitionOrder];
+    for (int32_t level = maxOrder; level >= 0; level--) {
+        const size_t partitions = static_cast<size_t>(1) << level;
+        uint64_t bits = 0;
+        bool extended = false;
+        for (size_t p = 0; p < partitions; p++) {
+            const size_t samples = (count >> level) - (p == 0 ? order : 0);
+            const uint32_t parameter = riceParameter(sums[p], samples);
+            parameters[p] = parameter;
+            bits += samples * (parameter + 1) + (sums[p] >> parameter);
+            extended = extended || parameter > kMaxRiceParameter;
+        }
+        // Coding method and partition order, then the parameters
+        bits += 2 + 4 + partitions * (extended ? 5 : 4);
+
+        if (bits < coding.bits) {
+            coding.bits = bits;
+            coding.partitionOrder = level;
+            coding.extended = extended;
+            memcpy(coding.parameters, parameters, partitions);
+        }
+
+        for (size_t p = 0; p < partitions / 2; p++)
+            sums[p] = sums[2 * p] + sums[2 * p + 1];
+    }
+}
+
+
+void
+FlacFrameEncoder::writeResidual(BitWriter& writer, const RiceCoding& coding,
+    const int32_t* residual, size_t count, uint32_t order)
+{
+    const uint32_t parameterBits = coding.extended ? 5 : 4;
+    writer.Write(coding.extended ? 1 : 0, 2);
+    writer.Write(coding.partitionOrder, 4);
+
+    const size_t partitions = static_cast<size_t>(1) << coding.partitionOrder;
+    for (size_t p = 0; p < partitions && !writer.overflow; p++) {
+        const size_t samples = (count >> coding.partitionOrder) - (p == 0 ? order : 0);
+        const uint32_t parameter = coding.parameters[p];
+        writer.Write(parameter, parameterBits);
+        for (size_t i = 0; i < samples; i++)
+            writer.WriteRice(fold(residual[i]), parameter);
+        residual += samples;
+    }
+}
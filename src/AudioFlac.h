@@ -0,0 +1,118 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef AUDIO_FLAC_H
+#define AUDIO_FLAC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "AudioConvert.h"
+
+// FLAC encoding for AudioFlacSink. A frame is encoded from its own samples
+// only, so frames can be encoded on any thread in any order and written out
+// in sequence. No MediaKit dependency.
+//
+// Every channel becomes a constant, verbatim, fixed or LPC subframe,
+// whichever comes out smallest. LPC coefficients come from Levinson-Durbin on
+// the autocorrelation of the Tukey windowed signal, the residual is Rice
+// coded in up to 256 partitions. Stereo frames pick the cheapest of
+// left/right, left/side, right/side and mid/side. With the default LPC order
+// streams stay within the FLAC subset up to 48 kHz.
+
+static const uint32_t kFlacMaxChannels = 8;
+// Only the last block of a stream may be shorter
+static const size_t kFlacMinBlockSize = 16;
+static const size_t kFlacMaxBlockSize = 65535;
+static const uint32_t kFlacMaxLPCOrder = 32;
+static const uint32_t kFlacDefaultLPCOrder = 8;
+static const uint32_t kFlacMaxPartitionOrder = 8;
+// "fLaC" and the STREAMINFO block
+static const size_t kFlacStreamHeaderSize = 42;
+
+// Writes the stream header for frames of blockSize frames into header. 0 for
+// the frame sizes or totalFrames means unknown, the MD5 signature is left
+// out.
+void flacStreamHeader(uint8_t* header, uint32_t channels, uint32_t bitsPerSample,
+    uint32_t sampleRate, uint32_t blockSize, uint32_t minFrameBytes, uint32_t maxFrameBytes,
+    uint64_t totalFrames);
+
+// Sets autocorrelation[lag] to the sum of data[i] * data[i - lag] for lags
+// below lagCount, accumulated in double.
+typedef void (*FlacAutocorrelationFunc)(double* autocorrelation, const float* data,
+    size_t count, uint32_t lagCount);
+
+// Returns NULL if the requested ISA is not supported
+FlacAutocorrelationFunc getFlacAutocorrelation(SampleKernelISA isa = SAMPLE_KERNEL_AUTO);
+
+class FlacFrameEncoder {
+public:
+    FlacFrameEncoder();
+    ~FlacFrameEncoder();
+
+    // bitsPerSample from 4 to 24, blockSize from kFlacMinBlockSize to
+    // kFlacMaxBlockSize frames, maxLPCOrder up to kFlacMaxLPCOrder, 0 for
+    // fixed predictors only. Returns false for other values or if allocation
+    // fails.
+    bool Init(uint32_t channels, uint32_t bitsPerSample, uint32_t sampleRate, size_t blockSize,
+        uint32_t maxLPCOrder = kFlacDefaultLPCOrder);
+
+    // Output bytes Encode() needs at most
+    size_t MaxFrameSize() const { return mMaxFrameSize; }
+
+    // Encodes frameCount interleaved frames, at most the block size, as the
+    // frame with number frameNumber. Samples have to be in the range of
+    // bitsPerSample. Only the last frame of a stream may be shorter. Returns
+    // the bytes written to output. Doesn't allocate.
+    size_t Encode(uint8_t* output, const int32_t* samples, size_t frameCount,
+        uint32_t frameNumber);
+
+    FlacFrameEncoder(const FlacFrameEncoder&) = delete;
+    FlacFrameEncoder& operator=(const FlacFrameEncoder&) = delete;
+
+private:
+    struct BitWriter;
+
+    // How a residual is split into partitions and their Rice parameters
+    struct RiceCoding {
+        uint32_t          partitionOrder;
+        // 5 bit parameters, for more than 14
+        bool              extended;
+        uint64_t          bits;
+        uint8_t           parameters[1 << kFlacMaxPartitionOrder];
+    };
+
+    uint32_t chooseStereo(size_t count);
+    void encodeSubframe(BitWriter& writer, const int32_t* signal, size_t count, uint32_t bits);
+    bool lpcResidual(int32_t* residual, const int32_t* signal, size_t count, uint32_t bits,
+        uint32_t& order, int32_t* coefficients, int& shift);
+    void chooseRiceCoding(RiceCoding& coding, const int32_t* residual, size_t count,
+        uint32_t order);
+    void writeResidual(BitWriter& writer, const RiceCoding& coding, const int32_t* residual,
+        size_t count, uint32_t order);
+
+    uint32_t          mChannels;
+    uint32_t          mBits;
+    uint32_t          mSampleRate;
+    size_t            mBlockSize;
+    uint32_t          mMaxLPCOrder;
+    uint32_t          mPrecision;
+    size_t            mMaxFrameSize;
+    FlacAutocorrelationFunc mAutocorrelation;
+
+    // A block per channel, followed by mid and side for stereo
+    int32_t*          mSignal;
+    int32_t*          mFixedResidual;
+    int32_t*          mLPCResidual;
+    // Window for mWindowFrames frames and the windowed signal
+    float*            mWindow;
+    float*            mWindowed;
+    size_t            mWindowFrames;
+    uint64_t*         mPartitionSums;
+    RiceCoding        mFixedCoding;
+    RiceCoding        mLPCCoding;
+};
+
+#endif // AUDIO_FLAC_H
@@ -0,0 +1,550 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "AudioFlacSink.h"
+
+static const int32 kMaxInt24 = (1 << 23) - 1;
+
+
+AudioFlacSink::AudioFlacSink()
+    : mFile(-1),
+      mLPCOrder(kFlacDefaultLPCOrder),
+      mChannels(0),
+      mSampleRate(0.0f),
+      mBits(0),
+      mBlockSize(0),
+      mDither(false),
+      mQuantizer(NULL),
+      mBlocks(NULL),
+      mBlockCount(0),
+      mFillIndex(0),
+      mFillFrames(0),
+      mFrameNumber(0),
+      mEncoders(NULL),
+      mEncoderCount(0),
+      mEncoderSem(-1),
+      mIdleEncoders(0),
+      mEncoderQuit(false),
+      mWriteIndex(0),
+      mFileOffset(0),
+      mWrittenFrames(0),
+      mMinFrameBytes(0),
+      mMaxFrameBytes(0),
+      mWriterThread(-1),
+      mWriterSem(-1),
+      mWriterWaiting(false),
+      mWriterQuit(false),
+      mFrames(0),
+      mDroppedFrames(0),
+      mEncodedBytes(0),
+      mStatus(B_OK)
+{
+}
+
+
+AudioFlacSink::~AudioFlacSink()
+{
+    Close();
+}
+
+
+status_t
+AudioFlacSink::Open(const char* path, uint32 channelCount, float sampleRate, uint32 bitsPerSample,
+    size_t blockSize, uint32 blockCount, uint32 encoderCount)
+{
+    // FLAC stores whole Hz in 20 bits
+    const uint32 rate = sampleRate > 0.0f && sampleRate < (1 << 20)
+        ? static_cast<uint32>(lroundf(sampleRate)) : 0;
+    if (path == NULL || channelCount == 0 || channelCount > kFlacMaxChannels || rate == 0
+        || rate >= (1 << 20) || (bitsPerSample != 16 && bitsPerSample != 24)
+        || blockSize < kFlacMinBlockSize || blockSize > kFlacMaxBlockSize || blockCount < 2) {
+        return B_BAD_VALUE;
+    }
+
+    if (IsOpen())
+        return B_BUSY;
+
+    if (encoderCount == 0) {
+        system_info info;
+        encoderCount = get_system_info(&info) == B_OK && info.cpu_count > 0 ? info.cpu_count : 1;
+    }
+    // More would only wait for blocks
+    encoderCount = encoderCount < blockCount ? encoderCount : blockCount;
+
+    mChannels = channelCount;
+    mSampleRate = rate;
+    mBits = bitsPerSample;
+    mBlockSize = blockSize;
+    mQuantizer = getQuantizer(bitsPerSample == 16 ? SAMPLE_INT16 : SAMPLE_INT32);
+
+    // Zeroed, so that cleanup() finds no buffers yet when setting up an
+    // element fails, and no threads
+    mEncoders = new(std::nothrow) Encoder[encoderCount]();
+    mBlocks = new(std::nothrow) Block[blockCount]();
+    if (mEncoders == NULL || mBlocks == NULL || !mFullBlocks.Init(blockCount)) {
+        cleanup();
+        return B_NO_MEMORY;
+    }
+    for (uint32 i = 0; i < encoderCount; i++)
+        mEncoders[i].thread = -1;
+    mEncoderCount = encoderCount;
+    mBlockCount = blockCount;
+
+    const size_t samples = blockSize * channelCount;
+    for (uint32 i = 0; i < encoderCount; i++) {
+        Encoder& encoder = mEncoders[i];
+        encoder.sink = this;
+        encoder.samples = static_cast<int32*>(malloc(samples * sizeof(int32)));
+        encoder.narrow = static_cast<int16*>(malloc(samples * sizeof(int16)));
+        seedDither(encoder.dither, static_cast<uint32>(system_time()) + i);
+        if (!encoder.flac.Init(channelCount, bitsPerSample, rate, blockSize, mLPCOrder)) {
+            cleanup();
+            return B_BAD_VALUE;
+        }
+        if (encoder.samples == NULL || encoder.narrow == NULL) {
+            cleanup();
+            return B_NO_MEMORY;
+        }
+    }
+
+    const size_t maxFrameSize = mEncoders[0].flac.MaxFrameSize();
+    for (uint32 i = 0; i < blockCount; i++) {
+        Block& block = mBlocks[i];
+        block.frames = static_cast<float*>(malloc(samples * sizeof(float)));
+        block.data = static_cast<uint8*>(malloc(maxFrameSize));
+        block.frameCount = 0;
+        block.bytes = 0;
+        block.number = 0;
+        block.state.store(BLOCK_FREE);
+        if (block.frames == NULL || block.data == NULL) {
+            cleanup();
+            return B_NO_MEMORY;
+        }
+    }
+    mFillIndex = 0;
+    mFillFrames = 0;
+    mFrameNumber = 0;
+    mWriteIndex = 0;
+    mWrittenFrames = 0;
+    mMinFrameBytes = 0;
+    mMaxFrameBytes = 0;
+    mFrames.store(0);
+    mDroppedFrames.store(0);
+    mEncodedBytes.store(0);
+    mStatus.store(B_OK);
+
+    mFile = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (mFile < 0) {
+        const status_t status = errno;
+        fprintf(stderr, "AudioFlacSink: Failed to create %s: %s\n", path, strerror(status));
+        cleanup();
+        return status;
+    }
+
+    // Length and frame sizes unknown until Close()
+    uint8 header[kFlacStreamHeaderSize];
+    flacStreamHeader(header, mChannels, mBits, rate, blockSize, 0, 0, 0);
+    const status_t headerStatus = writeAt(header, sizeof(header), 0);
+    if (headerStatus != B_OK) {
+        setError(headerStatus, "Failed to write header");
+        cleanup();
+        return headerStatus;
+    }
+    mFileOffset = sizeof(header);
+
+    mEncoderSem = create_sem(0, "AudioFlacSink encoders");
+    mWriterSem = create_sem(0, "AudioFlacSink writer");
+    if (mEncoderSem < B_OK || mWriterSem < B_OK) {
+        const status_t status = mEncoderSem < B_OK ? mEncoderSem : mWriterSem;
+        cleanup();
+        return status;
+    }
+
+    mEncoderQuit.store(false);
+    mIdleEncoders.store(0);
+    for (uint32 i = 0; i < encoderCount; i++) {
+        Encoder& encoder = mEncoders[i];
+        encoder.thread = spawn_thread(encoderThreadC, "AudioFlacSink encoder", B_NORMAL_PRIORITY,
+            &encoder);
+        if (encoder.thread < B_OK) {
+            const status_t status = encoder.thread;
+            cleanup();
+            return status;
+        }
+        resume_thread(encoder.thread);
+    }
+
+    mWriterQuit.store(false);
+    mWriterWaiting.store(false);
+    mWriterThread = spawn_thread(writerThreadC, "AudioFlacSink writer", B_NORMAL_PRIORITY, this);
+    if (mWriterThread < B_OK) {
+        const status_t status = mWriterThread;
+        cleanup();
+        return status;
+    }
+    resume_thread(mWriterThread);
+    return B_OK;
+}
+
+
+status_t
+AudioFlacSink::Close()
+{
+    if (!IsOpen())
+        return B_NO_INIT;
+
+    // The realtime side is gone, this thread takes over as the producer.
+    // Only the last frame of a stream may be short.
+    if (mFillFrames > 0)
+        submitBlock();
+
+    cleanup();
+    return mStatus.load();
+}
+
+
+void
+AudioFlacSink::cleanup()
+{
+    // Encoders drain the queue before they quit, the writer every encoded
+    // block after them
+    if (mEncoders != NULL) {
+        mEncoderQuit.store(true);
+        if (mEncoderSem >= B_OK)
+            release_sem_etc(mEncoderSem, mEncoderCount, 0);
+        for (uint32 i = 0; i < mEncoderCount; i++) {
+            if (mEncoders[i].thread >= B_OK) {
+                status_t result;
+                wait_for_thread(mEncoders[i].thread, &result);
+                mEncoders[i].thread = -1;
+            }
+        }
+    }
+
+    if (mWriterThread >= B_OK) {
+        mWriterQuit.store(true);
+        release_sem(mWriterSem);
+        status_t result;
+        wait_for_thread(mWriterThread, &result);
+        mWriterThread = -1;
+    }
+
+    if (mEncoderSem >= B_OK) {
+        delete_sem(mEncoderSem);
+        mEncoderSem = -1;
+    }
+    if (mWriterSem >= B_OK) {
+        delete_sem(mWriterSem);
+        mWriterSem = -1;
+    }
+
+    if (mFile >= 0) {
+        if (mFileOffset > 0) {
+            uint8 header[kFlacStreamHeaderSize];
+            flacStreamHeader(header, mChannels, mBits, static_cast<uint32>(mSampleRate),
+                mBlockSize, mMinFrameBytes, mMaxFrameBytes, mWrittenFrames);
+            const status_t status = writeAt(header, sizeof(header), 0);
+            if (status != B_OK)
+                setError(status, "Failed to update header");
+            else if (fsync(mFile) != 0)
+                setError(errno, "Failed to sync file");
+        }
+        close(mFile);
+        mFile = -1;
+    }
+
+    for (uint32 i = 0; mEncoders != NULL && i < mEncoderCount; i++) {
+        free(mEncoders[i].samples);
+        free(mEncoders[i].narrow);
+    }
+    delete[] mEncoders;
+    mEncoders = NULL;
+    mEncoderCount = 0;
+
+    for (uint32 i = 0; mBlocks != NULL && i < mBlockCount; i++) {
+        free(mBlocks[i].frames);
+        free(mBlocks[i].data);
+    }
+    delete[] mBlocks;
+    mBlocks = NULL;
+    mBlockCount = 0;
+    mFillFrames = 0;
+    mFileOffset = 0;
+}
+
+
+status_t
+AudioFlacSink::SetDither(bool enabled)
+{
+    if (IsOpen())
+        return B_BUSY;
+
+    mDither = enabled;
+    return B_OK;
+}
+
+
+status_t
+AudioFlacSink::SetLPCOrder(uint32 order)
+{
+    if (order > kFlacMaxLPCOrder)
+        return B_BAD_VALUE;
+
+    if (IsOpen())
+        return B_BUSY;
+
+    mLPCOrder = order;
+    return B_OK;
+}
+
+
+int32
+AudioFlacSink::AttachTo(AudioCapture& capture)
+{
+    if (!IsOpen())
+        return B_NO_INIT;
+
+    AudioChannelLayout layout = AUDIO_CHANNELS_NATIVE;
+    if (mChannels == 1)
+        layout = AUDIO_CHANNELS_MONO;
+    else if (mChannels == 2)
+        layout = AUDIO_CHANNELS_STEREO;
+    else if (capture.InputChannelCount() != mChannels)
+        return B_MISMATCHED_VALUES;
+
+    return capture.AddSink(WriteCallback, this, mSampleRate, layout);
+}
+
+
+size_t
+AudioFlacSink::Write(const float* frames, size_t frameCount)
+{
+    if (!IsOpen() || frameCount == 0)
+        return 0;
+
+    // Blocks come back in the order they were handed out, a busy next block
+    // means all are busy
+    size_t taken = 0;
+    while (taken < frameCount) {
+        Block& block = mBlocks[mFillIndex];
+        if (mFillFrames == 0 && block.state.load(std::memory_order_acquire) != BLOCK_FREE)
+            break;
+
+        const size_t room = mBlockSize - mFillFrames;
+        const size_t count = frameCount - taken < room ? frameCount - taken : room;
+        memcpy(block.frames + mFillFrames * mChannels, frames + taken * mChannels,
+            count * mChannels * sizeof(float));
+        mFillFrames += count;
+        taken += count;
+
+        if (mFillFrames == mBlockSize)
+            submitBlock();
+    }
+    if (taken < frameCount)
+        mDroppedFrames.fetch_add(frameCount - taken, std::memory_order_relaxed);
+
+    // Single writer, like the AudioCapture statistics
+    mFrames.store(mFrames.load(std::memory_order_relaxed) + taken, std::memory_order_relaxed);
+    return taken;
+}
+
+
+void
+AudioFlacSink::WriteCallback(const float* data, size_t frameCount, uint32 channelCount,
+    void* userData)
+{
+    AudioFlacSink* sink = static_cast<AudioFlacSink*>(userData);
+    if (channelCount != sink->mChannels) {
+        sink->mDroppedFrames.fetch_add(frameCount, std::memory_order_relaxed);
+        return;
+    }
+    sink->Write(data, frameCount);
+}
+
+
+void
+AudioFlacSink::submitBlock()
+{
+    Block& block = mBlocks[mFillIndex];
+    block.frameCount = mFillFrames;
+    block.number = mFrameNumber++;
+    block.state.store(BLOCK_FULL, std::memory_order_release);
+    mFullBlocks.Push(mFillIndex);
+    mFillIndex = (mFillIndex + 1) % mBlockCount;
+    mFillFrames = 0;
+
+    // Pairs with the fence in encoderLoop(): either an encoder going idle
+    // still sees the block, or it is counted here and gets woken
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (mIdleEncoders.load(std::memory_order_relaxed) > 0)
+        release_sem_etc(mEncoderSem, 1, B_DO_NOT_RESCHEDULE);
+}
+
+
+// #pragma mark - Encoders
+
+
+void
+AudioFlacSink::encodeBlock(Encoder& encoder, Block& block)
+{
+    const size_t samples = block.frameCount * mChannels;
+    if (mBits == 16) {
+        mQuantizer(encoder.narrow, block.frames, samples, mDither ? &encoder.dither : NULL);
+        for (size_t i = 0; i < samples; i++)
+            encoder.samples[i] = encoder.narrow[i];
+    } else {
+        // Full scale int32, rounded to its top 24 bits
+        mQuantizer(encoder.samples, block.frames, samples, NULL);
+        for (size_t i = 0; i < samples; i++) {
+            const int32 sample = (encoder.samples[i] >> 8) + ((encoder.samples[i] >> 7) & 1);
+            encoder.samples[i] = sample > kMaxInt24 ? kMaxInt24 : sample;
+        }
+    }
+
+    block.bytes = encoder.flac.Encode(block.data, encoder.samples, block.frameCount, block.number);
+    block.state.store(BLOCK_ENCODED);
+
+    if (mWriterWaiting.exchange(false))
+        release_sem(mWriterSem);
+}
+
+
+int32
+AudioFlacSink::encoderThreadC(void* cookie)
+{
+    Encoder* encoder = static_cast<Encoder*>(cookie);
+    return encoder->sink->encoderLoop(*encoder);
+}
+
+
+int32
+AudioFlacSink::encoderLoop(Encoder& encoder)
+{
+    while (true) {
+        const bool quit = mEncoderQuit.load();
+        uint32 index;
+        if (mFullBlocks.Pop(index)) {
+            encodeBlock(encoder, mBlocks[index]);
+            continue;
+        }
+        if (quit)
+            break;
+
+        // Any number of encoders may wait, so they are counted instead of
+        // flagged, see submitBlock()
+        mIdleEncoders.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (mFullBlocks.Count() > 0 || mEncoderQuit.load()) {
+            mIdleEncoders.fetch_sub(1);
+            continue;
+        }
+        acquire_sem(mEncoderSem);
+        mIdleEncoders.fetch_sub(1);
+    }
+    return B_OK;
+}
+
+
+// #pragma mark - Writer
+
+
+// Keeps the first error only
+void
+AudioFlacSink::setError(status_t status, const char* what)
+{
+    status_t expected = B_OK;
+    if (mStatus.compare_exchange_strong(expected, status))
+        fprintf(stderr, "AudioFlacSink: %s: %s\n", what, strerror(status));
+}
+
+
+status_t
+AudioFlacSink::writeAt(const uint8* data, size_t bytes, off_t offset)
+{
+    while (bytes > 0) {
+        const ssize_t written = pwrite(mFile, data, bytes, offset);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return errno;
+        }
+        data += written;
+        bytes -= written;
+        offset += written;
+    }
+    return B_OK;
+}
+
+
+// After an error blocks are still handed back, only not written, so the
+// capture never stalls on a broken disk
+void
+AudioFlacSink::writeBlock(Block& block)
+{
+    if (mStatus.load() == B_OK && block.bytes > 0) {
+        const status_t status = writeAt(block.data, block.bytes, mFileOffset);
+        if (status != B_OK) {
+            setError(status, "Failed to write frame");
+        } else {
+            mFileOffset += block.bytes;
+            mWrittenFrames += block.frameCount;
+            if (mMinFrameBytes == 0 || block.bytes < mMinFrameBytes)
+                mMinFrameBytes = block.bytes;
+            if (block.bytes > mMaxFrameBytes)
+                mMaxFrameBytes = block.bytes;
+            mEncodedBytes.store(mEncodedBytes.load(std::memory_order_relaxed) + block.bytes,
+                std::memory_order_relaxed);
+        }
+    }
+
+    block.state.store(BLOCK_FREE, std::memory_order_release);
+    mWriteIndex = (mWriteIndex + 1) % mBlockCount;
+}
+
+
+int32
+AudioFlacSink::writerThreadC(void* cookie)
+{
+    return static_cast<AudioFlacSink*>(cookie)->writerLoop();
+}
+
+
+int32
+AudioFlacSink::writerLoop()
+{
+    while (true) {
+        // Read before looking at the block, so quitting never leaves one
+        // encoded ahead of it behind
+        const bool quit = mWriterQuit.load();
+        Block& block = mBlocks[mWriteIndex];
+        if (block.state.load() == BLOCK_ENCODED) {
+            writeBlock(block);
+            continue;
+        }
+        if (quit)
+            break;
+
+        // Same handshake as AudioFileSink, only with encoders finishing
+        // blocks in any order: whichever finishes the block waited for
+        // signals it
+        mWriterWaiting.store(true);
+        if (block.state.load() == BLOCK_ENCODED || mWriterQuit.load()) {
+            mWriterWaiting.store(false);
+            continue;
+        }
+        acquire_sem(mWriterSem);
+        mWriterWaiting.store(false);
+    }
+    return B_OK;
+}
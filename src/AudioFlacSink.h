@@ -0,0 +1,165 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef AUDIO_FLAC_SINK_H
+#define AUDIO_FLAC_SINK_H
+
+#include "AudioCapture.h"
+#include "AudioFlac.h"
+
+#include <atomic>
+
+static const size_t kAudioFlacDefaultBlockSize = 4096;
+static const uint32 kAudioFlacDefaultBlockCount = 16;
+
+// Streams interleaved float frames into a FLAC file. The realtime side only
+// copies frames into one of a few preallocated blocks. A pool of encoder
+// threads quantizes full blocks and encodes each into a FLAC frame in
+// parallel, and a writer thread appends the frames to the file. Blocks are
+// filled, encoded and written in a fixed rotation, so the writer keeps the
+// frames in order just by waiting for the next block. A crash leaves a
+// stream that decodes up to its last whole frame. Its length goes into the
+// header at Close().
+class AudioFlacSink {
+public:
+    AudioFlacSink();
+    ~AudioFlacSink();
+
+    // Creates path and starts the threads. sampleRate is rounded to whole Hz
+    // and has to stay below 2^20, as in FLAC. bitsPerSample is 16 or 24. 24
+    // keeps all a float capture of a real converter holds. blockSize frames
+    // go into each FLAC frame. blockCount blocks bound the memory used and
+    // how far the encoders and the disk may fall behind before frames are
+    // dropped. encoderCount 0 starts one encoder per CPU.
+    status_t Open(const char* path, uint32 channelCount, float sampleRate,
+        uint32 bitsPerSample = 24, size_t blockSize = kAudioFlacDefaultBlockSize,
+        uint32 blockCount = kAudioFlacDefaultBlockCount, uint32 encoderCount = 0);
+    // Encodes and writes out what is buffered, completes the header and
+    // closes the file. Whatever calls Write() has to be stopped first.
+    // Returns the first write error, if any.
+    status_t Close();
+    bool IsOpen() const { return mFile >= 0; }
+
+    // TPDF dither when quantizing to 16 bits, off by default. Returns B_BUSY
+    // while open.
+    status_t SetDither(bool enabled);
+    // Highest LPC order the encoders try, kFlacDefaultLPCOrder by default,
+    // 0 for fixed predictors only. Above 12 the stream leaves the FLAC
+    // subset. Returns B_BUSY while open.
+    status_t SetLPCOrder(uint32 order);
+
+    // Adds the sink to capture at the sink's rate, in the mono, stereo or
+    // native layout matching its channel count. Returns the id from
+    // AudioCapture::AddSink(), or an error.
+    int32 AttachTo(AudioCapture& capture);
+
+    // Realtime side, from a single thread: copies frameCount frames of the
+    // sink's channel count into the current block. Never blocks, allocates
+    // or touches the file. Frames that find no free block are dropped and
+    // counted. Returns the frames taken.
+    size_t Write(const float* frames, size_t frameCount);
+    // AudioCallbackFunc forwarding to Write(), userData is the sink
+    static void WriteCallback(const float* data, size_t frameCount, uint32 channelCount,
+        void* userData);
+
+    uint32 ChannelCount() const { return mChannels; }
+    float SampleRate() const { return mSampleRate; }
+    uint32 BitsPerSample() const { return mBits; }
+    uint32 EncoderCount() const { return mEncoderCount; }
+    // Frames taken by Write() since Open()
+    uint64 FrameCount() const { return mFrames.load(std::memory_order_relaxed); }
+    uint64 DroppedFrameCount() const { return mDroppedFrames.load(std::memory_order_relaxed); }
+    // Bytes of FLAC frames in the file so far
+    uint64 EncodedBytes() const { return mEncodedBytes.load(std::memory_order_relaxed); }
+    // B_OK, or the first error the writer ran into
+    status_t Status() const { return mStatus.load(std::memory_order_relaxed); }
+
+    AudioFlacSink(const AudioFlacSink&) = delete;
+    AudioFlacSink& operator=(const AudioFlacSink&) = delete;
+
+private:
+    enum {
+        BLOCK_FREE = 0,
+        BLOCK_FULL,
+        BLOCK_ENCODED
+    };
+
+    struct Block {
+        // blockSize interleaved frames and room for their encoded frame
+        float*            frames;
+        uint8*            data;
+        size_t            frameCount;
+        size_t            bytes;
+        uint32            number;
+        std::atomic<int32> state;
+    };
+
+    struct Encoder {
+        AudioFlacSink*    sink;
+        thread_id         thread;
+        FlacFrameEncoder  flac;
+        // The block quantized, int16 first when 16 bit
+        int32*            samples;
+        int16*            narrow;
+        DitherState       dither;
+    };
+
+    void setError(status_t status, const char* what);
+    status_t writeAt(const uint8* data, size_t bytes, off_t offset);
+    void submitBlock();
+    void encodeBlock(Encoder& encoder, Block& block);
+    void writeBlock(Block& block);
+    void cleanup();
+    int32 encoderLoop(Encoder& encoder);
+    int32 writerLoop();
+
+    static int32 encoderThreadC(void* cookie);
+    static int32 writerThreadC(void* cookie);
+
+    int               mFile;
+    uint32            mLPCOrder;
+    uint32            mChannels;
+    float             mSampleRate;
+    uint32            mBits;
+    size_t            mBlockSize;
+    bool              mDither;
+    QuantizeFunc      mQuantizer;
+
+    Block*            mBlocks;
+    uint32            mBlockCount;
+    // Full blocks waiting for an encoder, pushed by the realtime side
+    AudioBlockQueue   mFullBlocks;
+    // Realtime side: block in the rotation being filled, its frames so far
+    // and the number of the next FLAC frame
+    uint32            mFillIndex;
+    size_t            mFillFrames;
+    uint32            mFrameNumber;
+
+    Encoder*          mEncoders;
+    uint32            mEncoderCount;
+    sem_id            mEncoderSem;
+    std::atomic<int32> mIdleEncoders;
+    std::atomic<bool> mEncoderQuit;
+
+    // Writer side: next block in the rotation to write, where it goes and
+    // what STREAMINFO needs at the end
+    uint32            mWriteIndex;
+    off_t             mFileOffset;
+    uint64            mWrittenFrames;
+    size_t            mMinFrameBytes;
+    size_t            mMaxFrameBytes;
+
+    thread_id         mWriterThread;
+    sem_id            mWriterSem;
+    std::atomic<bool> mWriterWaiting;
+    std::atomic<bool> mWriterQuit;
+
+    std::atomic<uint64> mFrames;
+    std::atomic<uint64> mDroppedFrames;
+    std::atomic<uint64> mEncodedBytes;
+    std::atomic<status_t> mStatus;
+};
+
+#endif // AUDIO_FLAC_SINK_H
@@ -0,0 +1,180 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "AudioGate.h"
+
+// Voice has to be this much above the noise floor in energy, about 9 dB
+static const double kVoiceMargin = 8.0;
+// The floor follows a louder background with this time constant, and a
+// quieter one right away. While there is voice it rises this many times
+// slower, so talking doesn't turn into background, but a steady sound that
+// merely looks like voice eventually does.
+static const double kNoiseFloorRiseSeconds = 10.0;
+static const double kVoiceRiseFactor = 10.0;
+// Zero crossing rates, in crossings per second over two, that voiced and
+// unvoiced speech fall into. Hum sits below, broadband hiss above.
+static const double kMinVoiceCrossingRate = 80.0;
+static const double kMaxVoiceCrossingRate = 3000.0;
+
+
+template<typename Sample>
+static size_t
+countZeroCrossings(const void* src, size_t frameCount, uint32_t channelCount)
+{
+    const Sample* s = static_cast<const Sample*>(src);
+    size_t crossings = 0;
+    bool negative = s[0] < 0;
+    for (size_t f = 1; f < frameCount; f++) {
+        const bool sign = s[f * channelCount] < 0;
+        crossings += sign != negative;
+        negative = sign;
+    }
+    return crossings;
+}
+
+
+AudioGate::AudioGate()
+    : mMeter(NULL),
+      mType(SAMPLE_FLOAT),
+      mChannels(0),
+      mSampleRate(0.0),
+      mThreshold(0.0),
+      mHangoverFrames(0),
+      mVoiceDetection(false),
+      mOpen(false),
+      mHangoverLeft(0),
+      mNoiseFloor(-1.0),
+      mPeak(NULL),
+      mSumSquares(NULL),
+      mClips(NULL)
+{
+}
+
+
+AudioGate::~AudioGate()
+{
+    free(mPeak);
+    free(mSumSquares);
+    free(mClips);
+}
+
+
+bool
+AudioGate::Init(SampleType type, uint32_t channels, double sampleRate, float thresholdDB,
+    double hangoverSeconds, bool voiceDetection)
+{
+    free(mPeak);
+    free(mSumSquares);
+    free(mClips);
+    mPeak = NULL;
+    mSumSquares = NULL;
+    mClips = NULL;
+
+    mMeter = getLevelMeter(type, channels);
+    if (mMeter == NULL || !(sampleRate > 0.0))
+        return false;
+
+    mPeak = static_cast<float*>(calloc(channels, sizeof(float)));
+    mSumSquares = static_cast<double*>(calloc(channels, sizeof(double)));
+    mClips = static_cast<uint32_t*>(calloc(channels, sizeof(uint32_t)));
+    if (mPeak == NULL || mSumSquares == NULL || mClips == NULL) {
+        mMeter = NULL;
+        return false;
+    }
+
+    mType = type;
+    mChannels = channels;
+    mSampleRate = sampleRate;
+    mThreshold = pow(10.0, thresholdDB / 10.0);
+    mHangoverFrames = hangoverSeconds > 0.0 ? static_cast<size_t>(hangoverSeconds * sampleRate) : 0;
+    mVoiceDetection = voiceDetection;
+    Reset();
+    return true;
+}
+
+
+void
+AudioGate::Reset()
+{
+    mOpen = false;
+    mHangoverLeft = 0;
+    mNoiseFloor = -1.0;
+}
+
+
+bool
+AudioGate::Process(const void* frames, size_t frameCount)
+{
+    if (mMeter == NULL || frameCount == 0)
+        return mOpen;
+
+    for (uint32_t c = 0; c < mChannels; c++) {
+        mPeak[c] = 0.0f;
+        mSumSquares[c] = 0.0;
+        mClips[c] = 0;
+    }
+    mMeter(mPeak, mSumSquares, mClips, frames, frameCount, mChannels);
+
+    double energy = 0.0;
+    for (uint32_t c = 0; c < mChannels; c++) {
+        if (mSumSquares[c] > energy)
+            energy = mSumSquares[c];
+    }
+    energy /= frameCount;
+
+    bool active = energy >= mThreshold;
+    if (mVoiceDetection)
+        active = isVoice(frames, frameCount, energy) && active;
+
+    if (active) {
+        mOpen = true;
+        mHangoverLeft = mHangoverFrames;
+    } else if (mOpen) {
+        if (mHangoverLeft > frameCount)
+            mHangoverLeft -= frameCount;
+        else
+            mOpen = false;
+    }
+    return mOpen;
+}
+
+
+void
+AudioGate::Open()
+{
+    mOpen = true;
+    mHangoverLeft = mHangoverFrames;
+}
+
+
+// Updates the noise floor as a side effect, so it has to see every buffer
+bool
+AudioGate::isVoice(const void* frames, size_t frameCount, double energy)
+{
+    const double floor = mNoiseFloor;
+    bool voice = false;
+    if (floor >= 0.0 && energy >= floor * kVoiceMargin) {
+        size_t crossings;
+        switch (mType) {
+            case SAMPLE_INT16: crossings = countZeroCrossings<int16_t>(frames, frameCount, mChannels); break;
+            case SAMPLE_INT32: crossings = countZeroCrossings<int32_t>(frames, frameCount, mChannels); break;
+            default:           crossings = countZeroCrossings<float>(frames, frameCount, mChannels); break;
+        }
+        const double crossingRate = crossings * mSampleRate / (2.0 * frameCount);
+        voice = crossingRate >= kMinVoiceCrossingRate && crossingRate <= kMaxVoiceCrossingRate;
+    }
+
+    if (floor < 0.0 || energy < floor) {
+        mNoiseFloor = energy;
+    } else {
+        const double riseSeconds = voice ? kNoiseFloorRiseSeconds * kVoiceRiseFactor : kNoiseFloorRiseSeconds;
+        const double rise = frameCount / (riseSeconds * mSampleRate);
+        mNoiseFloor += (energy - floor) * (rise < 1.0 ? rise : 1.0);
+    }
+    return voice;
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef AUDIO_GATE_H
+#define AUDIO_GATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "AudioLevel.h"
+
+// Open/closed decision for AudioCapture's input gate, made on raw device
+// buffers before anything converts them. No MediaKit dependency.
+//
+// The gate opens on a buffer whose loudest channel reaches the threshold RMS
+// and closes once the hangover has passed without another one. Voice
+// detection additionally wants the level well above a tracked noise floor
+// and a zero crossing rate of the first channel in the range of speech,
+// which keeps steady hiss, hum and rumble from holding the gate open.
+class AudioGate {
+public:
+    AudioGate();
+    ~AudioGate();
+
+    // SAMPLE_FLOAT, SAMPLE_INT16 and SAMPLE_INT32 device samples, see
+    // getLevelMeter(). Returns false for other types or if allocation fails.
+    bool Init(SampleType type, uint32_t channels, double sampleRate, float thresholdDB,
+        double hangoverSeconds, bool voiceDetection);
+    // Closes the gate and forgets the noise floor
+    void Reset();
+
+    // Measures frameCount interleaved device frames, returns whether the gate
+    // is open for them. Doesn't allocate.
+    bool Process(const void* frames, size_t frameCount);
+    // Opens the gate for frames it can't measure, as if they had reached the
+    // threshold
+    void Open();
+    bool IsOpen() const { return mOpen; }
+
+    AudioGate(const AudioGate&) = delete;
+    AudioGate& operator=(const AudioGate&) = delete;
+
+private:
+    bool isVoice(const void* frames, size_t frameCount, double energy);
+
+    LevelMeterFunc  mMeter;
+    SampleType      mType;
+    uint32_t        mChannels;
+    double          mSampleRate;
+    // Mean square of the threshold, full scale 1.0
+    double          mThreshold;
+    size_t          mHangoverFrames;
+    bool            mVoiceDetection;
+
+    bool            mOpen;
+    size_t          mHangoverLeft;
+    // Mean square, negative until the first buffer was measured
+    double          mNoiseFloor;
+
+    // Per-channel sums for the level meter, sized at Init()
+    float*          mPeak;
+    double*         mSumSquares;
+    uint32_t*       mClips;
+};
+
+#endif // AUDIO_GATE_H
@@ -0,0 +1,193 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#include "AudioLevel.h"
+#include "AudioSimd.h"
+
+#include <math.h>
+
+
+// #pragma mark - Scalar
+
+
+static void
+meterFloatScalar(float* peak, double* sumSquares, uint32_t* clips, const void* src,
+    size_t frameCount, uint32_t channelCount)
+{
+    const float* s = static_cast<const float*>(src);
+    for (size_t f = 0; f < frameCount; f++) {
+        for (uint32_t c = 0; c < channelCount; c++) {
+            const float x = *s++;
+            const float magnitude = fabsf(x);
+            if (magnitude > peak[c])
+                peak[c] = magnitude;
+            sumSquares[c] += x * x;
+            if (magnitude >= kLevelClipLevel)
+                clips[c]++;
+        }
+    }
+}
+
+
+// The most negative code has no positive counterpart, both ends count as
+// clipped
+template<typename Sample, int Bits>
+static void
+meterIntegerScalar(float* peak, double* sumSquares, uint32_t* clips, const void* src,
+    size_t frameCount, uint32_t channelCount)
+{
+    const Sample* s = static_cast<const Sample*>(src);
+    const Sample maximum = static_cast<Sample>((static_cast<int64_t>(1) << (Bits - 1)) - 1);
+    const float scale = 1.0f / static_cast<float>(static_cast<int64_t>(1) << (Bits - 1));
+    for (size_t f = 0; f < frameCount; f++) {
+        for (uint32_t c = 0; c < channelCount; c++) {
+            const Sample x = *s++;
+            const float value = x * scale;
+            const float magnitude = fabsf(value);
+            if (magnitude > peak[c])
+                peak[c] = magnitude;
+            sumSquares[c] += value * value;
+            if (x >= maximum || x < -maximum)
+                clips[c]++;
+        }
+    }
+}
+
+
+// The SIMD kernels treat the interleaved samples as one flat array. With a
+// channel count that divides the vector width every lane always sees the
+// same channel, so the lanes are only folded into channels at the end.
+
+
+// #pragma mark - SSE2
+
+
+#ifdef AUDIO_SIMD_SSE2
+
+TARGET_SSE2 static void
+meterFloatSSE2(float* peak, double* sumSquares, uint32_t* clips, const void* src,
+    size_t frameCount, uint32_t channelCount)
+{
+    const float* s = static_cast<const float*>(src);
+    const size_t count = frameCount * channelCount;
+    const __m128 magnitudeMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 clipLevel = _mm_set1_ps(kLevelClipLevel);
+    __m128 laneMax = _mm_setzero_ps();
+    __m128 laneSum = _mm_setzero_ps();
+    __m128i laneClips = _mm_setzero_si128();
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 x = _mm_loadu_ps(s + i);
+        const __m128 magnitude = _mm_and_ps(x, magnitudeMask);
+        // Operands in this order keep NaNs out of the peak
+        laneMax = _mm_max_ps(magnitude, laneMax);
+        laneSum = _mm_add_ps(laneSum, _mm_mul_ps(x, x));
+        // Compare masks are -1 per matching lane
+        laneClips = _mm_sub_epi32(laneClips, _mm_castps_si128(_mm_cmpge_ps(magnitude, clipLevel)));
+    }
+
+    float maxima[4];
+    float sums[4];
+    uint32_t counts[4];
+    _mm_storeu_ps(maxima, laneMax);
+    _mm_storeu_ps(sums, laneSum);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(counts), laneClips);
+    for (uint32_t lane = 0; lane < 4; lane++) {
+        const uint32_t c = lane % channelCount;
+        if (maxima[lane] > peak[c])
+            peak[c] = maxima[lane];
+        sumSquares[c] += sums[lane];
+        clips[c] += counts[lane];
+    }
+
+    // i is a whole number of frames, the rest starts at channel 0
+    meterFloatScalar(peak, sumSquares, clips, s + i, frameCount - i / channelCount, channelCount);
+}
+
+#endif // AUDIO_SIMD_SSE2
+
+
+// #pragma mark - NEON
+
+
+#ifdef AUDIO_SIMD_NEON
+
+static void
+meterFloatNEON(float* peak, double* sumSquares, uint32_t* clips, const void* src,
+    size_t frameCount, uint32_t channelCount)
+{
+    const float* s = static_cast<const float*>(src);
+    const size_t count = frameCount * channelCount;
+    const float32x4_t clipLevel = vdupq_n_f32(kLevelClipLevel);
+    float32x4_t laneMax = vdupq_n_f32(0.0f);
+    float32x4_t laneSum = vdupq_n_f32(0.0f);
+    uint32x4_t laneClips = vdupq_n_u32(0);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const float32x4_t x = vld1q_f32(s + i);
+        const float32x4_t magnitude = vabsq_f32(x);
+        laneMax = vmaxq_f32(laneMax, magnitude);
+        laneSum = vmlaq_f32(laneSum, x, x);
+        laneClips = vsubq_u32(laneClips, vcgeq_f32(magnitude, clipLevel));
+    }
+
+    float maxima[4];
+    float sums[4];
+    uint32_t counts[4];
+    vst1q_f32(maxima, laneMax);
+    vst1q_f32(sums, laneSum);
+    vst1q_u32(counts, laneClips);
+    for (uint32_t lane = 0; lane < 4; lane++) {
+        const uint32_t c = lane % channelCount;
+        if (maxima[lane] > peak[c])
+            peak[c] = maxima[lane];
+        sumSquares[c] += sums[lane];
+        clips[c] += counts[lane];
+    }
+
+    meterFloatScalar(peak, sumSquares, clips, s + i, frameCount - i / channelCount, channelCount);
+}
+
+#endif // AUDIO_SIMD_NEON
+
+
+// #pragma mark - Dispatch
+
+
+LevelMeterFunc
+getLevelMeter(SampleType type, uint32_t channelCount, SampleKernelISA isa)
+{
+    if (channelCount == 0)
+        return NULL;
+
+    if (isa == SAMPLE_KERNEL_AUTO)
+        isa = bestSampleKernelISA();
+    else if (!isSampleKernelISASupported(isa))
+        return NULL;
+
+    switch (type) {
+        case SAMPLE_INT16: return meterIntegerScalar<int16_t, 16>;
+        case SAMPLE_INT32: return meterIntegerScalar<int32_t, 32>;
+        case SAMPLE_FLOAT: break;
+        default:           return NULL;
+    }
+
+    if (4 % channelCount != 0)
+        return meterFloatScalar;
+
+    switch (isa) {
+#ifdef AUDIO_SIMD_SSE2
+        // Metering is bound by the loads, AVX2 has nothing to add
+        case SAMPLE_KERNEL_AVX2:
+        case SAMPLE_KERNEL_SSE2: return meterFloatSSE2;
+#endif
+#ifdef AUDIO_SIMD_NEON
+        case SAMPLE_KERNEL_NEON: return meterFloatNEON;
+#endif
+        default:                 return meterFloatScalar;
+    }
+}
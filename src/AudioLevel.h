@@ -0,0 +1,35 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef AUDIO_LEVEL_H
+#define AUDIO_LEVEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "AudioConvert.h"
+
+// Peak, RMS and clip metering for AudioCapture, run on frames that were just
+// converted so they are still in cache. No MediaKit dependency.
+
+// Float samples at or beyond this magnitude count as clipped, the positive
+// full scale of int16
+static const float kLevelClipLevel = 32767.0f / 32768.0f;
+
+// Accumulates frameCount interleaved frames of channelCount samples into the
+// per-channel arrays: peak keeps the largest magnitude, sumSquares adds the
+// squared samples and clips counts samples at full scale. Integer samples are
+// measured relative to their full scale, so all values come out as floats in
+// [0, 1].
+typedef void (*LevelMeterFunc)(float* peak, double* sumSquares, uint32_t* clips, const void* src,
+    size_t frameCount, uint32_t channelCount);
+
+// Supports SAMPLE_FLOAT, SAMPLE_INT16 and SAMPLE_INT32. Float frames of one,
+// two or four channels have vectorized kernels, the rest use the scalar ones.
+// Returns NULL for other types or if the requested ISA is not supported.
+LevelMeterFunc getLevelMeter(SampleType type, uint32_t channelCount,
+    SampleKernelISA isa = SAMPLE_KERNEL_AUTO);
+
+#endif // AUDIO_LEVEL_H
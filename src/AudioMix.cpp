@@ -0,0 +1,172 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#include "AudioMix.h"
+#include "AudioSimd.h"
+
+
+static void
+mixScalar(float* dst, const float* src, size_t frameCount, const float* matrix,
+    uint32_t inputChannels, uint32_t outputChannels)
+{
+    for (size_t f = 0; f < frameCount; f++) {
+        for (uint32_t o = 0; o < outputChannels; o++) {
+            const float* row = matrix + o * inputChannels;
+            float sum = 0.0f;
+            for (uint32_t i = 0; i < inputChannels; i++)
+                sum += row[i] * src[i];
+            dst[o] = sum;
+        }
+        src += inputChannels;
+        dst += outputChannels;
+    }
+}
+
+
+// The SIMD kernels keep several output frames in one register and add every
+// input channel as a broadcast sample times its matrix column, so there are
+// no horizontal sums and no reads past the last input frame.
+
+
+// #pragma mark - SSE2
+
+
+#ifdef AUDIO_SIMD_SSE2
+
+TARGET_SSE2 static void
+mixStereoSSE2(float* dst, const float* src, size_t frameCount, const float* matrix,
+    uint32_t inputChannels, uint32_t)
+{
+    const uint32_t n = inputChannels;
+    __m128 columns[kMaxSimdMixInputs];
+    for (uint32_t i = 0; i < n; i++)
+        columns[i] = _mm_setr_ps(matrix[i], matrix[n + i], matrix[i], matrix[n + i]);
+
+    // Two frames per vector: L0 R0 L1 R1
+    size_t f = 0;
+    for (; f + 2 <= frameCount; f += 2) {
+        const float* a = src + f * n;
+        const float* b = a + n;
+        __m128 acc = _mm_setzero_ps();
+        for (uint32_t i = 0; i < n; i++) {
+            __m128 x = _mm_unpacklo_ps(_mm_load_ss(a + i), _mm_load_ss(b + i));
+            acc = _mm_add_ps(acc, _mm_mul_ps(columns[i], _mm_unpacklo_ps(x, x)));
+        }
+        _mm_storeu_ps(dst + f * 2, acc);
+    }
+    mixScalar(dst + f * 2, src + f * n, frameCount - f, matrix, n, 2);
+}
+
+
+TARGET_SSE2 static void
+mixMonoSSE2(float* dst, const float* src, size_t frameCount, const float* matrix,
+    uint32_t inputChannels, uint32_t)
+{
+    const uint32_t n = inputChannels;
+
+    // Four frames per vector
+    size_t f = 0;
+    for (; f + 4 <= frameCount; f += 4) {
+        const float* a = src + f * n;
+        __m128 acc = _mm_setzero_ps();
+        for (uint32_t i = 0; i < n; i++) {
+            __m128 x = _mm_setr_ps(a[i], a[n + i], a[2 * n + i], a[3 * n + i]);
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(matrix[i]), x));
+        }
+        _mm_storeu_ps(dst + f, acc);
+    }
+    mixScalar(dst + f, src + f * n, frameCount - f, matrix, n, 1);
+}
+
+#endif // AUDIO_SIMD_SSE2
+
+
+// #pragma mark - NEON
+
+
+#ifdef AUDIO_SIMD_NEON
+
+static void
+mixStereoNEON(float* dst, const float* src, size_t frameCount, const float* matrix,
+    uint32_t inputChannels, uint32_t)
+{
+    const uint32_t n = inputChannels;
+    float32x4_t columns[kMaxSimdMixInputs];
+    for (uint32_t i = 0; i < n; i++) {
+        float32x2_t column = vset_lane_f32(matrix[n + i], vdup_n_f32(matrix[i]), 1);
+        columns[i] = vcombine_f32(column, column);
+    }
+
+    // Two frames per vector: L0 R0 L1 R1
+    size_t f = 0;
+    for (; f + 2 <= frameCount; f += 2) {
+        const float* a = src + f * n;
+        const float* b = a + n;
+        float32x4_t acc = vdupq_n_f32(0.0f);
+        for (uint32_t i = 0; i < n; i++)
+            acc = vmlaq_f32(acc, columns[i], vcombine_f32(vdup_n_f32(a[i]), vdup_n_f32(b[i])));
+        vst1q_f32(dst + f * 2, acc);
+    }
+    mixScalar(dst + f * 2, src + f * n, frameCount - f, matrix, n, 2);
+}
+
+
+static void
+mixMonoNEON(float* dst, const float* src, size_t frameCount, const float* matrix,
+    uint32_t inputChannels, uint32_t)
+{
+    const uint32_t n = inputChannels;
+
+    // Four frames per vector
+    size_t f = 0;
+    for (; f + 4 <= frameCount; f += 4) {
+        const float* a = src + f * n;
+        float32x4_t acc = vdupq_n_f32(0.0f);
+        for (uint32_t i = 0; i < n; i++) {
+            float32x4_t x = vdupq_n_f32(a[i]);
+            x = vsetq_lane_f32(a[n + i], x, 1);
+            x = vsetq_lane_f32(a[2 * n + i], x, 2);
+            x = vsetq_lane_f32(a[3 * n + i], x, 3);
+            acc = vmlaq_n_f32(acc, x, matrix[i]);
+        }
+        vst1q_f32(dst + f, acc);
+    }
+    mixScalar(dst + f, src + f * n, frameCount - f, matrix, n, 1);
+}
+
+#endif // AUDIO_SIMD_NEON
+
+
+// #pragma mark - Dispatch
+
+
+MatrixMixFunc
+getMatrixMixer(uint32_t inputChannels, uint32_t outputChannels, SampleKernelISA isa)
+{
+    if (inputChannels == 0 || outputChannels == 0)
+        return NULL;
+
+    if (isa == SAMPLE_KERNEL_AUTO)
+        isa = bestSampleKernelISA();
+    else if (!isSampleKernelISASupported(isa))
+        return NULL;
+
+    if (outputChannels > 2 || inputChannels > kMaxSimdMixInputs)
+        return mixScalar;
+
+    const bool stereo = outputChannels == 2;
+    switch (isa) {
+#ifdef AUDIO_SIMD_SSE2
+        // Wider vectors don't pay off here, assembling the broadcast lanes
+        // costs more than the extra multiply width saves
+        case SAMPLE_KERNEL_AVX2:
+        case SAMPLE_KERNEL_SSE2: return stereo ? mixStereoSSE2 : mixMonoSSE2;
+#endif
+#ifdef AUDIO_SIMD_NEON
+        case SAMPLE_KERNEL_NEON: return stereo ? mixStereoNEON : mixMonoNEON;
+#endif
+        default:                 return mixScalar;
+    }
+}
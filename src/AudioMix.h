@@ -0,0 +1,33 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef AUDIO_MIX_H
+#define AUDIO_MIX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "AudioConvert.h"
+
+// Channel matrix mixing for AudioCapture's output layouts. Like
+// AudioConvert.h this has no MediaKit dependency.
+
+// Largest input channel count the SIMD kernels handle, wider matrices fall
+// back to the scalar kernel
+static const uint32_t kMaxSimdMixInputs = 32;
+
+// Mixes frameCount interleaved float frames of inputChannels into
+// outputChannels. matrix is row-major, outputChannels rows of inputChannels
+// coefficients. dst and src must not overlap.
+typedef void (*MatrixMixFunc)(float* dst, const float* src, size_t frameCount,
+    const float* matrix, uint32_t inputChannels, uint32_t outputChannels);
+
+// Returns the mixer for the given shape, or NULL if the requested ISA is not
+// supported. Mono and stereo outputs have vectorized kernels, other shapes use
+// the scalar one.
+MatrixMixFunc getMatrixMixer(uint32_t inputChannels, uint32_t outputChannels,
+    SampleKernelISA isa = SAMPLE_KERNEL_AUTO);
+
+#endif // AUDIO_MIX_H
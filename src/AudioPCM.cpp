@@ -0,0 +1,380 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "AudioPCM.h"
+#include "AudioSimd.h"
+
+// Clamping happens in float before the conversion, so every ISA saturates the
+// same way. 2147483520 is the largest float below 2^31.
+static const float kInt16Max = 32767.0f;
+static const float kInt16Min = -32768.0f;
+static const float kInt32Max = 2147483520.0f;
+static const float kInt32Min = -2147483648.0f;
+// Maps the top 24 bits of a generator output onto [0, 1) LSB
+static const float kDitherScale = 1.0f / 16777216.0f;
+
+
+void
+seedDither(DitherState& state, uint32_t seed)
+{
+    // xorshift must never be seeded with zero
+    for (int i = 0; i < 4; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        state.lanes[i] = seed != 0 ? seed : 0x9e3779b9u;
+    }
+}
+
+
+static inline uint32_t
+xorshift(uint32_t& x)
+{
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+
+// #pragma mark - Scalar
+
+
+static inline float
+clampSample(float x, float low, float high)
+{
+    return x < low ? low : (x > high ? high : x);
+}
+
+
+static void
+quantizeInt16Scalar(void* dst, const float* src, size_t count, DitherState* dither)
+{
+    int16_t* out = static_cast<int16_t*>(dst);
+    if (dither == NULL) {
+        for (size_t i = 0; i < count; i++)
+            out[i] = static_cast<int16_t>(lrintf(clampSample(src[i] * 32768.0f, kInt16Min, kInt16Max)));
+        return;
+    }
+
+    uint32_t state = dither->lanes[0];
+    for (size_t i = 0; i < count; i++) {
+        const int32_t a = xorshift(state) >> 8;
+        const int32_t b = xorshift(state) >> 8;
+        const float noise = (a - b) * kDitherScale;
+        out[i] = static_cast<int16_t>(lrintf(clampSample(src[i] * 32768.0f + noise, kInt16Min, kInt16Max)));
+    }
+    dither->lanes[0] = state;
+}
+
+
+static void
+quantizeInt32Scalar(void* dst, const float* src, size_t count, DitherState*)
+{
+    int32_t* out = static_cast<int32_t*>(dst);
+    for (size_t i = 0; i < count; i++)
+        out[i] = static_cast<int32_t>(lrintf(clampSample(src[i] * 2147483648.0f, kInt32Min, kInt32Max)));
+}
+
+
+// #pragma mark - SSE2
+
+
+#ifdef AUDIO_SIMD_SSE2
+
+TARGET_SSE2 static inline __m128i
+xorshiftSSE2(__m128i x)
+{
+    x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+    return _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+}
+
+
+TARGET_SSE2 static inline __m128
+ditherNoiseSSE2(__m128i& state)
+{
+    state = xorshiftSSE2(state);
+    __m128i a = _mm_srli_epi32(state, 8);
+    state = xorshiftSSE2(state);
+    __m128i b = _mm_srli_epi32(state, 8);
+    return _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(a, b)), _mm_set1_ps(kDitherScale));
+}
+
+
+TARGET_SSE2 static void
+quantizeInt16SSE2(void* dst, const float* src, size_t count, DitherState* dither)
+{
+    int16_t* out = static_cast<int16_t*>(dst);
+    const __m128 scale = _mm_set1_ps(32768.0f);
+    const __m128 low = _mm_set1_ps(kInt16Min);
+    const __m128 high = _mm_set1_ps(kInt16Max);
+    size_t i = 0;
+
+    if (dither == NULL) {
+        for (; i + 8 <= count; i += 8) {
+            __m128 a = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i), scale), low), high);
+            __m128 b = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i + 4), scale), low), high);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+        }
+        quantizeInt16Scalar(out + i, src + i, count - i, NULL);
+        return;
+    }
+
+    __m128i state = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dither->lanes));
+    for (; i + 8 <= count; i += 8) {
+        __m128 a = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src + i), scale), ditherNoiseSSE2(state));
+        __m128 b = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src + i + 4), scale), ditherNoiseSSE2(state));
+        a = _mm_min_ps(_mm_max_ps(a, low), high);
+        b = _mm_min_ps(_mm_max_ps(b, low), high);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+            _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dither->lanes), state);
+    quantizeInt16Scalar(out + i, src + i, count - i, dither);
+}
+
+
+TARGET_SSE2 static void
+quantizeInt32SSE2(void* dst, const float* src, size_t count, DitherState*)
+{
+    int32_t* out = static_cast<int32_t*>(dst);
+    const __m128 scale = _mm_set1_ps(2147483648.0f);
+    const __m128 low = _mm_set1_ps(kInt32Min);
+    const __m128 high = _mm_set1_ps(kInt32Max);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 x = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src + i), scale), low), high);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_cvtps_epi32(x));
+    }
+    quantizeInt32Scalar(out + i, src + i, count - i, NULL);
+}
+
+#endif // AUDIO_SIMD_SSE2
+
+
+// #pragma mark - NEON
+
+
+// Round-to-nearest conversions only exist on AArch64, 32-bit ARM stays scalar
+#if defined(AUDIO_SIMD_NEON) && defined(__aarch64__)
+#define AUDIO_PCM_NEON 1
+
+static inline uint32x4_t
+xorshiftNEON(uint32x4_t x)
+{
+    x = veorq_u32(x, vshlq_n_u32(x, 13));
+    x = veorq_u32(x, vshrq_n_u32(x, 17));
+    return veorq_u32(x, vshlq_n_u32(x, 5));
+}
+
+
+static inline float32x4_t
+ditherNoiseNEON(uint32x4_t& state)
+{
+    state = xorshiftNEON(state);
+    int32x4_t a = vreinterpretq_s32_u32(vshrq_n_u32(state, 8));
+    state = xorshiftNEON(state);
+    int32x4_t b = vreinterpretq_s32_u32(vshrq_n_u32(state, 8));
+    return vmulq_n_f32(vcvtq_f32_s32(vsubq_s32(a, b)), kDitherScale);
+}
+
+
+static void
+quantizeInt16NEON(void* dst, const float* src, size_t count, DitherState* dither)
+{
+    int16_t* out = static_cast<int16_t*>(dst);
+    const float32x4_t low = vdupq_n_f32(kInt16Min);
+    const float32x4_t high = vdupq_n_f32(kInt16Max);
+    uint32x4_t state = vdupq_n_u32(0);
+    if (dither != NULL)
+        state = vld1q_u32(dither->lanes);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        float32x4_t a = vmulq_n_f32(vld1q_f32(src + i), 32768.0f);
+        float32x4_t b = vmulq_n_f32(vld1q_f32(src + i + 4), 32768.0f);
+        if (dither != NULL) {
+            a = vaddq_f32(a, ditherNoiseNEON(state));
+            b = vaddq_f32(b, ditherNoiseNEON(state));
+        }
+        a = vminq_f32(vmaxq_f32(a, low), high);
+        b = vminq_f32(vmaxq_f32(b, low), high);
+        vst1q_s16(out + i, vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(a)), vqmovn_s32(vcvtnq_s32_f32(b))));
+    }
+
+    if (dither != NULL)
+        vst1q_u32(dither->lanes, state);
+    quantizeInt16Scalar(out + i, src + i, count - i, dither);
+}
+
+
+static void
+quantizeInt32NEON(void* dst, const float* src, size_t count, DitherState*)
+{
+    int32_t* out = static_cast<int32_t*>(dst);
+    const float32x4_t low = vdupq_n_f32(kInt32Min);
+    const float32x4_t high = vdupq_n_f32(kInt32Max);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t x = vmulq_n_f32(vld1q_f32(src + i), 2147483648.0f);
+        vst1q_s32(out + i, vcvtnq_s32_f32(vminq_f32(vmaxq_f32(x, low), high)));
+    }
+    quantizeInt32Scalar(out + i, src + i, count - i, NULL);
+}
+
+#endif // AUDIO_SIMD_NEON && __aarch64__
+
+
+// #pragma mark - Integer frame converters
+
+
+template<typename Sample> struct PCMTraits;
+
+// Everything is widened to the int32 range first, narrowing takes the top bits
+template<> struct PCMTraits<int32_t> {
+    static const SampleType kType = SAMPLE_INT32;
+    static inline int32_t ToInt32(int32_t sample) { return sample; }
+    static inline int32_t FromInt32(int32_t value) { return value; }
+};
+
+template<> struct PCMTraits<int16_t> {
+    static const SampleType kType = SAMPLE_INT16;
+    static inline int32_t ToInt32(int16_t sample) { return sample * 65536; }
+    static inline int16_t FromInt32(int32_t value) { return static_cast<int16_t>(value >> 16); }
+};
+
+template<> struct PCMTraits<int8_t> {
+    static const SampleType kType = SAMPLE_INT8;
+    static inline int32_t ToInt32(int8_t sample) { return sample * 16777216; }
+};
+
+template<> struct PCMTraits<uint8_t> {
+    static const SampleType kType = SAMPLE_UINT8;
+    static inline int32_t ToInt32(uint8_t sample)
+        { return (static_cast<int32_t>(sample) - 128) * 16777216; }
+};
+
+
+// OutChannels is 2 or 0 for every input channel, InChannels == 0 takes the
+// channel count at runtime
+template<typename Input, typename Output, uint32_t InChannels, uint32_t OutChannels>
+struct PCMFrameConverter {
+    static void Convert(void* dst, const void* src, size_t frameCount, uint32_t inputChannels)
+    {
+        const uint32_t stride = InChannels != 0 ? InChannels : inputChannels;
+        const uint32_t outputs = OutChannels != 0 ? OutChannels : stride;
+        const Input* in = static_cast<const Input*>(src);
+        Output* out = static_cast<Output*>(dst);
+        for (size_t i = 0; i < frameCount; i++) {
+            for (uint32_t c = 0; c < outputs; c++) {
+                // Mono input feeds every output channel
+                const Input sample = in[stride == 1 ? 0 : c];
+                out[c] = PCMTraits<Output>::FromInt32(PCMTraits<Input>::ToInt32(sample));
+            }
+            out += outputs;
+            in += stride;
+        }
+    }
+};
+
+
+// Same sample type and layout, nothing to do but copy
+template<typename Sample>
+static void
+copyFrames(void* dst, const void* src, size_t frameCount, uint32_t inputChannels)
+{
+    memcpy(dst, src, frameCount * inputChannels * sizeof(Sample));
+}
+
+
+template<typename Input, typename Output, uint32_t OutChannels>
+static PCMFrameConvertFunc
+pcmFrameConverterFor(uint32_t inputChannels)
+{
+    switch (inputChannels) {
+        case 1: return PCMFrameConverter<Input, Output, 1, OutChannels>::Convert;
+        case 2: return PCMFrameConverter<Input, Output, 2, OutChannels>::Convert;
+        case 4: return PCMFrameConverter<Input, Output, 4, OutChannels>::Convert;
+        case 6: return PCMFrameConverter<Input, Output, 6, OutChannels>::Convert;
+        case 8: return PCMFrameConverter<Input, Output, 8, OutChannels>::Convert;
+        default: return PCMFrameConverter<Input, Output, 0, OutChannels>::Convert;
+    }
+}
+
+
+template<typename Output, uint32_t OutChannels>
+static PCMFrameConvertFunc
+pcmFrameConverterFor(SampleType inputType, uint32_t inputChannels)
+{
+    switch (inputType) {
+        case SAMPLE_INT32: return pcmFrameConverterFor<int32_t, Output, OutChannels>(inputChannels);
+        case SAMPLE_INT16: return pcmFrameConverterFor<int16_t, Output, OutChannels>(inputChannels);
+        case SAMPLE_INT8:  return pcmFrameConverterFor<int8_t, Output, OutChannels>(inputChannels);
+        case SAMPLE_UINT8: return pcmFrameConverterFor<uint8_t, Output, OutChannels>(inputChannels);
+        default:           return NULL;
+    }
+}
+
+
+template<typename Output>
+static PCMFrameConvertFunc
+pcmFrameConverterFor(SampleType inputType, uint32_t inputChannels, uint32_t outputChannels)
+{
+    if (outputChannels == inputChannels) {
+        if (inputType == PCMTraits<Output>::kType)
+            return copyFrames<Output>;
+        return pcmFrameConverterFor<Output, 0>(inputType, inputChannels);
+    }
+    if (outputChannels == 2)
+        return pcmFrameConverterFor<Output, 2>(inputType, inputChannels);
+    return NULL;
+}
+
+
+// #pragma mark - Dispatch
+
+
+QuantizeFunc
+getQuantizer(SampleType outputType, SampleKernelISA isa)
+{
+    if (outputType != SAMPLE_INT16 && outputType != SAMPLE_INT32)
+        return NULL;
+
+    if (isa == SAMPLE_KERNEL_AUTO)
+        isa = bestSampleKernelISA();
+    else if (!isSampleKernelISASupported(isa))
+        return NULL;
+
+    const bool int16 = outputType == SAMPLE_INT16;
+    switch (isa) {
+#ifdef AUDIO_SIMD_SSE2
+        // AVX2 machines use the SSE2 kernels
+        case SAMPLE_KERNEL_AVX2:
+        case SAMPLE_KERNEL_SSE2: return int16 ? quantizeInt16SSE2 : quantizeInt32SSE2;
+#endif
+#ifdef AUDIO_PCM_NEON
+        case SAMPLE_KERNEL_NEON: return int16 ? quantizeInt16NEON : quantizeInt32NEON;
+#endif
+        default:                 return int16 ? quantizeInt16Scalar : quantizeInt32Scalar;
+    }
+}
+
+
+PCMFrameConvertFunc
+getPCMFrameConverter(SampleType inputType, SampleType outputType, uint32_t inputChannels,
+    uint32_t outputChannels)
+{
+    if (inputChannels == 0)
+        return NULL;
+
+    switch (outputType) {
+        case SAMPLE_INT16: return pcmFrameConverterFor<int16_t>(inputType, inputChannels, outputChannels);
+        case SAMPLE_INT32: return pcmFrameConverterFor<int32_t>(inputType, inputChannels, outputChannels);
+        default:           return NULL;
+    }
+}
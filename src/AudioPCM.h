@@ -0,0 +1,44 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef AUDIO_PCM_H
+#define AUDIO_PCM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "AudioConvert.h"
+
+// Integer output paths for AudioCapture: float to int16/int32 quantizers with
+// optional TPDF dither, and converters that take integer device samples to
+// integer output without going through float. No MediaKit dependency.
+
+// Independent xorshift generators, one per SIMD lane
+struct DitherState {
+    uint32_t lanes[4];
+};
+
+void seedDither(DitherState& state, uint32_t seed);
+
+// Converts sampleCount floats in [-1, 1) to SAMPLE_INT16 or SAMPLE_INT32,
+// rounding to nearest and saturating. With a non-NULL dither the int16
+// quantizer adds triangular dither of +-1 LSB first; int32 ignores it since
+// float has no bits below that LSB to begin with.
+typedef void (*QuantizeFunc)(void* dst, const float* src, size_t sampleCount, DitherState* dither);
+
+QuantizeFunc getQuantizer(SampleType outputType, SampleKernelISA isa = SAMPLE_KERNEL_AUTO);
+
+// Converts frameCount interleaved integer device frames straight into
+// integer output frames. Narrowing keeps the top bits, widening shifts up.
+typedef void (*PCMFrameConvertFunc)(void* dst, const void* src, size_t frameCount,
+    uint32_t inputChannels);
+
+// Supports the layouts of getFrameConverter(): stereo from the first two
+// channels or duplicated mono, and the device layout unchanged. Returns NULL
+// for float input, non-integer output or other layouts.
+PCMFrameConvertFunc getPCMFrameConverter(SampleType inputType, SampleType outputType,
+    uint32_t inputChannels, uint32_t outputChannels = 2);
+
+#endif // AUDIO_PCM_H
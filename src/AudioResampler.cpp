@@ -0,0 +1,35 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#include <new>
+
+#include "AudioResampler.h"
+#include "LinearResampler.h"
+#include "SincResampler.h"
+
+
+AudioResampler*
+AudioResampler::Create(ResamplerQuality quality, uint32_t channels,
+    double inputRate, double outputRate)
+{
+    if (!(inputRate > 0.0) || !(outputRate > 0.0))
+        return NULL;
+
+    if (quality == RESAMPLER_LINEAR) {
+        LinearResampler* resampler = new(std::nothrow) LinearResampler();
+        if (resampler != NULL && !resampler->Init(channels, inputRate, outputRate)) {
+            delete resampler;
+            resampler = NULL;
+        }
+        return resampler;
+    }
+
+    SincResampler* resampler = new(std::nothrow) SincResampler();
+    if (resampler != NULL && !resampler->Init(channels, inputRate / outputRate, quality)) {
+        delete resampler;
+        resampler = NULL;
+    }
+    return resampler;
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef AUDIO_RESAMPLER_H
+#define AUDIO_RESAMPLER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum ResamplerQuality {
+    RESAMPLER_LINEAR = 0,
+    RESAMPLER_SINC_FAST,
+    RESAMPLER_SINC_MEDIUM,
+    RESAMPLER_SINC_BEST
+};
+
+// Streaming resampler working on interleaved float frames. State is carried
+// across Process() calls, so a stream can be fed in buffers of any size.
+class AudioResampler {
+public:
+    virtual ~AudioResampler() {}
+
+    virtual void Reset() = 0;
+
+    // Consumes all inFrameCount input frames and writes at most maxOutFrames
+    // output frames. Returns the number of frames written.
+    virtual size_t Process(float* out, size_t maxOutFrames, const float* in,
+        size_t inFrameCount) = 0;
+
+    // Scales the input/output rate ratio by factor to follow a drifting
+    // clock, 1.0 restores the nominal ratio. Cheap enough to call for every
+    // buffer, and kept across Reset().
+    virtual void SetRateAdjustment(double factor) = 0;
+
+    // Upper bound for the output of a Process() call with inFrameCount frames
+    virtual size_t MaxOutputFrames(size_t inFrameCount) const = 0;
+
+    // Input frames the resampler holds back before they affect the output
+    virtual uint32_t Latency() const = 0;
+
+    // Returns NULL if the parameters are invalid or allocation fails
+    static AudioResampler* Create(ResamplerQuality quality, uint32_t channels,
+        double inputRate, double outputRate);
+};
+
+#endif // AUDIO_RESAMPLER_H
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "AudioRingBuffer.h"
+
+
+AudioRingBuffer::AudioRingBuffer()
+    : mBuffer(NULL),
+      mCapacity(0),
+      mFrameSize(0),
+      mWriteIndex(0),
+      mReadIndex(0)
+{
+}
+
+
+AudioRingBuffer::~AudioRingBuffer()
+{
+    free(mBuffer);
+}
+
+
+bool
+AudioRingBuffer::Init(size_t frameCount, size_t frameSize)
+{
+    free(mBuffer);
+    mBuffer = NULL;
+    mCapacity = 0;
+    mFrameSize = 0;
+
+    if (frameCount == 0 || frameSize == 0)
+        return false;
+
+    size_t capacity = 1;
+    while (capacity < frameCount)
+        capacity <<= 1;
+
+    mBuffer = static_cast<uint8_t*>(calloc(capacity, frameSize));
+    if (mBuffer == NULL)
+        return false;
+
+    mCapacity = capacity;
+    mFrameSize = frameSize;
+    Reset();
+    return true;
+}
+
+
+void
+AudioRingBuffer::Reset()
+{
+    mWriteIndex.store(0, std::memory_order_relaxed);
+    mReadIndex.store(0, std::memory_order_relaxed);
+}
+
+
+size_t
+AudioRingBuffer::Space() const
+{
+    return mCapacity - (mWriteIndex.load(std::memory_order_relaxed)
+        - mReadIndex.load(std::memory_order_acquire));
+}
+
+
+size_t
+AudioRingBuffer::Available() const
+{
+    return mWriteIndex.load(std::memory_order_acquire)
+        - mReadIndex.load(std::memory_order_relaxed);
+}
+
+
+size_t
+AudioRingBuffer::Write(const void* frames, size_t frameCount)
+{
+    const size_t writeIndex = mWriteIndex.load(std::memory_order_relaxed);
+    const size_t readIndex = mReadIndex.load(std::memory_order_acquire);
+    const size_t space = mCapacity - (writeIndex - readIndex);
+    if (frameCount > space)
+        frameCount = space;
+    if (frameCount == 0)
+        return 0;
+
+    const size_t offset = writeIndex & (mCapacity - 1);
+    const size_t first = frameCount < mCapacity - offset ? frameCount : mCapacity - offset;
+    const uint8_t* source = static_cast<const uint8_t*>(frames);
+    memcpy(mBuffer + offset * mFrameSize, source, first * mFrameSize);
+    memcpy(mBuffer, source + first * mFrameSize, (frameCount - first) * mFrameSize);
+
+    mWriteIndex.store(writeIndex + frameCount, std::memory_order_release);
+    return frameCount;
+}
+
+
+size_t
+AudioRingBuffer::Read(void* frames, size_t maxFrames)
+{
+    const size_t readIndex = mReadIndex.load(std::memory_order_relaxed);
+    const size_t writeIndex = mWriteIndex.load(std::memory_order_acquire);
+    size_t frameCount = writeIndex - readIndex;
+    if (frameCount > maxFrames)
+        frameCount = maxFrames;
+    if (frameCount == 0)
+        return 0;
+
+    const size_t offset = readIndex & (mCapacity - 1);
+    const size_t first = frameCount < mCapacity - offset ? frameCount : mCapacity - offset;
+    uint8_t* target = static_cast<uint8_t*>(frames);
+    memcpy(target, mBuffer + offset * mFrameSize, first * mFrameSize);
+    memcpy(target + first * mFrameSize, mBuffer, (frameCount - first) * mFrameSize);
+
+    mReadIndex.store(readIndex + frameCount, std::memory_order_release);
+    return frameCount;
+}
+
+
+size_t
+AudioRingBuffer::Discard(size_t maxFrames)
+{
+    const size_t readIndex = mReadIndex.load(std::memory_order_relaxed);
+    const size_t writeIndex = mWriteIndex.load(std::memory_order_acquire);
+    size_t frameCount = writeIndex - readIndex;
+    if (frameCount > maxFrames)
+        frameCount = maxFrames;
+
+    mReadIndex.store(readIndex + frameCount, std::memory_order_release);
+    return frameCount;
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef AUDIO_RING_BUFFER_H
+#define AUDIO_RING_BUFFER_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Lock-free single-producer/single-consumer ring of fixed-size frames. One
+// thread may call Write() while another calls Read(); neither ever blocks or
+// allocates. The capacity is rounded up to a power of two.
+class AudioRingBuffer {
+public:
+    AudioRingBuffer();
+    ~AudioRingBuffer();
+
+    bool Init(size_t frameCount, size_t frameSize);
+    // Not thread safe, only call while neither side is active
+    void Reset();
+
+    // Producer side. Copies as many frames as fit and returns that count.
+    size_t Write(const void* frames, size_t frameCount);
+    size_t Space() const;
+
+    // Consumer side. Copies up to maxFrames frames and returns that count.
+    size_t Read(void* frames, size_t maxFrames);
+    // Drops up to maxFrames frames without copying them, returns that count
+    size_t Discard(size_t maxFrames);
+    size_t Available() const;
+
+    size_t Capacity() const { return mCapacity; }
+    size_t FrameSize() const { return mFrameSize; }
+
+    AudioRingBuffer(const AudioRingBuffer&) = delete;
+    AudioRingBuffer& operator=(const AudioRingBuffer&) = delete;
+
+private:
+    uint8_t*            mBuffer;
+    size_t              mCapacity;
+    size_t              mFrameSize;
+
+    // Free-running frame counters, wrapped with the power-of-two mask. Kept
+    // on separate cache lines so both sides don't bounce one line.
+    alignas(64) std::atomic<size_t> mWriteIndex;
+    alignas(64) std::atomic<size_t> mReadIndex;
+};
+
+#endif // AUDIO_RING_BUFFER_H
@@ -0,0 +1,33 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef AUDIO_SIMD_H
+#define AUDIO_SIMD_H
+
+// Private to the library sources: decides which SIMD code paths get compiled.
+// AVX2 code is always built on x86 with GCC-compatible compilers and only
+// selected at runtime, see isSampleKernelISASupported().
+
+#if defined(__x86_64__) || defined(__i386__)
+#define AUDIO_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define AUDIO_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(AUDIO_SIMD_X86) && defined(__GNUC__)
+#define AUDIO_SIMD_AVX2 1
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#if defined(__SSE2__) || defined(AUDIO_SIMD_AVX2)
+#define AUDIO_SIMD_SSE2 1
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#endif
+
+#endif // AUDIO_SIMD_H
@@ -0,0 +1,261 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "LinearResampler.h"
+
+static const uint64_t kPhaseOne = 1ULL << 32;
+// The weight uses the top 24 fractional bits, which is all a float can hold
+// and keeps the conversion a signed one
+static const float kWeightScale = 1.0f / 16777216.0f;
+
+
+template<typename Sample>
+struct LinearBlend;
+
+template<>
+struct LinearBlend<float> {
+    typedef float Weight;
+
+    static inline float
+    weight(uint64_t phase)
+    {
+        return static_cast<int32_t>(static_cast<uint32_t>(phase) >> 8) * kWeightScale;
+    }
+
+    static inline float
+    blend(float a, float b, float weight)
+    {
+        return a + (b - a) * weight;
+    }
+};
+
+// 15 weight bits keep (b - a) * weight inside int32 for any int16 pair, and
+// the result always lies between a and b, so it can't overflow int16
+template<>
+struct LinearBlend<int16_t> {
+    typedef int32_t Weight;
+
+    static inline int32_t
+    weight(uint64_t phase)
+    {
+        return static_cast<int32_t>(static_cast<uint32_t>(phase) >> 17);
+    }
+
+    static inline int16_t
+    blend(int16_t a, int16_t b, int32_t weight)
+    {
+        return static_cast<int16_t>(a + (((b - a) * weight + (1 << 14)) >> 15));
+    }
+};
+
+
+LinearResampler::LinearResampler()
+    : mChannels(0),
+      mPhase(kPhaseOne),
+      mStep(kPhaseOne),
+      mStepRemainder(0),
+      mStepDenominator(1),
+      mRemainderAccumulator(0),
+      mNominalStep(kPhaseOne),
+      mNominalStepRemainder(0),
+      mNominalStepDenominator(1),
+      mHistory(NULL)
+{
+}
+
+
+LinearResampler::~LinearResampler()
+{
+    free(mHistory);
+}
+
+
+bool
+LinearResampler::Init(uint32_t channels, double inputRate, double outputRate)
+{
+    free(mHistory);
+    mHistory = NULL;
+    mChannels = 0;
+
+    if (channels == 0 || !(inputRate > 0.0) || !(outputRate > 0.0))
+        return false;
+
+    if (inputRate == floor(inputRate) && outputRate == floor(outputRate)
+        && inputRate < 2147483648.0 && outputRate < 2147483648.0) {
+        const uint64_t numerator = static_cast<uint64_t>(inputRate) << 32;
+        const uint64_t denominator = static_cast<uint64_t>(outputRate);
+        mStep = numerator / denominator;
+        mStepRemainder = numerator % denominator;
+        mStepDenominator = denominator;
+    } else {
+        mStep = static_cast<uint64_t>(inputRate / outputRate * kPhaseOne + 0.5);
+        mStepRemainder = 0;
+        mStepDenominator = 1;
+    }
+
+    if (mStep == 0)
+        return false;
+
+    mNominalStep = mStep;
+    mNominalStepRemainder = mStepRemainder;
+    mNominalStepDenominator = mStepDenominator;
+
+    mHistory = calloc(channels, sizeof(float));
+    if (mHistory == NULL)
+        return false;
+
+    mChannels = channels;
+    Reset();
+    return true;
+}
+
+
+void
+LinearResampler::Reset()
+{
+    // Interpolation index 1 is the first frame of the next buffer
+    mPhase = kPhaseOne;
+    mRemainderAccumulator = 0;
+    if (mHistory != NULL)
+        memset(mHistory, 0, mChannels * sizeof(float));
+}
+
+
+void
+LinearResampler::SetRateAdjustment(double factor)
+{
+    if (!(factor > 0.0))
+        return;
+
+    mRemainderAccumulator = 0;
+    if (factor == 1.0) {
+        mStep = mNominalStep;
+        mStepRemainder = mNominalStepRemainder;
+        mStepDenominator = mNominalStepDenominator;
+        return;
+    }
+
+    const double nominal = mNominalStep
+        + static_cast<double>(mNominalStepRemainder) / mNominalStepDenominator;
+    const uint64_t step = static_cast<uint64_t>(nominal * factor + 0.5);
+    if (step == 0)
+        return;
+
+    mStep = step;
+    mStepRemainder = 0;
+    mStepDenominator = 1;
+}
+
+
+size_t
+LinearResampler::MaxOutputFrames(size_t inFrameCount) const
+{
+    return static_cast<size_t>((static_cast<uint64_t>(inFrameCount) << 32) / mStep) + 2;
+}
+
+
+size_t
+LinearResampler::Process(float* out, size_t maxOutFrames, const float* in, size_t inFrameCount)
+{
+    if (mHistory == NULL || inFrameCount == 0)
+        return 0;
+
+    switch (mChannels) {
+        case 1:  return interpolate<float, 1>(out, maxOutFrames, in, inFrameCount);
+        case 2:  return interpolate<float, 2>(out, maxOutFrames, in, inFrameCount);
+        default: return interpolate<float, 0>(out, maxOutFrames, in, inFrameCount);
+    }
+}
+
+
+size_t
+LinearResampler::Process(int16_t* out, size_t maxOutFrames, const int16_t* in,
+    size_t inFrameCount)
+{
+    if (mHistory == NULL || inFrameCount == 0)
+        return 0;
+
+    switch (mChannels) {
+        case 1:  return interpolate<int16_t, 1>(out, maxOutFrames, in, inFrameCount);
+        case 2:  return interpolate<int16_t, 2>(out, maxOutFrames, in, inFrameCount);
+        default: return interpolate<int16_t, 0>(out, maxOutFrames, in, inFrameCount);
+    }
+}
+
+
+// Channels == 0 uses the runtime channel count
+template<typename Sample, uint32_t Channels>
+size_t
+LinearResampler::interpolate(Sample* out, size_t maxOutFrames, const Sample* in,
+    size_t inFrameCount)
+{
+    typedef LinearBlend<Sample> Blend;
+    const uint32_t channels = Channels != 0 ? Channels : mChannels;
+    Sample* history = static_cast<Sample*>(mHistory);
+    // Interpolation index i blends input frames i - 1 and i, where frame -1
+    // is the history. Every index below inFrameCount can be produced.
+    const uint64_t limit = static_cast<uint64_t>(inFrameCount) << 32;
+    const uint64_t step = mStep;
+    const uint64_t remainder = mStepRemainder;
+    const uint64_t denominator = mStepDenominator;
+    uint64_t phase = mPhase;
+    uint64_t accumulator = mRemainderAccumulator;
+    size_t produced = 0;
+
+    // Outputs between the previous buffer and this one
+    while (produced < maxOutFrames && phase < kPhaseOne) {
+        const typename Blend::Weight weight = Blend::weight(phase);
+        for (uint32_t c = 0; c < channels; c++)
+            out[c] = Blend::blend(history[c], in[c], weight);
+        out += channels;
+        produced++;
+
+        phase += step;
+        accumulator += remainder;
+        if (accumulator >= denominator) {
+            accumulator -= denominator;
+            phase++;
+        }
+    }
+
+    // Steady state in blocks that are known to stay inside the buffer, so the
+    // inner loop needs no bounds check
+    const Sample* base = in - channels;
+    while (produced < maxOutFrames && phase < limit) {
+        size_t block = static_cast<size_t>((limit - 1 - phase) / (step + 1)) + 1;
+        if (block > maxOutFrames - produced)
+            block = maxOutFrames - produced;
+
+        for (size_t i = 0; i < block; i++) {
+            const Sample* a = base + (phase >> 32) * channels;
+            const Sample* b = a + channels;
+            const typename Blend::Weight weight = Blend::weight(phase);
+            for (uint32_t c = 0; c < channels; c++)
+                out[c] = Blend::blend(a[c], b[c], weight);
+            out += channels;
+
+            phase += step;
+            accumulator += remainder;
+            if (accumulator >= denominator) {
+                accumulator -= denominator;
+                phase++;
+            }
+        }
+        produced += block;
+    }
+
+    // Output space ran out: drop the rest rather than fall behind
+    if (phase < limit)
+        phase = limit;
+
+    mPhase = phase - limit;
+    mRemainderAccumulator = accumulator;
+    memcpy(history, in + (inFrameCount - 1) * channels, channels * sizeof(Sample));
+    return produced;
+}
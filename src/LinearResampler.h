@@ -0,0 +1,67 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef LINEAR_RESAMPLER_H
+#define LINEAR_RESAMPLER_H
+
+#include "AudioResampler.h"
+
+// Two-tap linear interpolator driven by a 32.32 fixed-point phase
+// accumulator. The upper 32 bits index the input frame, the lower 32 bits
+// are the interpolation weight. For integer sample rates the step error is
+// carried in a remainder term, so the position stays exact indefinitely
+// instead of drifting with repeated floating-point additions.
+class LinearResampler : public AudioResampler {
+public:
+    LinearResampler();
+    virtual ~LinearResampler();
+
+    bool Init(uint32_t channels, double inputRate, double outputRate);
+
+    virtual void Reset();
+    virtual size_t Process(float* out, size_t maxOutFrames, const float* in,
+        size_t inFrameCount);
+    // Integer path for int16 streams: the weight is the top 15 fraction bits
+    // and the blend is done in 32-bit integer arithmetic. Shares the phase
+    // state with the float overload, so a stream must stick to one of them
+    // between Reset() calls.
+    size_t Process(int16_t* out, size_t maxOutFrames, const int16_t* in,
+        size_t inFrameCount);
+    virtual void SetRateAdjustment(double factor);
+    virtual size_t MaxOutputFrames(size_t inFrameCount) const;
+    virtual uint32_t Latency() const { return 1; }
+
+    uint32_t Channels() const { return mChannels; }
+    // Position of the next output frame relative to the last frame of the
+    // previous buffer, in 32.32 fixed point
+    uint64_t Phase() const { return mPhase; }
+
+    LinearResampler(const LinearResampler&) = delete;
+    LinearResampler& operator=(const LinearResampler&) = delete;
+
+private:
+    template<typename Sample, uint32_t Channels>
+    size_t interpolate(Sample* out, size_t maxOutFrames, const Sample* in,
+        size_t inFrameCount);
+
+    uint32_t        mChannels;
+
+    uint64_t        mPhase;
+    uint64_t        mStep;
+    // Exact rational stepping: the true step is mStep + mStepRemainder / mStepDenominator
+    uint64_t        mStepRemainder;
+    uint64_t        mStepDenominator;
+    uint64_t        mRemainderAccumulator;
+    // Step for the nominal rates, an adjusted step drops the exact remainder
+    uint64_t        mNominalStep;
+    uint64_t        mNominalStepRemainder;
+    uint64_t        mNominalStepDenominator;
+
+    // Last input frame of the previous buffer, interpolation index 0. Sized
+    // for float, the int16 path uses the front of it.
+    void*           mHistory;
+};
+
+#endif // LINEAR_RESAMPLER_H
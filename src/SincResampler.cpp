@@ -0,0 +1,391 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "AudioConvert.h"
+#include "AudioSimd.h"
+#include "SincResampler.h"
+
+// Frames of input buffered per channel on top of the filter length
+static const size_t kBlockFrames = 1024;
+// Keeps the coefficient table within a few hundred KB for large ratios
+static const size_t kMaxCoefficients = 65536;
+static const uint32_t kMaxTaps = 1024;
+
+struct SincPreset {
+    uint32_t taps;
+    uint32_t phases;
+    double   rolloff;
+    double   beta;
+};
+
+static const SincPreset kSincPresets[] = {
+    { 16, 128, 0.90, 6.0 },     // RESAMPLER_SINC_FAST
+    { 32, 256, 0.93, 8.0 },     // RESAMPLER_SINC_MEDIUM
+    { 64, 512, 0.95, 10.0 }     // RESAMPLER_SINC_BEST
+};
+
+
+// #pragma mark - Dot products
+
+
+// Every kernel computes two dot products of x against adjacent coefficient
+// rows, sharing the loads of x. taps is always a multiple of 8.
+
+static void
+dotProductScalar(const float* x, const float* h0, const float* h1, size_t taps,
+    float* d0, float* d1)
+{
+    float sum0 = 0.0f, sum1 = 0.0f;
+    for (size_t i = 0; i < taps; i++) {
+        sum0 += x[i] * h0[i];
+        sum1 += x[i] * h1[i];
+    }
+    *d0 = sum0;
+    *d1 = sum1;
+}
+
+
+#ifdef AUDIO_SIMD_SSE2
+
+TARGET_SSE2 static inline float
+horizontalSumSSE2(__m128 v)
+{
+    __m128 shuffled = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 sums = _mm_add_ps(v, shuffled);
+    shuffled = _mm_movehl_ps(shuffled, sums);
+    return _mm_cvtss_f32(_mm_add_ss(sums, shuffled));
+}
+
+
+TARGET_SSE2 static void
+dotProductSSE2(const float* x, const float* h0, const float* h1, size_t taps,
+    float* d0, float* d1)
+{
+    __m128 sum0 = _mm_setzero_ps();
+    __m128 sum1 = _mm_setzero_ps();
+    for (size_t i = 0; i < taps; i += 4) {
+        __m128 v = _mm_loadu_ps(x + i);
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(v, _mm_loadu_ps(h0 + i)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(v, _mm_loadu_ps(h1 + i)));
+    }
+    *d0 = horizontalSumSSE2(sum0);
+    *d1 = horizontalSumSSE2(sum1);
+}
+
+#endif // AUDIO_SIMD_SSE2
+
+
+#ifdef AUDIO_SIMD_AVX2
+
+TARGET_AVX2 static void
+dotProductAVX2(const float* x, const float* h0, const float* h1, size_t taps,
+    float* d0, float* d1)
+{
+    __m256 sum0 = _mm256_setzero_ps();
+    __m256 sum1 = _mm256_setzero_ps();
+    for (size_t i = 0; i < taps; i += 8) {
+        __m256 v = _mm256_loadu_ps(x + i);
+        sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(v, _mm256_loadu_ps(h0 + i)));
+        sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(v, _mm256_loadu_ps(h1 + i)));
+    }
+    __m128 lo0 = _mm_add_ps(_mm256_castps256_ps128(sum0), _mm256_extractf128_ps(sum0, 1));
+    __m128 lo1 = _mm_add_ps(_mm256_castps256_ps128(sum1), _mm256_extractf128_ps(sum1, 1));
+    lo0 = _mm_add_ps(lo0, _mm_movehl_ps(lo0, lo0));
+    lo1 = _mm_add_ps(lo1, _mm_movehl_ps(lo1, lo1));
+    *d0 = _mm_cvtss_f32(_mm_add_ss(lo0, _mm_shuffle_ps(lo0, lo0, 1)));
+    *d1 = _mm_cvtss_f32(_mm_add_ss(lo1, _mm_shuffle_ps(lo1, lo1, 1)));
+}
+
+#endif // AUDIO_SIMD_AVX2
+
+
+#ifdef AUDIO_SIMD_NEON
+
+static void
+dotProductNEON(const float* x, const float* h0, const float* h1, size_t taps,
+    float* d0, float* d1)
+{
+    float32x4_t sum0 = vdupq_n_f32(0.0f);
+    float32x4_t sum1 = vdupq_n_f32(0.0f);
+    for (size_t i = 0; i < taps; i += 4) {
+        float32x4_t v = vld1q_f32(x + i);
+        sum0 = vmlaq_f32(sum0, v, vld1q_f32(h0 + i));
+        sum1 = vmlaq_f32(sum1, v, vld1q_f32(h1 + i));
+    }
+    float32x2_t pair0 = vadd_f32(vget_low_f32(sum0), vget_high_f32(sum0));
+    float32x2_t pair1 = vadd_f32(vget_low_f32(sum1), vget_high_f32(sum1));
+    *d0 = vget_lane_f32(vpadd_f32(pair0, pair0), 0);
+    *d1 = vget_lane_f32(vpadd_f32(pair1, pair1), 0);
+}
+
+#endif // AUDIO_SIMD_NEON
+
+
+static SincResampler::DotProductFunc
+selectDotProduct()
+{
+    switch (bestSampleKernelISA()) {
+#ifdef AUDIO_SIMD_AVX2
+        case SAMPLE_KERNEL_AVX2: return dotProductAVX2;
+#endif
+#ifdef AUDIO_SIMD_SSE2
+        case SAMPLE_KERNEL_SSE2: return dotProductSSE2;
+#endif
+#ifdef AUDIO_SIMD_NEON
+        case SAMPLE_KERNEL_NEON: return dotProductNEON;
+#endif
+        default:                 return dotProductScalar;
+    }
+}
+
+
+// Zeroth order modified Bessel function of the first kind, for the window
+static double
+besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    const double halfX = x / 2.0;
+    for (int k = 1; k < 64; k++) {
+        term *= (halfX / k) * (halfX / k);
+        sum += term;
+        if (term < sum * 1e-12)
+            break;
+    }
+    return sum;
+}
+
+
+// #pragma mark - SincResampler
+
+
+SincResampler::SincResampler()
+    : mChannels(0),
+      mRatio(1.0),
+      mNominalRatio(1.0),
+      mTaps(0),
+      mPhases(0),
+      mCoefficients(NULL),
+      mHistory(NULL),
+      mHistoryLength(0),
+      mFill(0),
+      mIndex(0),
+      mFraction(0.0),
+      mStep(1),
+      mStepFraction(0.0),
+      mDotProduct(dotProductScalar)
+{
+}
+
+
+SincResampler::~SincResampler()
+{
+    cleanup();
+}
+
+
+void
+SincResampler::cleanup()
+{
+    free(mCoefficients);
+    mCoefficients = NULL;
+    free(mHistory);
+    mHistory = NULL;
+    mChannels = 0;
+}
+
+
+bool
+SincResampler::Init(uint32_t channels, double ratio, ResamplerQuality quality)
+{
+    cleanup();
+
+    if (channels == 0 || !(ratio > 0.0) || quality < RESAMPLER_SINC_FAST
+        || quality > RESAMPLER_SINC_BEST) {
+        return false;
+    }
+
+    const SincPreset& preset = kSincPresets[quality - RESAMPLER_SINC_FAST];
+
+    // Downsampling stretches the kernel so the transition band keeps its
+    // width relative to the output rate
+    const double scale = ratio > 1.0 ? 1.0 / ratio : 1.0;
+    uint32_t taps = static_cast<uint32_t>(ceil(preset.taps / scale));
+    taps = (taps + 7) & ~7u;
+    if (taps > kMaxTaps)
+        taps = kMaxTaps;
+
+    uint32_t phases = preset.phases;
+    while (phases > 16 && static_cast<size_t>(phases + 1) * taps > kMaxCoefficients)
+        phases /= 2;
+
+    mChannels = channels;
+    mRatio = ratio;
+    mNominalRatio = ratio;
+    mTaps = taps;
+    mPhases = phases;
+    mStep = static_cast<size_t>(ratio);
+    mStepFraction = ratio - mStep;
+    mHistoryLength = mTaps + kBlockFrames;
+
+    mCoefficients = static_cast<float*>(malloc(sizeof(float) * (mPhases + 1) * mTaps));
+    mHistory = static_cast<float*>(malloc(sizeof(float) * mHistoryLength * mChannels));
+    if (mCoefficients == NULL || mHistory == NULL) {
+        cleanup();
+        return false;
+    }
+
+    buildCoefficients(0.5 * preset.rolloff * scale, preset.beta);
+    mDotProduct = selectDotProduct();
+    Reset();
+    return true;
+}
+
+
+void
+SincResampler::buildCoefficients(double cutoff, double beta)
+{
+    const int half = mTaps / 2;
+    const double windowNorm = besselI0(beta);
+
+    for (uint32_t p = 0; p <= mPhases; p++) {
+        float* row = mCoefficients + p * mTaps;
+        const double fraction = static_cast<double>(p) / mPhases;
+        double sum = 0.0;
+        for (uint32_t k = 0; k < mTaps; k++) {
+            // Distance in input frames between the output position and tap k
+            const double t = fraction + half - 1 - static_cast<int>(k);
+            const double x = t / half;
+            double window = 0.0;
+            if (fabs(x) < 1.0)
+                window = besselI0(beta * sqrt(1.0 - x * x)) / windowNorm;
+            const double arg = 2.0 * cutoff * t;
+            const double sinc = fabs(arg) < 1e-9 ? 1.0 : sin(M_PI * arg) / (M_PI * arg);
+            const double value = 2.0 * cutoff * sinc * window;
+            row[k] = static_cast<float>(value);
+            sum += value;
+        }
+        // Unity gain at DC for every phase
+        for (uint32_t k = 0; k < mTaps && sum != 0.0; k++)
+            row[k] = static_cast<float>(row[k] / sum);
+    }
+}
+
+
+void
+SincResampler::Reset()
+{
+    if (mHistory == NULL)
+        return;
+
+    memset(mHistory, 0, sizeof(float) * mHistoryLength * mChannels);
+    // Pre-roll with silence so the first output lines up with input frame 0
+    mFill = mTaps / 2 - 1;
+    mIndex = 0;
+    mFraction = 0.0;
+}
+
+
+void
+SincResampler::SetRateAdjustment(double factor)
+{
+    if (!(factor > 0.0))
+        return;
+
+    // Small trims only, the cutoff stays where Init() put it
+    mRatio = mNominalRatio * factor;
+    mStep = static_cast<size_t>(mRatio);
+    mStepFraction = mRatio - mStep;
+}
+
+
+size_t
+SincResampler::MaxOutputFrames(size_t inFrameCount) const
+{
+    return static_cast<size_t>((mFill + inFrameCount) / mRatio) + 2;
+}
+
+
+size_t
+SincResampler::Process(float* out, size_t maxOutFrames, const float* in, size_t inFrameCount)
+{
+    size_t produced = 0;
+    if (mHistory == NULL)
+        return 0;
+
+    while (inFrameCount > 0) {
+        const size_t room = mHistoryLength - mFill;
+        const size_t count = room < inFrameCount ? room : inFrameCount;
+        if (count == 0)
+            break;
+
+        // Deinterleave into the per-channel history
+        for (uint32_t c = 0; c < mChannels; c++) {
+            float* history = mHistory + c * mHistoryLength + mFill;
+            const float* src = in + c;
+            for (size_t i = 0; i < count; i++, src += mChannels)
+                history[i] = *src;
+        }
+        mFill += count;
+        in += count * mChannels;
+        inFrameCount -= count;
+
+        produced += drain(out + produced * mChannels, maxOutFrames - produced);
+        compact();
+    }
+
+    return produced;
+}
+
+
+size_t
+SincResampler::drain(float* out, size_t maxOutFrames)
+{
+    size_t produced = 0;
+    while (mIndex + mTaps <= mFill && produced < maxOutFrames) {
+        const double phase = mFraction * mPhases;
+        const uint32_t row = static_cast<uint32_t>(phase);
+        const float blend = static_cast<float>(phase - row);
+        const float* h0 = mCoefficients + row * mTaps;
+        const float* h1 = h0 + mTaps;
+
+        for (uint32_t c = 0; c < mChannels; c++) {
+            float d0, d1;
+            mDotProduct(mHistory + c * mHistoryLength + mIndex, h0, h1, mTaps, &d0, &d1);
+            out[c] = d0 + (d1 - d0) * blend;
+        }
+        out += mChannels;
+        produced++;
+
+        mIndex += mStep;
+        mFraction += mStepFraction;
+        if (mFraction >= 1.0) {
+            mFraction -= 1.0;
+            mIndex++;
+        }
+    }
+    return produced;
+}
+
+
+void
+SincResampler::compact()
+{
+    const size_t shift = mIndex < mFill ? mIndex : mFill;
+    if (shift == 0)
+        return;
+
+    const size_t keep = mFill - shift;
+    for (uint32_t c = 0; c < mChannels; c++) {
+        float* history = mHistory + c * mHistoryLength;
+        memmove(history, history + shift, keep * sizeof(float));
+    }
+    mFill = keep;
+    mIndex -= shift;
+}
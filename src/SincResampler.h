@@ -0,0 +1,70 @@
+/*
+ * Copyright 2025, Gerasim Troeglazov, 3dEyes@gmail.com
+ * Distributed under the terms of the MIT License.
+ */
+
+#ifndef SINC_RESAMPLER_H
+#define SINC_RESAMPLER_H
+
+#include "AudioResampler.h"
+
+// Streaming polyphase FIR resampler with a Kaiser-windowed sinc kernel.
+// Coefficients are precomputed for a fixed set of phases, outputs between two
+// phases blend the results of both rows. When downsampling, the cutoff and
+// the filter length follow the output rate, so nothing above the new Nyquist
+// frequency aliases back.
+class SincResampler : public AudioResampler {
+public:
+    SincResampler();
+    virtual ~SincResampler();
+
+    // ratio is input rate / output rate. Allocates everything the resampler
+    // needs, Process() never touches the allocator afterwards.
+    bool Init(uint32_t channels, double ratio, ResamplerQuality quality);
+
+    virtual void Reset();
+    virtual size_t Process(float* out, size_t maxOutFrames, const float* in,
+        size_t inFrameCount);
+    virtual void SetRateAdjustment(double factor);
+    virtual size_t MaxOutputFrames(size_t inFrameCount) const;
+    // Input frames the filter looks ahead of the current output position
+    virtual uint32_t Latency() const { return mTaps / 2; }
+
+    uint32_t Channels() const { return mChannels; }
+    double Ratio() const { return mRatio; }
+    uint32_t Taps() const { return mTaps; }
+    uint32_t Phases() const { return mPhases; }
+
+    SincResampler(const SincResampler&) = delete;
+    SincResampler& operator=(const SincResampler&) = delete;
+
+    typedef void (*DotProductFunc)(const float* x, const float* h0, const float* h1,
+        size_t taps, float* d0, float* d1);
+
+private:
+    void cleanup();
+    void buildCoefficients(double cutoff, double beta);
+    size_t drain(float* out, size_t maxOutFrames);
+    void compact();
+
+    uint32_t        mChannels;
+    double          mRatio;
+    // Ratio given to Init(), the filter is designed for it
+    double          mNominalRatio;
+    uint32_t        mTaps;
+    uint32_t        mPhases;
+
+    float*          mCoefficients;
+    float*          mHistory;
+    size_t          mHistoryLength;
+    size_t          mFill;
+    size_t          mIndex;
+    double          mFraction;
+
+    size_t          mStep;
+    double          mStepFraction;
+
+    DotProductFunc  mDotProduct;
+};
+
+#endif // SINC_RESAMPLER_H